@@ -370,7 +370,7 @@ endif(BUILD_PYTHON)
 if(BUILD_CPP_API)
   file(GLOB_RECURSE of_cpp_api_files ${PROJECT_SOURCE_DIR}/oneflow/api/cpp/*.cpp
        ${PROJECT_SOURCE_DIR}/oneflow/api/cpp/*.h)
-  list(FILTER of_cpp_api_files EXCLUDE REGEX "oneflow/api/cpp/tests")
+  list(FILTER of_cpp_api_files EXCLUDE REGEX "oneflow/api/cpp/(tests|benchmarks)")
   oneflow_add_library(oneflow_cpp SHARED ${of_cpp_api_files})
   set_target_properties(oneflow_cpp PROPERTIES ARCHIVE_OUTPUT_DIRECTORY "${LIBONEFLOW_LIBRARY_DIR}"
                                                LIBRARY_OUTPUT_DIRECTORY "${LIBONEFLOW_LIBRARY_DIR}")
@@ -414,6 +414,12 @@ if(BUILD_TESTING)
     find_package(Threads REQUIRED)
     target_link_libraries(oneflow_cpp_api_testexe oneflow_cpp ${oneflow_third_party_libs}
                           ${oneflow_test_libs} Threads::Threads)
+
+    oneflow_add_executable(oneflow_cpp_api_batching_benchmark
+                           ${PROJECT_SOURCE_DIR}/oneflow/api/cpp/benchmarks/batching_benchmark.cpp)
+    set_target_properties(oneflow_cpp_api_batching_benchmark
+                          PROPERTIES RUNTIME_OUTPUT_DIRECTORY "${PROJECT_BINARY_DIR}/bin")
+    target_link_libraries(oneflow_cpp_api_batching_benchmark oneflow_cpp Threads::Threads)
   endif()
 endif()
 
@@ -497,7 +503,8 @@ if(BUILD_CPP_API)
     DESTINATION include/oneflow
     FILES_MATCHING
     PATTERN "*.h"
-    PATTERN "tests" EXCLUDE)
+    PATTERN "tests" EXCLUDE
+    PATTERN "benchmarks" EXCLUDE)
   set(LIBONEFLOW_THIRD_PARTY_DIRS)
   checkdirandappendslash(DIR ${PROTOBUF_LIBRARY_DIR} OUTPUT PROTOBUF_LIBRARY_DIR_APPENDED)
   list(APPEND LIBONEFLOW_THIRD_PARTY_DIRS ${PROTOBUF_LIBRARY_DIR_APPENDED})
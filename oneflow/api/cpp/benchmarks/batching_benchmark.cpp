@@ -0,0 +1,219 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Open-loop load generator for DynamicBatcher. For every offered rate it sends requests at fixed
+// intervals and prints the achieved throughput against the latency percentiles, e.g.
+//
+//   oneflow_cpp_api_batching_benchmark --model=<path> --in_features=3 --qps=500,1000,2000
+//
+// Latencies are measured from the scheduled send time, so a stalled sender does not hide the
+// queueing it causes.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "oneflow/api/cpp/api.h"
+
+namespace oneflow_api {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkOptions {
+  std::string model_path = "./oneflow/api/cpp/tests/graph_test_model/affine_with_parameter";
+  std::string device = "cpu";
+  int64_t in_features = 3;
+  int64_t rows = 1;
+  double seconds = 2;
+  std::vector<double> qps{100, 500, 1000, 2000, 5000};
+  BatchingOptions batching;
+};
+
+template<typename T>
+std::vector<T> ParseList(const std::string& value) {
+  std::vector<T> list;
+  std::stringstream stream(value);
+  std::string item;
+  while (std::getline(stream, item, ',')) { list.emplace_back(static_cast<T>(std::stod(item))); }
+  return list;
+}
+
+bool ParseArgs(int argc, char** argv, BenchmarkOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const size_t pos = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 || pos == std::string::npos) { return false; }
+    const std::string key = arg.substr(2, pos - 2);
+    const std::string value = arg.substr(pos + 1);
+    if (key == "model") {
+      options->model_path = value;
+    } else if (key == "device") {
+      options->device = value;
+    } else if (key == "in_features") {
+      options->in_features = std::stoll(value);
+    } else if (key == "rows") {
+      options->rows = std::stoll(value);
+    } else if (key == "seconds") {
+      options->seconds = std::stod(value);
+    } else if (key == "qps") {
+      options->qps = ParseList<double>(value);
+    } else if (key == "batch_sizes") {
+      options->batching.batch_sizes = ParseList<int>(value);
+    } else if (key == "max_queue_delay_us") {
+      options->batching.max_queue_delay_us = std::stoll(value);
+    } else if (key == "num_workers") {
+      options->batching.num_workers = std::stoi(value);
+    } else {
+      return false;
+    }
+  }
+  return !options->qps.empty() && options->rows > 0 && options->seconds > 0;
+}
+
+std::vector<Tensor> MakeInputs(const BenchmarkOptions& options, const Device& device) {
+  std::vector<float> data(options.rows * options.in_features, 1);
+  std::vector<Tensor> inputs;
+  inputs.emplace_back(Tensor::from_buffer(data.data(), Shape({options.rows, options.in_features}),
+                                          device, DType::kFloat));
+  return inputs;
+}
+
+struct Pending {
+  Clock::time_point scheduled_time;
+  std::future<std::vector<Tensor>> future;
+};
+
+// Waits for the requests in send order and records their latencies in microseconds.
+class LatencyCollector final {
+ public:
+  LatencyCollector() : done_(false), thread_(&LatencyCollector::Loop, this) {}
+
+  void Add(Pending pending) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_.emplace_back(std::move(pending));
+    }
+    cond_.notify_one();
+  }
+
+  std::vector<double> Finish() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+    }
+    cond_.notify_one();
+    thread_.join();
+    return latencies_us_;
+  }
+
+ private:
+  void Loop() {
+    while (true) {
+      Pending pending;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this]() { return done_ || !pending_.empty(); });
+        if (pending_.empty()) { break; }
+        pending = std::move(pending_.front());
+        pending_.pop_front();
+      }
+      pending.future.get();
+      latencies_us_.emplace_back(
+          std::chrono::duration<double, std::micro>(Clock::now() - pending.scheduled_time)
+              .count());
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<Pending> pending_;
+  bool done_;
+  std::vector<double> latencies_us_;
+  std::thread thread_;
+};
+
+double Percentile(const std::vector<double>& sorted, double q) {
+  if (sorted.empty()) { return 0; }
+  const size_t index = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+  return sorted.at(std::min(index, sorted.size() - 1));
+}
+
+void RunRate(const BenchmarkOptions& options, const Device& device, double qps) {
+  DynamicBatcher batcher(options.model_path, device, options.batching);
+  const std::vector<Tensor> inputs = MakeInputs(options, device);
+  // Loads the graph before the clock starts.
+  batcher.Enqueue(inputs).get();
+  const BatchingStats warmup_stats = batcher.GetStats();
+
+  const auto period = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / qps));
+  const int64_t num_requests = std::max<int64_t>(static_cast<int64_t>(qps * options.seconds), 1);
+  LatencyCollector collector;
+  const auto start_time = Clock::now();
+  for (int64_t i = 0; i < num_requests; ++i) {
+    Pending pending;
+    pending.scheduled_time = start_time + i * period;
+    std::this_thread::sleep_until(pending.scheduled_time);
+    pending.future = batcher.Enqueue(inputs);
+    collector.Add(std::move(pending));
+  }
+  std::vector<double> latencies_us = collector.Finish();
+  const double elapsed_s = std::chrono::duration<double>(Clock::now() - start_time).count();
+  std::sort(latencies_us.begin(), latencies_us.end());
+
+  const BatchingStats stats = batcher.GetStats();
+  const int64_t num_batches = stats.num_batches - warmup_stats.num_batches;
+  const double batch_fill_sum = stats.batch_fill.sum() - warmup_stats.batch_fill.sum();
+  std::printf("%12.0f %16.1f %12.1f %12.1f %12.1f %12.3f\n", qps, num_requests / elapsed_s,
+              Percentile(latencies_us, 0.5), Percentile(latencies_us, 0.99),
+              latencies_us.back(), num_batches > 0 ? batch_fill_sum / num_batches : 0.0);
+  std::fflush(stdout);
+}
+
+}  // namespace
+
+}  // namespace oneflow_api
+
+int main(int argc, char** argv) {
+  oneflow_api::BenchmarkOptions options;
+  if (!oneflow_api::ParseArgs(argc, argv, &options)) {
+    std::fprintf(stderr,
+                 "usage: %s [--model=PATH] [--device=cpu] [--in_features=N] [--rows=N]\n"
+                 "          [--seconds=S] [--qps=Q1,Q2,...] [--batch_sizes=B1,B2,...]\n"
+                 "          [--max_queue_delay_us=US] [--num_workers=N]\n",
+                 argv[0]);
+    return EXIT_FAILURE;
+  }
+  oneflow_api::initialize();
+  {
+    const oneflow_api::Device device(options.device);
+    std::printf("%12s %16s %12s %12s %12s %12s\n", "offered_qps", "throughput_qps", "p50_us",
+                "p99_us", "max_us", "batch_fill");
+    for (const double qps : options.qps) { oneflow_api::RunRate(options, device, qps); }
+  }
+  oneflow_api::release();
+  return EXIT_SUCCESS;
+}
@@ -23,5 +23,6 @@ limitations under the License.
 #include "framework/tensor.h"
 #include "framework/ivalue.h"
 #include "framework/graph.h"
+#include "framework/batching.h"
 
 #endif  // ONEFLOW_API_CPP_FRAMEWORK_H_
@@ -0,0 +1,320 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "oneflow/api/cpp/framework/batching.h"
+#include "oneflow/api/cpp/framework/device.h"
+#include "oneflow/api/cpp/framework/graph.h"
+#include "oneflow/api/cpp/framework/ivalue.h"
+#include "oneflow/api/cpp/framework/shape.h"
+#include "oneflow/api/cpp/framework/tensor.h"
+#include "oneflow/core/common/just.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/shape.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+#include "oneflow/core/functional/functional.h"
+#include "oneflow/core/job/lazy_mode.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace oneflow_api {
+
+namespace of = oneflow;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Request {
+  std::vector<Tensor> inputs;
+  int64_t rows;
+  Clock::time_point enqueue_time;
+  std::promise<std::vector<Tensor>> promise;
+};
+
+std::vector<double> QueueTimeUpperBounds() {
+  std::vector<double> upper_bounds;
+  for (double decade = 10; decade <= 1e6; decade *= 10) {
+    upper_bounds.emplace_back(decade);
+    upper_bounds.emplace_back(2 * decade);
+    upper_bounds.emplace_back(5 * decade);
+  }
+  return upper_bounds;
+}
+
+std::vector<double> BatchFillUpperBounds() {
+  std::vector<double> upper_bounds;
+  for (int i = 1; i <= 10; ++i) { upper_bounds.emplace_back(i / 10.0); }
+  return upper_bounds;
+}
+
+// Stacks the rows of all requests, the graph pads them up to its batch size.
+of::Maybe<of::one::Tensor> ConcatRows(const of::one::TensorTuple& inputs) {
+  if (inputs.size() == 1) { return inputs.at(0); }
+  return of::one::functional::Concat(inputs, 0);
+}
+
+// Copies rows [start, start + rows) out of a batched output, the output buffers are reused by the
+// next batch running on the same graph.
+of::Maybe<of::one::Tensor> SliceRows(const std::shared_ptr<of::one::Tensor>& output,
+                                     int64_t start, int64_t rows) {
+  const of::Shape& shape = *output->shape();
+  std::vector<int64_t> starts(shape.NumAxes(), 0);
+  std::vector<int64_t> stops(shape.dim_vec().begin(), shape.dim_vec().end());
+  std::vector<int64_t> steps(shape.NumAxes(), 1);
+  starts[0] = start;
+  stops[0] = start + rows;
+  return of::one::functional::Slice(output, starts, stops, steps, /*enable_view_slice=*/false);
+}
+
+}  // namespace
+
+Histogram::Histogram(const std::vector<double>& upper_bounds)
+    : upper_bounds_(upper_bounds), counts_(upper_bounds.size() + 1, 0), total_count_(0), sum_(0) {
+  CHECK(std::is_sorted(upper_bounds_.begin(), upper_bounds_.end()));
+}
+
+void Histogram::Observe(double value) {
+  const auto it = std::lower_bound(upper_bounds_.begin(), upper_bounds_.end(), value);
+  counts_[it - upper_bounds_.begin()] += 1;
+  total_count_ += 1;
+  sum_ += value;
+}
+
+double Histogram::Quantile(double q) const {
+  if (total_count_ == 0) { return 0; }
+  const double rank = std::min(std::max(q, 0.0), 1.0) * total_count_;
+  int64_t count = 0;
+  for (size_t i = 0; i < upper_bounds_.size(); ++i) {
+    count += counts_[i];
+    if (count > 0 && count >= rank) { return upper_bounds_[i]; }
+  }
+  return std::numeric_limits<double>::infinity();
+}
+
+BatchingStats::BatchingStats()
+    : num_requests(0),
+      num_batches(0),
+      queue_time_us(QueueTimeUpperBounds()),
+      batch_fill(BatchFillUpperBounds()) {}
+
+class DynamicBatcher::DynamicBatcherImpl final {
+ public:
+  DynamicBatcherImpl(const std::string& model_path, const Device& device,
+                     const BatchingOptions& options);
+  ~DynamicBatcherImpl();
+
+  std::future<std::vector<Tensor>> Enqueue(const std::vector<Tensor>& inputs);
+  BatchingStats GetStats() const;
+
+ private:
+  void WorkerLoop();
+  // Blocks until a batch is ready, an empty batch means the batcher stopped.
+  std::vector<std::unique_ptr<Request>> TakeBatch();
+  void RunBatch(const std::vector<std::unique_ptr<Request>>& requests);
+  of::Maybe<std::vector<std::vector<Tensor>>> Run(
+      const std::vector<std::unique_ptr<Request>>& requests);
+  int64_t max_batch_size() const { return options_.batch_sizes.back(); }
+
+  BatchingOptions options_;
+  Graph graph_;
+
+  std::deque<std::unique_ptr<Request>> queue_;
+  int64_t queued_rows_;
+  bool stopped_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+
+  BatchingStats stats_;
+  mutable std::mutex stats_mutex_;
+
+  std::vector<std::thread> workers_;
+};
+
+DynamicBatcher::DynamicBatcher(const std::string& model_path, const Device& device,
+                               const BatchingOptions& options)
+    : batcher_(std::make_unique<DynamicBatcherImpl>(model_path, device, options)) {}
+
+DynamicBatcher::~DynamicBatcher() = default;
+
+std::future<std::vector<Tensor>> DynamicBatcher::Enqueue(const std::vector<Tensor>& inputs) {
+  return batcher_->Enqueue(inputs);
+}
+
+BatchingStats DynamicBatcher::GetStats() const { return batcher_->GetStats(); }
+
+DynamicBatcher::DynamicBatcherImpl::DynamicBatcherImpl(const std::string& model_path,
+                                                       const Device& device,
+                                                       const BatchingOptions& options)
+    : options_(options), graph_(model_path, device), queued_rows_(0), stopped_(false) {
+  CHECK(!options_.batch_sizes.empty());
+  CHECK_GT(options_.num_workers, 0);
+  std::sort(options_.batch_sizes.begin(), options_.batch_sizes.end());
+  options_.batch_sizes.erase(
+      std::unique(options_.batch_sizes.begin(), options_.batch_sizes.end()),
+      options_.batch_sizes.end());
+  CHECK_GT(options_.batch_sizes.front(), 0);
+  graph_.AddBatchSizeBuckets(options_.batch_sizes);
+  graph_.set_max_in_flight_requests(options_.num_workers);
+  for (int i = 0; i < options_.num_workers; ++i) {
+    workers_.emplace_back(&DynamicBatcherImpl::WorkerLoop, this);
+  }
+}
+
+DynamicBatcher::DynamicBatcherImpl::~DynamicBatcherImpl() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  cond_.notify_all();
+  for (auto& worker : workers_) { worker.join(); }
+}
+
+std::future<std::vector<Tensor>> DynamicBatcher::DynamicBatcherImpl::Enqueue(
+    const std::vector<Tensor>& inputs) {
+  auto request = std::make_unique<Request>();
+  request->inputs = inputs;
+  // Scalar inputs have no rows to batch along, they are rejected with the other invalid requests.
+  const bool has_rows = std::all_of(inputs.begin(), inputs.end(),
+  // Scalar inputs have no rows to batch along, they are rejected like other invalid requests.
+  request->rows = inputs.empty() || !has_rows ? 0 : inputs.at(0).shape().At(0);
+  request->enqueue_time = Clock::now();
+  auto future = request->promise.get_future();
+  const bool rows_matched =
+      has_rows && std::all_of(inputs.begin(), inputs.end(), [&](const Tensor& input) {
+        return input.shape().At(0) == request->rows;
+      });
+  if (request->rows <= 0 || request->rows > max_batch_size() || !rows_matched) {
+    request->promise.set_exception(std::make_exception_ptr(std::invalid_argument(
+        "DynamicBatcher requests need the same number of rows in every input, between 1 and "
+        + std::to_string(max_batch_size()))));
+    return future;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queued_rows_ += request->rows;
+    queue_.emplace_back(std::move(request));
+  }
+  cond_.notify_all();
+  return future;
+}
+
+BatchingStats DynamicBatcher::DynamicBatcherImpl::GetStats() const {
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  return stats_;
+}
+
+void DynamicBatcher::DynamicBatcherImpl::WorkerLoop() {
+  while (true) {
+    const auto requests = TakeBatch();
+    if (requests.empty()) { break; }
+    RunBatch(requests);
+  }
+}
+
+std::vector<std::unique_ptr<Request>> DynamicBatcher::DynamicBatcherImpl::TakeBatch() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::vector<std::unique_ptr<Request>> requests;
+  while (requests.empty()) {
+    cond_.wait(lock, [this]() { return stopped_ || !queue_.empty(); });
+    if (queue_.empty()) { break; }
+    // Another worker may take the queued requests while this one waits for the deadline.
+    const auto deadline =
+        queue_.front()->enqueue_time + std::chrono::microseconds(options_.max_queue_delay_us);
+    cond_.wait_until(lock, deadline, [this]() {
+      return stopped_ || queue_.empty() || queued_rows_ >= max_batch_size();
+    });
+    int64_t rows = 0;
+    while (!queue_.empty() && rows + queue_.front()->rows <= max_batch_size()) {
+      rows += queue_.front()->rows;
+      requests.emplace_back(std::move(queue_.front()));
+      queue_.pop_front();
+    }
+    queued_rows_ -= rows;
+  }
+  return requests;
+}
+
+void DynamicBatcher::DynamicBatcherImpl::RunBatch(
+    const std::vector<std::unique_ptr<Request>>& requests) {
+  const auto launch_time = Clock::now();
+  int64_t rows = 0;
+  for (const auto& request : requests) { rows += request->rows; }
+  const size_t bucket =
+      std::lower_bound(options_.batch_sizes.begin(), options_.batch_sizes.end(), rows)
+      - options_.batch_sizes.begin();
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.num_requests += requests.size();
+    stats_.num_batches += 1;
+    for (const auto& request : requests) {
+      stats_.queue_time_us.Observe(
+          std::chrono::duration<double, std::micro>(launch_time - request->enqueue_time).count());
+    }
+    stats_.batch_fill.Observe(static_cast<double>(rows) / options_.batch_sizes.at(bucket));
+  }
+  try {
+    auto outputs = Run(requests).GetOrThrow();
+    for (size_t i = 0; i < requests.size(); ++i) {
+      requests.at(i)->promise.set_value(std::move(outputs.at(i)));
+    }
+  } catch (...) {
+    for (const auto& request : requests) {
+      request->promise.set_exception(std::current_exception());
+    }
+  }
+}
+
+of::Maybe<std::vector<std::vector<Tensor>>> DynamicBatcher::DynamicBatcherImpl::Run(
+    const std::vector<std::unique_ptr<Request>>& requests) {
+  const of::LazyMode::Guard lazy_mode_disabled_guard{false};
+  std::vector<Tensor> batch_inputs;
+  for (size_t i = 0; i < requests.at(0)->inputs.size(); ++i) {
+    of::one::TensorTuple inputs;
+    for (const auto& request : requests) {
+      inputs.emplace_back(request->inputs.at(i).__internal_tensor());
+    }
+    batch_inputs.emplace_back(Tensor(JUST(ConcatRows(inputs))));
+  }
+
+  const IValue value = graph_.Forward(batch_inputs);
+  std::vector<Tensor> batch_outputs;
+  if (value.IsTensor()) {
+    batch_outputs.emplace_back(value.ToTensor());
+  } else if (value.IsTensorVector()) {
+    batch_outputs = value.ToTensorVector();
+  }
+
+  std::vector<std::vector<Tensor>> outputs(requests.size());
+  int64_t start = 0;
+  for (size_t i = 0; i < requests.size(); ++i) {
+    for (const auto& batch_output : batch_outputs) {
+      outputs.at(i).emplace_back(
+          Tensor(JUST(SliceRows(batch_output.__internal_tensor(), start, requests.at(i)->rows))));
+    }
+    start += requests.at(i)->rows;
+  }
+  return outputs;
+}
+
+}  // namespace oneflow_api
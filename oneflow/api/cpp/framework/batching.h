@@ -0,0 +1,96 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef ONEFLOW_API_CPP_FRAMEWORK_BATCHING_H_
+#define ONEFLOW_API_CPP_FRAMEWORK_BATCHING_H_
+
+#include "device.h"
+#include "tensor.h"
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace oneflow_api {
+
+struct BatchingOptions {
+  // Batch size buckets of the graph, a batch runs on the smallest one that fits it.
+  std::vector<int> batch_sizes{1, 2, 4, 8, 16, 32};
+  // A batch is launched once it reaches the largest batch size or its oldest request has been
+  // queued for this long.
+  int64_t max_queue_delay_us = 1000;
+  // Number of batches running on the graph at the same time.
+  int num_workers = 2;
+};
+
+class Histogram {
+ public:
+  // Bucket i counts the values in (upper_bounds[i - 1], upper_bounds[i]], the last bucket counts
+  // the values above upper_bounds.back().
+  explicit Histogram(const std::vector<double>& upper_bounds);
+
+  void Observe(double value);
+  // Upper bound of the bucket holding the q-quantile, q in [0, 1].
+  [[nodiscard]] double Quantile(double q) const;
+
+  [[nodiscard]] const std::vector<double>& upper_bounds() const { return upper_bounds_; }
+  [[nodiscard]] const std::vector<int64_t>& counts() const { return counts_; }
+  [[nodiscard]] int64_t total_count() const { return total_count_; }
+  [[nodiscard]] double sum() const { return sum_; }
+
+ private:
+  std::vector<double> upper_bounds_;
+  std::vector<int64_t> counts_;
+  int64_t total_count_;
+  double sum_;
+};
+
+struct BatchingStats {
+  BatchingStats();
+
+  int64_t num_requests;
+  int64_t num_batches;
+  // Time from Enqueue to the launch of the batch, in microseconds.
+  Histogram queue_time_us;
+  // Rows of a batch divided by the batch size it ran on.
+  Histogram batch_fill;
+};
+
+// Coalesces requests into batches along dim 0 of every input and runs them on a graph with a shape
+// bucket per configured batch size. The outputs are split back into the rows of each request.
+class DynamicBatcher {
+ public:
+  DynamicBatcher(const std::string& model_path, const Device& device = Device("cpu"),
+                 const BatchingOptions& options = BatchingOptions());
+  // Runs the requests still queued before returning.
+  ~DynamicBatcher();
+
+  DynamicBatcher(const DynamicBatcher& batcher) = delete;
+  DynamicBatcher& operator=(const DynamicBatcher& batcher) = delete;
+
+  // All inputs of a request have the same number of rows, at most the largest batch size.
+  std::future<std::vector<Tensor>> Enqueue(const std::vector<Tensor>& inputs);
+  [[nodiscard]] BatchingStats GetStats() const;
+
+ private:
+  class DynamicBatcherImpl;
+  std::unique_ptr<DynamicBatcherImpl> batcher_;
+};
+
+}  // namespace oneflow_api
+
+#endif  // ONEFLOW_API_CPP_FRAMEWORK_BATCHING_H_
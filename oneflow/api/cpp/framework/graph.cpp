@@ -32,6 +32,7 @@ limitations under the License.
 #include "oneflow/core/common/shape.h"
 #include "oneflow/core/common/symbol.h"
 #include "oneflow/core/common/util.h"
+#include "oneflow/core/eager/eager_blob_object.h"
 #include "oneflow/core/framework/device.h"
 #include "oneflow/core/framework/dtype.h"
 #include "oneflow/core/framework/multi_client_session_context.h"
@@ -55,7 +56,17 @@ limitations under the License.
 #include "oneflow/core/operator/interface_blob_conf.pb.h"
 #include "oneflow/core/operator/op_conf.pb.h"
 #include "oneflow/core/register/logical_blob_id.pb.h"
+#include "oneflow/core/thread/thread_manager.h"
+#include "oneflow/core/vm/vm_sync.h"
 #include "oneflow/core/vm/vm_util.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <iterator>
+#include <mutex>
 
 namespace oneflow_api {
 
@@ -108,6 +119,243 @@ Shape OfShapeToOfApiShape(const of::Shape& of_shape) {
   return Shape(dims);
 }
 
+of::Shape OfApiShapeToOfShape(const Shape& shape) {
+  of::DimVector dims(shape.NumAxes());
+  for (int64_t i = 0; i < shape.NumAxes(); ++i) { dims[i] = shape.At(i); }
+  return of::Shape(dims);
+}
+
+// Whether every dimension of outer is at least as long as that of inner.
+bool CoversShape(const of::Shape& outer, const of::Shape& inner) {
+  if (outer.NumAxes() != inner.NumAxes()) { return false; }
+  for (int64_t axis = 0; axis < outer.NumAxes(); ++axis) {
+    if (outer.At(axis) < inner.At(axis)) { return false; }
+  }
+  return true;
+}
+
+// Tensors of the input shapes of a bucket, the inputs of a run are copied to their beginning.
+struct PaddedInputs {
+  of::one::TensorTuple buffers;
+  // Shape of the input last copied into each buffer, the rest of the buffer is zero.
+  std::vector<of::Shape> copied_shapes;
+};
+
+// Padded input buffers for concurrent runs of one graph. A run holds its buffers until the graph
+// consumed them, so they are only handed out again after the run finished.
+class PaddedInputPool final {
+ public:
+  explicit PaddedInputPool(const std::shared_ptr<of::one::TensorTuple>& zeros) : zeros_(zeros) {}
+  PaddedInputPool(const PaddedInputPool&) = delete;
+  PaddedInputPool& operator=(const PaddedInputPool&) = delete;
+  ~PaddedInputPool() = default;
+
+  std::shared_ptr<PaddedInputs> Acquire() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!idle_.empty()) {
+        auto padded = idle_.back();
+        idle_.pop_back();
+        return padded;
+      }
+    }
+    auto padded = std::make_shared<PaddedInputs>();
+    padded->buffers.resize(zeros_->size());
+    for (const auto& zero : *zeros_) {
+      padded->copied_shapes.emplace_back(of::DimVector(zero->shape()->NumAxes(), 0));
+    }
+    return padded;
+  }
+
+  void Release(const std::shared_ptr<PaddedInputs>& padded) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.emplace_back(padded);
+  }
+
+  // Inputs of the bucket shapes are fed as they are, the others are copied into the buffers and
+  // padded with zeros at the end of every dimension. The buffers are allocated on first use.
+  of::Maybe<of::one::TensorTuple> Pad(PaddedInputs* padded, const of::one::TensorTuple& inputs) {
+    const of::LazyMode::Guard lazy_mode_disabled_guard{false};
+    of::one::TensorTuple padded_inputs;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      const auto& input = inputs.at(i);
+      const auto& zero = zeros_->at(i);
+      const of::Shape& shape = *zero->shape();
+      if (*input->shape() == shape) {
+        padded_inputs.emplace_back(input);
+        continue;
+      }
+      CHECK_OR_RETURN(input->dtype() == zero->dtype())
+          << "Graph input " << i << " has data type " << input->dtype()->name() << ", expected "
+          << zero->dtype()->name();
+      auto& buffer = padded->buffers.at(i);
+      of::Shape& copied_shape = padded->copied_shapes.at(i);
+      const std::vector<int64_t> starts(shape.NumAxes(), 0);
+      const std::vector<int64_t> steps(shape.NumAxes(), 1);
+      if (!buffer) {
+        buffer = JUST(of::one::functional::ZerosLike(zero));
+      } else if (!CoversShape(*input->shape(), copied_shape)) {
+        // Rows of an earlier, larger input would otherwise show through the padding.
+        const std::vector<int64_t> stops(shape.dim_vec().begin(), shape.dim_vec().end());
+        JUST(of::one::functional::SliceUpdate(buffer, zero, starts, stops, steps,
+                                              /*inplace=*/true));
+      }
+      const std::vector<int64_t> stops(input->shape()->dim_vec().begin(),
+                                       input->shape()->dim_vec().end());
+      JUST(of::one::functional::SliceUpdate(buffer, input, starts, stops, steps,
+                                            /*inplace=*/true));
+      copied_shape = *input->shape();
+      padded_inputs.emplace_back(buffer);
+    }
+    return padded_inputs;
+  }
+
+ private:
+  const std::shared_ptr<of::one::TensorTuple> zeros_;
+  std::vector<std::shared_ptr<PaddedInputs>> idle_;
+  std::mutex mutex_;
+};
+
+// Copies the first rows of output, the output buffers are reused by later runs.
+of::Maybe<of::one::Tensor> SliceBatch(const std::shared_ptr<of::one::Tensor>& output,
+                                      int64_t rows) {
+  const of::Shape& shape = *output->shape();
+  std::vector<int64_t> starts(shape.NumAxes(), 0);
+  std::vector<int64_t> stops(shape.dim_vec().begin(), shape.dim_vec().end());
+  std::vector<int64_t> steps(shape.NumAxes(), 1);
+  stops[0] = rows;
+  const of::LazyMode::Guard lazy_mode_disabled_guard{false};
+  return of::one::functional::Slice(output, starts, stops, steps, /*enable_view_slice=*/false);
+}
+
+// Read-only private mapping of a file. Its pages are those of the page cache, so processes mapping
+// the same model share one copy of the weights.
+class MappedFile final {
+ public:
+  explicit MappedFile(const std::string& filename) : filename_(filename), data_(nullptr), size_(0) {
+    const int fd = open(filename.c_str(), O_RDONLY);
+    PCHECK(fd != -1) << "Could not open " << filename;
+    struct stat sb {};
+    PCHECK(fstat(fd, &sb) == 0);
+    size_ = sb.st_size;
+    if (size_ > 0) {
+      void* ptr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+      PCHECK(ptr != MAP_FAILED) << "Could not map " << filename;
+      data_ = static_cast<char*>(ptr);
+    }
+    PCHECK(close(fd) == 0);
+  }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile() {
+    if (data_ != nullptr) { PCHECK(munmap(data_, size_) == 0); }
+  }
+
+  const std::string& filename() const { return filename_; }
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  std::string filename_;
+  char* data_;
+  size_t size_;
+};
+
+// Replaces the storage of a CPU tensor with the mapping of its file, which stays mapped as long as
+// the tensor storage lives. Writing to the tensor afterwards faults on the read-only pages.
+of::Maybe<void> AliasTensorToFile(const std::shared_ptr<of::one::Tensor>& tensor,
+                                  const std::shared_ptr<MappedFile>& file) {
+  if (file->size() == 0) { return of::Maybe<void>::Ok(); }
+  const auto& eager_blob_object = JUST(tensor->eager_blob_object());
+  CHECK_EQ_OR_RETURN(eager_blob_object->ByteSizeOfBlobBody(), file->size());
+  const auto& KeepFileMapped = [file](char*) {};
+  eager_blob_object->tensor_storage()->set_blob_dptr(
+      std::unique_ptr<char, std::function<void(char*)>>(const_cast<char*>(file->data()),
+                                                        KeepFileMapped),
+      file->size());
+  return of::Maybe<void>::Ok();
+}
+
+// Job building, the global variable tensor manager and the session are shared by all graphs.
+std::mutex* CompileMutex() {
+  static std::mutex mutex;
+  return &mutex;
+}
+
+// Output tensors for concurrent runs of one graph. Every run writes into a tuple of its own and
+// returns those tensors to the caller, so a tuple is only handed out again after the run finished
+// and the caller released all of its tensors.
+class OutputBufferPool final {
+ public:
+  OutputBufferPool(const std::shared_ptr<of::one::TensorTuple>& registered_outputs,
+                   size_t max_in_flight)
+      : template_(registered_outputs), max_in_flight_(max_in_flight), in_flight_(0) {
+    idle_.emplace_back(registered_outputs);
+  }
+  OutputBufferPool(const OutputBufferPool&) = delete;
+  OutputBufferPool& operator=(const OutputBufferPool&) = delete;
+  ~OutputBufferPool() = default;
+
+  // Blocks while max_in_flight runs hold a tuple.
+  of::Maybe<of::one::TensorTuple> Acquire() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this]() { return in_flight_ < max_in_flight_; });
+      in_flight_ += 1;
+      for (auto it = idle_.begin(); it != idle_.end(); ++it) {
+        if (IsReleased(**it)) {
+          auto outputs = *it;
+          idle_.erase(it);
+          return outputs;
+        }
+      }
+    }
+    auto outputs = NewOutputs();
+    if (!outputs.IsOk()) { Release(nullptr); }
+    return outputs;
+  }
+
+  void Release(const std::shared_ptr<of::one::TensorTuple>& outputs) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (outputs) { idle_.emplace_back(outputs); }
+      // Tuples still held by callers are dropped first, they are freed with the last tensor.
+      for (auto it = idle_.begin(); it != idle_.end() && idle_.size() > max_in_flight_;) {
+        it = IsReleased(**it) ? std::next(it) : idle_.erase(it);
+      }
+      while (idle_.size() > max_in_flight_) { idle_.pop_back(); }
+      in_flight_ -= 1;
+    }
+    cond_.notify_one();
+  }
+
+ private:
+  static bool IsReleased(const of::one::TensorTuple& outputs) {
+    for (const auto& tensor : outputs) {
+      if (tensor.use_count() > 1) { return false; }
+    }
+    return true;
+  }
+
+  of::Maybe<of::one::TensorTuple> NewOutputs() const {
+    const of::LazyMode::Guard lazy_mode_disabled_guard{false};
+    auto outputs = std::make_shared<of::one::TensorTuple>();
+    for (const auto& tensor : *template_) {
+      outputs->emplace_back(JUST(of::one::functional::Empty(*tensor->shape(), tensor->dtype(),
+                                                            JUST(tensor->device()),
+                                                            /*pin_memory=*/false)));
+    }
+    return outputs;
+  }
+
+  const std::shared_ptr<of::one::TensorTuple> template_;
+  const size_t max_in_flight_;
+  size_t in_flight_;
+  std::vector<std::shared_ptr<of::one::TensorTuple>> idle_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+};
+
 }  // namespace
 
 class Graph::GraphImpl final {
@@ -115,40 +363,72 @@ class Graph::GraphImpl final {
   explicit GraphImpl(const std::string& model_path, const Device& device = Device("cpu"));
 
   GraphImpl(const GraphImpl& graph) = delete;
-  GraphImpl(GraphImpl&& graph) = default;
+  GraphImpl(GraphImpl&& graph) = delete;
 
   ~GraphImpl();
 
   GraphImpl& operator=(const GraphImpl& graph) = delete;
-  GraphImpl& operator=(GraphImpl&& graph) = default;
+  GraphImpl& operator=(GraphImpl&& graph) = delete;
 
   InputOutputInfos GetInputInfos();
   InputOutputInfos GetOutputInfos();
   std::vector<Tensor> Forward(const std::vector<Tensor>& inputs);
   void set_batch_size(int batch_size) { batch_size_ = batch_size; }
+  void set_max_in_flight_requests(int max_in_flight_requests) {
+    CHECK_GT(max_in_flight_requests, 0);
+    max_in_flight_requests_ = max_in_flight_requests;
+  }
+  void set_batch_major_outputs(const std::vector<std::string>& output_names);
+  void AddShapeBucket(const std::vector<Shape>& input_shapes);
+  void AddBatchSizeBuckets(const std::vector<int>& batch_sizes);
+  void CompileBuckets();
 
  private:
+  // One compiled plan for fixed input shapes.
+  struct ShapeBucket {
+    std::vector<of::Shape> input_shapes;
+    int64_t elem_cnt = 0;
+    std::atomic<bool> is_compiled{false};
+    std::shared_ptr<of::NNGraph> graph;
+    of::HashMap<std::string, std::shared_ptr<of::one::Tensor>> output_name_to_tensor;
+    std::unique_ptr<PaddedInputPool> padded_input_pool;
+    std::unique_ptr<OutputBufferPool> output_buffer_pool;
+    std::shared_ptr<of::one::TensorTuple> parameter_tensor_tuple;
+  };
+
   of::Maybe<void> CollectInputOutputInfos();
-  of::Maybe<void> Compile(const std::vector<Tensor>& inputs);
-  of::Maybe<std::vector<Tensor>> Run(const std::vector<Tensor>& inputs) const;
-  of::Maybe<void> AddOp(of::OperatorConf op_conf);
-  of::Maybe<void> BuildGraph();
+  std::vector<Shape> GetModelInputShapes(int batch_size) const;
+  void InitShapeBuckets();
+  of::Maybe<ShapeBucket*> FindShapeBucket(const std::vector<Tensor>& inputs) const;
+  void CompileIfNeeded(ShapeBucket* bucket);
+  of::Maybe<void> Compile(ShapeBucket* bucket);
+  of::Maybe<std::vector<Tensor>> Run(ShapeBucket* bucket, const std::vector<Tensor>& inputs);
+  of::Maybe<std::vector<Tensor>> Run(ShapeBucket* bucket, const of::one::TensorTuple& inputs,
+                                     PaddedInputs* padded_inputs,
+                                     const of::one::TensorTuple& outputs);
+  of::Maybe<void> AddOp(of::OperatorConf op_conf, const ShapeBucket& bucket);
+  of::Maybe<void> BuildGraph(ShapeBucket* bucket);
   of::Maybe<void> LoadCheckpoint();
-  of::Maybe<void> RegisterTensors(const std::vector<Tensor>& inputs);
+  of::Maybe<void> RegisterTensors(ShapeBucket* bucket);
 
-  std::shared_ptr<of::NNGraph> graph_ = nullptr;
   std::string model_path_;
-  bool is_compiled_ = false;
   int batch_size_ = 0;
+  int max_in_flight_requests_ = 2;
   Device device_;
   of::Job job_;
 
   InputOutputInfos input_infos_;
   InputOutputInfos output_infos_;
-  of::HashMap<std::string, std::shared_ptr<of::one::Tensor>> output_name_to_tensor_;
+  // Indexed by output order, these outputs are cut back to the rows of a request.
+  std::vector<bool> batch_major_outputs_;
   of::HashMap<std::string, std::shared_ptr<of::one::Tensor>> variable_op_name_to_tensor_;
-  std::shared_ptr<of::one::TensorTuple> output_tensor_tuple_;
-  std::shared_ptr<of::one::TensorTuple> parameter_tensor_tuple_;
+  // Sorted by the number of input elements.
+  std::vector<std::unique_ptr<ShapeBucket>> buckets_;
+  std::once_flag init_buckets_flag_;
+  int64_t num_compiled_buckets_ = 0;
+  // Keeps the launch order of concurrent runs identical to the order their instructions are
+  // pushed to the runtime buffers.
+  std::mutex launch_mutex_;
 };
 
 Graph::Graph(const std::string& model_path, const Device& device)
@@ -192,6 +472,24 @@ IValue Graph::Forward(const IValue& inputs) {
 
 void Graph::set_batch_size(int batch_size) { graph_->set_batch_size(batch_size); }
 
+void Graph::set_max_in_flight_requests(int max_in_flight_requests) {
+  graph_->set_max_in_flight_requests(max_in_flight_requests);
+}
+
+void Graph::set_batch_major_outputs(const std::vector<std::string>& output_names) {
+  graph_->set_batch_major_outputs(output_names);
+}
+
+void Graph::AddShapeBucket(const std::vector<Shape>& input_shapes) {
+  graph_->AddShapeBucket(input_shapes);
+}
+
+void Graph::AddBatchSizeBuckets(const std::vector<int>& batch_sizes) {
+  graph_->AddBatchSizeBuckets(batch_sizes);
+}
+
+void Graph::CompileBuckets() { graph_->CompileBuckets(); }
+
 Graph Graph::Load(const std::string& model_path, const Device& device) {
   Graph graph(model_path, device);
   return graph;
@@ -201,6 +499,7 @@ Graph::GraphImpl::GraphImpl(const std::string& model_path, const Device& device)
     : model_path_(model_path), device_(device) {
   CHECK_JUST(of::LoadJobFromIR(&job_, model_path + "/model.mlir"));
   CollectInputOutputInfos();
+  batch_major_outputs_.assign(output_infos_.size(), false);
   if (of::ParseBooleanFromEnv("ONEFLOW_SERVING_DEBUG", false)) { LOG(ERROR) << job_.DebugString(); }
   job_.mutable_job_conf()->mutable_predict_conf();
   job_.mutable_job_conf()->set_job_name(job_.mutable_job_conf()->job_name() + of::NewUniqueId());
@@ -235,58 +534,179 @@ of::Maybe<void> Graph::GraphImpl::CollectInputOutputInfos() {
 }
 
 std::vector<Tensor> Graph::GraphImpl::Forward(const std::vector<Tensor>& inputs) {
-  if (!is_compiled_) {
-    static std::mutex mtx;
-    std::lock_guard<std::mutex> lock(mtx);
-    Compile(inputs).GetOrThrow();
-    is_compiled_ = true;
+  InitShapeBuckets();
+  ShapeBucket* bucket = FindShapeBucket(inputs).GetOrThrow();
+  CompileIfNeeded(bucket);
+  return Run(bucket, inputs).GetOrThrow();
+}
+
+void Graph::GraphImpl::set_batch_major_outputs(const std::vector<std::string>& output_names) {
+  batch_major_outputs_.assign(output_infos_.size(), false);
+  for (const auto& output_name : output_names) {
+    const auto it = output_infos_.find(output_name);
+    CHECK(it != output_infos_.end()) << "Graph has no output named " << output_name;
+    batch_major_outputs_.at(it->second.input_output_index_) = true;
   }
-  return Run(inputs).GetOrThrow();
 }
 
-of::Maybe<void> Graph::GraphImpl::Compile(const std::vector<Tensor>& inputs) {
-  JUST(BuildGraph());
-  JUST(RegisterTensors(inputs));
-  JUST(graph_->CompileAndInitRuntime());
-  return of::Maybe<void>::Ok();
+void Graph::GraphImpl::AddShapeBucket(const std::vector<Shape>& input_shapes) {
+  CHECK_EQ(input_shapes.size(), input_infos_.size());
+  auto bucket = std::make_unique<ShapeBucket>();
+  for (const auto& shape : input_shapes) {
+    bucket->input_shapes.emplace_back(OfApiShapeToOfShape(shape));
+  }
+  for (const auto& shape : bucket->input_shapes) { bucket->elem_cnt += shape.elem_cnt(); }
+  const auto it = std::upper_bound(buckets_.begin(), buckets_.end(), bucket->elem_cnt,
+                                   [](int64_t elem_cnt, const std::unique_ptr<ShapeBucket>& b) {
+                                     return elem_cnt < b->elem_cnt;
+                                   });
+  buckets_.insert(it, std::move(bucket));
+}
+
+void Graph::GraphImpl::AddBatchSizeBuckets(const std::vector<int>& batch_sizes) {
+  for (int batch_size : batch_sizes) {
+    CHECK_GT(batch_size, 0);
+    AddShapeBucket(GetModelInputShapes(batch_size));
+  }
 }
 
-of::Maybe<std::vector<Tensor>> Graph::GraphImpl::Run(const std::vector<Tensor>& inputs) const {
-  const auto input_tensor_tuple = std::make_shared<of::one::TensorTuple>();
-  for (const auto& tensor : inputs) { input_tensor_tuple->emplace_back(tensor.tensor_); }
+void Graph::GraphImpl::CompileBuckets() {
+  InitShapeBuckets();
+  for (const auto& bucket : buckets_) { CompileIfNeeded(bucket.get()); }
+}
 
-  JUST(of::RunLazyNNGraph(*input_tensor_tuple, *output_tensor_tuple_, *parameter_tensor_tuple_,
-                          graph_));
-  JUST(of::SoftSyncNNGraphBuffers(*output_tensor_tuple_, graph_));
+std::vector<Shape> Graph::GraphImpl::GetModelInputShapes(int batch_size) const {
+  std::vector<Shape> input_shapes(input_infos_.size());
+  for (const auto& input_info : input_infos_) {
+    const Shape& shape = input_info.second.input_output_shape_;
+    std::vector<int64_t> dims(shape.NumAxes());
+    for (int64_t i = 0; i < shape.NumAxes(); ++i) { dims[i] = shape.At(i); }
+    if (batch_size > 0 && !dims.empty()) { dims[0] = batch_size; }
+    input_shapes.at(input_info.second.input_output_index_) = Shape(dims);
+  }
+  return input_shapes;
+}
 
-  std::vector<Tensor> outputs;
-  for (const auto& tensor : *output_tensor_tuple_) { outputs.emplace_back(Tensor(tensor)); }
+void Graph::GraphImpl::InitShapeBuckets() {
+  std::call_once(init_buckets_flag_, [this]() {
+    if (buckets_.empty()) { AddShapeBucket(GetModelInputShapes(batch_size_)); }
+  });
+}
+
+of::Maybe<Graph::GraphImpl::ShapeBucket*> Graph::GraphImpl::FindShapeBucket(
+    const std::vector<Tensor>& inputs) const {
+  CHECK_EQ_OR_RETURN(inputs.size(), input_infos_.size())
+      << "Graph expects " << input_infos_.size() << " inputs, but got " << inputs.size();
+  const auto Covers = [&](const ShapeBucket& bucket) {
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      if (!CoversShape(bucket.input_shapes.at(i), *inputs.at(i).tensor_->shape())) {
+        return false;
+      }
+    }
+    return true;
+  };
+  // Buckets are sorted by their number of elements, the first covering one is the smallest.
+  for (const auto& bucket : buckets_) {
+    if (Covers(*bucket)) { return bucket.get(); }
+  }
+  UNIMPLEMENTED_THEN_RETURN() << "No shape bucket of the graph covers the input shapes";
+}
+
+void Graph::GraphImpl::CompileIfNeeded(ShapeBucket* bucket) {
+  if (!bucket->is_compiled.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(*CompileMutex());
+    if (!bucket->is_compiled.load(std::memory_order_relaxed)) {
+      Compile(bucket).GetOrThrow();
+      bucket->is_compiled.store(true, std::memory_order_release);
+    }
+  }
+}
+
+of::Maybe<void> Graph::GraphImpl::Compile(ShapeBucket* bucket) {
+  JUST(BuildGraph(bucket));
+  JUST(RegisterTensors(bucket));
+  JUST(bucket->graph->CompileAndInitRuntime());
+  return of::Maybe<void>::Ok();
+}
+
+of::Maybe<std::vector<Tensor>> Graph::GraphImpl::Run(ShapeBucket* bucket,
+                                                     const std::vector<Tensor>& inputs) {
+  of::one::TensorTuple input_tensor_tuple;
+  for (const auto& input : inputs) { input_tensor_tuple.emplace_back(input.tensor_); }
+  // The output pool bounds the runs in flight, so it is acquired first. Buffers of a failed run
+  // are dropped.
+  const auto output_tensor_tuple = JUST(bucket->output_buffer_pool->Acquire());
+  const auto padded_inputs = bucket->padded_input_pool->Acquire();
+  const auto outputs = Run(bucket, input_tensor_tuple, padded_inputs.get(), *output_tensor_tuple);
+  bucket->output_buffer_pool->Release(output_tensor_tuple);
+  if (outputs.IsOk()) { bucket->padded_input_pool->Release(padded_inputs); }
   return outputs;
 }
 
-of::Maybe<void> Graph::GraphImpl::AddOp(of::OperatorConf op_conf) {
+of::Maybe<std::vector<Tensor>> Graph::GraphImpl::Run(ShapeBucket* bucket,
+                                                     const of::one::TensorTuple& inputs,
+                                                     PaddedInputs* padded_inputs,
+                                                     const of::one::TensorTuple& outputs) {
+  const of::one::TensorTuple padded_input_tuple =
+      *JUST(bucket->padded_input_pool->Pad(padded_inputs, inputs));
+  {
+    std::lock_guard<std::mutex> lock(launch_mutex_);
+    JUST(of::RunLazyNNGraph(padded_input_tuple, outputs, *bucket->parameter_tensor_tuple,
+                            bucket->graph));
+  }
+  // Only waits for this run, later runs keep going in the pipeline.
+  JUST(of::SoftSyncNNGraphBuffers(outputs, bucket->graph));
+
+  // Batch-major outputs of a request padded along the batch dimension are cut back to its rows.
+  int64_t batch_size = 0;
+  if (!inputs.empty() && inputs.at(0)->shape()->NumAxes() > 0) {
+    batch_size = inputs.at(0)->shape()->At(0);
+    if (batch_size == bucket->input_shapes.at(0).At(0)) { batch_size = 0; }
+  }
+  std::vector<Tensor> output_tensors;
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    const auto& tensor = outputs.at(i);
+    if (batch_size > 0 && batch_major_outputs_.at(i)) {
+      CHECK_OR_RETURN(tensor->shape()->NumAxes() > 0 && tensor->shape()->At(0) >= batch_size)
+          << "Batch-major output " << i << " of shape " << tensor->shape()->ToString()
+          << " has fewer than " << batch_size << " rows";
+      output_tensors.emplace_back(Tensor(JUST(SliceBatch(tensor, batch_size))));
+    } else {
+      output_tensors.emplace_back(Tensor(tensor));
+    }
+  }
+  return output_tensors;
+}
+
+of::Maybe<void> Graph::GraphImpl::AddOp(of::OperatorConf op_conf, const ShapeBucket& bucket) {
   {
     const std::shared_ptr<of::Scope> scope = JUST(of::GetCurrentScope());
     op_conf.set_scope_symbol_id(scope->symbol_id().value_or(0));
   }
   op_conf.set_device_tag(GetDeviceTag(device_));
-  if (batch_size_ > 0 && op_conf.has_input_conf()) {
-    op_conf.mutable_input_conf()->mutable_blob_conf()->mutable_shape()->mutable_dim()->Set(
-        0, batch_size_);
+  if (op_conf.has_input_conf()) {
+    const size_t index = input_infos_.at(op_conf.name()).input_output_index_;
+    bucket.input_shapes.at(index).ToProto(
+        op_conf.mutable_input_conf()->mutable_blob_conf()->mutable_shape());
   }
   auto* ctx = JUST(of::GetCurInferCtx());
   JUST(ctx->AddAndInferConsistentOp(op_conf));
   return of::Maybe<void>::Ok();
 }
 
-of::Maybe<void> Graph::GraphImpl::BuildGraph() {
-  CompileScope build_graph_scope(job_.job_conf(), *device_.device_->shared_from_symbol());
+of::Maybe<void> Graph::GraphImpl::BuildGraph(ShapeBucket* bucket) {
+  // Every bucket is a job of its own, all of them share the variable tensors.
+  of::JobConfigProto job_conf = job_.job_conf();
+  job_conf.set_job_name(job_conf.job_name() + "_bucket" + std::to_string(num_compiled_buckets_));
+  num_compiled_buckets_ += 1;
+  CompileScope build_graph_scope(job_conf, *device_.device_->shared_from_symbol());
+  const bool has_variables = !variable_op_name_to_tensor_.empty();
   {
     const of::OpGraph op_graph(job_);
     op_graph.TopoForEachNode([&](const of::OpNode* node) -> of::Maybe<void> {
       const of::OperatorConf& op_conf = node->op().op_conf();
-      JUST(AddOp(op_conf));
-      if (op_conf.has_variable_conf()) {
+      JUST(AddOp(op_conf, *bucket));
+      if (op_conf.has_variable_conf() && !has_variables) {
         const of::LazyMode::Guard lazy_mode_disabled_guard{false};
         const of::VariableOpConf& variable_conf = op_conf.variable_conf();
         variable_op_name_to_tensor_[op_conf.name()] = JUST(of::one::functional::Empty(
@@ -297,28 +717,27 @@ of::Maybe<void> Graph::GraphImpl::BuildGraph() {
       return of::Maybe<void>::Ok();
     });
   }
-  JUST(LoadCheckpoint());
+  if (!has_variables) { JUST(LoadCheckpoint()); }
+  {
+    const auto& pair = Unzip(variable_op_name_to_tensor_);
+    JUST(of::FillVariableTensorMgr(pair.first, pair.second));
+  }
   JUST(of::CurJobBuildAndInferCtx_Complete());
   const std::shared_ptr<of::Job> complete_job = JUST(of::GetCurrentJob());
   int64_t job_id = JUST(of::JobBuildAndInferCtx_GetCurrentJobId());
   CHECK(of::Global<OneFlowEnv>::Get() != nullptr);
-  graph_ = std::make_shared<of::NNGraph>(job_.job_conf().job_name(), *complete_job, job_id,
-                                         of::Global<OneFlowEnv>::Get()->GetSessionCtx());
+  bucket->graph = std::make_shared<of::NNGraph>(job_conf.job_name(), *complete_job, job_id,
+                                                of::Global<OneFlowEnv>::Get()->GetSessionCtx());
   {
     const of::OpGraph complete_graph(*complete_job);
     complete_graph.TopoForEachNode([&](const of::OpNode* node) -> of::Maybe<void> {
       const of::LazyMode::Guard lazy_mode_disabled_guard{false};
       const of::OperatorConf& op_conf = node->op().op_conf();
       if (op_conf.has_output_conf()) {
-        of::InterfaceBlobConf blob_conf = op_conf.output_conf().blob_conf();
-        if (batch_size_ > 0) {
-          const std::string input_lbi_str = op_conf.output_conf().in();
-          const of::LogicalBlobId input_lbi = of::GenLogicalBlobId(input_lbi_str);
-          int64_t batch_size = node->LogicalBlobDesc4Lbi(input_lbi).shape().At(0);
-          blob_conf.mutable_shape()->set_dim(0, batch_size);
-        }
-        output_name_to_tensor_[op_conf.name()] = JUST(of::one::functional::Empty(
-            of::Shape(blob_conf.shape()),
+        const of::InterfaceBlobConf& blob_conf = op_conf.output_conf().blob_conf();
+        const of::LogicalBlobId input_lbi = of::GenLogicalBlobId(op_conf.output_conf().in());
+        bucket->output_name_to_tensor[op_conf.name()] = JUST(of::one::functional::Empty(
+            node->LogicalBlobDesc4Lbi(input_lbi).shape(),
             JUST(of::DType::Get(static_cast<of::DataType>(blob_conf.data_type()))),
             *device_.device_, /*pin_memory=*/false));
       }
@@ -329,54 +748,80 @@ of::Maybe<void> Graph::GraphImpl::BuildGraph() {
 }
 
 of::Maybe<void> Graph::GraphImpl::LoadCheckpoint() {
-  for (const auto& variable_op_name_and_tensor : variable_op_name_to_tensor_) {
-    const auto& variable_op_name = variable_op_name_and_tensor.first;
-    const auto& variable_tensor = variable_op_name_and_tensor.second;
-    const std::string variable_filename = model_path_ + "/" + variable_op_name + "/out";
-    const std::string buffer = [&]() {
-      std::ifstream variable_file(variable_filename, std::ios::binary);
-      CHECK(variable_file.is_open());
-      std::stringstream ss;
-      ss << variable_file.rdbuf();
-      return ss.str();
-    }();
-    const auto& callback = [&](uint64_t of_blob_ptr) {
-      CHECK_JUST(of::BlobBufferCopyUtil<void>::From(
-          of_blob_ptr, buffer.data(),
-          variable_tensor->shape()->elem_cnt()
-              * of::GetSizeOfDataType(variable_tensor->dtype()->data_type())));
-    };
-    JUST(of::one::SyncAccessTensorWithTimeOut(variable_tensor, callback, "mut"));
-  }
   const auto& pair = Unzip(variable_op_name_to_tensor_);
-  JUST(of::FillVariableTensorMgr(pair.first, pair.second));
+  const std::vector<std::string>& variable_op_names = pair.first;
+  const std::vector<std::shared_ptr<of::one::Tensor>>& variable_tensors = pair.second;
+  // Mapping with MAP_POPULATE reads the whole file, so the variables are read in parallel.
+  std::vector<std::shared_ptr<MappedFile>> variable_files(variable_op_names.size());
+  of::MultiThreadLoop(variable_op_names.size(), [&](size_t i) {
+    variable_files[i] =
+        std::make_shared<MappedFile>(model_path_ + "/" + variable_op_names[i] + "/out");
+  });
+  const bool alias_variables = device_.type() == "cpu"
+                               && of::ParseBooleanFromEnv("ONEFLOW_SERVING_MMAP_VARIABLES", false);
+  // The storage of the variables is only swapped after their allocation finished.
+  if (alias_variables) { JUST(of::vm::CurrentRankSync()); }
+  for (size_t i = 0; i < variable_tensors.size(); ++i) {
+    const auto& variable_tensor = variable_tensors[i];
+    const auto& variable_file = variable_files[i];
+    const size_t variable_bytes = variable_tensor->shape()->elem_cnt()
+                                  * of::GetSizeOfDataType(variable_tensor->dtype()->data_type());
+    CHECK_EQ_OR_RETURN(variable_file->size(), variable_bytes)
+        << "The size of " << variable_file->filename() << " does not match variable "
+        << variable_op_names[i];
+    if (alias_variables) {
+      JUST(AliasTensorToFile(variable_tensor, variable_file));
+    } else {
+      const auto& callback = [&](uint64_t of_blob_ptr) {
+        CHECK_JUST(of::BlobBufferCopyUtil<void>::From(of_blob_ptr, variable_file->data(),
+                                                      variable_bytes));
+      };
+      JUST(of::one::SyncAccessTensorWithTimeOut(variable_tensor, callback, "mut"));
+    }
+  }
   return of::Maybe<void>::Ok();
 }
 
-of::Maybe<void> Graph::GraphImpl::RegisterTensors(const std::vector<Tensor>& inputs) {
+of::Maybe<void> Graph::GraphImpl::RegisterTensors(ShapeBucket* bucket) {
   {
-    std::vector<std::string> input_op_names(inputs.size());
-    std::vector<std::shared_ptr<of::one::Tensor>> input_tensors(inputs.size());
+    const of::LazyMode::Guard lazy_mode_disabled_guard{false};
+    std::vector<std::string> input_op_names(input_infos_.size());
+    std::vector<std::shared_ptr<of::one::Tensor>> input_tensors(input_infos_.size());
     for (const auto& input_info : input_infos_) {
       size_t index = input_info.second.input_output_index_;
       input_op_names[index] = input_info.first;
-      input_tensors[index] = inputs.at(index).tensor_;
+      input_tensors[index] = JUST(of::one::functional::Empty(
+          bucket->input_shapes.at(index),
+          JUST(of::DType::Get(static_cast<of::DataType>(input_info.second.datatype_))),
+          *device_.device_, /*pin_memory=*/false));
+    }
+    JUST(bucket->graph->RegisterInputOpNamesAndTensors(input_op_names, input_tensors));
+    auto zeros = std::make_shared<of::one::TensorTuple>();
+    for (const auto& input_tensor : input_tensors) {
+      zeros->emplace_back(JUST(of::one::functional::ZerosLike(input_tensor)));
     }
-    JUST(graph_->RegisterInputOpNamesAndTensors(input_op_names, input_tensors));
+    bucket->padded_input_pool = std::make_unique<PaddedInputPool>(zeros);
   }
   {
-    const auto& pair = Unzip(output_name_to_tensor_);
-    const std::vector<std::string>& output_op_names = pair.first;
-    const std::vector<std::shared_ptr<of::one::Tensor>>& output_tensors = pair.second;
-    JUST(graph_->RegisterOutputOpNamesAndTensors(output_op_names, output_tensors));
-    output_tensor_tuple_ = ConvertToTensorTuple(output_tensors);
+    std::vector<std::string> output_op_names(output_infos_.size());
+    std::vector<std::shared_ptr<of::one::Tensor>> output_tensors(output_infos_.size());
+    for (const auto& output_info : output_infos_) {
+      size_t index = output_info.second.input_output_index_;
+      output_op_names[index] = output_info.first;
+      output_tensors[index] = bucket->output_name_to_tensor.at(output_info.first);
+    }
+    JUST(bucket->graph->RegisterOutputOpNamesAndTensors(output_op_names, output_tensors));
+    bucket->output_buffer_pool = std::make_unique<OutputBufferPool>(
+        ConvertToTensorTuple(output_tensors), max_in_flight_requests_);
+    // The pool must be the only owner of its tensors to tell when callers released them.
+    bucket->output_name_to_tensor.clear();
   }
   {
     const auto& t = of::DumpVariableTensorMgr();
     const std::vector<std::string>& variable_op_names = std::get<0>(t);
     const std::vector<std::shared_ptr<of::one::Tensor>>& variable_tensors = std::get<1>(t);
-    JUST(graph_->RegisterVariableOpNamesAndTensors(variable_op_names, variable_tensors));
-    parameter_tensor_tuple_ = ConvertToTensorTuple(variable_tensors);
+    JUST(bucket->graph->RegisterVariableOpNamesAndTensors(variable_op_names, variable_tensors));
+    bucket->parameter_tensor_tuple = ConvertToTensorTuple(variable_tensors);
   }
   return of::Maybe<void>::Ok();
 }
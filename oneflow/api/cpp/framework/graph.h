@@ -25,6 +25,7 @@ limitations under the License.
 #include <cstddef>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace oneflow {
 
@@ -61,8 +62,27 @@ class Graph {
 
   InputOutputInfos GetInputInfos();
   InputOutputInfos GetOutputInfos();
+  // Thread-safe: concurrent calls on one Graph share its parameters and are pipelined by the
+  // runtime, each writing into its own output tensors.
   IValue Forward(const IValue& inputs);
   void set_batch_size(int batch_size);
+  // Upper bound of concurrent Forward calls in flight, further calls block until one finishes.
+  // Must be set before the first Forward, the default is 2.
+  void set_max_in_flight_requests(int max_in_flight_requests);
+  // Names the outputs whose dim 0 is the batch dimension. When a request is padded along the
+  // batch dimension, these outputs are cut back to its batch size (dim 0 of the first input), the
+  // other outputs keep the shapes of the bucket. Must be called before the first Forward.
+  void set_batch_major_outputs(const std::vector<std::string>& output_names);
+  // Declares a plan for fixed shapes of all inputs, in input order. Forward runs on the bucket
+  // with the fewest elements whose shapes cover the inputs, shorter dimensions are zero-padded at
+  // the end.
+  // Buckets share the variables and are compiled on first use or by CompileBuckets. Without any
+  // bucket, the graph uses the model input shapes with the batch size set by set_batch_size.
+  // Must be called before the first Forward.
+  void AddShapeBucket(const std::vector<Shape>& input_shapes);
+  // Adds a bucket per batch size, the other dimensions are those of the model inputs.
+  void AddBatchSizeBuckets(const std::vector<int>& batch_sizes);
+  void CompileBuckets();
 
   static Graph Load(const std::string& model_path, const Device& device = Device("cpu"));
 
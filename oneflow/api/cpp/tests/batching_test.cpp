@@ -0,0 +1,113 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <gtest/gtest.h>
+#include <array>
+#include <future>
+#include <stdexcept>
+#include <vector>
+#include "oneflow/api/cpp/framework.h"
+#include "oneflow/api/cpp/tests/api_test.h"
+
+namespace oneflow_api {
+
+namespace {
+
+const char* const kModelPath = "./oneflow/api/cpp/tests/graph_test_model/affine_with_parameter";
+
+std::vector<Tensor> MakeInputs(const Device& device, int64_t rows, float value) {
+  std::vector<float> data(rows * 3, value);
+  std::vector<Tensor> inputs;
+  inputs.emplace_back(Tensor::from_buffer(data.data(), Shape({rows, 3}), device, DType::kFloat));
+  return inputs;
+}
+
+}  // namespace
+
+TEST(Api, dynamic_batcher_test) {
+  EnvScope scope;
+  Device device("cpu");
+  BatchingOptions options;
+  options.batch_sizes = {2, 4, 8};
+  // Holds every batch until it reaches 8 rows, so the batches only depend on the request order.
+  options.max_queue_delay_us = 60 * 1000 * 1000;
+  DynamicBatcher batcher(kModelPath, device, options);
+
+  // Four groups of requests with 1, 2, 1, 2 and 2 rows, each group fills one batch of 8 rows.
+  const std::array<int64_t, 5> group_rows{1, 2, 1, 2, 2};
+  const int num_groups = 4;
+  const int num_requests = num_groups * static_cast<int>(group_rows.size());
+  std::vector<std::future<std::vector<Tensor>>> futures;
+  for (int i = 0; i < num_requests; ++i) {
+    futures.emplace_back(batcher.Enqueue(
+        MakeInputs(device, group_rows.at(i % group_rows.size()), static_cast<float>(i))));
+  }
+  for (int i = 0; i < num_requests; ++i) {
+    const std::vector<Tensor> outputs = futures.at(i).get();
+    ASSERT_EQ(outputs.size(), 1);
+    const int64_t rows = group_rows.at(i % group_rows.size());
+    ASSERT_EQ(outputs.at(0).shape(), Shape({rows, 4}));
+    std::vector<float> buf(rows * 4);
+    outputs.at(0).copy_to(buf.data());
+    for (const float& element : buf) { ASSERT_EQ(element, 3 * i + 1); }
+  }
+
+  const BatchingStats stats = batcher.GetStats();
+  ASSERT_EQ(stats.num_requests, num_requests);
+  ASSERT_EQ(stats.num_batches, num_groups);
+  ASSERT_EQ(stats.queue_time_us.total_count(), num_requests);
+  ASSERT_EQ(stats.batch_fill.total_count(), num_groups);
+  ASSERT_EQ(stats.batch_fill.counts().at(9), num_groups);
+}
+
+TEST(Api, dynamic_batcher_deadline_test) {
+  EnvScope scope;
+  Device device("cpu");
+  BatchingOptions options;
+  options.batch_sizes = {2, 4, 8};
+  options.max_queue_delay_us = 1000;
+  options.num_workers = 1;
+  DynamicBatcher batcher(kModelPath, device, options);
+
+  // A lone request never fills a batch, it runs on the smallest bucket once its deadline passes.
+  const std::vector<Tensor> outputs = batcher.Enqueue(MakeInputs(device, 1, 2)).get();
+  ASSERT_EQ(outputs.at(0).shape(), Shape({1, 4}));
+  std::vector<float> buf(4);
+  outputs.at(0).copy_to(buf.data());
+  for (const float& element : buf) { ASSERT_EQ(element, 7); }
+
+  const BatchingStats stats = batcher.GetStats();
+  ASSERT_EQ(stats.num_batches, 1);
+  ASSERT_EQ(stats.batch_fill.counts().at(4), 1);
+  ASSERT_GE(stats.queue_time_us.Quantile(1.0), 1000);
+}
+
+TEST(Api, dynamic_batcher_invalid_request_test) {
+  EnvScope scope;
+  Device device("cpu");
+  BatchingOptions options;
+  options.batch_sizes = {1, 2};
+  DynamicBatcher batcher(kModelPath, device, options);
+
+  auto future = batcher.Enqueue(MakeInputs(device, 3, 1));
+  ASSERT_THROW(future.get(), std::invalid_argument);
+  // Scalar inputs have no batch dimension.
+  future = batcher.Enqueue({Tensor(Shape(std::vector<int64_t>{}), device, DType::kFloat)});
+  ASSERT_THROW(future.get(), std::invalid_argument);
+  ASSERT_EQ(batcher.GetStats().num_requests, 0);
+}
+
+}  // namespace oneflow_api
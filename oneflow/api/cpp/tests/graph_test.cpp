@@ -19,6 +19,7 @@ limitations under the License.
 #include <array>
 #include <chrono>
 #include <cstdint>
+#include <cstdlib>
 #include <functional>
 #include <iostream>
 #include <thread>
@@ -159,6 +160,83 @@ TEST(Api, graph_thread_test) {
   for (auto& thread : threads) { thread.join(); }
 }
 
+TEST(Api, graph_mmap_variables_test) {
+  EnvScope scope;
+  Device device("cpu");
+  // CPU variables alias the read-only mapping of the checkpoint files.
+  setenv("ONEFLOW_SERVING_MMAP_VARIABLES", "1", 1);
+  Graph graph = LoadGraph(device);
+  Forward(graph, device, 1);
+  Forward(graph, device, 1);
+  unsetenv("ONEFLOW_SERVING_MMAP_VARIABLES");
+}
+
+TEST(Api, graph_shape_bucket_test) {
+  EnvScope scope;
+  Device device("cpu");
+  Graph graph = LoadGraph(device);
+  graph.set_batch_major_outputs({"_MyGraph_0-output_0"});
+  graph.AddBatchSizeBuckets({2, 8});
+  // Padded up to the bucket of 2 and of 8, outputs keep the rows of the request.
+  Forward(graph, device, 1);
+  Forward(graph, device, 5);
+  Forward(graph, device, 8);
+  graph.CompileBuckets();
+  Forward(graph, device, 2);
+
+  std::vector<float> data(9 * 3, 1);
+  std::vector<Tensor> inputs;
+  inputs.emplace_back(Tensor::from_buffer(data.data(), Shape({9, 3}), device, DType::kFloat));
+  ASSERT_ANY_THROW(graph.Forward(inputs));
+}
+
+TEST(Api, graph_shape_bucket_padding_test) {
+  EnvScope scope;
+  Device device("cpu");
+  Graph graph = LoadGraph(device);
+  graph.AddBatchSizeBuckets({8});
+
+  // Without batch-major outputs, the padded rows come back as well. They only see the bias, also
+  // after a larger request ran on the same bucket.
+  for (const int64_t rows : {5, 3}) {
+    std::vector<float> data(rows * 3, 1);
+    std::vector<Tensor> inputs;
+    inputs.emplace_back(Tensor::from_buffer(data.data(), Shape({rows, 3}), device, DType::kFloat));
+    Tensor output = graph.Forward(inputs).ToTensor();
+    ASSERT_EQ(output.shape(), Shape({8, 4}));
+    std::vector<float> buf(8 * 4);
+    output.copy_to(buf.data());
+    for (int64_t i = 0; i < 8 * 4; ++i) { ASSERT_EQ(buf.at(i), i < rows * 4 ? 4 : 1); }
+  }
+}
+
+TEST(Api, graph_concurrent_forward_test) {
+  EnvScope scope;
+
+  Device device("cpu");
+  Graph graph = LoadGraph(device);
+  graph.set_max_in_flight_requests(4);
+  Forward(graph, device, 1);
+
+  // Every thread feeds its own input value, so outputs written into another request's buffers
+  // would show up as wrong values.
+  const auto ForwardWithValue = [&](float value) {
+    for (int i = 0; i < 10; ++i) {
+      std::array<float, 3> data{};
+      std::fill(data.begin(), data.end(), value);
+      std::vector<Tensor> inputs;
+      inputs.emplace_back(Tensor::from_buffer(data.data(), Shape({1, 3}), device, DType::kFloat));
+      Tensor output = graph.Forward(inputs).ToTensor();
+      std::array<float, 4> buf{};
+      output.copy_to(buf.data());
+      for (const float& element : buf) { ASSERT_EQ(element, 3 * value + 1); }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) { threads.emplace_back(ForwardWithValue, static_cast<float>(i)); }
+  for (auto& thread : threads) { thread.join(); }
+}
+
 TEST(Api, graph_input_order_test) {
   EnvScope scope;
 
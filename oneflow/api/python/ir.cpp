@@ -21,11 +21,22 @@ limitations under the License.
 #include <glog/logging.h>
 #include "oneflow/api/python/of_api_registry.h"
 
+namespace py = pybind11;
+
 namespace oneflow {
 
 ONEFLOW_API_PYBIND11_MODULE("ir", m) {
   m.def("load_jit_shared_lib",
         [](const std::string& lib_path) { MutSharedLibPaths()->insert(lib_path); });
+  m.def("jit_cache_stats", []() {
+    const MlirJitCacheStats stats = GetMlirJitCacheStats();
+    py::dict dict;
+    dict["num_compiles"] = stats.num_compiles;
+    dict["num_memory_hits"] = stats.num_memory_hits;
+    dict["num_disk_hits"] = stats.num_disk_hits;
+    dict["compile_time_ms"] = stats.compile_time_ms;
+    return dict;
+  });
 }
 
 }  // namespace oneflow
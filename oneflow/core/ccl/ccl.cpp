@@ -26,6 +26,7 @@ limitations under the License.
 #include "oneflow/core/job/eager_nccl_comm_manager.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
 #include "oneflow/core/common/constant.h"
+#include "oneflow/core/common/container_util.h"
 
 namespace oneflow {
 namespace ccl {
@@ -305,6 +306,72 @@ Maybe<void> AllGather<DeviceType::kCPU>(const void* in, void* out, size_t elem_c
   return Maybe<void>::Ok();
 }
 
+template<>
+Maybe<void> AllToAll<DeviceType::kCPU>(const void* send, const std::vector<int64_t>& send_offsets,
+                                       const std::vector<int64_t>& send_elem_cnts, void* recv,
+                                       const std::vector<int64_t>& recv_offsets,
+                                       const std::vector<int64_t>& recv_elem_cnts, DataType dtype,
+                                       Symbol<ParallelDesc> parallel_desc, ep::Stream* stream) {
+  const int64_t parallel_num = parallel_desc->parallel_num();
+  CHECK_EQ_OR_RETURN(send_offsets.size(), parallel_num);
+  CHECK_EQ_OR_RETURN(send_elem_cnts.size(), parallel_num);
+  CHECK_EQ_OR_RETURN(recv_offsets.size(), parallel_num);
+  CHECK_EQ_OR_RETURN(recv_elem_cnts.size(), parallel_num);
+  const auto& opt_parallel_id = JUST(GetParallelId4CurrentProcessCtx(parallel_desc));
+  CHECK_OR_RETURN(opt_parallel_id->has_value());
+  const int64_t parallel_id = JUST(*opt_parallel_id);
+  const size_t size_of_dtype = GetSizeOfDataType(dtype);
+  const char* char_send = reinterpret_cast<const char*>(send);
+  char* char_recv = reinterpret_cast<char*>(recv);
+  CHECK_EQ_OR_RETURN(send_elem_cnts.at(parallel_id), recv_elem_cnts.at(parallel_id));
+  if (recv_elem_cnts.at(parallel_id) > 0) {
+    std::memcpy(char_recv + recv_offsets.at(parallel_id) * size_of_dtype,
+                char_send + send_offsets.at(parallel_id) * size_of_dtype,
+                recv_elem_cnts.at(parallel_id) * size_of_dtype);
+  }
+  if (parallel_num == 1) { return Maybe<void>::Ok(); }
+  CHECK_EQ_OR_RETURN(parallel_num, parallel_desc->sorted_machine_ids().size());
+  std::vector<int64_t> ranks(parallel_num);
+  HashMap<int64_t, int64_t> rank2parallel_id;
+  for (int64_t i = 0; i < parallel_num; ++i) {
+    ranks.at(i) = JUST(parallel_desc->MachineId4ParallelId(i));
+    rank2parallel_id[ranks.at(i)] = i;
+  }
+  TransportToken transport_token = JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
+  NaiveAsyncTransportCtx ctx(
+      transport_token,
+      [&](int64_t rank, void** buffer, std::size_t* size,
+          std::function<void()>* Cb) -> Maybe<void> {
+        const int64_t peer = JUST(MapAt(rank2parallel_id, rank));
+        *buffer = const_cast<char*>(char_send + send_offsets.at(peer) * size_of_dtype);
+        *size = send_elem_cnts.at(peer) * size_of_dtype;
+        *Cb = [] {};
+        return Maybe<void>::Ok();
+      },
+      [&](int64_t rank, void** buffer, std::size_t* size,
+          std::function<void()>* Cb) -> Maybe<void> {
+        const int64_t peer = JUST(MapAt(rank2parallel_id, rank));
+        *buffer = char_recv + recv_offsets.at(peer) * size_of_dtype;
+        *size = recv_elem_cnts.at(peer) * size_of_dtype;
+        *Cb = [] {};
+        return Maybe<void>::Ok();
+      });
+  // All peers are posted at once; staggering the order keeps every rank from hitting the same
+  // peer first.
+  for (int64_t i = 1; i < parallel_num; ++i) {
+    const int64_t send_peer = (parallel_id + i) % parallel_num;
+    const int64_t recv_peer = (parallel_id - i + parallel_num) % parallel_num;
+    if (send_elem_cnts.at(send_peer) > 0) {
+      JUST(TransportUtil::SendDataToRank(ranks.at(send_peer), transport_token, &ctx));
+    }
+    if (recv_elem_cnts.at(recv_peer) > 0) {
+      JUST(TransportUtil::ReceiveDataFromRank(ranks.at(recv_peer), transport_token, &ctx));
+    }
+  }
+  JUST(ctx.WaitDone());
+  return Maybe<void>::Ok();
+}
+
 template<>
 Maybe<void> Broadcast<DeviceType::kCPU>(const void* in, void* out, size_t elem_cnt, DataType dtype,
                                         int64_t root, Symbol<ParallelDesc> parallel_desc,
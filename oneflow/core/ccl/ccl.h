@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_CCL_CCL_H_
 #define ONEFLOW_CORE_CCL_CCL_H_
 
+#include <vector>
 #include "oneflow/core/common/data_type.pb.h"
 #include "oneflow/core/common/device_type.h"
 #include "oneflow/core/common/symbol.h"
@@ -59,6 +60,15 @@ template<DeviceType device_type>
 Maybe<void> AllGather(const void* in, void* out, size_t elem_cnt, DataType dtype,
                       Symbol<ParallelDesc> parallel_desc, ep::Stream* stream);
 
+// Rank parallel_id sends send_elem_cnts[i] elements starting at send_offsets[i] to the i-th rank
+// of parallel_desc and receives recv_elem_cnts[i] elements at recv_offsets[i] from it.
+template<DeviceType device_type>
+Maybe<void> AllToAll(const void* send, const std::vector<int64_t>& send_offsets,
+                     const std::vector<int64_t>& send_elem_cnts, void* recv,
+                     const std::vector<int64_t>& recv_offsets,
+                     const std::vector<int64_t>& recv_elem_cnts, DataType dtype,
+                     Symbol<ParallelDesc> parallel_desc, ep::Stream* stream);
+
 template<DeviceType device_type>
 Maybe<void> Send(const void* in, size_t elem_cnt, DataType dtype, int64_t dst, ep::Stream* stream);
 
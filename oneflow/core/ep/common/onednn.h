@@ -23,6 +23,7 @@ limitations under the License.
 namespace oneflow {
 
 DEFINE_ENV_BOOL(ONEFLOW_ENABLE_ONEDNN_OPTS, true);
+DEFINE_ENV_INTEGER(ONEFLOW_ONEDNN_PRIMITIVE_CACHE_CAPACITY, 1024);
 
 namespace ep {
 namespace primitive {
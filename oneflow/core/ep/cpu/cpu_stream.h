@@ -37,6 +37,9 @@ limitations under the License.
 
 #ifdef WITH_ONEDNN
 #include <oneapi/dnnl/dnnl.hpp>
+#include <list>
+#include <unordered_map>
+#include "oneflow/core/ep/common/onednn.h"
 #endif
 
 namespace oneflow {
@@ -158,13 +161,54 @@ class CpuStream : public Stream {
 
 #ifdef WITH_ONEDNN
 
+namespace onednn_key {
+
+template<typename T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value,
+                                             int>::type = 0>
+void Append(std::string* key, const T& value) {
+  const int64_t v = static_cast<int64_t>(value);
+  key->append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+inline void Append(std::string* key, float value) {
+  key->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void Append(std::string* key, const dnnl::memory::dims& dims) {
+  Append(key, dims.size());
+  key->append(reinterpret_cast<const char*>(dims.data()), dims.size() * sizeof(dims[0]));
+}
+
+inline void AppendAll(std::string* key) {}
+
+template<typename T, typename... Args>
+void AppendAll(std::string* key, const T& value, const Args&... args) {
+  Append(key, value);
+  AppendAll(key, args...);
+}
+
+}  // namespace onednn_key
+
+// Key of OneDnnExecutor's primitive cache, `op` names the primitive kind and `args` are everything
+// its primitive descriptor depends on (dims, strides, data types, algorithms, attributes).
+template<typename... Args>
+std::string MakeOneDnnPrimitiveKey(const char* op, const Args&... args) {
+  std::string key(op);
+  key.push_back('\0');
+  onednn_key::AppendAll(&key, args...);
+  return key;
+}
+
 class OneDnnExecutor {
  public:
   OF_DISALLOW_COPY_AND_MOVE(OneDnnExecutor);
 
   OneDnnExecutor() = delete;
 
-  explicit OneDnnExecutor(CpuStream* cpu_stream) : cpu_stream_(cpu_stream) {
+  explicit OneDnnExecutor(CpuStream* cpu_stream)
+      : cpu_stream_(cpu_stream),
+        primitive_cache_capacity_(
+            std::max<int64_t>(EnvInteger<ONEFLOW_ONEDNN_PRIMITIVE_CACHE_CAPACITY>(), 0)) {
     engine_.reset(new dnnl::engine(dnnl::engine::kind::cpu, 0));
     stream_.reset(new dnnl::stream(*engine_));
   }
@@ -178,10 +222,52 @@ class OneDnnExecutor {
     stream_->wait();
   }
 
+  // Returns the primitive cached under `key`, a miss creates it by `create()` and evicts the least
+  // recently used entry when the cache is full.
+  template<typename F>
+  dnnl::primitive GetOrCreatePrimitive(const std::string& key, const F& create) {
+    auto it = primitive_cache_index_.find(key);
+    if (it != primitive_cache_index_.end()) {
+      primitive_cache_hits_ += 1;
+      primitive_cache_.splice(primitive_cache_.begin(), primitive_cache_, it->second);
+      return it->second->second;
+    }
+    primitive_cache_misses_ += 1;
+    dnnl::primitive primitive = create();
+    if (primitive_cache_capacity_ == 0) { return primitive; }
+    if (primitive_cache_.size() >= primitive_cache_capacity_) {
+      primitive_cache_index_.erase(primitive_cache_.back().first);
+      primitive_cache_.pop_back();
+    }
+    primitive_cache_.emplace_front(key, primitive);
+    primitive_cache_index_.emplace(key, primitive_cache_.begin());
+    return primitive;
+  }
+
+  // Debug accessors of the primitive cache.
+  size_t primitive_cache_capacity() const { return primitive_cache_capacity_; }
+  size_t primitive_cache_hits() const { return primitive_cache_hits_; }
+  size_t primitive_cache_misses() const { return primitive_cache_misses_; }
+  size_t primitive_cache_size() const { return primitive_cache_.size(); }
+  // Keys of the cached primitives, from the most to the least recently used.
+  std::vector<std::string> primitive_cache_keys() const {
+    std::vector<std::string> keys;
+    keys.reserve(primitive_cache_.size());
+    for (const auto& pair : primitive_cache_) { keys.push_back(pair.first); }
+    return keys;
+  }
+
  private:
+  using PrimitiveCacheList = std::list<std::pair<std::string, dnnl::primitive>>;
+
   CpuStream* cpu_stream_ = nullptr;
   std::unique_ptr<dnnl::engine> engine_;
   std::unique_ptr<dnnl::stream> stream_;
+  size_t primitive_cache_capacity_;
+  PrimitiveCacheList primitive_cache_;
+  std::unordered_map<std::string, PrimitiveCacheList::iterator> primitive_cache_index_;
+  size_t primitive_cache_hits_ = 0;
+  size_t primitive_cache_misses_ = 0;
 };
 
 #endif
@@ -0,0 +1,98 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef WITH_ONEDNN
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/test/test_util.h"
+
+namespace oneflow {
+
+namespace ep {
+
+namespace test {
+
+namespace {
+
+dnnl::primitive CreateReorder(dnnl::engine* engine, int64_t n) {
+  dnnl::memory::desc md({n}, dnnl::memory::data_type::f32, dnnl::memory::format_tag::a);
+  return dnnl::reorder(dnnl::reorder::primitive_desc(*engine, md, *engine, md));
+}
+
+}  // namespace
+
+TEST(OneDnnExecutor, PrimitiveCacheLru) {
+  ASSERT_EQ(setenv("ONEFLOW_ONEDNN_PRIMITIVE_CACHE_CAPACITY", "2", 1), 0);
+  DeviceManagerRegistry registry;
+  auto device = registry.GetDevice(DeviceType::kCPU, 0);
+  {
+    StreamGuard stream_guard(device.get());
+    const auto& executor = stream_guard.stream()->As<CpuStream>()->onednn_executor();
+    ASSERT_EQ(executor->primitive_cache_capacity(), 2U);
+    const std::string key_a = MakeOneDnnPrimitiveKey("reorder", 1);
+    const std::string key_b = MakeOneDnnPrimitiveKey("reorder", 2);
+    const std::string key_c = MakeOneDnnPrimitiveKey("reorder", 3);
+    executor->Launch([&](dnnl::engine* engine, dnnl::stream* stream) {
+      size_t num_created = 0;
+      auto GetOrCreate = [&](const std::string& key, int64_t n) {
+        return executor->GetOrCreatePrimitive(key, [&]() {
+          num_created += 1;
+          return CreateReorder(engine, n);
+        });
+      };
+      dnnl::primitive a = GetOrCreate(key_a, 1);
+      dnnl::primitive b = GetOrCreate(key_b, 2);
+      EXPECT_EQ(executor->primitive_cache_keys(), (std::vector<std::string>{key_b, key_a}));
+      // A hit returns the cached primitive and makes it the most recently used.
+      EXPECT_EQ(GetOrCreate(key_a, 1).get(), a.get());
+      EXPECT_EQ(executor->primitive_cache_keys(), (std::vector<std::string>{key_a, key_b}));
+      // Exceeding the capacity evicts the least recently used entry, which is now b.
+      GetOrCreate(key_c, 3);
+      EXPECT_EQ(executor->primitive_cache_keys(), (std::vector<std::string>{key_c, key_a}));
+      EXPECT_NE(GetOrCreate(key_b, 2).get(), b.get());
+      EXPECT_EQ(executor->primitive_cache_keys(), (std::vector<std::string>{key_b, key_c}));
+      EXPECT_EQ(num_created, 4U);
+    });
+    EXPECT_EQ(executor->primitive_cache_hits(), 1U);
+    EXPECT_EQ(executor->primitive_cache_misses(), 4U);
+    EXPECT_EQ(executor->primitive_cache_size(), 2U);
+  }
+  ASSERT_EQ(setenv("ONEFLOW_ONEDNN_PRIMITIVE_CACHE_CAPACITY", "0", 1), 0);
+  {
+    StreamGuard stream_guard(device.get());
+    const auto& executor = stream_guard.stream()->As<CpuStream>()->onednn_executor();
+    executor->Launch([&](dnnl::engine* engine, dnnl::stream* stream) {
+      const std::string key = MakeOneDnnPrimitiveKey("reorder", 1);
+      auto Create = [&]() { return CreateReorder(engine, 1); };
+      executor->GetOrCreatePrimitive(key, Create);
+      executor->GetOrCreatePrimitive(key, Create);
+    });
+    // A zero capacity disables caching.
+    EXPECT_EQ(executor->primitive_cache_hits(), 0U);
+    EXPECT_EQ(executor->primitive_cache_misses(), 2U);
+    EXPECT_EQ(executor->primitive_cache_size(), 0U);
+  }
+  ASSERT_EQ(unsetenv("ONEFLOW_ONEDNN_PRIMITIVE_CACHE_CAPACITY"), 0);
+}
+
+}  // namespace test
+
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // WITH_ONEDNN
@@ -99,32 +99,28 @@ class AddOneDnnImpl : public Add {
       }
     }
 
-    stream->As<CpuStream>()->onednn_executor()->Launch(
-        [&](dnnl::engine* onednn_engine, dnnl::stream* onednn_stream) {
-          dnnl::memory::dims src_dims = {static_cast<dnnl::memory::dim>(count)};
-          std::vector<dnnl::memory::desc> src_md;
-          std::vector<dnnl::memory> src_mem;
-          src_md.reserve(arity);
-          src_mem.reserve(arity);
-
-          for (int i = 0; i < arity; i++) {
-            auto md = dnnl::memory::desc(src_dims, type_onednn_, dnnl::memory::format_tag::x);
-            auto mem = dnnl::memory(md, *onednn_engine, (void*)(srcs)[i]);
-            src_md.emplace_back(md);
-            src_mem.emplace_back(mem);
-          }
-
-          std::vector<float> scales(arity, 1.0);
-          auto sum_pd = dnnl::sum::primitive_desc(scales, src_md, *onednn_engine);
-          auto sum_prim = dnnl::sum(sum_pd);
-          auto dst_mem = dnnl::memory(sum_pd.dst_desc(), *onednn_engine, dst);
-          std::unordered_map<int, dnnl::memory> sum_args{{DNNL_ARG_DST, dst_mem}};
-          for (int i = 0; i < arity; ++i) {
-            sum_args.insert({DNNL_ARG_MULTIPLE_SRC + i, src_mem[i]});
-          }
-
-          sum_prim.execute(*onednn_stream, sum_args);
-        });
+    OneDnnExecutor* executor = stream->As<CpuStream>()->onednn_executor().get();
+    executor->Launch([&](dnnl::engine* onednn_engine, dnnl::stream* onednn_stream) {
+      dnnl::memory::dims src_dims = {static_cast<dnnl::memory::dim>(count)};
+      const auto md = dnnl::memory::desc(src_dims, type_onednn_, dnnl::memory::format_tag::x);
+      std::vector<dnnl::memory> src_mem;
+      src_mem.reserve(arity);
+      for (int i = 0; i < arity; i++) {
+        src_mem.emplace_back(dnnl::memory(md, *onednn_engine, (void*)(srcs)[i]));
+      }
+
+      const dnnl::primitive sum_prim = executor->GetOrCreatePrimitive(
+          MakeOneDnnPrimitiveKey("sum", type_onednn_, arity, count), [&]() {
+            std::vector<dnnl::memory::desc> src_md(arity, md);
+            std::vector<float> scales(arity, 1.0);
+            return dnnl::sum(dnnl::sum::primitive_desc(scales, src_md, *onednn_engine));
+          });
+      auto dst_mem = dnnl::memory(md, *onednn_engine, dst);
+      std::unordered_map<int, dnnl::memory> sum_args{{DNNL_ARG_DST, dst_mem}};
+      for (int i = 0; i < arity; ++i) { sum_args.insert({DNNL_ARG_MULTIPLE_SRC + i, src_mem[i]}); }
+
+      sum_prim.execute(*onednn_stream, sum_args);
+    });
   }
 
  private:
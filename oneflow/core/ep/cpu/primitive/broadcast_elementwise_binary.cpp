@@ -180,8 +180,8 @@ class OneDnnBroadcastElementwiseBinaryImpl : public BroadcastElementwiseBinary {
   void Launch(Stream* stream, size_t num_src0_dims, const int64_t* src0_dims, const void* src0,
               size_t num_src1_dims, const int64_t* src1_dims, const void* src1,
               void* dst) override {
-    stream->As<CpuStream>()->onednn_executor()->Launch([&](dnnl::engine* onednn_engine,
-                                                           dnnl::stream* onednn_stream) {
+    OneDnnExecutor* executor = stream->As<CpuStream>()->onednn_executor().get();
+    executor->Launch([&](dnnl::engine* onednn_engine, dnnl::stream* onednn_stream) {
       // onednn do not optimize for 3d tensor in our experiments, so expand it
       // to 4d if needed.
       // Note that only onednn "internal" dims will be affected, the shape
@@ -223,9 +223,13 @@ class OneDnnBroadcastElementwiseBinaryImpl : public BroadcastElementwiseBinary {
       auto src_1_mem = dnnl::memory(src_1_md, *onednn_engine, (void*)onednn_src1);
       auto dst_mem = dnnl::memory(dst_md, *onednn_engine, dst);
 
-      auto binary_d = dnnl::binary::desc(algorithm, src_0_md, src_1_md, dst_md);
-      auto binary_pd = dnnl::binary::primitive_desc(binary_d, *onednn_engine);
-      auto binary_prim = dnnl::binary(binary_pd);
+      const dnnl::primitive binary_prim = executor->GetOrCreatePrimitive(
+          MakeOneDnnPrimitiveKey("binary", algorithm, src_onednn, dst_onednn, src_0_dims,
+                                 src_1_dims, dst_dims),
+          [&]() {
+            auto binary_d = dnnl::binary::desc(algorithm, src_0_md, src_1_md, dst_md);
+            return dnnl::binary(dnnl::binary::primitive_desc(binary_d, *onednn_engine));
+          });
 
       binary_prim.execute(
           *onednn_stream,
@@ -17,6 +17,10 @@ limitations under the License.
 #include "oneflow/core/ep/include/primitive/broadcast_matmul.h"
 #include "oneflow/core/ep/common/primitive/broadcast_matmul.h"
 #include "oneflow/core/common/blas.h"
+#include "oneflow/core/ep/cpu/primitive/type_seq.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/common/onednn.h"
+#include "oneflow/core/device/cpu_pseudo_bfloat16.h"
 
 namespace oneflow {
 
@@ -85,6 +89,168 @@ void LaunchCblasBroadcastMatmul(Stream* /*stream*/, DataType data_type,
                              a_batch_dims, b_batch_dims, c_batch_dims, a, b, c, func);
 }
 
+// Reduced precision matmul without native BLAS support: rows of op(a) are converted block by
+// block to float, multiplied by the float copy of b with sgemm and rounded back into c, so all
+// accumulation happens in float while the fp32 working set stays bounded.
+
+struct Float16Converter {
+  using T = float16;
+  static float ToFloat(T x) { return static_cast<float>(x); }
+  static T FromFloat(float x) { return static_cast<T>(x); }
+};
+
+// bfloat16 has no native type on cpu, values are stored as the upper 16 bits of a float.
+struct BFloat16Converter {
+  using T = uint16_t;
+  static float ToFloat(T x) { return CpuBFloat16ToFloat(x); }
+  static T FromFloat(float x) { return FloatToCpuBFloat16(x); }
+};
+
+constexpr int64_t kConvertingMatmulBlockRows = 64;
+
+template<typename Converter>
+void ConvertingMatmul(CBLAS_TRANSPOSE trans_a, CBLAS_TRANSPOSE trans_b, int64_t m, int64_t n,
+                      int64_t k, float alpha, const typename Converter::T* a,
+                      const typename Converter::T* b, float beta, typename Converter::T* c,
+                      std::vector<float>* buf) {
+  const int64_t block_rows = std::min(m, kConvertingMatmulBlockRows);
+  buf->resize(k * n + block_rows * (k + n));
+  float* b_buf = buf->data();
+  float* a_buf = b_buf + k * n;
+  float* c_buf = a_buf + block_rows * k;
+  for (int64_t i = 0; i < k * n; ++i) { b_buf[i] = Converter::ToFloat(b[i]); }
+  const int ldb = trans_b == CblasNoTrans ? n : k;
+  for (int64_t row_begin = 0; row_begin < m; row_begin += block_rows) {
+    const int64_t rows = std::min(block_rows, m - row_begin);
+    int lda = 0;
+    if (trans_a == CblasNoTrans) {
+      // rows of a are contiguous
+      const typename Converter::T* a_block = a + row_begin * k;
+      for (int64_t i = 0; i < rows * k; ++i) { a_buf[i] = Converter::ToFloat(a_block[i]); }
+      lda = k;
+    } else {
+      // a is stored as (k, m), gather the columns of the block
+      for (int64_t kk = 0; kk < k; ++kk) {
+        const typename Converter::T* a_row = a + kk * m + row_begin;
+        float* a_buf_row = a_buf + kk * rows;
+        for (int64_t i = 0; i < rows; ++i) { a_buf_row[i] = Converter::ToFloat(a_row[i]); }
+      }
+      lda = rows;
+    }
+    typename Converter::T* c_block = c + row_begin * n;
+    if (beta != 0) {
+      for (int64_t i = 0; i < rows * n; ++i) { c_buf[i] = Converter::ToFloat(c_block[i]); }
+    }
+    cblas_gemm<float>(CblasRowMajor, trans_a, trans_b, rows, n, k, alpha, a_buf, lda, b_buf, ldb,
+                      beta, c_buf, n);
+    for (int64_t i = 0; i < rows * n; ++i) { c_block[i] = Converter::FromFloat(c_buf[i]); }
+  }
+}
+
+template<typename Converter>
+void LaunchConvertingBroadcastMatmul(Stream* /*stream*/, DataType data_type,
+                                     BlasTransposeType transpose_a, BlasTransposeType transpose_b,
+                                     int64_t num_batch_dims, const int64_t* broadcast_batch_dims,
+                                     const int64_t* a_batch_dims, const int64_t* b_batch_dims,
+                                     const int64_t* c_batch_dims, int64_t m, int64_t n, int64_t k,
+                                     Scalar alpha, const void* a, const void* b, Scalar beta,
+                                     void* c) {
+  using T = typename Converter::T;
+  const CBLAS_TRANSPOSE cblas_trans_a = GetCblasTranspose(transpose_a);
+  const CBLAS_TRANSPOSE cblas_trans_b = GetCblasTranspose(transpose_b);
+  const float alpha_value = alpha.Value<float>();
+  std::vector<float> buf;
+  auto func = [&](const void* batch_a, const void* batch_b, void* batch_c, Scalar batch_beta) {
+    ConvertingMatmul<Converter>(cblas_trans_a, cblas_trans_b, m, n, k, alpha_value,
+                                static_cast<const T*>(batch_a), static_cast<const T*>(batch_b),
+                                batch_beta.Value<float>(), static_cast<T*>(batch_c), &buf);
+  };
+  ForEachMatmul<kMaxNumDims>(data_type, m, n, k, beta, num_batch_dims, broadcast_batch_dims,
+                             a_batch_dims, b_batch_dims, c_batch_dims, a, b, c, func);
+}
+
+#ifdef WITH_ONEDNN
+
+dnnl::memory::desc OneDnnMatrixDesc(int64_t rows, int64_t cols, bool trans,
+                                    dnnl::memory::data_type data_type) {
+  const dnnl::memory::dims strides =
+      trans ? dnnl::memory::dims{1, rows} : dnnl::memory::dims{cols, 1};
+  return dnnl::memory::desc({rows, cols}, data_type, strides);
+}
+
+dnnl::matmul::primitive_desc NewOneDnnMatmulPrimitiveDesc(const dnnl::engine& engine,
+                                                          dnnl::memory::data_type data_type,
+                                                          bool trans_a, bool trans_b, int64_t m,
+                                                          int64_t n, int64_t k, float alpha,
+                                                          float beta) {
+  dnnl::primitive_attr attr;
+  if (alpha != 1) { attr.set_output_scales(0, {alpha}); }
+  if (beta != 0) {
+    dnnl::post_ops ops;
+    ops.append_sum(beta);
+    attr.set_post_ops(ops);
+  }
+  const dnnl::matmul::desc matmul_d(OneDnnMatrixDesc(m, k, trans_a, data_type),
+                                    OneDnnMatrixDesc(k, n, trans_b, data_type),
+                                    OneDnnMatrixDesc(m, n, false, data_type));
+  return dnnl::matmul::primitive_desc(matmul_d, attr, engine);
+}
+
+// oneDNN falls back to slow reference kernels when the cpu lacks the isa for a reduced precision
+// type, in that case the converting sgemm path is faster.
+bool OneDnnHasOptimizedMatmul(dnnl::memory::data_type data_type) {
+  try {
+    const dnnl::engine engine(dnnl::engine::kind::cpu, 0);
+    const auto pd = NewOneDnnMatmulPrimitiveDesc(engine, data_type, false, false, 64, 64, 64, 1, 0);
+    return pd.impl_info_str().find("ref") == std::string::npos;
+  } catch (const dnnl::error&) { return false; }
+}
+
+template<dnnl::memory::data_type onednn_data_type>
+bool OneDnnMatmulIsAvailable() {
+  static const bool available = OneDnnHasOptimizedMatmul(onednn_data_type);
+  return OneDnnIsEnabled() && available;
+}
+
+template<dnnl::memory::data_type onednn_data_type>
+void LaunchOneDnnBroadcastMatmul(Stream* stream, DataType data_type,
+                                 BlasTransposeType transpose_a, BlasTransposeType transpose_b,
+                                 int64_t num_batch_dims, const int64_t* broadcast_batch_dims,
+                                 const int64_t* a_batch_dims, const int64_t* b_batch_dims,
+                                 const int64_t* c_batch_dims, int64_t m, int64_t n, int64_t k,
+                                 Scalar alpha, const void* a, const void* b, Scalar beta,
+                                 void* c) {
+  const bool trans_a = transpose_a == BlasTransposeType::T;
+  const bool trans_b = transpose_b == BlasTransposeType::T;
+  const float alpha_value = alpha.Value<float>();
+  OneDnnExecutor* executor = stream->As<CpuStream>()->onednn_executor().get();
+  executor->Launch([&](dnnl::engine* onednn_engine, dnnl::stream* onednn_stream) {
+    const dnnl::memory::desc a_md = OneDnnMatrixDesc(m, k, trans_a, onednn_data_type);
+    const dnnl::memory::desc b_md = OneDnnMatrixDesc(k, n, trans_b, onednn_data_type);
+    const dnnl::memory::desc c_md = OneDnnMatrixDesc(m, n, false, onednn_data_type);
+    auto func = [&](const void* batch_a, const void* batch_b, void* batch_c, Scalar batch_beta) {
+      const float beta_value = batch_beta.Value<float>();
+      const dnnl::primitive matmul = executor->GetOrCreatePrimitive(
+          MakeOneDnnPrimitiveKey("matmul", onednn_data_type, trans_a, trans_b, m, n, k, alpha_value,
+                                 beta_value),
+          [&]() {
+            return dnnl::matmul(NewOneDnnMatmulPrimitiveDesc(*onednn_engine, onednn_data_type,
+                                                             trans_a, trans_b, m, n, k,
+                                                             alpha_value, beta_value));
+          });
+      dnnl::memory a_mem(a_md, *onednn_engine, const_cast<void*>(batch_a));
+      dnnl::memory b_mem(b_md, *onednn_engine, const_cast<void*>(batch_b));
+      dnnl::memory c_mem(c_md, *onednn_engine, batch_c);
+      matmul.execute(*onednn_stream,
+                     {{DNNL_ARG_SRC, a_mem}, {DNNL_ARG_WEIGHTS, b_mem}, {DNNL_ARG_DST, c_mem}});
+    };
+    ForEachMatmul<kMaxNumDims>(data_type, m, n, k, beta, num_batch_dims, broadcast_batch_dims,
+                               a_batch_dims, b_batch_dims, c_batch_dims, a, b, c, func);
+  });
+}
+
+#endif  // WITH_ONEDNN
+
 void LaunchBroadcastMatmul(Stream* stream, DataType data_type, BlasTransposeType transpose_a,
                            BlasTransposeType transpose_b, int64_t num_batch_dims,
                            const int64_t* broadcast_batch_dims, const int64_t* a_batch_dims,
@@ -99,6 +265,30 @@ void LaunchBroadcastMatmul(Stream* stream, DataType data_type, BlasTransposeType
     LaunchCblasBroadcastMatmul<double>(stream, data_type, transpose_a, transpose_b, num_batch_dims,
                                        broadcast_batch_dims, a_batch_dims, b_batch_dims,
                                        c_batch_dims, m, n, k, alpha, a, b, beta, c);
+  } else if (data_type == DataType::kFloat16) {
+#ifdef WITH_ONEDNN
+    if (OneDnnMatmulIsAvailable<dnnl::memory::data_type::f16>()) {
+      LaunchOneDnnBroadcastMatmul<dnnl::memory::data_type::f16>(
+          stream, data_type, transpose_a, transpose_b, num_batch_dims, broadcast_batch_dims,
+          a_batch_dims, b_batch_dims, c_batch_dims, m, n, k, alpha, a, b, beta, c);
+      return;
+    }
+#endif  // WITH_ONEDNN
+    LaunchConvertingBroadcastMatmul<Float16Converter>(
+        stream, data_type, transpose_a, transpose_b, num_batch_dims, broadcast_batch_dims,
+        a_batch_dims, b_batch_dims, c_batch_dims, m, n, k, alpha, a, b, beta, c);
+  } else if (data_type == DataType::kBFloat16) {
+#ifdef WITH_ONEDNN
+    if (OneDnnMatmulIsAvailable<dnnl::memory::data_type::bf16>()) {
+      LaunchOneDnnBroadcastMatmul<dnnl::memory::data_type::bf16>(
+          stream, data_type, transpose_a, transpose_b, num_batch_dims, broadcast_batch_dims,
+          a_batch_dims, b_batch_dims, c_batch_dims, m, n, k, alpha, a, b, beta, c);
+      return;
+    }
+#endif  // WITH_ONEDNN
+    LaunchConvertingBroadcastMatmul<BFloat16Converter>(
+        stream, data_type, transpose_a, transpose_b, num_batch_dims, broadcast_batch_dims,
+        a_batch_dims, b_batch_dims, c_batch_dims, m, n, k, alpha, a, b, beta, c);
   } else {
     UNIMPLEMENTED();
   }
@@ -114,7 +304,8 @@ class BroadcastMatmulFactoryImpl : public BroadcastMatmulFactory {
                                        BlasTransposeType transpose_b,
                                        size_t max_num_dims) override {
     if (max_num_dims > kMaxNumDims) { return nullptr; }
-    if (data_type == DataType::kFloat || data_type == DataType::kDouble) {
+    if (data_type == DataType::kFloat || data_type == DataType::kDouble
+        || data_type == DataType::kFloat16 || data_type == DataType::kBFloat16) {
       return std::make_unique<BroadcastMatmulImpl<kMaxNumDims>>(data_type, transpose_a,
                                                                 transpose_b);
     } else {
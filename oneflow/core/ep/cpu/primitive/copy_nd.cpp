@@ -15,6 +15,8 @@ limitations under the License.
 */
 #include "oneflow/core/ep/include/primitive/copy_nd.h"
 #include "oneflow/core/ep/common/primitive/copy_nd.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include <cstring>
 
 namespace oneflow {
 
@@ -23,29 +25,57 @@ namespace primitive {
 
 namespace {
 
+constexpr int64_t kMinElemsPerChunk = 32768;
+
+// Number of elements in the innermost dim of the copy extent.
+template<size_t num_dims, typename IndexType,
+         typename std::enable_if<num_dims == 1, int>::type = 0>
+IndexType GetRowSize(const CopyNdKernelParams<num_dims, IndexType>& params) {
+  return params.count;
+}
+
+template<size_t num_dims, typename IndexType,
+         typename std::enable_if<(num_dims > 1), int>::type = 0>
+IndexType GetRowSize(const CopyNdKernelParams<num_dims, IndexType>& params) {
+  IndexType index[num_dims]{};
+  index[num_dims - 2] = 1;
+  return params.copy_index_helper.NdIndexToOffset(index);
+}
+
+// The innermost dim of the extent is contiguous in both src and dst, so it is copied as one run per
+// row and only the row index is decomposed.
 template<size_t num_dims, size_t movement_size, typename IndexType>
-void CopyNdKernel(CopyNdKernelParams<num_dims, IndexType> params) {
-  using T = typename std::aligned_storage<movement_size, movement_size>::type;
-  const T* src = reinterpret_cast<const T*>(params.src);
-  T* dst = reinterpret_cast<T*>(params.dst);
-  for (IndexType i = 0; i < params.count; ++i) {
-    IndexType copy_index[num_dims];
-    IndexType src_index[num_dims];
-    IndexType dst_index[num_dims];
-    params.copy_index_helper.OffsetToNdIndex(i, copy_index);
-    for (size_t j = 0; j < num_dims; ++j) {
-      src_index[j] = params.src_pos[j] + copy_index[j];
-      dst_index[j] = params.dst_pos[j] + copy_index[j];
-    }
-    const IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
-    const IndexType dst_offset = params.dst_index_helper.NdIndexToOffset(dst_index);
-    dst[dst_offset] = src[src_offset];
-  }
+void CopyNdKernel(Stream* stream, CopyNdKernelParams<num_dims, IndexType> params) {
+  const char* src = static_cast<const char*>(params.src);
+  char* dst = static_cast<char*>(params.dst);
+  if (params.count == 0) { return; }
+  const int64_t cols = GetRowSize(params);
+  const int64_t rows = params.count / cols;
+  const size_t row_size = cols * movement_size;
+  stream->As<CpuStream>()->ParallelFor(
+      0, rows,
+      [&](int64_t begin, int64_t end) {
+        IndexType copy_index[num_dims];
+        IndexType src_index[num_dims];
+        IndexType dst_index[num_dims];
+        for (int64_t row = begin; row < end; ++row) {
+          params.copy_index_helper.OffsetToNdIndex(row * cols, copy_index);
+          for (size_t j = 0; j < num_dims; ++j) {
+            src_index[j] = params.src_pos[j] + copy_index[j];
+            dst_index[j] = params.dst_pos[j] + copy_index[j];
+          }
+          const IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
+          const IndexType dst_offset = params.dst_index_helper.NdIndexToOffset(dst_index);
+          std::memcpy(dst + dst_offset * movement_size, src + src_offset * movement_size,
+                      row_size);
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / cols));
 }
 
 template<size_t num_dims, size_t movement_size, typename IndexType>
 void LaunchKernel(Stream* stream, CopyNdKernelParams<num_dims, IndexType> params) {
-  CopyNdKernel<num_dims, movement_size, IndexType>(params);
+  CopyNdKernel<num_dims, movement_size, IndexType>(stream, params);
 }
 
 class CopyNdImpl : public CopyNd {
@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/ep/cpu/cpu_stream.h"
 #include "oneflow/core/ep/cpu/cpu_device.h"
 #include "oneflow/core/ep/common/onednn.h"
+#include <cstring>
 
 namespace oneflow {
 
@@ -30,29 +31,135 @@ namespace internal {
 
 namespace {
 
+constexpr int64_t kMinElemsPerChunk = 32768;
+constexpr int64_t kTransposeTileSize = 16;
+
+// dst[c * dst_ld + r] = src[r * src_ld + c], full tiles have compile time bounds so that the
+// compiler can unroll and vectorize them.
+template<typename T>
+void TransposeTile(const T* src, int64_t src_ld, T* dst, int64_t dst_ld, int64_t rows,
+                   int64_t cols) {
+  if (rows == kTransposeTileSize && cols == kTransposeTileSize) {
+    for (int64_t c = 0; c < kTransposeTileSize; ++c) {
+      for (int64_t r = 0; r < kTransposeTileSize; ++r) {
+        dst[c * dst_ld + r] = src[r * src_ld + c];
+      }
+    }
+  } else {
+    for (int64_t c = 0; c < cols; ++c) {
+      for (int64_t r = 0; r < rows; ++r) { dst[c * dst_ld + r] = src[r * src_ld + c]; }
+    }
+  }
+}
+
+// The innermost dim is not permuted, every dst row is a contiguous run of src.
 template<size_t num_dims, size_t movement_size, typename IndexType>
-void PermuteKernel(PermuteKernelParams<num_dims, IndexType> params) {
+void PermuteRowsKernel(Stream* stream, const int64_t* src_dims, const void* src_ptr,
+                       const int* permutation, void* dst_ptr, size_t count) {
+  const PermuteKernelParams<num_dims, IndexType> params =
+      MakePermuteParams<num_dims, IndexType>(src_dims, src_ptr, permutation, dst_ptr, count);
+  const int64_t cols = src_dims[num_dims - 1];
+  const int64_t rows = params.count / cols;
+  const size_t row_size = cols * movement_size;
+  const char* src = static_cast<const char*>(params.src);
+  char* dst = static_cast<char*>(params.dst);
+  stream->As<CpuStream>()->ParallelFor(
+      0, rows,
+      [&](int64_t begin, int64_t end) {
+        IndexType src_index[num_dims];
+        IndexType dst_index[num_dims];
+        for (int64_t row = begin; row < end; ++row) {
+          params.dst_index_helper.OffsetToNdIndex(row * cols, dst_index);
+          for (size_t dim = 0; dim < num_dims; ++dim) {
+            src_index[params.permutation[dim]] = dst_index[dim];
+          }
+          const IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
+          std::memcpy(dst + row * row_size, src + src_offset * movement_size, row_size);
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / cols));
+}
+
+// The src innermost dim moves to dst dim `col_dim` and the dst innermost dim comes from src dim
+// `row_dim`, so every index of the remaining dims selects a (rows, cols) matrix that is transposed
+// tile by tile. Work items are row tiles of these matrices.
+template<size_t num_dims, size_t movement_size>
+void PermuteTransposeKernel(Stream* stream, const int64_t* src_dims, const void* src_ptr,
+                            const int* permutation, void* dst_ptr) {
   using T = typename std::aligned_storage<movement_size, movement_size>::type;
-  const T* src = reinterpret_cast<const T*>(params.src);
-  T* dst = reinterpret_cast<T*>(params.dst);
-  for (IndexType i = 0; i < params.count; ++i) {
-    IndexType src_index[num_dims];
-    IndexType dst_index[num_dims];
-    params.dst_index_helper.OffsetToNdIndex(i, dst_index);
-    for (size_t dim = 0; dim < num_dims; ++dim) {
-      src_index[params.permutation[dim]] = dst_index[dim];
-    }
-    IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
-    dst[i] = src[src_offset];
+  const T* src = reinterpret_cast<const T*>(src_ptr);
+  T* dst = reinterpret_cast<T*>(dst_ptr);
+  int64_t src_strides[num_dims];
+  int64_t dst_dims[num_dims];
+  int64_t dst_strides[num_dims];
+  src_strides[num_dims - 1] = 1;
+  for (int64_t i = static_cast<int64_t>(num_dims) - 2; i >= 0; --i) {
+    src_strides[i] = src_strides[i + 1] * src_dims[i + 1];
+  }
+  for (size_t i = 0; i < num_dims; ++i) { dst_dims[i] = src_dims[permutation[i]]; }
+  dst_strides[num_dims - 1] = 1;
+  for (int64_t i = static_cast<int64_t>(num_dims) - 2; i >= 0; --i) {
+    dst_strides[i] = dst_strides[i + 1] * dst_dims[i + 1];
   }
+  const int last_dim = static_cast<int>(num_dims) - 1;
+  const int row_dim = permutation[last_dim];
+  int col_dim = 0;
+  for (int i = 0; i < last_dim; ++i) {
+    if (permutation[i] == last_dim) { col_dim = i; }
+  }
+  const int64_t rows = src_dims[row_dim];
+  const int64_t cols = src_dims[last_dim];
+  const int64_t src_ld = src_strides[row_dim];
+  const int64_t dst_ld = dst_strides[col_dim];
+  // remaining dims in dst order
+  int64_t outer_dims[num_dims];
+  int64_t outer_src_strides[num_dims];
+  int64_t outer_dst_strides[num_dims];
+  int num_outer_dims = 0;
+  int64_t outer_count = 1;
+  for (int i = 0; i < last_dim; ++i) {
+    if (i == col_dim) { continue; }
+    outer_dims[num_outer_dims] = dst_dims[i];
+    outer_src_strides[num_outer_dims] = src_strides[permutation[i]];
+    outer_dst_strides[num_outer_dims] = dst_strides[i];
+    outer_count *= dst_dims[i];
+    num_outer_dims += 1;
+  }
+  const int64_t row_tiles = (rows + kTransposeTileSize - 1) / kTransposeTileSize;
+  stream->As<CpuStream>()->ParallelFor(
+      0, outer_count * row_tiles,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t item = begin; item < end; ++item) {
+          int64_t outer = item / row_tiles;
+          const int64_t row_begin = (item - outer * row_tiles) * kTransposeTileSize;
+          const int64_t tile_rows = std::min(kTransposeTileSize, rows - row_begin);
+          int64_t src_offset = row_begin * src_ld;
+          int64_t dst_offset = row_begin;
+          for (int i = num_outer_dims - 1; i >= 0; --i) {
+            const int64_t index = outer % outer_dims[i];
+            outer /= outer_dims[i];
+            src_offset += index * outer_src_strides[i];
+            dst_offset += index * outer_dst_strides[i];
+          }
+          for (int64_t col_begin = 0; col_begin < cols; col_begin += kTransposeTileSize) {
+            TransposeTile<T>(src + src_offset + col_begin, src_ld,
+                             dst + dst_offset + col_begin * dst_ld, dst_ld, tile_rows,
+                             std::min(kTransposeTileSize, cols - col_begin));
+          }
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / (kTransposeTileSize * cols)));
 }
 
 template<size_t num_dims, size_t movement_size, typename IndexType>
 void LaunchKernel(Stream* stream, const int64_t* src_dims, const void* src, const int* permutation,
                   void* dst, size_t count) {
-  PermuteKernelParams<num_dims, IndexType> params =
-      MakePermuteParams<num_dims, IndexType>(src_dims, src, permutation, dst, count);
-  PermuteKernel<num_dims, movement_size, IndexType>(params);
+  if (permutation[num_dims - 1] == static_cast<int>(num_dims) - 1) {
+    PermuteRowsKernel<num_dims, movement_size, IndexType>(stream, src_dims, src, permutation, dst,
+                                                          count);
+  } else {
+    PermuteTransposeKernel<num_dims, movement_size>(stream, src_dims, src, permutation, dst);
+  }
 }
 class PermuteImpl : public Permute {
  public:
@@ -83,8 +190,8 @@ class OneDnnPermuteImpl : public Permute {
     CHECK_LE(num_dims, kMaxNumDims);
     CHECK_GT(num_dims, 0);
 
-    stream->As<CpuStream>()->onednn_executor()->Launch([&](dnnl::engine* onednn_engine,
-                                                           dnnl::stream* onednn_stream) {
+    OneDnnExecutor* executor = stream->As<CpuStream>()->onednn_executor().get();
+    executor->Launch([&](dnnl::engine* onednn_engine, dnnl::stream* onednn_stream) {
       size_t onednn_num_dims = num_dims;
       dnnl::memory::dims onednn_dims(kMaxNumDims + 1, 0);
       dnnl::memory::dims onednn_permute(kMaxNumDims + 1, 0);
@@ -119,9 +226,12 @@ class OneDnnPermuteImpl : public Permute {
       auto dst_mem_desc = dnnl::memory::desc(onednn_dims, onednn_data_type, dst_stride);
       auto src_mem = dnnl::memory(src_mem_desc, *onednn_engine, const_cast<void*>(src));
       auto dst_mem = dnnl::memory(dst_mem_desc, *onednn_engine, dst);
-      auto reorder_primitive_desc =
-          dnnl::reorder::primitive_desc(*onednn_engine, src_mem_desc, *onednn_engine, dst_mem_desc);
-      auto reorder_primitive = dnnl::reorder(reorder_primitive_desc);
+      const dnnl::primitive reorder_primitive = executor->GetOrCreatePrimitive(
+          MakeOneDnnPrimitiveKey("reorder", onednn_data_type, onednn_dims, src_stride, dst_stride),
+          [&]() {
+            return dnnl::reorder(dnnl::reorder::primitive_desc(*onednn_engine, src_mem_desc,
+                                                               *onednn_engine, dst_mem_desc));
+          });
 
       reorder_primitive.execute(*onednn_stream, {{DNNL_ARG_SRC, src_mem}, {DNNL_ARG_DST, dst_mem}});
     });
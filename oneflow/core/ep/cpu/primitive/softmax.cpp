@@ -81,20 +81,23 @@ class SoftmaxImpl : public SoftmaxBase {
 
 template<class OneDnnSoftmax, dnnl::memory::data_type data_type>
 void SoftmaxOneDnn(Stream* stream, size_t rows, size_t cols, const void* x, void* y) {
-  stream->As<CpuStream>()->onednn_executor()->Launch(
-      [&](dnnl::engine* onednn_engine, dnnl::stream* onednn_stream) {
-        dnnl::memory::dims src_dims = {static_cast<dnnl::memory::dim>(rows),
-                                       static_cast<dnnl::memory::dim>(cols)};
-
-        auto src_md = dnnl::memory::desc(src_dims, data_type, dnnl::memory::format_tag::nc);
-        auto src_mem = dnnl::memory(src_md, *onednn_engine, const_cast<void*>(x));
-        auto dst_mem = dnnl::memory(src_md, *onednn_engine, y);
-        auto softmax_d = typename OneDnnSoftmax::desc(dnnl::prop_kind::forward, src_md, 1);
-        auto softmax_pd = typename OneDnnSoftmax::primitive_desc(softmax_d, *onednn_engine);
-        auto softmax_prim = OneDnnSoftmax(softmax_pd);
-
-        softmax_prim.execute(*onednn_stream, {{DNNL_ARG_SRC, src_mem}, {DNNL_ARG_DST, dst_mem}});
-      });
+  OneDnnExecutor* executor = stream->As<CpuStream>()->onednn_executor().get();
+  executor->Launch([&](dnnl::engine* onednn_engine, dnnl::stream* onednn_stream) {
+    dnnl::memory::dims src_dims = {static_cast<dnnl::memory::dim>(rows),
+                                   static_cast<dnnl::memory::dim>(cols)};
+
+    auto src_md = dnnl::memory::desc(src_dims, data_type, dnnl::memory::format_tag::nc);
+    auto src_mem = dnnl::memory(src_md, *onednn_engine, const_cast<void*>(x));
+    auto dst_mem = dnnl::memory(src_md, *onednn_engine, y);
+    const bool is_log_softmax = std::is_same<OneDnnSoftmax, dnnl::logsoftmax_forward>::value;
+    const dnnl::primitive softmax_prim = executor->GetOrCreatePrimitive(
+        MakeOneDnnPrimitiveKey("softmax", is_log_softmax, data_type, src_dims), [&]() {
+          auto softmax_d = typename OneDnnSoftmax::desc(dnnl::prop_kind::forward, src_md, 1);
+          return OneDnnSoftmax(typename OneDnnSoftmax::primitive_desc(softmax_d, *onednn_engine));
+        });
+
+    softmax_prim.execute(*onednn_stream, {{DNNL_ARG_SRC, src_mem}, {DNNL_ARG_DST, dst_mem}});
+  });
 }
 
 template<typename SoftmaxBase, Algorithm algorithm, dnnl::memory::data_type data_type>
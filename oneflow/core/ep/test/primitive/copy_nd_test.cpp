@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/ep/include/primitive/memset.h"
 #include "oneflow/core/ep/include/primitive/memcpy.h"
 #include "oneflow/core/ep/include/primitive/copy_nd.h"
+#include <numeric>
 
 namespace oneflow {
 
@@ -85,8 +86,89 @@ void TestCopyNd(DeviceManagerRegistry* registry, const std::set<DeviceType>& dev
   }
 }
 
+// Copies `extent` from `src_pos` of a src filled with its indices to `dst_pos` of a dst filled with
+// -1 and checks every dst element.
+template<DataType data_type, typename T>
+void TestCopyNdRegion(DeviceManagerRegistry* registry, const std::set<DeviceType>& device_types,
+                      const std::vector<int64_t>& src_dims, const std::vector<int64_t>& src_pos,
+                      const std::vector<int64_t>& dst_dims, const std::vector<int64_t>& dst_pos,
+                      const std::vector<int64_t>& extent) {
+  const size_t num_dims = extent.size();
+  const int64_t src_elem =
+      std::accumulate(src_dims.begin(), src_dims.end(), int64_t(1), std::multiplies<int64_t>());
+  const int64_t dst_elem =
+      std::accumulate(dst_dims.begin(), dst_dims.end(), int64_t(1), std::multiplies<int64_t>());
+  const int64_t src_size = src_elem * sizeof(T);
+  const int64_t dst_size = dst_elem * sizeof(T);
+  std::vector<T> expected(dst_elem, static_cast<T>(-1));
+  std::vector<int64_t> index(num_dims, 0);
+  const int64_t extent_elem =
+      std::accumulate(extent.begin(), extent.end(), int64_t(1), std::multiplies<int64_t>());
+  for (int64_t i = 0; i < extent_elem; ++i) {
+    int64_t remaining = i;
+    int64_t src_offset = 0;
+    int64_t dst_offset = 0;
+    for (int64_t d = num_dims - 1; d >= 0; --d) {
+      index[d] = remaining % extent[d];
+      remaining /= extent[d];
+    }
+    for (size_t d = 0; d < num_dims; ++d) {
+      src_offset = src_offset * src_dims[d] + src_pos[d] + index[d];
+      dst_offset = dst_offset * dst_dims[d] + dst_pos[d] + index[d];
+    }
+    expected[dst_offset] = static_cast<T>(src_offset);
+  }
+
+  for (const auto& device_type : device_types) {
+    auto device = registry->GetDevice(device_type, 0);
+    ep::test::PinnedMemoryGuard input(device.get(), src_size);
+    ep::test::PinnedMemoryGuard output(device.get(), dst_size);
+    ep::test::DeviceMemoryGuard device_src(device.get(), src_size);
+    ep::test::DeviceMemoryGuard device_dst(device.get(), dst_size);
+    for (int64_t i = 0; i < src_elem; ++i) { *(input.ptr<T>() + i) = static_cast<T>(i); }
+    for (int64_t i = 0; i < dst_elem; ++i) { *(output.ptr<T>() + i) = static_cast<T>(-1); }
+    ep::test::StreamGuard stream(device.get());
+    std::unique_ptr<Memcpy> h2d = NewPrimitive<MemcpyFactory>(device_type, MemcpyKind::kHtoD);
+    ASSERT_TRUE(h2d.operator bool());
+    std::unique_ptr<CopyNd> copy_nd = NewPrimitive<CopyNdFactory>(device_type, num_dims);
+    ASSERT_TRUE(copy_nd.operator bool());
+    std::unique_ptr<Memcpy> d2h = NewPrimitive<MemcpyFactory>(device_type, MemcpyKind::kDtoH);
+    ASSERT_TRUE(d2h.operator bool());
+    h2d->Launch(stream.stream(), device_src.ptr(), input.ptr(), src_size);
+    h2d->Launch(stream.stream(), device_dst.ptr(), output.ptr(), dst_size);
+    copy_nd->Launch(stream.stream(), data_type, num_dims, device_dst.ptr(), dst_dims.data(),
+                    dst_pos.data(), device_src.ptr(), src_dims.data(), src_pos.data(),
+                    extent.data());
+    d2h->Launch(stream.stream(), output.ptr(), device_dst.ptr(), dst_size);
+    CHECK_JUST(stream.stream()->Sync());
+    for (int64_t i = 0; i < dst_elem; ++i) { ASSERT_EQ(expected[i], *(output.ptr<T>() + i)); }
+  }
+}
+
 }  // namespace
 
+TEST_F(PrimitiveTest, TestCopyNdZeroSize) {
+  // an empty extent must leave dst untouched, whichever dim is empty; only the cpu kernel accepts
+  // empty copies
+  if (available_device_types_.count(DeviceType::kCPU) == 0) { return; }
+  const std::set<DeviceType> device_types{DeviceType::kCPU};
+  TestCopyNdRegion<DataType::kFloat, float>(&device_manager_registry_, device_types, {4, 5, 6},
+                                            {1, 0, 2}, {6, 7, 8}, {0, 2, 1}, {0, 5, 3});
+  TestCopyNdRegion<DataType::kFloat, float>(&device_manager_registry_, device_types, {4, 5, 6},
+                                            {1, 0, 2}, {6, 7, 8}, {0, 2, 1}, {3, 4, 0});
+  TestCopyNdRegion<DataType::kInt32, int32_t>(&device_manager_registry_, device_types, {16}, {3},
+                                              {16}, {5}, {0});
+}
+
+TEST_F(PrimitiveTest, TestCopyNd1D) {
+  TestCopyNdRegion<DataType::kFloat, float>(&device_manager_registry_, available_device_types_,
+                                            {37}, {5}, {50}, {11}, {29});
+  TestCopyNdRegion<DataType::kInt8, int8_t>(&device_manager_registry_, available_device_types_,
+                                            {100}, {1}, {100}, {0}, {99});
+  TestCopyNdRegion<DataType::kDouble, double>(&device_manager_registry_, available_device_types_,
+                                              {1}, {0}, {1}, {0}, {1});
+}
+
 TEST_F(PrimitiveTest, TestCopyNd) {
   for (int i = 1; i < 6; ++i) {
     TestCopyNd<DataType::kDouble, double>(&device_manager_registry_, available_device_types_, i);
@@ -17,6 +17,7 @@ limitations under the License.
 #include "oneflow/core/ep/test/primitive/primitive_test.h"
 #include "oneflow/core/ep/include/primitive/memcpy.h"
 #include "oneflow/core/ep/include/primitive/permute.h"
+#include <cstdlib>
 #include <Eigen/Core>
 #include <unsupported/Eigen/CXX11/Tensor>
 namespace oneflow {
@@ -118,6 +119,51 @@ void TestPermute3D(DeviceManagerRegistry* registry, const std::set<DeviceType>&
   }
 }
 
+template<typename T, DataType dtype>
+void TestPermute4D(DeviceManagerRegistry* registry, const std::set<DeviceType>& device_types,
+                   const int dims[4], const int permutation_list[4]) {
+  using EigenVec = Eigen::Matrix<T, 1, Eigen::Dynamic>;
+  const int elem_cnt = dims[0] * dims[1] * dims[2] * dims[3];
+  const int matrix_size = elem_cnt * sizeof(T);
+
+  for (const auto& device_type : device_types) {
+    Eigen::Tensor<T, 4, Eigen::RowMajor> mat(dims[0], dims[1], dims[2], dims[3]);
+    mat.setRandom();
+    auto device = registry->GetDevice(device_type, 0);
+
+    ep::test::PinnedMemoryGuard host_src(device.get(), matrix_size);
+    ep::test::PinnedMemoryGuard host_dst(device.get(), matrix_size);
+    ep::test::DeviceMemoryGuard device_src(device.get(), matrix_size);
+    ep::test::DeviceMemoryGuard device_dst(device.get(), matrix_size);
+
+    ep::test::StreamGuard stream(device.get());
+    std::unique_ptr<Permute> permute =
+        NewPrimitive<PermuteFactory>(device_type, /*max_num_dims=*/4);
+    ASSERT_TRUE(permute.operator bool());
+    std::unique_ptr<Memcpy> h2d = NewPrimitive<MemcpyFactory>(device_type, MemcpyKind::kHtoD);
+    std::unique_ptr<Memcpy> d2h = NewPrimitive<MemcpyFactory>(device_type, MemcpyKind::kDtoH);
+    ASSERT_TRUE(d2h.operator bool());
+    ASSERT_TRUE(h2d.operator bool());
+    std::memcpy(host_src.ptr(), mat.data(), matrix_size);
+    h2d->Launch(stream.stream(), device_src.ptr<T>(), host_src.ptr<T>(), matrix_size);
+    const int64_t src_dims[4] = {dims[0], dims[1], dims[2], dims[3]};
+    permute->Launch(stream.stream(), dtype, /*num_dims=*/4, src_dims, device_src.ptr<T>(),
+                    permutation_list, device_dst.ptr<T>());
+    d2h->Launch(stream.stream(), host_dst.ptr<T>(), device_dst.ptr<T>(), matrix_size);
+    CHECK_JUST(stream.stream()->Sync());
+
+    Eigen::array<int, 4> shuffle_index(
+        {permutation_list[0], permutation_list[1], permutation_list[2], permutation_list[3]});
+    Eigen::Tensor<T, 4, Eigen::RowMajor> mat_transposed = mat.shuffle(shuffle_index);
+
+    auto eigen_transposed_res = Eigen::Map<EigenVec, Eigen::Unaligned>(
+        reinterpret_cast<T*>(mat_transposed.data()), elem_cnt);
+    auto permute_primitive_res =
+        Eigen::Map<EigenVec, Eigen::Unaligned>(host_dst.ptr<T>(), elem_cnt);
+    ASSERT_TRUE(eigen_transposed_res.template isApprox(permute_primitive_res));
+  }
+}
+
 TEST_F(PrimitiveTest, TestBatchPermute) {
   const int permutation_list[2] = {1, 0};
   const int32_t dims0[2] = {2, 3};
@@ -162,6 +208,29 @@ TEST_F(PrimitiveTest, TestPermute) {
       &device_manager_registry_, available_device_types_, dims4, permutation_list4);
 }
 
+TEST_F(PrimitiveTest, TestPermute4D) {
+  // NCHW -> NHWC, NHWC -> NCHW, attention head split/merge, full reverse
+  const int permutation_lists[5][4] = {
+      {0, 2, 3, 1}, {0, 3, 1, 2}, {0, 2, 1, 3}, {1, 0, 2, 3}, {3, 2, 1, 0}};
+  // sizes are not multiples of the cpu transpose tile
+  const int32_t dims[2][4] = {{2, 37, 19, 23}, {3, 17, 33, 8}};
+  // the cpu permute is backed by oneDNN unless it is disabled, run both it and the tiled fallback
+  for (const char* enable_onednn : {"1", "0"}) {
+    ASSERT_EQ(setenv("ONEFLOW_ENABLE_ONEDNN_OPTS", enable_onednn, 1), 0);
+    for (const auto& permutation_list : permutation_lists) {
+      for (const auto& dim : dims) {
+        TestPermute4D<float, DataType::kFloat>(&device_manager_registry_, available_device_types_,
+                                               dim, permutation_list);
+        TestPermute4D<double, DataType::kDouble>(
+            &device_manager_registry_, available_device_types_, dim, permutation_list);
+        TestPermute4D<Eigen::half, DataType::kFloat16>(
+            &device_manager_registry_, available_device_types_, dim, permutation_list);
+      }
+    }
+  }
+  ASSERT_EQ(unsetenv("ONEFLOW_ENABLE_ONEDNN_OPTS"), 0);
+}
+
 }  // namespace test
 
 }  // namespace primitive
@@ -45,6 +45,7 @@ class NNGraph final : public NNGraphIf {
 
   const std::string& job_name() const override { return name_; }
   const Job& job() const { return job_; }
+  const Plan& plan() const { return plan_; }
   int64_t job_id() const { return job_id_; }
   const std::vector<std::string>& inputs_op_names() const override;
   const std::vector<std::string>& outputs_op_names() const override;
@@ -415,7 +415,6 @@ class TensorDotFunctor {
 class FusedMLPFunctor {
  public:
   FusedMLPFunctor() {
-#if CUDA_VERSION >= 11040
     fused_op_.resize(kMaxInputCount /*the maximum number of inputs*/);
     for (int n = 1; n < fused_op_.size(); ++n) {
       fused_op_[n] = CHECK_JUST(one::OpBuilder("cublas_fused_mlp")
@@ -427,7 +426,6 @@ class FusedMLPFunctor {
                                     .Output("hidden", n)
                                     .Build());
     }
-#endif
   }
   Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& x, const TensorTuple& weights,
                            const TensorTuple& biases, bool skip_final_activation) const {
@@ -461,15 +459,21 @@ class FusedMLPFunctor {
       k = n;
     }
 
-#if CUDA_VERSION >= 11060
     DeviceType device_type{};
     if (x->is_consistent()) {
       device_type = JUST(x->parallel_desc())->device_type();
     } else {
       device_type = JUST(x->device())->enum_type();
     }
+    // The cpu kernel is only registered for float and double.
+    const DataType dtype = x->dtype()->data_type();
+    bool has_fused_kernel = (device_type == DeviceType::kCPU)
+                            && (dtype == DataType::kFloat || dtype == DataType::kDouble);
+#if CUDA_VERSION >= 11060
+    has_fused_kernel = has_fused_kernel || (device_type == DeviceType::kCUDA);
+#endif  // CUDA_VERSION >= 11060
 
-    if ((device_type == DeviceType::kCUDA) && (weight_size <= kMaxInputCount)
+    if (has_fused_kernel && (weight_size <= kMaxInputCount)
         && (!ParseBooleanFromEnv("ONEFLOW_FUNCTOR_DISABLE_FUSED_MLP", false))) {
       TensorTuple input(2 * weight_size + 1);
       input[0] = x;
@@ -480,7 +484,6 @@ class FusedMLPFunctor {
       JUST(attrs.SetAttr<bool>("skip_final_activation", skip_final_activation));
       return OpInterpUtil::Dispatch<Tensor>(*fused_op_[weight_size], input, attrs);
     }
-#endif  // CUDA_VERSION >= 11060
 
     // Fall back to Naive matmul + bias_add + relu
     std::shared_ptr<one::Tensor> out = x;
@@ -500,9 +503,7 @@ class FusedMLPFunctor {
   }
 
  private:
-#if CUDA_VERSION >= 11040
   std::vector<std::shared_ptr<OpExpr>> fused_op_;
-#endif
 };
 
 class LayerNormFunctor {
@@ -57,6 +57,15 @@ struct relu_f {
   }
 };
 
+// The cpu fused cell kernels are only registered for float and double, and compute the input
+// gates themselves.
+bool has_cpu_fused_cell_kernel(DeviceType device_type, const std::shared_ptr<one::Tensor>& input,
+                               bool pre_compute_input) {
+  const DataType dtype = input->dtype()->data_type();
+  return device_type == DeviceType::kCPU && !pre_compute_input
+         && (dtype == DataType::kFloat || dtype == DataType::kDouble);
+}
+
 Maybe<void> check_rnn_cell_forward_input(const std::shared_ptr<one::Tensor>& input,
                                          int64_t input_size) {
   CHECK_OR_RETURN(input->shape()->At(1) == input_size)
@@ -231,7 +240,8 @@ struct GRUCell {
       input_device = JUST(input->device())->enum_type();
     }
 
-    if (input_device == DeviceType::kCUDA) {
+    if (input_device == DeviceType::kCUDA
+        || has_cpu_fused_cell_kernel(input_device, input, pre_compute_input)) {
       CHECK_OR_RETURN(!pre_compute_input);
 
       std::shared_ptr<one::Tensor> igates = JUST(params.matmul_ih(input));
@@ -284,7 +294,8 @@ struct LSTMCell {
       input_device = JUST(input->device())->enum_type();
     }
 
-    if (input_device == DeviceType::kCUDA) {
+    if (input_device == DeviceType::kCUDA
+        || has_cpu_fused_cell_kernel(input_device, input, pre_compute_input)) {
       CHECK_OR_RETURN(!pre_compute_input);
 
       std::shared_ptr<one::Tensor> igates = JUST(params.matmul_ih(input));
@@ -32,13 +32,15 @@ using namespace boxing::collective;
 
 namespace {
 
-void NcclInitCollectiveNode(CollectiveBoxingGenericTaskNode* node,
-                            const ParallelDesc& parallel_desc, int64_t parallel_id,
-                            const std::string& name, const LogicalBlobId& lbi,
-                            const BlobDesc& logical_blob_desc, OpType op_type, int64_t root) {
+void InitCollectiveNode(CollectiveBoxingGenericTaskNode* node, const ParallelDesc& parallel_desc,
+                        int64_t parallel_id, const std::string& name, const LogicalBlobId& lbi,
+                        const BlobDesc& logical_blob_desc, OpType op_type, int64_t root,
+                        Backend backend) {
+  const DeviceType device_type =
+      backend == Backend::kBackendCCL ? DeviceType::kCPU : DeviceType::kCUDA;
   OperatorConf op_conf;
   op_conf.set_name(name);
-  op_conf.set_device_tag(*CHECK_JUST(DeviceTag4DeviceType(DeviceType::kCUDA)));
+  op_conf.set_device_tag(*CHECK_JUST(DeviceTag4DeviceType(device_type)));
   CollectiveBoxingGenericOpConf* conf = op_conf.mutable_collective_boxing_generic_conf();
   *conf->mutable_lbi() = lbi;
   RankDesc* rank_desc = conf->mutable_rank_desc();
@@ -59,16 +61,38 @@ void NcclInitCollectiveNode(CollectiveBoxingGenericTaskNode* node,
   } else {
     CHECK_EQ(root, -1);
   }
-  op_desc->set_backend(Backend::kBackendNCCL);
+  op_desc->set_backend(backend);
   rank_desc->set_rank(parallel_id);
 
   const int64_t machine_id = CHECK_JUST(parallel_desc.MachineId4ParallelId(parallel_id));
   const int64_t device_index = CHECK_JUST(parallel_desc.DeviceId4ParallelId(parallel_id));
-  const int64_t thrd_id = EncodeStreamIdToInt64(
-      GenerateNamedTaskStreamId(machine_id, DeviceType::kCUDA, device_index, "NCCL"));
+  const int64_t thrd_id = EncodeStreamIdToInt64(GenerateNamedTaskStreamId(
+      machine_id, device_type, device_index, backend == Backend::kBackendCCL ? "CCL" : "NCCL"));
   node->Init(machine_id, thrd_id, lbi, op_conf);
 }
 
+void NcclInitCollectiveNode(CollectiveBoxingGenericTaskNode* node,
+                            const ParallelDesc& parallel_desc, int64_t parallel_id,
+                            const std::string& name, const LogicalBlobId& lbi,
+                            const BlobDesc& logical_blob_desc, OpType op_type, int64_t root) {
+  InitCollectiveNode(node, parallel_desc, parallel_id, name, lbi, logical_blob_desc, op_type, root,
+                     Backend::kBackendNCCL);
+}
+
+void CclInitCollectiveNode(CollectiveBoxingGenericTaskNode* node,
+                           const ParallelDesc& parallel_desc, int64_t parallel_id,
+                           const std::string& name, const LogicalBlobId& lbi,
+                           const BlobDesc& logical_blob_desc, OpType op_type) {
+  InitCollectiveNode(node, parallel_desc, parallel_id, name, lbi, logical_blob_desc, op_type, -1,
+                     Backend::kBackendCCL);
+}
+
+// The cpu collectives of ccl run between processes, so every process holds exactly one rank.
+bool IsCclSupportedParallelDesc(const ParallelDesc& parallel_desc) {
+  return parallel_desc.device_type() == DeviceType::kCPU && parallel_desc.parallel_num() > 1
+         && parallel_desc.parallel_num() == parallel_desc.sorted_machine_ids().size();
+}
+
 int64_t FindRootParallelId(const ParallelDesc& multi_device, const ParallelDesc& sole_device) {
   CHECK_EQ(sole_device.parallel_num(), 1);
   const int64_t root_machine_id = CHECK_JUST(sole_device.MachineId4ParallelId(0));
@@ -534,6 +558,113 @@ class NcclCollectiveBoxingAll2AllSubTskGphBuilder final : public SubTskGphBuilde
   }
 };
 
+class CclCollectiveBoxingAllReduceSubTskGphBuilder final : public SubTskGphBuilder {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CclCollectiveBoxingAllReduceSubTskGphBuilder);
+  CclCollectiveBoxingAllReduceSubTskGphBuilder() = default;
+  ~CclCollectiveBoxingAllReduceSubTskGphBuilder() override = default;
+
+  Maybe<SubTskGphBuilderStatus> Build(
+      SubTskGphBuilderCtx* ctx, const std::vector<TaskNode*>& sorted_in_tasks,
+      std::vector<TaskNode*>* sorted_out_tasks,
+      std::vector<std::vector<TaskNode*>>* sorted_ctrl_tasks, const ParallelDesc& in_parallel_desc,
+      const ParallelDesc& out_parallel_desc, const LogicalBlobId& lbi,
+      const BlobDesc& logical_blob_desc, const SbpParallel& in_sbp_parallel,
+      const SbpParallel& out_sbp_parallel, const Shape& time_shape) const override {
+    if (out_parallel_desc.Equals(in_parallel_desc)
+        && !SubTskGphBuilderUtil::BlobHasDynamicShape(logical_blob_desc)
+        && IsCclSupportedParallelDesc(out_parallel_desc)
+        && SubTskGphBuilderUtil::IsBoxingP2B(in_sbp_parallel, out_sbp_parallel)) {
+      const std::string op_name = "System-Boxing-CclCollectiveBoxingAllReduce-" + NewUniqueId();
+      FOR_RANGE(int64_t, i, 0, in_parallel_desc.parallel_num()) {
+        TaskNode* in_node = sorted_in_tasks.at(i);
+        auto* collective_node = ctx->task_graph()->NewNode<CollectiveBoxingGenericTaskNode>();
+        CclInitCollectiveNode(collective_node, in_parallel_desc, i, op_name, lbi,
+                              logical_blob_desc, OpType::kOpTypeAllReduce);
+        ctx->task_graph()->ConnectWithLbi(in_node, collective_node, lbi);
+        sorted_out_tasks->emplace_back(collective_node);
+      }
+      return TRY(BuildSubTskGphBuilderStatus("CclCollectiveBoxingAllReduceSubTskGphBuilder", ""));
+    } else {
+      return Error::BoxingNotSupportedError();
+    }
+  }
+};
+
+class CclCollectiveBoxingReduceScatterSubTskGphBuilder final : public SubTskGphBuilder {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CclCollectiveBoxingReduceScatterSubTskGphBuilder);
+  CclCollectiveBoxingReduceScatterSubTskGphBuilder() = default;
+  ~CclCollectiveBoxingReduceScatterSubTskGphBuilder() override = default;
+
+  Maybe<SubTskGphBuilderStatus> Build(
+      SubTskGphBuilderCtx* ctx, const std::vector<TaskNode*>& sorted_in_tasks,
+      std::vector<TaskNode*>* sorted_out_tasks,
+      std::vector<std::vector<TaskNode*>>* sorted_ctrl_tasks, const ParallelDesc& in_parallel_desc,
+      const ParallelDesc& out_parallel_desc, const LogicalBlobId& lbi,
+      const BlobDesc& logical_blob_desc, const SbpParallel& in_sbp_parallel,
+      const SbpParallel& out_sbp_parallel, const Shape& time_shape) const override {
+    if (out_parallel_desc.Equals(in_parallel_desc)
+        && !SubTskGphBuilderUtil::BlobHasDynamicShape(logical_blob_desc)
+        && IsCclSupportedParallelDesc(out_parallel_desc)
+        && logical_blob_desc.shape().NumAxes() > 0
+        && logical_blob_desc.shape().At(0) % out_parallel_desc.parallel_num() == 0
+        && SubTskGphBuilderUtil::IsBoxingP2S(in_sbp_parallel, out_sbp_parallel)
+        && out_sbp_parallel.split_parallel().axis() == 0) {
+      const std::string op_name =
+          "System-Boxing-CclCollectiveBoxingReduceScatter-" + NewUniqueId();
+      FOR_RANGE(int64_t, i, 0, in_parallel_desc.parallel_num()) {
+        TaskNode* in_node = sorted_in_tasks.at(i);
+        auto* collective_node = ctx->task_graph()->NewNode<CollectiveBoxingGenericTaskNode>();
+        CclInitCollectiveNode(collective_node, in_parallel_desc, i, op_name, lbi,
+                              logical_blob_desc, OpType::kOpTypeReduceScatter);
+        ctx->task_graph()->ConnectWithLbi(in_node, collective_node, lbi);
+        sorted_out_tasks->emplace_back(collective_node);
+      }
+      return TRY(
+          BuildSubTskGphBuilderStatus("CclCollectiveBoxingReduceScatterSubTskGphBuilder", ""));
+    } else {
+      return Error::BoxingNotSupportedError();
+    }
+  }
+};
+
+class CclCollectiveBoxingAllGatherSubTskGphBuilder final : public SubTskGphBuilder {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CclCollectiveBoxingAllGatherSubTskGphBuilder);
+  CclCollectiveBoxingAllGatherSubTskGphBuilder() = default;
+  ~CclCollectiveBoxingAllGatherSubTskGphBuilder() override = default;
+
+  Maybe<SubTskGphBuilderStatus> Build(
+      SubTskGphBuilderCtx* ctx, const std::vector<TaskNode*>& sorted_in_tasks,
+      std::vector<TaskNode*>* sorted_out_tasks,
+      std::vector<std::vector<TaskNode*>>* sorted_ctrl_tasks, const ParallelDesc& in_parallel_desc,
+      const ParallelDesc& out_parallel_desc, const LogicalBlobId& lbi,
+      const BlobDesc& logical_blob_desc, const SbpParallel& in_sbp_parallel,
+      const SbpParallel& out_sbp_parallel, const Shape& time_shape) const override {
+    if (out_parallel_desc.Equals(in_parallel_desc)
+        && !SubTskGphBuilderUtil::BlobHasDynamicShape(logical_blob_desc)
+        && IsCclSupportedParallelDesc(out_parallel_desc)
+        && logical_blob_desc.shape().NumAxes() > 0
+        && logical_blob_desc.shape().At(0) % out_parallel_desc.parallel_num() == 0
+        && SubTskGphBuilderUtil::IsBoxingS2B(in_sbp_parallel, out_sbp_parallel)
+        && in_sbp_parallel.split_parallel().axis() == 0) {
+      const std::string op_name = "System-Boxing-CclCollectiveBoxingAllGather-" + NewUniqueId();
+      FOR_RANGE(int64_t, i, 0, in_parallel_desc.parallel_num()) {
+        TaskNode* in_node = sorted_in_tasks.at(i);
+        auto* collective_node = ctx->task_graph()->NewNode<CollectiveBoxingGenericTaskNode>();
+        CclInitCollectiveNode(collective_node, out_parallel_desc, i, op_name, lbi,
+                              logical_blob_desc, OpType::kOpTypeAllGather);
+        ctx->task_graph()->ConnectWithLbi(in_node, collective_node, lbi);
+        sorted_out_tasks->emplace_back(collective_node);
+      }
+      return TRY(BuildSubTskGphBuilderStatus("CclCollectiveBoxingAllGatherSubTskGphBuilder", ""));
+    } else {
+      return Error::BoxingNotSupportedError();
+    }
+  }
+};
+
 }  // namespace
 
 CollectiveBoxingSubTskGphBuilder::CollectiveBoxingSubTskGphBuilder() {
@@ -555,6 +686,11 @@ CollectiveBoxingSubTskGphBuilder::CollectiveBoxingSubTskGphBuilder() {
     LOG(WARNING) << "nccl_enable_all_to_all is unavailable unless NCCL_VERSION > 2.7.0";
 #endif
   }
+  if (collective_boxing_conf.ccl_enable()) {
+    builders.emplace_back(new CclCollectiveBoxingAllReduceSubTskGphBuilder());
+    builders.emplace_back(new CclCollectiveBoxingReduceScatterSubTskGphBuilder());
+    builders.emplace_back(new CclCollectiveBoxingAllGatherSubTskGphBuilder());
+  }
   chain_builder_.reset(new ChainSubTskGphBuilder(builders));
 }
 
@@ -0,0 +1,304 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/collective_boxing/ccl_executor_backend.h"
+#include "oneflow/core/job/collective_boxing/request_store.h"
+#include "oneflow/core/ccl/ccl.h"
+#include "oneflow/core/common/channel.h"
+#include "oneflow/core/graph/boxing/collective_boxing_util.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/parallel_desc.h"
+#include "oneflow/core/thread/thread_consistent_id.h"
+
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace oneflow {
+
+namespace boxing {
+
+namespace collective {
+
+namespace {
+
+ccl::ReduceType GetCclReduceType(ReduceMethod reduce_method) {
+  if (reduce_method == kReduceMethodSum) {
+    return ccl::kSum;
+  } else {
+    UNIMPLEMENTED();
+    return ccl::kInvalidReduceFunctorType;
+  }
+}
+
+Symbol<ParallelDesc> MakeCpuParallelDesc(const DeviceSet& device_set) {
+  ParallelConf parallel_conf;
+  parallel_conf.set_device_tag("cpu");
+  for (const auto& device : device_set.device()) {
+    parallel_conf.add_device_name(std::to_string(device.machine_id()) + ":"
+                                  + std::to_string(device.device_id()));
+  }
+  return SymbolOf(ParallelDesc(parallel_conf));
+}
+
+// Everything the worker needs to run one request, so that it never touches the request store.
+struct CclRequest {
+  OpType op_type;
+  DataType data_type;
+  ReduceMethod reduce_method;
+  int64_t elem_cnt;
+  int64_t size_in_bytes;
+  Symbol<ParallelDesc> parallel_desc;
+  std::shared_ptr<const RuntimeRequestInfo> runtime_request_info;
+};
+
+Maybe<void> LaunchCclRequest(const CclRequest& request) {
+  const void* send_buff = request.runtime_request_info->send_buff;
+  void* recv_buff = request.runtime_request_info->recv_buff;
+  const int64_t num_ranks = request.parallel_desc->parallel_num();
+  if (request.op_type == OpType::kOpTypeAllReduce) {
+    JUST(ccl::AllReduce<DeviceType::kCPU>(send_buff, recv_buff, request.elem_cnt,
+                                          request.data_type,
+                                          GetCclReduceType(request.reduce_method),
+                                          request.parallel_desc, nullptr));
+  } else if (request.op_type == OpType::kOpTypeReduceScatter) {
+    CHECK_EQ_OR_RETURN(request.elem_cnt % num_ranks, 0);
+    JUST(ccl::ReduceScatter<DeviceType::kCPU>(send_buff, recv_buff, request.elem_cnt / num_ranks,
+                                              request.data_type,
+                                              GetCclReduceType(request.reduce_method),
+                                              request.parallel_desc, nullptr));
+  } else if (request.op_type == OpType::kOpTypeAllGather) {
+    CHECK_EQ_OR_RETURN(request.elem_cnt % num_ranks, 0);
+    JUST(ccl::AllGather<DeviceType::kCPU>(send_buff, recv_buff, request.elem_cnt / num_ranks,
+                                          request.data_type, request.parallel_desc, nullptr));
+  } else {
+    UNIMPLEMENTED_THEN_RETURN() << "unsupported op type of ccl collective boxing: "
+                                << OpType_Name(request.op_type);
+  }
+  return Maybe<void>::Ok();
+}
+
+// Reduces all requests of the group with a single all-reduce on a packed buffer.
+Maybe<void> LaunchFusedAllReduce(const std::vector<CclRequest>& requests,
+                                 std::vector<char>* fusion_buffer) {
+  const CclRequest& first = requests.front();
+  int64_t offset = 0;
+  for (const auto& request : requests) { offset += request.size_in_bytes; }
+  if (fusion_buffer->size() < offset) { fusion_buffer->resize(offset); }
+  offset = 0;
+  for (const auto& request : requests) {
+    std::memcpy(fusion_buffer->data() + offset, request.runtime_request_info->send_buff,
+                request.size_in_bytes);
+    offset += request.size_in_bytes;
+  }
+  JUST(ccl::AllReduce<DeviceType::kCPU>(
+      fusion_buffer->data(), fusion_buffer->data(), offset / GetSizeOfDataType(first.data_type),
+      first.data_type, GetCclReduceType(first.reduce_method), first.parallel_desc, nullptr));
+  offset = 0;
+  for (const auto& request : requests) {
+    std::memcpy(request.runtime_request_info->recv_buff, fusion_buffer->data() + offset,
+                request.size_in_bytes);
+    offset += request.size_in_bytes;
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> LaunchGroup(const std::vector<CclRequest>& requests,
+                        std::vector<char>* fusion_buffer) {
+  if (requests.front().op_type == OpType::kOpTypeAllReduce && requests.size() > 1) {
+    JUST(LaunchFusedAllReduce(requests, fusion_buffer));
+  } else {
+    for (const auto& request : requests) { JUST(LaunchCclRequest(request)); }
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+// The backend is created with the scheduler of the session, before ccl may be enabled by a
+// resource update. The worker thread is started by the first job with ccl requests, and the
+// fusion options are read whenever requests are grouped.
+struct CclExecutorBackend::Impl {
+  explicit Impl(std::shared_ptr<RequestStore> request_store)
+      : request_store(std::move(request_store)) {}
+  ~Impl() {
+    group_chan.Close();
+    if (worker.joinable()) { worker.join(); }
+  }
+
+  // The cpu collectives are transported by the control plane of the current thread, so all of
+  // them run on a dedicated thread in the order the scheduler executes the groups.
+  void PollGroup() {
+    CHECK_JUST(InitThisThreadConsistentId(kThreadConsistentIdCollectiveBoxing,
+                                          "CollectiveBoxingCcl"));
+    std::vector<char> fusion_buffer;
+    while (true) {
+      std::vector<CclRequest> requests;
+      ChannelStatus status = group_chan.Receive(&requests);
+      if (status == kChannelStatusErrorClosed) { break; }
+      CHECK_EQ(status, kChannelStatusSuccess);
+      const Maybe<void> result = LaunchGroup(requests, &fusion_buffer);
+      for (const auto& request : requests) { request.runtime_request_info->callback(result); }
+    }
+  }
+
+  void InitParallelDesc(int64_t job_id) {
+    request_store->ForEachMutRequestEntryInJob(
+        job_id, [&](RequestEntry* request_entry, int32_t i, const RequestId& request_id) {
+          const auto& request = request_entry->desc();
+          if (request.op_desc().backend() != Backend::kBackendCCL) { return; }
+          if (!request_entry->HasRankOnThisNode()) { return; }
+          CHECK_EQ(request_entry->LocalRankCount(), 1)
+              << "ccl collective boxing requires one rank per process";
+          if (!worker.joinable()) { worker = std::thread(&Impl::PollGroup, this); }
+          const auto& device_set_symbol = request_entry->device_set_symbol();
+          if (device_set2parallel_desc.count(device_set_symbol) > 0) { return; }
+          device_set2parallel_desc.emplace(device_set_symbol,
+                                           MakeCpuParallelDesc(request.device_set()));
+        });
+  }
+
+  bool CanRequestEntryFuse(const RequestEntry* lhs, const RequestEntry* rhs) const {
+    if (lhs->device_set_symbol() != rhs->device_set_symbol()) { return false; }
+    const auto& lhs_op_desc = lhs->desc().op_desc();
+    const auto& rhs_op_desc = rhs->desc().op_desc();
+    if (lhs_op_desc.op_type() != rhs_op_desc.op_type()) { return false; }
+    if (lhs_op_desc.op_type() == OpType::kOpTypeAllReduce) {
+      return lhs_op_desc.reduce_method() == rhs_op_desc.reduce_method()
+             && lhs_op_desc.data_type() == rhs_op_desc.data_type();
+    }
+    return true;
+  }
+
+  void GroupRequests(const std::vector<RequestId>& request_ids,
+                     const std::function<void(std::vector<RequestId>&&, void*)>& Handler) {
+    const CollectiveBoxingConf& conf =
+        Global<ResourceDesc, ForSession>::Get()->collective_boxing_conf();
+    CHECK_GE(conf.ccl_fusion_threshold_mb(), 0);
+    CHECK_GT(conf.ccl_fusion_max_ops(), 0);
+    const int64_t fusion_threshold = conf.ccl_fusion_threshold_mb() * 1024 * 1024;
+    std::vector<RequestId> group;
+    int64_t group_size = 0;
+    request_store->ForEachMutRequestEntryForIdsInJob(
+        request_ids, [&](RequestEntry* request_entry, int32_t i, const RequestId& request_id) {
+          const int64_t size = request_entry->size_in_bytes();
+          if (group.empty()
+              || !CanRequestEntryFuse(request_store->MutRequestEntry(group.back()), request_entry)
+              || group_size + size > fusion_threshold
+              || group.size() >= conf.ccl_fusion_max_ops()) {
+            if (!group.empty()) {
+              void* token = CreateGroupToken(group);
+              Handler(std::move(group), token);
+              group.clear();
+              group_size = 0;
+            }
+          }
+          group.emplace_back(request_id);
+          group_size += size;
+        });
+    if (!group.empty()) {
+      void* token = CreateGroupToken(group);
+      Handler(std::move(group), token);
+    }
+  }
+
+  struct GroupToken {
+    GroupToken(const std::vector<RequestId>& group, Symbol<ParallelDesc> parallel_desc)
+        : request_ids(group), parallel_desc(parallel_desc) {}
+    std::vector<RequestId> request_ids;
+    Symbol<ParallelDesc> parallel_desc;
+  };
+
+  void* CreateGroupToken(const std::vector<RequestId>& group) {
+    CHECK_GT(group.size(), 0);
+    const Symbol<DeviceSet>& first_device_set =
+        request_store->MutRequestEntry(group.front())->device_set_symbol();
+    auto it = device_set2parallel_desc.find(first_device_set);
+    CHECK(it != device_set2parallel_desc.end());
+    request_store->ForEachMutRequestEntryForIdsInJob(
+        group, [&](RequestEntry* request_entry, int32_t i, const RequestId& request_id) {
+          CHECK(request_entry->device_set_symbol() == first_device_set);
+        });
+    return new GroupToken(group, it->second);
+  }
+
+  void DestroyGroupToken(void* group_token) {
+    GroupToken* token = static_cast<GroupToken*>(group_token);
+    delete token;
+  }
+
+  void ExecuteGroup(void* group_token) {
+    GroupToken* token = static_cast<GroupToken*>(group_token);
+    const std::vector<RequestId>& request_ids = token->request_ids;
+    if (request_ids.empty()) { return; }
+    std::vector<CclRequest> requests;
+    requests.reserve(request_ids.size());
+    request_store->ForEachMutRequestEntryForIdsInJob(
+        request_ids, [&](RequestEntry* request_entry, int32_t i, const RequestId& request_id) {
+          const auto& op_desc = request_entry->desc().op_desc();
+          CclRequest request;
+          request.op_type = op_desc.op_type();
+          request.data_type = op_desc.data_type();
+          request.reduce_method = op_desc.reduce_method();
+          request.elem_cnt = request_entry->elem_cnt();
+          request.size_in_bytes = request_entry->size_in_bytes();
+          request.parallel_desc = token->parallel_desc;
+          request.runtime_request_info = std::move(request_entry->ResetRuntimeRequest().at(0));
+          requests.emplace_back(std::move(request));
+        });
+    CHECK_EQ(group_chan.Send(std::move(requests)), kChannelStatusSuccess);
+  }
+
+  std::shared_ptr<RequestStore> request_store;
+  HashMap<Symbol<DeviceSet>, Symbol<ParallelDesc>> device_set2parallel_desc;
+  Channel<std::vector<CclRequest>> group_chan;
+  std::thread worker;
+};
+
+CclExecutorBackend::CclExecutorBackend() = default;
+
+CclExecutorBackend::~CclExecutorBackend() = default;
+
+void CclExecutorBackend::Init(std::shared_ptr<RequestStore> request_store) {
+  impl_ = std::make_unique<Impl>(request_store);
+}
+
+void CclExecutorBackend::InitJob(int64_t job_id) { impl_->InitParallelDesc(job_id); }
+
+void CclExecutorBackend::DeinitJob(int64_t job_id) {}
+
+void CclExecutorBackend::GroupRequests(
+    const std::vector<RequestId>& request_ids,
+    const std::function<void(std::vector<RequestId>&&, void*)>& Handler) {
+  impl_->GroupRequests(request_ids, Handler);
+}
+
+void* CclExecutorBackend::CreateGroupToken(const std::vector<RequestId>& group) {
+  return impl_->CreateGroupToken(group);
+}
+
+void CclExecutorBackend::DestroyGroupToken(void* group_token) {
+  return impl_->DestroyGroupToken(group_token);
+}
+
+void CclExecutorBackend::ExecuteGroup(void* group_token) { impl_->ExecuteGroup(group_token); }
+
+}  // namespace collective
+
+}  // namespace boxing
+
+}  // namespace oneflow
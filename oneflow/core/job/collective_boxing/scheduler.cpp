@@ -21,6 +21,7 @@ limitations under the License.
 #include "oneflow/core/graph/boxing/collective_boxing_util.h"
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/job/collective_boxing/nccl_executor_backend.h"
+#include "oneflow/core/job/collective_boxing/ccl_executor_backend.h"
 #include "oneflow/core/job/plan.pb.h"
 #include "oneflow/core/job/resource_desc.h"
 #include "oneflow/core/device/cuda_util.h"
@@ -129,20 +130,23 @@ void ExecutorImpl::Init(std::shared_ptr<RequestStore> request_store) {
     backends_.at(Backend::kBackendNCCL) = std::move(nccl_backend);
   }
 #endif
+  // ccl_enable may be turned on after the session is initialized, it only gates the sub task graph
+  // builders.
+  std::unique_ptr<ExecutorBackend> ccl_backend = std::make_unique<CclExecutorBackend>();
+  ccl_backend->Init(request_store_);
+  backends_.at(Backend::kBackendCCL) = std::move(ccl_backend);
 }
 
 void ExecutorImpl::InitJob(int64_t job_id) {
-#ifdef WITH_CUDA
-  if (backends_.at(Backend::kBackendNCCL)) { backends_.at(Backend::kBackendNCCL)->InitJob(job_id); }
-#endif
+  for (auto& backend : backends_) {
+    if (backend) { backend->InitJob(job_id); }
+  }
 }
 
 void ExecutorImpl::DeinitJob(int64_t job_id) {
-#ifdef WITH_CUDA
-  if (backends_.at(Backend::kBackendNCCL)) {
-    backends_.at(Backend::kBackendNCCL)->DeinitJob(job_id);
+  for (auto& backend : backends_) {
+    if (backend) { backend->DeinitJob(job_id); }
   }
-#endif
 }
 
 GroupToken* ExecutorImpl::CreateGroupToken(const std::vector<RequestId>& group,
@@ -151,7 +155,7 @@ GroupToken* ExecutorImpl::CreateGroupToken(const std::vector<RequestId>& group,
 }
 
 void ExecutorImpl::DestroyGroupToken(GroupToken* group_token) {
-  backends_.at(Backend::kBackendNCCL)->DestroyGroupToken(group_token->backend_group_token());
+  backends_.at(group_token->backend())->DestroyGroupToken(group_token->backend_group_token());
   delete group_token;
 }
 
@@ -119,6 +119,18 @@ void ResourceDesc::Update(const Resource& reso_conf) {
     resource_.set_disable_group_boxing_by_dst_parallel(
         reso_conf.disable_group_boxing_by_dst_parallel());
   }
+  const CollectiveBoxingConf& collective_boxing_conf = reso_conf.collective_boxing_conf();
+  CollectiveBoxingConf* mut_collective_boxing_conf = resource_.mutable_collective_boxing_conf();
+  if (collective_boxing_conf.has_ccl_enable()) {
+    mut_collective_boxing_conf->set_ccl_enable(collective_boxing_conf.ccl_enable());
+  }
+  if (collective_boxing_conf.has_ccl_fusion_threshold_mb()) {
+    mut_collective_boxing_conf->set_ccl_fusion_threshold_mb(
+        collective_boxing_conf.ccl_fusion_threshold_mb());
+  }
+  if (collective_boxing_conf.has_ccl_fusion_max_ops()) {
+    mut_collective_boxing_conf->set_ccl_fusion_max_ops(collective_boxing_conf.ccl_fusion_max_ops());
+  }
 }
 
 }  // namespace oneflow
@@ -41,21 +41,81 @@ bool IsUserOpWithTypeName(const OperatorConf& op_conf, const std::string& op_typ
   return op_conf.has_user_conf() && op_conf.user_conf().op_type_name() == op_type_name;
 };
 
+// Update ops which can be replaced by a multi_tensor_* op: CPU, a single device, no amsgrad and
+// the same data type for model and model_diff, since the CPU multi tensor kernels need them.
+bool IsMultiTensorUpdateSupported(const OpNode* op_node) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  if (!IsUserOpWithTypeName(op_conf, "sgd_update") && !IsUserOpWithTypeName(op_conf, "adam_update")
+      && !IsUserOpWithTypeName(op_conf, "lamb_update")) {
+    return false;
+  }
+  if (op_node->parallel_desc().device_type() != DeviceType::kCPU
+      || op_node->parallel_desc().parallel_num() != 1) {
+    return false;
+  }
+  const user_op::UserOpConfWrapper user_op_conf(op_conf);
+  if (user_op_conf.op_type_name() == "adam_update"
+      && (user_op_conf.attr<bool>("amsgrad") || user_op_conf.has_input("max_v", 0))) {
+    return false;
+  }
+  const DataType model_data_type =
+      op_node->LogicalBlobDesc4Lbi(GenLogicalBlobId(user_op_conf.input("model", 0))).data_type();
+  const DataType model_diff_data_type =
+      op_node->LogicalBlobDesc4Lbi(GenLogicalBlobId(user_op_conf.input("model_diff", 0)))
+          .data_type();
+  return model_data_type == model_diff_data_type
+         && (model_data_type == DataType::kFloat || model_data_type == DataType::kDouble);
+}
+
+// Update ops can share a multi tensor op when everything but their tensors is the same.
+std::string GetMultiTensorUpdateGroupKey(const OpNode* op_node) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  const user_op::UserOpConfWrapper user_op_conf(op_conf);
+  std::string key = user_op_conf.op_type_name() + "\n" + std::to_string(op_conf.scope_symbol_id())
+                    + "\n" + PbMessage2TxtString(op_node->parallel_desc().parallel_conf());
+  const DataType data_type =
+      op_node->LogicalBlobDesc4Lbi(GenLogicalBlobId(user_op_conf.input("model", 0))).data_type();
+  key += "\n" + DataType_Name(data_type);
+  for (const std::string& arg_name :
+       {"learning_rate", "scale_by_tensor", "skip_if", "bias_correction1", "bias_correction2"}) {
+    if (user_op_conf.has_input(arg_name, 0)) {
+      key += "\n" + arg_name + ":" + user_op_conf.input(arg_name, 0);
+    }
+  }
+  const std::map<std::string, AttrValue> attrs(op_conf.user_conf().attr().begin(),
+                                               op_conf.user_conf().attr().end());
+  for (const auto& pair : attrs) {
+    key += "\n" + pair.first + ":" + PbMessage2TxtString(pair.second);
+  }
+  return key;
+}
+
 class FuseUpdateOpsPass final : public JobPass {
  public:
   FuseUpdateOpsPass() = default;
   ~FuseUpdateOpsPass() override = default;
 
   bool IsEnabled(const JobPassCtx& ctx) const {
-    return ctx.job_desc().job_conf().enable_fuse_model_update_ops();
+    return ctx.job_desc().job_conf().enable_fuse_model_update_ops()
+           || ctx.job_desc().job_conf().enable_multi_tensor_model_update();
   }
   Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder) const;
+  Maybe<void> ApplyMultiTensorUpdate(const OpGraph& op_graph, JobBuilder* job_builder) const;
 
   Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
     if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
-    const OpGraph op_graph(*job);
-    JobBuilder job_builder(job);
-    return Apply(op_graph, &job_builder);
+    if (ctx->job_desc().job_conf().enable_fuse_model_update_ops()) {
+      const OpGraph op_graph(*job);
+      JobBuilder job_builder(job);
+      JUST(Apply(op_graph, &job_builder));
+    }
+    // Grouping runs on the rewritten job, so that the multi tensor ops take the fused update ops.
+    if (ctx->job_desc().job_conf().enable_multi_tensor_model_update()) {
+      const OpGraph op_graph(*job);
+      JobBuilder job_builder(job);
+      JUST(ApplyMultiTensorUpdate(op_graph, &job_builder));
+    }
+    return Maybe<void>::Ok();
   }
 };
 
@@ -237,6 +297,80 @@ Maybe<void> FuseUpdateOpsPass::Apply(const OpGraph& op_graph, JobBuilder* job_bu
   return Maybe<void>::Ok();
 }
 
+Maybe<void> FuseUpdateOpsPass::ApplyMultiTensorUpdate(const OpGraph& op_graph,
+                                                      JobBuilder* job_builder) const {
+  HashSet<std::string> ctrl_in_op_names;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    for (const std::string& ctrl_in_op_name : op_node->op().op_conf().ctrl_in_op_name()) {
+      ctrl_in_op_names.insert(ctrl_in_op_name);
+    }
+  });
+  std::vector<std::string> group_keys;
+  HashMap<std::string, std::vector<const OpNode*>> group_key2op_nodes;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    if (!IsMultiTensorUpdateSupported(op_node)) { return; }
+    if (!op_node->op().op_conf().ctrl_in_op_name().empty()
+        || ctrl_in_op_names.count(op_node->op().op_name()) > 0) {
+      return;
+    }
+    const std::string key = GetMultiTensorUpdateGroupKey(op_node);
+    auto it = group_key2op_nodes.find(key);
+    if (it == group_key2op_nodes.end()) {
+      group_keys.emplace_back(key);
+      it = group_key2op_nodes.emplace(key, std::vector<const OpNode*>()).first;
+    }
+    it->second.emplace_back(op_node);
+  });
+
+  std::vector<std::string> del_op_names;
+  for (const std::string& key : group_keys) {
+    const std::vector<const OpNode*>& op_nodes = group_key2op_nodes.at(key);
+    if (op_nodes.size() < 2) { continue; }
+    const OperatorConf& first_op_conf = op_nodes.front()->op().op_conf();
+    const user_op::UserOpConfWrapper first_conf(first_op_conf);
+    const bool has_moments = first_conf.op_type_name() != "sgd_update";
+
+    user_op::UserOpConfWrapperBuilder multi_tensor_op_builder(
+        "System-MultiTensorModelUpdate-" + first_conf.op_type_name() + "_" + NewUniqueId());
+    multi_tensor_op_builder.OpTypeName("multi_tensor_" + first_conf.op_type_name());
+    for (const std::string& arg_name : {"model", "model_diff", "m", "v"}) {
+      if (!has_moments && (arg_name == "m" || arg_name == "v")) { continue; }
+      for (const OpNode* op_node : op_nodes) {
+        const user_op::UserOpConfWrapper user_op_conf(op_node->op().op_conf());
+        multi_tensor_op_builder.Input(arg_name, user_op_conf.input(arg_name, 0));
+      }
+    }
+    for (const std::string& arg_name :
+         {"learning_rate", "scale_by_tensor", "skip_if", "bias_correction1", "bias_correction2"}) {
+      if (first_conf.has_input(arg_name, 0)) {
+        multi_tensor_op_builder.Input(arg_name, first_conf.input(arg_name, 0));
+      }
+    }
+    multi_tensor_op_builder
+        .Attr<float>("learning_rate_val", first_conf.attr<float>("learning_rate_val"))
+        .Attr<double>("scale", first_conf.attr<double>("scale"))
+        .Attr<float>("l1", first_conf.attr<float>("l1"))
+        .Attr<float>("l2", first_conf.attr<float>("l2"))
+        .Attr<float>("weight_decay", first_conf.attr<float>("weight_decay"));
+    if (has_moments) {
+      multi_tensor_op_builder
+          .Attr<float>("bias_correction1_val", first_conf.attr<float>("bias_correction1_val"))
+          .Attr<float>("bias_correction2_val", first_conf.attr<float>("bias_correction2_val"))
+          .Attr<float>("beta1", first_conf.attr<float>("beta1"))
+          .Attr<float>("beta2", first_conf.attr<float>("beta2"))
+          .Attr<float>("epsilon", first_conf.attr<float>("epsilon"))
+          .Attr<bool>("do_bias_correction", first_conf.attr<bool>("do_bias_correction"));
+    }
+    CHECK_OR_RETURN(first_op_conf.has_scope_symbol_id());
+    multi_tensor_op_builder.ScopeSymbolId(first_op_conf.scope_symbol_id());
+    job_builder->AddOps(op_nodes.front()->parallel_desc().parallel_conf(),
+                        {multi_tensor_op_builder.Build().op_conf()});
+    for (const OpNode* op_node : op_nodes) { del_op_names.emplace_back(op_node->op().op_name()); }
+  }
+  job_builder->DelOps(del_op_names);
+  return Maybe<void>::Ok();
+}
+
 }  // namespace
 
 REGISTER_JOB_PASS("FuseUpdateOpsPass", FuseUpdateOpsPass);
@@ -17,26 +17,298 @@ limitations under the License.
 #include "oneflow/core/common/preprocessor.h"
 #include "oneflow/core/ndarray/ndarray_reduce_impl.h"
 #include "oneflow/core/ndarray/binary_func.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
 
 namespace oneflow {
 
-#define SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(struct_name)                                        \
-  template<typename T, template<typename> class binary_func>                                   \
-  struct struct_name<DeviceType::kCPU, T, binary_func> final {                                 \
-    using RetT = typename BinaryFuncTrait<binary_func, T>::return_type;                        \
-    static bool Matched(const XpuVarNdarray<RetT>& y, const XpuVarNdarray<const T>& x) {       \
-      return false;                                                                            \
-    }                                                                                          \
-    static void Reduce(ep::Stream* stream, const XpuVarNdarray<RetT>& y,                       \
-                       const XpuVarNdarray<const T>& x, const XpuVarNdarray<T>& tmp_storage) { \
-      UNIMPLEMENTED();                                                                         \
-    }                                                                                          \
+namespace {
+
+constexpr int64_t kReduceLanes = 8;
+constexpr int64_t kPairwiseBlockSize = 16 * kReduceLanes;
+constexpr int64_t kColBlockSize = 128;
+constexpr int64_t kMinElemsPerChunk = 32768;
+
+template<typename T, template<typename> class binary_func>
+struct IsCompensatedSum final {
+  static constexpr bool value =
+      std::is_floating_point<T>::value && std::is_same<binary_func<T>, BinaryFuncSum<T>>::value;
+};
+
+// Pairwise reduction of a contiguous range: blocks of kPairwiseBlockSize are reduced with
+// kReduceLanes independent accumulators so that the inner loop vectorizes, and blocks are combined
+// as a binary tree, which keeps the rounding error of float sums at O(log(n)).
+template<typename T, template<typename> class binary_func>
+T ReduceContiguous(const T* x, int64_t n) {
+  if (n > kPairwiseBlockSize) {
+    int64_t half = n / 2;
+    half -= half % kReduceLanes;
+    return binary_func<T>::Invoke(ReduceContiguous<T, binary_func>(x, half),
+                                  ReduceContiguous<T, binary_func>(x + half, n - half));
+  }
+  T reduced = UnitOfBinaryFunc<T, binary_func>::Val();
+  int64_t i = 0;
+  if (n >= kReduceLanes) {
+    T lanes[kReduceLanes];
+    for (int64_t lane = 0; lane < kReduceLanes; ++lane) { lanes[lane] = x[lane]; }
+    for (i = kReduceLanes; i + kReduceLanes <= n; i += kReduceLanes) {
+      for (int64_t lane = 0; lane < kReduceLanes; ++lane) {
+        lanes[lane] = binary_func<T>::Invoke(lanes[lane], x[i + lane]);
+      }
+    }
+    for (int64_t stride = kReduceLanes / 2; stride > 0; stride /= 2) {
+      for (int64_t lane = 0; lane < stride; ++lane) {
+        lanes[lane] = binary_func<T>::Invoke(lanes[lane], lanes[lane + stride]);
+      }
+    }
+    reduced = lanes[0];
+  }
+  for (; i < n; ++i) { reduced = binary_func<T>::Invoke(reduced, x[i]); }
+  return reduced;
+}
+
+int64_t GetNumThreads(ep::Stream* stream) {
+  return stream->As<ep::CpuStream>()->device()->GetNumThreads();
+}
+
+int64_t GetNumChunks(ep::Stream* stream, int64_t elem_cnt, int64_t max_num_chunks) {
+  const int64_t num_chunks = std::min<int64_t>(GetNumThreads(stream), max_num_chunks);
+  return std::max<int64_t>(
+      1, std::min<int64_t>(num_chunks, (elem_cnt + kMinElemsPerChunk - 1) / kMinElemsPerChunk));
+}
+
+// Reduces a contiguous range with one chunk per thread, the per-thread partials are combined on
+// the calling thread.
+template<typename T, template<typename> class binary_func>
+T ParallelReduceContiguous(ep::Stream* stream, const T* x, int64_t n) {
+  const int64_t num_chunks = GetNumChunks(stream, n, n);
+  if (num_chunks == 1) { return ReduceContiguous<T, binary_func>(x, n); }
+  int64_t chunk_size = (n + num_chunks - 1) / num_chunks;
+  chunk_size = (chunk_size + kReduceLanes - 1) / kReduceLanes * kReduceLanes;
+  // std::vector is avoided since its bool specialization has neither data() nor per-element
+  // thread safety.
+  std::unique_ptr<T[]> partials(new T[num_chunks]);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_chunks,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t chunk = begin; chunk < end; ++chunk) {
+          const int64_t offset = std::min(n, chunk * chunk_size);
+          partials[chunk] = ReduceContiguous<T, binary_func>(
+              x + offset, std::min(n, offset + chunk_size) - offset);
+        }
+      },
+      1);
+  return ReduceContiguous<T, binary_func>(partials.get(), num_chunks);
+}
+
+// Reduces rows [row_begin, row_end) of a (num_rows, num_cols) matrix over columns
+// [col_begin, col_end) into dst. Rows are streamed through a block of at most kColBlockSize
+// accumulators, float sums use Kahan compensation since they are not reduced pairwise.
+template<typename T, template<typename> class binary_func>
+typename std::enable_if<!IsCompensatedSum<T, binary_func>::value>::type ColBlockReduce(
+    const T* x, int64_t num_cols, int64_t row_begin, int64_t row_end, int64_t col_begin,
+    int64_t col_end, T* dst) {
+  T acc[kColBlockSize];
+  const int64_t block_size = col_end - col_begin;
+  for (int64_t j = 0; j < block_size; ++j) { acc[j] = UnitOfBinaryFunc<T, binary_func>::Val(); }
+  for (int64_t row = row_begin; row < row_end; ++row) {
+    const T* row_x = x + row * num_cols + col_begin;
+    for (int64_t j = 0; j < block_size; ++j) { acc[j] = binary_func<T>::Invoke(acc[j], row_x[j]); }
+  }
+  for (int64_t j = 0; j < block_size; ++j) { dst[j] = acc[j]; }
+}
+
+template<typename T, template<typename> class binary_func>
+typename std::enable_if<IsCompensatedSum<T, binary_func>::value>::type ColBlockReduce(
+    const T* x, int64_t num_cols, int64_t row_begin, int64_t row_end, int64_t col_begin,
+    int64_t col_end, T* dst) {
+  T sum[kColBlockSize];
+  T compensation[kColBlockSize];
+  const int64_t block_size = col_end - col_begin;
+  for (int64_t j = 0; j < block_size; ++j) {
+    sum[j] = 0;
+    compensation[j] = 0;
   }
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayScalarReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayMatrixRowReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayMatrixColReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayXYZCubeXZReduce);
-#undef SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL
+  for (int64_t row = row_begin; row < row_end; ++row) {
+    const T* row_x = x + row * num_cols + col_begin;
+    for (int64_t j = 0; j < block_size; ++j) {
+      const T y = row_x[j] - compensation[j];
+      const T t = sum[j] + y;
+      compensation[j] = (t - sum[j]) - y;
+      sum[j] = t;
+    }
+  }
+  for (int64_t j = 0; j < block_size; ++j) { dst[j] = sum[j] - compensation[j]; }
+}
+
+// Reduces the rows of a (num_rows, num_cols) matrix into num_cols results. Columns are split into
+// cache sized blocks, and when there are fewer blocks than threads rows are split into chunks as
+// well, every chunk writing its partials into its own slice which are reduced at the end.
+template<typename T, template<typename> class binary_func, typename RetT>
+void ParallelColReduce(ep::Stream* stream, const T* x, int64_t num_rows, int64_t num_cols,
+                       RetT* y) {
+  const int64_t num_col_blocks = (num_cols + kColBlockSize - 1) / kColBlockSize;
+  const int64_t num_threads = GetNumThreads(stream);
+  const int64_t num_row_chunks =
+      std::min<int64_t>(GetNumChunks(stream, num_rows * num_cols, num_rows),
+                        std::max<int64_t>(1, num_threads / num_col_blocks));
+  const int64_t rows_per_chunk = (num_rows + num_row_chunks - 1) / num_row_chunks;
+  std::unique_ptr<T[]> partials(new T[num_row_chunks * num_cols]);
+  ep::CpuStream* cpu_stream = stream->As<ep::CpuStream>();
+  cpu_stream->ParallelFor(
+      0, num_row_chunks * num_col_blocks,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t task = begin; task < end; ++task) {
+          const int64_t chunk = task / num_col_blocks;
+          const int64_t col_begin = (task % num_col_blocks) * kColBlockSize;
+          const int64_t col_end = std::min(num_cols, col_begin + kColBlockSize);
+          ColBlockReduce<T, binary_func>(x, num_cols, std::min(num_rows, chunk * rows_per_chunk),
+                                         std::min(num_rows, (chunk + 1) * rows_per_chunk),
+                                         col_begin, col_end,
+                                         partials.get() + chunk * num_cols + col_begin);
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / (rows_per_chunk * kColBlockSize)));
+  cpu_stream->ParallelFor(
+      0, num_cols,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t col = begin; col < end; ++col) {
+          T reduced = partials[col];
+          for (int64_t chunk = 1; chunk < num_row_chunks; ++chunk) {
+            reduced = binary_func<T>::Invoke(reduced, partials[chunk * num_cols + col]);
+          }
+          y[col] = static_cast<RetT>(reduced);
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / num_row_chunks));
+}
+
+}  // namespace
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayScalarReduce<DeviceType::kCPU, T, binary_func> final {
+  using RetT = typename BinaryFuncTrait<binary_func, T>::return_type;
+  static bool Matched(const XpuVarNdarray<RetT>& y, const XpuVarNdarray<const T>& x) {
+    return y.shape().ElemNum() == 1;
+  }
+
+  static void Reduce(ep::Stream* stream, const XpuVarNdarray<RetT>& y,
+                     const XpuVarNdarray<const T>& x, const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    *y.ptr() = static_cast<RetT>(
+        ParallelReduceContiguous<T, binary_func>(stream, x.ptr(), x.shape().ElemNum()));
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayMatrixRowReduce<DeviceType::kCPU, T, binary_func> final {
+  using RetT = typename BinaryFuncTrait<binary_func, T>::return_type;
+  static bool Matched(const XpuVarNdarray<RetT>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 2) { return false; }
+    if (y.shape().NumAxes() != 2) { return false; }
+    if (x.shape().ElemNum() == 0) { return false; }
+    return x.shape().At(0) == y.shape().At(0) && y.shape().At(1) == 1;
+  }
+
+  static void Reduce(ep::Stream* stream, const XpuVarNdarray<RetT>& y,
+                     const XpuVarNdarray<const T>& x, const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    const int64_t num_rows = x.shape().At(0);
+    const int64_t num_cols = x.shape().At(1);
+    const T* x_ptr = x.ptr();
+    RetT* y_ptr = y.ptr();
+    if (num_rows < GetNumThreads(stream)) {
+      // Too few rows to keep every thread busy, split each row instead.
+      for (int64_t row = 0; row < num_rows; ++row) {
+        y_ptr[row] = static_cast<RetT>(
+            ParallelReduceContiguous<T, binary_func>(stream, x_ptr + row * num_cols, num_cols));
+      }
+      return;
+    }
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, num_rows,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t row = begin; row < end; ++row) {
+            y_ptr[row] = static_cast<RetT>(
+                ReduceContiguous<T, binary_func>(x_ptr + row * num_cols, num_cols));
+          }
+        },
+        std::max<int64_t>(1, kMinElemsPerChunk / num_cols));
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayMatrixColReduce<DeviceType::kCPU, T, binary_func> final {
+  using RetT = typename BinaryFuncTrait<binary_func, T>::return_type;
+  static bool Matched(const XpuVarNdarray<RetT>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 2) { return false; }
+    if (y.shape().NumAxes() != 2) { return false; }
+    if (x.shape().ElemNum() == 0) { return false; }
+    return y.shape().At(0) == 1 && x.shape().At(1) == y.shape().At(1);
+  }
+
+  static void Reduce(ep::Stream* stream, const XpuVarNdarray<RetT>& y,
+                     const XpuVarNdarray<const T>& x, const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    ParallelColReduce<T, binary_func>(stream, x.ptr(), x.shape().At(0), x.shape().At(1), y.ptr());
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayXYZCubeXZReduce<DeviceType::kCPU, T, binary_func> final {
+  using RetT = typename BinaryFuncTrait<binary_func, T>::return_type;
+  static bool Matched(const XpuVarNdarray<RetT>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 3) { return false; }
+    if (y.shape().NumAxes() != 3) { return false; }
+    if (x.shape().ElemNum() == 0) { return false; }
+    return y.shape().At(0) == 1 && x.shape().At(1) == y.shape().At(1) && y.shape().At(2) == 1;
+  }
+
+  static void Reduce(ep::Stream* stream, const XpuVarNdarray<RetT>& y,
+                     const XpuVarNdarray<const T>& x, const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    const int64_t dim_x = x.shape().At(0);
+    const int64_t dim_y = x.shape().At(1);
+    const int64_t dim_z = x.shape().At(2);
+    const T* x_ptr = x.ptr();
+    RetT* y_ptr = y.ptr();
+    if (dim_z == 1) {
+      return ParallelColReduce<T, binary_func>(stream, x_ptr, dim_x, dim_y, y_ptr);
+    }
+    // Every (x, y) pair owns a contiguous run of dim_z elements. Runs are reduced pairwise, and
+    // when dim_y is too small to keep every thread busy dim_x is split into per-thread chunks.
+    const int64_t num_x_chunks =
+        std::min<int64_t>(GetNumChunks(stream, x.shape().ElemNum(), dim_x),
+                          std::max<int64_t>(1, GetNumThreads(stream) / dim_y));
+    const int64_t x_per_chunk = (dim_x + num_x_chunks - 1) / num_x_chunks;
+    std::unique_ptr<T[]> partials(new T[num_x_chunks * dim_y]);
+    ep::CpuStream* cpu_stream = stream->As<ep::CpuStream>();
+    cpu_stream->ParallelFor(
+        0, num_x_chunks * dim_y,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t task = begin; task < end; ++task) {
+            const int64_t chunk = task / dim_y;
+            const int64_t j = task % dim_y;
+            T reduced = UnitOfBinaryFunc<T, binary_func>::Val();
+            const int64_t i_end = std::min(dim_x, (chunk + 1) * x_per_chunk);
+            for (int64_t i = chunk * x_per_chunk; i < i_end; ++i) {
+              reduced = binary_func<T>::Invoke(
+                  reduced,
+                  ReduceContiguous<T, binary_func>(x_ptr + (i * dim_y + j) * dim_z, dim_z));
+            }
+            partials[task] = reduced;
+          }
+        },
+        std::max<int64_t>(1, kMinElemsPerChunk / (x_per_chunk * dim_z)));
+    for (int64_t j = 0; j < dim_y; ++j) {
+      T reduced = partials[j];
+      for (int64_t chunk = 1; chunk < num_x_chunks; ++chunk) {
+        reduced = binary_func<T>::Invoke(reduced, partials[chunk * dim_y + j]);
+      }
+      y_ptr[j] = static_cast<RetT>(reduced);
+    }
+  }
+};
 
 #define INSTANTIATE_NDARRAY_REDUCE_IMPL(dtype, binary_func)                                       \
   template struct NdarrayScalarReduce<DeviceType::kCPU, OF_PP_PAIR_FIRST(dtype), binary_func>;    \
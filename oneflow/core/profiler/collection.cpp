@@ -19,6 +19,7 @@ limitations under the License.
 #include <unordered_map>
 #include "nlohmann/json.hpp"
 #include "oneflow/core/profiler/collection.h"
+#include "oneflow/core/profiler/trace_recorder.h"
 #include "oneflow/core/profiler/util.h"
 
 using json = nlohmann::json;
@@ -143,8 +144,27 @@ void ProfileMgr::UnregisterEventRecorder(const std::string& event_recorder_key)
   }
 }
 
+ProfileMgr::ProfileMgr(bool use_cpu, bool use_cuda, bool record_shapes, bool record_bandwidth)
+    : use_cpu_(use_cpu),
+      use_cuda_(use_cuda),
+      record_shapes_(record_shapes),
+      record_bandwidth_(record_bandwidth) {
+  if (use_cpu_) { TraceRecorder::Get()->Enable(); }
+}
+
+ProfileMgr::~ProfileMgr() {
+  if (use_cpu_) { TraceRecorder::Get()->Disable(); }
+}
+
 std::string ProfileMgr::DumpResultsJson() {
-  const json j = ExportEvents();
+  json j;
+  j["events"] = ExportEvents();
+  if (use_cpu_) {
+    TraceRecorder::Get()->Disable();
+    j["traceEvents"] = TraceRecorder::Get()->ExportTraceEvents();
+  } else {
+    j["traceEvents"] = json::array();
+  }
   return j.dump();
 }
 
@@ -153,11 +153,9 @@ class ProfileMgr {
  public:
   friend class EventRecorder;
 
-  ProfileMgr(bool use_cpu, bool use_cuda, bool record_shapes, bool record_bandwidth)
-      : use_cpu_(use_cpu),
-        use_cuda_(use_cuda),
-        record_shapes_(record_shapes),
-        record_bandwidth_(record_bandwidth) {}
+  // Recording the host ranges of OF_PROFILER_RANGE_PUSH/POP starts with a ProfileMgr using the cpu.
+  ProfileMgr(bool use_cpu, bool use_cuda, bool record_shapes, bool record_bandwidth);
+  ~ProfileMgr();
 
   std::string RegisterEventRecorder(const std::shared_ptr<EventRecorder>& event_recorder,
                                     const std::string& name);
@@ -16,13 +16,16 @@ limitations under the License.
 
 #include "oneflow/core/profiler/profiler.h"
 #include "oneflow/core/profiler/collection.h"
+#include "oneflow/core/profiler/trace_recorder.h"
 #include "oneflow/core/vm/vm_util.h"
 #ifdef OF_ENABLE_PROFILER
-#include <nvtx3/nvToolsExt.h>
 #include <sys/syscall.h>
 #include <iostream>
+#ifdef WITH_CUDA
+#include <nvtx3/nvToolsExt.h>
 #include <cuda_profiler_api.h>
 #include "oneflow/core/device/cuda_util.h"
+#endif  // WITH_CUDA
 #endif  // OF_ENABLE_PROFILER
 
 namespace oneflow {
@@ -37,19 +40,28 @@ void NameThisHostThread(const std::string& name) {
         new std::string(GetStringFromEnv("ONEFLOW_PROFILER_HOST_THREAD_NAME_PREFIX", "")));
   }
   const std::string name_with_prefix = *thread_name_prefix + name;
+#ifdef WITH_CUDA
   nvtxNameOsThreadA(syscall(SYS_gettid), name_with_prefix.c_str());
+#endif  // WITH_CUDA
+  TraceRecorder::Get()->NameThisThread(name_with_prefix);
 #endif  // OF_ENABLE_PROFILER
 }
 
 void RangePush(const std::string& name) {
 #ifdef OF_ENABLE_PROFILER
+#ifdef WITH_CUDA
   nvtxRangePushA(name.c_str());
+#endif  // WITH_CUDA
+  TraceRecorder::Get()->RangePush(name);
 #endif  // OF_ENABLE_PROFILER
 }
 
 void RangePop() {
 #ifdef OF_ENABLE_PROFILER
+#ifdef WITH_CUDA
   nvtxRangePop();
+#endif  // WITH_CUDA
+  TraceRecorder::Get()->RangePop();
 #endif  // OF_ENABLE_PROFILER
 }
 
@@ -79,15 +91,15 @@ void LogHostMemoryUsage(const std::string& name) {
 }
 
 void ProfilerStart() {
-#ifdef OF_ENABLE_PROFILER
+#if defined(OF_ENABLE_PROFILER) && defined(WITH_CUDA)
   OF_CUDA_CHECK(cudaProfilerStart());
-#endif  // OF_ENABLE_PROFILER
+#endif  // OF_ENABLE_PROFILER && WITH_CUDA
 }
 
 void ProfilerStop() {
-#ifdef OF_ENABLE_PROFILER
+#if defined(OF_ENABLE_PROFILER) && defined(WITH_CUDA)
   OF_CUDA_CHECK(cudaProfilerStop());
-#endif  // OF_ENABLE_PROFILER
+#endif  // OF_ENABLE_PROFILER && WITH_CUDA
 }
 
 void EnableProfiler(bool use_cpu, bool use_cuda, bool record_shapes, bool record_bandwidth) {
@@ -97,7 +109,8 @@ void EnableProfiler(bool use_cpu, bool use_cuda, bool record_shapes, bool record
   }
 }
 
-// DisableProfilerAndReturnResult will return a json of profile results.
+// DisableProfilerAndReturnResult will return a json of profile results, with the host ranges in
+// its "traceEvents" when the cpu is profiled.
 Maybe<std::string> DisableProfilerAndReturnResult() {
   JUST(vm::ClusterSync());
 
@@ -65,7 +65,8 @@ class RangeGuard final {
 
 void EnableProfiler(bool use_cpu, bool use_cuda, bool record_shapes, bool record_bandwidth);
 
-// DisableProfilerAndReturnResult will return a json of profile results.
+// DisableProfilerAndReturnResult will return a json of profile results, with the host ranges in
+// its "traceEvents" when the cpu is profiled.
 Maybe<std::string> DisableProfilerAndReturnResult();
 
 Maybe<std::string> StartRecord(const std::string& name);
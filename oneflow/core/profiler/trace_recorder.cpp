@@ -0,0 +1,243 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/trace_recorder.h"
+#include <sys/syscall.h>
+#include <algorithm>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "oneflow/core/common/env_var/env_var.h"
+#include "oneflow/core/common/global.h"
+#include "oneflow/core/control/ctrl_bootstrap.pb.h"
+#include "oneflow/core/profiler/util.h"
+#include "oneflow/core/rpc/include/global_process_ctx.h"
+
+namespace oneflow {
+
+DEFINE_ENV_INTEGER(ONEFLOW_PROFILER_TRACE_BUFFER_SIZE, 65536);
+
+namespace profiler {
+
+namespace {
+
+// The time stamp counter is read on x86, it is converted to time when the trace is exported.
+inline uint64_t GetTick() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return static_cast<uint64_t>(GetTimeNow(true));
+#endif
+}
+
+struct TraceRange {
+  uint64_t begin_tick;
+  uint64_t end_tick;
+  uint32_t name_id;
+};
+
+struct OpenRange {
+  uint64_t begin_tick;
+  uint32_t name_id;
+  int32_t depth;
+};
+
+int64_t RoundUpToPowerOfTwo(int64_t value) {
+  int64_t result = 1;
+  while (result < value) { result <<= 1; }
+  return result;
+}
+
+}  // namespace
+
+// Written by its own thread only. The exporter reads the ranges below num_ranges. Reset runs
+// under the mutex of TraceRecorder, which the exporter holds as well.
+class ThreadTrace final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ThreadTrace);
+  explicit ThreadTrace(int64_t tid) : tid(tid), depth(0), generation(-1), num_ranges(0) {}
+  ~ThreadTrace() = default;
+
+  void Reset(int64_t new_generation, int64_t capacity) {
+    if (ranges.size() != static_cast<size_t>(capacity)) { ranges.resize(capacity); }
+    open_ranges.clear();
+    num_ranges.store(0, std::memory_order_relaxed);
+    generation.store(new_generation, std::memory_order_release);
+  }
+
+  void Append(const OpenRange& open_range, uint64_t end_tick) {
+    const uint64_t index = num_ranges.load(std::memory_order_relaxed);
+    TraceRange* range = &ranges[index & (ranges.size() - 1)];
+    range->begin_tick = open_range.begin_tick;
+    range->end_tick = end_tick;
+    range->name_id = open_range.name_id;
+    num_ranges.store(index + 1, std::memory_order_release);
+  }
+
+  const int64_t tid;
+  // Guarded by the mutex of TraceRecorder.
+  std::string name;
+  // Tracked even when the recorder is disabled, so that a pop is only matched with the push of
+  // the same range.
+  int32_t depth;
+  std::atomic<int64_t> generation;
+  std::vector<OpenRange> open_ranges;
+  std::unordered_map<std::string, uint32_t> name2id;
+  std::vector<TraceRange> ranges;
+  std::atomic<uint64_t> num_ranges;
+};
+
+TraceRecorder::TraceRecorder()
+    : enabled_(false),
+      generation_(0),
+      capacity_per_thread_(RoundUpToPowerOfTwo(EnvInteger<ONEFLOW_PROFILER_TRACE_BUFFER_SIZE>())),
+      enabled_at_tick_(0),
+      enabled_at_ns_(0) {}
+
+TraceRecorder* TraceRecorder::Get() {
+  static TraceRecorder* recorder = new TraceRecorder();
+  return recorder;
+}
+
+void TraceRecorder::Enable() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The traces only referenced here belong to exited threads.
+  thread_traces_.erase(std::remove_if(thread_traces_.begin(), thread_traces_.end(),
+                                      [](const std::shared_ptr<ThreadTrace>& trace) {
+                                        return trace.use_count() == 1;
+                                      }),
+                       thread_traces_.end());
+  enabled_at_ns_ = GetTimeNow(true);
+  enabled_at_tick_ = GetTick();
+  ++generation_;
+  enabled_.store(true, std::memory_order_release);
+}
+
+void TraceRecorder::Disable() { enabled_.store(false, std::memory_order_release); }
+
+ThreadTrace* TraceRecorder::GetThisThreadTrace() {
+  static thread_local std::shared_ptr<ThreadTrace> trace;
+  if (!trace) {
+    trace = std::make_shared<ThreadTrace>(syscall(SYS_gettid));
+    std::lock_guard<std::mutex> lock(mutex_);
+    thread_traces_.emplace_back(trace);
+  }
+  return trace.get();
+}
+
+void TraceRecorder::ResetThreadTrace(ThreadTrace* trace, int64_t generation) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  trace->Reset(generation, capacity_per_thread_);
+}
+
+uint32_t TraceRecorder::InternName(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = name2id_.find(name);
+  if (it != name2id_.end()) { return it->second; }
+  const uint32_t id = names_.size();
+  names_.emplace_back(name);
+  name2id_.emplace(name, id);
+  return id;
+}
+
+void TraceRecorder::RangePush(const std::string& name) {
+  ThreadTrace* trace = GetThisThreadTrace();
+  const int32_t depth = trace->depth++;
+  if (!IsEnabled()) { return; }
+  const int64_t generation = generation_.load(std::memory_order_relaxed);
+  if (trace->generation.load(std::memory_order_relaxed) != generation) {
+    ResetThreadTrace(trace, generation);
+  }
+  uint32_t name_id = 0;
+  auto it = trace->name2id.find(name);
+  if (it != trace->name2id.end()) {
+    name_id = it->second;
+  } else {
+    name_id = InternName(name);
+    trace->name2id.emplace(name, name_id);
+  }
+  trace->open_ranges.emplace_back(OpenRange{GetTick(), name_id, depth});
+}
+
+void TraceRecorder::RangePop() {
+  ThreadTrace* trace = GetThisThreadTrace();
+  const int32_t depth = --trace->depth;
+  if (trace->open_ranges.empty() || trace->open_ranges.back().depth != depth) { return; }
+  const OpenRange open_range = trace->open_ranges.back();
+  trace->open_ranges.pop_back();
+  // Ranges still open when the recorder is disabled are dropped.
+  if (!IsEnabled()) { return; }
+  trace->Append(open_range, GetTick());
+}
+
+void TraceRecorder::NameThisThread(const std::string& name) {
+  ThreadTrace* trace = GetThisThreadTrace();
+  std::lock_guard<std::mutex> lock(mutex_);
+  trace->name = name;
+}
+
+nlohmann::json TraceRecorder::ExportTraceEvents() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int64_t now_ns = GetTimeNow(true);
+  const uint64_t now_tick = GetTick();
+  const double ns_per_tick =
+      now_tick > enabled_at_tick_
+          ? static_cast<double>(now_ns - enabled_at_ns_) / (now_tick - enabled_at_tick_)
+          : 1.0;
+  const auto TickToUs = [&](uint64_t tick) {
+    return (static_cast<double>(tick) - static_cast<double>(enabled_at_tick_)) * ns_per_tick
+           / 1000;
+  };
+  // Processes without a process ctx, e.g. in tests, are exported as rank 0.
+  const int64_t pid = Global<ProcessCtx>::Get() == nullptr ? 0 : GlobalProcessCtx::Rank();
+  const int64_t generation = generation_.load(std::memory_order_relaxed);
+  nlohmann::json events = nlohmann::json::array();
+  events.push_back({{"name", "process_name"},
+                    {"ph", "M"},
+                    {"pid", pid},
+                    {"args", {{"name", "rank " + std::to_string(pid)}}}});
+  for (const auto& trace : thread_traces_) {
+    if (!trace->name.empty()) {
+      events.push_back({{"name", "thread_name"},
+                        {"ph", "M"},
+                        {"pid", pid},
+                        {"tid", trace->tid},
+                        {"args", {{"name", trace->name}}}});
+    }
+    if (trace->generation.load(std::memory_order_acquire) != generation) { continue; }
+    const uint64_t num_ranges = trace->num_ranges.load(std::memory_order_acquire);
+    const uint64_t capacity = trace->ranges.size();
+    if (num_ranges > capacity) {
+      LOG(WARNING) << "The trace buffer of thread " << trace->tid << " overflowed, the first "
+                   << num_ranges - capacity << " ranges are dropped. Increase "
+                   << "ONEFLOW_PROFILER_TRACE_BUFFER_SIZE to keep them.";
+    }
+    for (uint64_t i = num_ranges > capacity ? num_ranges - capacity : 0; i < num_ranges; ++i) {
+      const TraceRange& range = trace->ranges[i & (capacity - 1)];
+      events.push_back({{"name", names_.at(range.name_id)},
+                        {"ph", "X"},
+                        {"pid", pid},
+                        {"tid", trace->tid},
+                        {"ts", TickToUs(range.begin_tick)},
+                        {"dur", TickToUs(range.end_tick) - TickToUs(range.begin_tick)}});
+    }
+  }
+  return events;
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_TRACE_RECORDER_H_
+#define ONEFLOW_CORE_PROFILER_TRACE_RECORDER_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+class ThreadTrace;
+
+// Records the host ranges of OF_PROFILER_RANGE_PUSH/POP into a ring buffer per thread. Names are
+// interned once per thread, the hot path only takes the timestamps and writes one slot.
+class TraceRecorder final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TraceRecorder);
+  ~TraceRecorder() = default;
+
+  static TraceRecorder* Get();
+
+  bool IsEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+  // Drops the ranges of the previous session.
+  void Enable();
+  void Disable();
+
+  void RangePush(const std::string& name);
+  void RangePop();
+  void NameThisThread(const std::string& name);
+
+  // Chrome trace events ("X" for the ranges, "M" for the thread names) of the last session, in
+  // microseconds since it was enabled.
+  nlohmann::json ExportTraceEvents();
+
+ private:
+  TraceRecorder();
+
+  ThreadTrace* GetThisThreadTrace();
+  void ResetThreadTrace(ThreadTrace* trace, int64_t generation);
+  uint32_t InternName(const std::string& name);
+
+  std::atomic<bool> enabled_;
+  std::atomic<int64_t> generation_;
+  int64_t capacity_per_thread_;
+  uint64_t enabled_at_tick_;
+  int64_t enabled_at_ns_;
+
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<ThreadTrace>> thread_traces_;
+  std::unordered_map<std::string, uint32_t> name2id_;
+  std::vector<std::string> names_;
+};
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_TRACE_RECORDER_H_
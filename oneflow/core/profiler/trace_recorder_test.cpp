@@ -0,0 +1,121 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/profiler/trace_recorder.h"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace test {
+
+namespace {
+
+// The ranges recorded by the calling thread, in the order they were closed.
+std::vector<nlohmann::json> RangesOfThisThread(const nlohmann::json& events) {
+  const int64_t tid = syscall(SYS_gettid);
+  std::vector<nlohmann::json> ranges;
+  for (const auto& event : events) {
+    if (event["ph"] == "X" && event["tid"] == tid) { ranges.emplace_back(event); }
+  }
+  return ranges;
+}
+
+}  // namespace
+
+TEST(TraceRecorder, nested_ranges) {
+  TraceRecorder* recorder = TraceRecorder::Get();
+  recorder->Enable();
+  recorder->RangePush("outer");
+  recorder->RangePush("inner");
+  recorder->RangePop();
+  recorder->RangePop();
+  recorder->Disable();
+
+  const std::vector<nlohmann::json> ranges = RangesOfThisThread(recorder->ExportTraceEvents());
+  ASSERT_EQ(ranges.size(), 2);
+  const nlohmann::json& inner = ranges.at(0);
+  const nlohmann::json& outer = ranges.at(1);
+  ASSERT_EQ(inner["name"], "inner");
+  ASSERT_EQ(outer["name"], "outer");
+  const double inner_begin = inner["ts"];
+  const double inner_end = inner_begin + inner["dur"].get<double>();
+  const double outer_begin = outer["ts"];
+  const double outer_end = outer_begin + outer["dur"].get<double>();
+  ASSERT_GE(inner_begin, outer_begin);
+  ASSERT_LE(inner_end, outer_end);
+}
+
+TEST(TraceRecorder, ranges_across_disable_are_dropped) {
+  TraceRecorder* recorder = TraceRecorder::Get();
+  recorder->Enable();
+  recorder->RangePush("closed_after_disable");
+  recorder->Disable();
+  recorder->RangePop();
+
+  recorder->RangePush("opened_before_enable");
+  recorder->Enable();
+  recorder->RangePush("recorded");
+  recorder->RangePop();
+  recorder->RangePop();
+  recorder->Disable();
+
+  const std::vector<nlohmann::json> ranges = RangesOfThisThread(recorder->ExportTraceEvents());
+  ASSERT_EQ(ranges.size(), 1);
+  ASSERT_EQ(ranges.at(0)["name"], "recorded");
+}
+
+TEST(TraceRecorder, export_events) {
+  TraceRecorder* recorder = TraceRecorder::Get();
+  recorder->NameThisThread("trace_recorder_test");
+  recorder->Enable();
+  recorder->RangePush("range");
+  recorder->RangePop();
+  recorder->Disable();
+
+  const nlohmann::json events = recorder->ExportTraceEvents();
+  const int64_t tid = syscall(SYS_gettid);
+  ASSERT_FALSE(events.empty());
+  // Without a process ctx the trace is exported as rank 0.
+  ASSERT_EQ(events[0]["name"], "process_name");
+  ASSERT_EQ(events[0]["ph"], "M");
+  ASSERT_EQ(events[0]["pid"], 0);
+  ASSERT_EQ(events[0]["args"]["name"], "rank 0");
+  bool has_thread_name = false;
+  for (const auto& event : events) {
+    ASSERT_EQ(event["pid"], 0);
+    if (event["name"] == "thread_name" && event["tid"] == tid) {
+      ASSERT_EQ(event["ph"], "M");
+      ASSERT_EQ(event["args"]["name"], "trace_recorder_test");
+      has_thread_name = true;
+    }
+  }
+  ASSERT_TRUE(has_thread_name);
+  const std::vector<nlohmann::json> ranges = RangesOfThisThread(events);
+  ASSERT_EQ(ranges.size(), 1);
+  ASSERT_EQ(ranges.at(0)["name"], "range");
+  ASSERT_GE(ranges.at(0)["ts"].get<double>(), 0);
+  ASSERT_GE(ranges.at(0)["dur"].get<double>(), 0);
+}
+
+}  // namespace test
+
+}  // namespace profiler
+
+}  // namespace oneflow
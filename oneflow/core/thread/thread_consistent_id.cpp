@@ -20,6 +20,13 @@ limitations under the License.
 
 namespace oneflow {
 
+static_assert(kThreadConsistentIdScheduler < kThreadConsistentIdVmWorkerBegin
+                  && kThreadConsistentIdVmWorkerEnd <= kThreadConsistentIdCollectiveBoxing,
+              "the vm worker threads must not share ids with other threads");
+static_assert(static_cast<size_t>(kThreadConsistentIdCollectiveBoxing)
+                  < TransportToken::MaxNumberOfThreadConsistentUId(),
+              "thread consistent ids must fit into a transport token");
+
 namespace {
 
 class ConsistentIdStorage final {
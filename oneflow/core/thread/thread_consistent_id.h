@@ -24,6 +24,12 @@ namespace oneflow {
 const static int kThreadConsistentIdMain = 0;
 const static int kThreadConsistentIdHook = 1;
 const static int kThreadConsistentIdScheduler = 2;
+// The vm worker threads of stream types supporting transport instructions take the ids in
+// [kThreadConsistentIdVmWorkerBegin, kThreadConsistentIdVmWorkerEnd).
+const static int kThreadConsistentIdVmWorkerBegin = 3;
+const static int kThreadConsistentIdVmWorkerEnd = 7;
+// The thread running lazy collective boxing on the ccl backend.
+const static int kThreadConsistentIdCollectiveBoxing = 7;
 
 size_t GetThreadConsistentIdCount();
 
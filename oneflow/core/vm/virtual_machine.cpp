@@ -87,9 +87,11 @@ void GetWorkerThreadInitializer(intrusive::shared_ptr<vm::VirtualMachineEngine>
     stream_type_indexes.insert(GetStreamTypeIndex(thread_ctx));
   }
   HashMap<std::type_index, int64_t> stream_type_index2consistent_id;
-  int64_t thread_consistent_id = kThreadConsistentIdScheduler + 1;
+  int64_t thread_consistent_id = kThreadConsistentIdVmWorkerBegin;
   for (const auto& stream_type_index : stream_type_indexes) {
     VLOG(3) << "transport stream type: " << stream_type_index.name();
+    CHECK_LT(thread_consistent_id, kThreadConsistentIdVmWorkerEnd)
+        << "too many transport stream types for the thread consistent ids of vm workers";
     stream_type_index2consistent_id[stream_type_index] = thread_consistent_id++;
   }
   *Initializer = [stream_type_index2consistent_id](vm::ThreadCtx* thread_ctx) {
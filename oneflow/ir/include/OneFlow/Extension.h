@@ -16,6 +16,7 @@ limitations under the License.
 
 #ifndef ONEFLOW_IR_INCLUDE_ONEFLOW_EXTENSION_H_
 #define ONEFLOW_IR_INCLUDE_ONEFLOW_EXTENSION_H_
+#include <cstdint>
 #include <unordered_set>
 #include <string>
 
@@ -25,6 +26,17 @@ using SharedLibs = std::unordered_set<std::string>;
 SharedLibs* MutSharedLibPaths();
 const SharedLibs* SharedLibPaths();
 
+// Counters of the process-wide cache of compiled mlir_jit kernels.
+struct MlirJitCacheStats {
+  int64_t num_compiles = 0;
+  int64_t num_memory_hits = 0;
+  // Kernels loaded from the object files under ONEFLOW_MLIR_JIT_CACHE_DIR.
+  int64_t num_disk_hits = 0;
+  double compile_time_ms = 0;
+};
+
+MlirJitCacheStats GetMlirJitCacheStats();
+
 }  // namespace oneflow
 
 #endif  // ONEFLOW_IR_INCLUDE_ONEFLOW_EXTENSION_H_
@@ -29,12 +29,15 @@ limitations under the License.
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/None.h"
 #include "llvm/Support/Casting.h"
+#include "mlir/Conversion/AsyncToLLVM/AsyncToLLVM.h"
 #include "mlir/Conversion/LinalgToLLVM/LinalgToLLVM.h"
 #include "mlir/Conversion/MemRefToLLVM/MemRefToLLVM.h"
 #include "mlir/Conversion/ReconcileUnrealizedCasts/ReconcileUnrealizedCasts.h"
 #include "mlir/Conversion/FuncToLLVM/ConvertFuncToLLVMPass.h"
 #include "mlir/Conversion/TosaToLinalg/TosaToLinalg.h"
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/Arithmetic/Transforms/Passes.h"
+#include "mlir/Dialect/Async/Passes.h"
 #include "mlir/Dialect/Linalg/Passes.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
 #include "mlir/Dialect/SCF/Passes.h"
@@ -744,10 +747,24 @@ void AddLowerToLinalgMemRefPasses(PassManager& pm) {
       mlir::bufferization::createFinalizingBufferizePass());  // finalizing-bufferize
 }
 
+// Iterations of a parallel loop run by one async task, the same grain as CpuStream::ParallelFor.
+constexpr int32_t kAsyncParallelForMinTaskSize = 32768;
+
+// Parallel loops are split into blocks run as async tasks on the OneFlow thread pool (see
+// oneflow-runtime), the loops of a block are vectorized by the -O3 pipeline of the JIT.
 LogicalResult LowerModuleToLLVM(mlir::MLIRContext* context, ModuleOp module) {
   mlir::PassManager pm(context);
   AddLowerToLinalgMemRefPasses(pm);
-  pm.addNestedPass<func::FuncOp>(createConvertLinalgToLoopsPass());  // convert-linalg-to-loops
+  pm.addNestedPass<func::FuncOp>(
+      createConvertLinalgToParallelLoopsPass());  // convert-linalg-to-parallel-loops
+  pm.addNestedPass<func::FuncOp>(createParallelLoopFusionPass());  // scf-parallel-loop-fusion
+  pm.addPass(createAsyncParallelForPass(/*asyncDispatch=*/true, /*numWorkerThreads=*/-1,
+                                        kAsyncParallelForMinTaskSize));  // async-parallel-for
+  pm.addPass(createAsyncToAsyncRuntimePass());         // async-to-async-runtime
+  pm.addPass(createAsyncRuntimeRefCountingPass());     // async-runtime-ref-counting
+  pm.addPass(createAsyncRuntimeRefCountingOptPass());  // async-runtime-ref-counting-opt
+  pm.addPass(arith::createArithmeticExpandOpsPass());  // arith-expand
+  pm.addPass(createConvertAsyncToLLVMPass());          // convert-async-to-llvm
   pm.addNestedPass<func::FuncOp>(createConvertSCFToCFPass());        // convert-scf-to-cf
   pm.addPass(createConvertLinalgToLLVMPass());                       // convert-linalg-to-llvm
   pm.addPass(createMemRefToLLVMPass());                              // convert-memref-to-llvm
@@ -18,16 +18,34 @@ limitations under the License.
 #include "mlir/Dialect/Linalg/IR/Linalg.h"
 #include "mlir/ExecutionEngine/ExecutionEngine.h"
 #include "mlir/ExecutionEngine/MemRefUtils.h"
+#include "mlir/ExecutionEngine/OptUtils.h"
 #include "mlir/Target/LLVMIR/Dialect/LLVMIR/LLVMToLLVMIRTranslation.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/SHA256.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
 #include "OneFlow/OneFlowDialect.h"
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/common/switch_func.h"
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/core/job/version.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
 #include "oneflow/ir/include/OneFlow/Passes.h"
 #include "oneflow/ir/include/OneFlow/Extension.h"
+#include "oneflow/ir/oneflow-runtime/include/OneFlow/AsyncRuntime.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
 
 namespace oneflow {
 
@@ -132,10 +150,19 @@ llvm::SmallVector<OpaqueMemRefDescriptor> GetMLIRCInterfaceArgs(
   return args;
 }
 
-void WithMlirContext(
-    user_op::KernelComputeContext* ctx, const llvm::SmallVector<llvm::StringRef, 4>& ext_libs,
+llvm::orc::SymbolMap AsyncRuntimeSymbolMap(llvm::orc::MangleAndInterner interner) {
+  llvm::orc::SymbolMap symbol_map;
+  for (const auto& pair : AsyncRuntimeSymbols()) {
+    symbol_map[interner(pair.first)] = llvm::JITEvaluatedSymbol::fromPointer(pair.second);
+  }
+  return symbol_map;
+}
+
+std::unique_ptr<mlir::ExecutionEngine> CreateExecutionEngine(
+    const std::string& op_name, const llvm::SmallVector<llvm::StringRef, 4>& ext_libs,
     const std::function<mlir::OwningOpRef<mlir::ModuleOp>(mlir::MLIRContext* mlir_ctx)>& parse,
-    const std::function<void(mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module)>& lower) {
+    const std::function<void(mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module)>& lower,
+    bool enable_object_dump) {
   mlir::DialectRegistry registry;
   registry
       .insert<mlir::oneflow::OneFlowDialect, mlir::func::FuncDialect, mlir::memref::MemRefDialect,
@@ -143,7 +170,7 @@ void WithMlirContext(
   mlir::registerLLVMDialectTranslation(registry);
   mlir::MLIRContext mlir_ctx(registry);
   mlir::OwningOpRef<mlir::ModuleOp> module = parse(&mlir_ctx);
-  CHECK(!!module) << "fail to parse MLIR, op: " << ctx->op_name();
+  CHECK(!!module) << "fail to parse MLIR, op: " << op_name;
   if (ParseBooleanFromEnv("ONEFLOW_MLIR_STDOUT", false)) { module->print(llvm::outs()); }
   llvm::InitializeNativeTarget();
   llvm::InitializeNativeTargetAsmPrinter();
@@ -153,24 +180,278 @@ void WithMlirContext(
     std::string mlir;
     llvm::raw_string_ostream os_mlir(mlir);
     module->print(os_mlir);
-    TeePersistentLogStream::Create(JoinPath("jit", ctx->op_name() + ".mlir"))->Write(mlir);
+    TeePersistentLogStream::Create(JoinPath("jit", op_name + ".mlir"))->Write(mlir);
   }
 
+  // The host target machine gives the vectorizers of the -O3 pipeline the host SIMD width.
+  auto tm_builder_or_error = llvm::orc::JITTargetMachineBuilder::detectHost();
+  CHECK(!!tm_builder_or_error) << "fail to detect host, "
+                               << llvm::toString(tm_builder_or_error.takeError());
+  auto tm_or_error = tm_builder_or_error->createTargetMachine();
+  CHECK(!!tm_or_error) << "fail to create target machine, "
+                       << llvm::toString(tm_or_error.takeError());
+  std::unique_ptr<llvm::TargetMachine> tm = std::move(tm_or_error.get());
+
   mlir::ExecutionEngineOptions jitOptions;
-  jitOptions.transformer = {};
-  jitOptions.jitCodeGenOptLevel = llvm::None;
+  jitOptions.transformer =
+      mlir::makeOptimizingTransformer(/*optLevel=*/3, /*sizeLevel=*/0, tm.get());
+  jitOptions.jitCodeGenOptLevel = llvm::CodeGenOpt::Aggressive;
   jitOptions.sharedLibPaths = ext_libs;
+  jitOptions.enableObjectDump = enable_object_dump;
 
   auto jit_or_error = mlir::ExecutionEngine::create(*module, jitOptions);
   CHECK(!!jit_or_error) << "failed to create JIT exe engine, "
                         << llvm::toString(jit_or_error.takeError());
   auto jit = std::move(jit_or_error.get());
-  llvm::SmallVector<OpaqueMemRefDescriptor> args /* args must outlive JIT invocation */ =
-      GetMLIRCInterfaceArgs(ctx);
-  llvm::SmallVector<void*> packed_args{};
-  for (auto& arg /* arg must be a reference*/ : args) { packed_args.push_back(&arg); }
-  auto error = jit->invokePacked(GetMLIRCInterface(ctx->op_name()), packed_args);
-  CHECK(!error) << "fail to invoke jit engine, error: " << llvm::toString(std::move(error));
+  jit->registerSymbols(AsyncRuntimeSymbolMap);
+  return jit;
+}
+
+// A compiled mlir_jit function, owned either by the ExecutionEngine that compiled it or by the
+// LLJIT instance that loaded it from the on-disk cache.
+class JitFunction final {
+ public:
+  using PackedFunc = void (*)(void**);
+
+  JitFunction(std::unique_ptr<mlir::ExecutionEngine>&& engine, PackedFunc func)
+      : engine_(std::move(engine)), func_(func) {}
+  JitFunction(std::unique_ptr<llvm::orc::LLJIT>&& jit, PackedFunc func)
+      : jit_(std::move(jit)), func_(func) {}
+
+  void Invoke(user_op::KernelComputeContext* ctx) const {
+    llvm::SmallVector<OpaqueMemRefDescriptor> args /* args must outlive JIT invocation */ =
+        GetMLIRCInterfaceArgs(ctx);
+    llvm::SmallVector<void*> packed_args{};
+    for (auto& arg /* arg must be a reference*/ : args) { packed_args.push_back(&arg); }
+    func_(packed_args.data());
+  }
+
+ private:
+  std::unique_ptr<mlir::ExecutionEngine> engine_;
+  std::unique_ptr<llvm::orc::LLJIT> jit_;
+  PackedFunc func_;
+};
+
+// Host triple, CPU and enabled features, the code of a compiled function is only valid on hosts
+// with the same key.
+const std::string& HostTargetKey() {
+  static const std::string key = []() {
+    std::string key = llvm::sys::getProcessTriple() + ";" + llvm::sys::getHostCPUName().str();
+    llvm::StringMap<bool> features;
+    if (llvm::sys::getHostCPUFeatures(features)) {
+      std::vector<std::string> enabled_features;
+      for (const auto& feature : features) {
+        if (feature.second) { enabled_features.emplace_back(feature.first().str()); }
+      }
+      std::sort(enabled_features.begin(), enabled_features.end());
+      for (const auto& feature : enabled_features) { key += ";" + feature; }
+    }
+    return key;
+  }();
+  return key;
+}
+
+// Process-wide cache of compiled mlir_jit functions, so every kernel with the same assembly is
+// compiled once. With ONEFLOW_MLIR_JIT_CACHE_DIR set, the object code of CPU functions is also
+// stored there and loaded by later processes instead of being compiled again.
+class MlirJitCache final {
+ public:
+  using CreateEngineFn = std::function<std::unique_ptr<mlir::ExecutionEngine>(bool)>;
+
+  static MlirJitCache* Get() {
+    static MlirJitCache cache;
+    return &cache;
+  }
+
+  std::shared_ptr<const JitFunction> GetOrCompile(
+      DeviceType device_type, const std::string& op_name, const std::string& assembly,
+      const llvm::SmallVector<llvm::StringRef, 4>& ext_libs, const CreateEngineFn& CreateEngine) {
+    const std::string func_name = GetMLIRCInterface(op_name);
+    const std::string key = std::to_string(static_cast<int>(device_type)) + ";" + func_name + ";"
+                            + HostTargetKey() + ";" + assembly;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = functions_.find(key);
+    if (it != functions_.end()) {
+      stats_.num_memory_hits += 1;
+      return it->second;
+    }
+    const std::string cache_dir = GetStringFromEnv("ONEFLOW_MLIR_JIT_CACHE_DIR", "");
+    const std::string disk_cache_key = DiskCacheKey(key);
+    std::string cache_path;
+    if (!cache_dir.empty() && device_type == DeviceType::kCPU) {
+      if (const std::error_code error = llvm::sys::fs::create_directories(cache_dir)) {
+        LOG(WARNING) << "fail to create mlir_jit cache dir " << cache_dir << ": "
+                     << error.message() << ", the disk cache is skipped";
+      } else {
+        const auto digest = llvm::SHA256::hash(llvm::arrayRefFromStringRef(disk_cache_key));
+        cache_path = JoinPath(cache_dir, llvm::toHex(digest, /*LowerCase=*/true));
+      }
+    }
+    std::shared_ptr<const JitFunction> function;
+    if (!cache_path.empty() && MatchesKeyFile(cache_path + ".key", disk_cache_key)) {
+      function = LoadObjectFile(cache_path + ".o", func_name, ext_libs);
+      if (function) { stats_.num_disk_hits += 1; }
+    }
+    if (!function) {
+      const auto start = std::chrono::steady_clock::now();
+      auto engine = CreateEngine(/*enable_object_dump=*/!cache_path.empty());
+      auto func_or_error = engine->lookupPacked(func_name);
+      CHECK(!!func_or_error) << "fail to find jit function " << func_name << ", error: "
+                             << llvm::toString(func_or_error.takeError());
+      if (!cache_path.empty()) { StoreObjectFile(engine.get(), cache_path, disk_cache_key); }
+      function = std::make_shared<JitFunction>(std::move(engine), *func_or_error);
+      const double compile_time_ms =
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+              .count();
+      stats_.num_compiles += 1;
+      stats_.compile_time_ms += compile_time_ms;
+      VLOG(1) << "mlir_jit " << op_name << " compiled in " << compile_time_ms << " ms";
+    }
+    functions_.emplace(key, function);
+    return function;
+  }
+
+  MlirJitCacheStats stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+ private:
+  MlirJitCache() = default;
+
+  // The key of the memory cache together with the versions the object code is produced by. It is
+  // stored in full next to the object file, which is named by its digest.
+  static std::string DiskCacheKey(const std::string& key) {
+    return std::string("llvm ") + LLVM_VERSION_STRING + ";oneflow " + GetOneFlowGitVersion() + ";"
+           + key;
+  }
+
+  static bool MatchesKeyFile(const std::string& key_file, const std::string& disk_cache_key) {
+    auto buffer_or_error = llvm::MemoryBuffer::getFile(key_file);
+    if (!buffer_or_error) { return false; }
+    if ((*buffer_or_error)->getBuffer() != disk_cache_key) {
+      VLOG(1) << key_file << " belongs to another mlir_jit function or version";
+      return false;
+    }
+    return true;
+  }
+
+  static bool WriteFile(const std::string& filename, const std::string& content) {
+    std::error_code error;
+    llvm::raw_fd_ostream os(filename, error);
+    if (error) { return false; }
+    os << content;
+    os.close();
+    return !os.has_error();
+  }
+
+  // Writes both files under temporary names and renames them into place, the object file first.
+  // The key file is only there once the object file is complete, so readers and concurrent
+  // writers never see a partial cache entry.
+  static void StoreObjectFile(mlir::ExecutionEngine* engine, const std::string& cache_path,
+                              const std::string& disk_cache_key) {
+    const std::string suffix = ".tmp" + std::to_string(llvm::sys::Process::getProcessId());
+    const std::string object_file = cache_path + ".o";
+    const std::string key_file = cache_path + ".key";
+    engine->dumpToObjectFile(object_file + suffix);
+    const bool stored = llvm::sys::fs::exists(object_file + suffix)
+                  && WriteFile(key_file + suffix, disk_cache_key)
+                  && !llvm::sys::fs::rename(object_file + suffix, object_file)
+                  && !llvm::sys::fs::rename(key_file + suffix, key_file);
+    if (!stored) {
+      LOG(WARNING) << "fail to store mlir_jit object code to " << object_file;
+      llvm::sys::fs::remove(object_file + suffix);
+      llvm::sys::fs::remove(key_file + suffix);
+    }
+  }
+
+  static std::shared_ptr<const JitFunction> LoadObjectFile(
+      const std::string& object_file, const std::string& func_name,
+      const llvm::SmallVector<llvm::StringRef, 4>& ext_libs) {
+    auto jit_or_error = llvm::orc::LLJITBuilder().create();
+    if (!jit_or_error) {
+      LOG(WARNING) << "fail to create LLJIT: " << llvm::toString(jit_or_error.takeError());
+      return nullptr;
+    }
+    auto jit = std::move(*jit_or_error);
+    auto& dylib = jit->getMainJITDylib();
+    const char global_prefix = jit->getDataLayout().getGlobalPrefix();
+    dylib.addGenerator(llvm::cantFail(
+        llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(global_prefix)));
+    for (const auto& lib : ext_libs) {
+      auto generator_or_error =
+          llvm::orc::DynamicLibrarySearchGenerator::Load(lib.str().c_str(), global_prefix);
+      if (!generator_or_error) {
+        LOG(WARNING) << "fail to load " << lib.str() << ": "
+                     << llvm::toString(generator_or_error.takeError());
+        return nullptr;
+      }
+      dylib.addGenerator(std::move(*generator_or_error));
+    }
+    llvm::orc::MangleAndInterner interner(jit->getExecutionSession(), jit->getDataLayout());
+    if (auto error = dylib.define(llvm::orc::absoluteSymbols(AsyncRuntimeSymbolMap(interner)))) {
+      LOG(WARNING) << "fail to define async runtime symbols: " << llvm::toString(std::move(error));
+      return nullptr;
+    }
+    auto buffer_or_error = llvm::MemoryBuffer::getFile(object_file);
+    if (!buffer_or_error) {
+      LOG(WARNING) << "fail to read " << object_file;
+      return nullptr;
+    }
+    if (auto error = jit->addObjectFile(std::move(*buffer_or_error))) {
+      LOG(WARNING) << "fail to add " << object_file << ": " << llvm::toString(std::move(error));
+      return nullptr;
+    }
+    // The packed wrapper emitted by the ExecutionEngine for the C interface.
+    auto symbol_or_error = jit->lookup("_mlir_" + func_name);
+    if (!symbol_or_error) {
+      LOG(WARNING) << "fail to find " << func_name << " in " << object_file << ": "
+                   << llvm::toString(symbol_or_error.takeError());
+      return nullptr;
+    }
+    auto func = reinterpret_cast<JitFunction::PackedFunc>(symbol_or_error->getAddress());
+    return std::make_shared<JitFunction>(std::move(jit), func);
+  }
+
+  std::mutex mutex_;
+  HashMap<std::string, std::shared_ptr<const JitFunction>> functions_;
+  MlirJitCacheStats stats_;
+};
+
+class MlirJitKernelState final : public user_op::OpKernelState {
+ public:
+  explicit MlirJitKernelState(std::shared_ptr<const JitFunction>&& function)
+      : function_(std::move(function)) {}
+  ~MlirJitKernelState() override = default;
+
+  const JitFunction& function() const { return *function_; }
+
+ private:
+  std::shared_ptr<const JitFunction> function_;
+};
+
+std::shared_ptr<user_op::OpKernelState> CreateMlirJitKernelState(
+    user_op::KernelInitContext* ctx,
+    const std::function<mlir::LogicalResult(mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module)>&
+        Lower) {
+  llvm::SmallVector<llvm::StringRef, 4> ext_libs(
+      {SharedLibPaths()->begin(), SharedLibPaths()->end()});
+  const std::string& op_name = ctx->op_name();
+  const std::string& assembly = ctx->Attr<std::string>("mlir_assembly");
+  auto function = MlirJitCache::Get()->GetOrCompile(
+      ctx->device_type(), op_name, assembly, ext_libs, [&](bool enable_object_dump) {
+        return CreateExecutionEngine(
+            op_name, ext_libs,
+            [&](mlir::MLIRContext* mlir_ctx) {
+              return mlir::parseSourceString<mlir::ModuleOp>(assembly, mlir_ctx);
+            },
+            [&](mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module) {
+              CHECK(mlir::succeeded(Lower(mlir_ctx, module)))
+                  << "fail to lower OneFlow to LLVM, op: " << op_name;
+            },
+            enable_object_dump);
+      });
+  return std::make_shared<MlirJitKernelState>(std::move(function));
 }
 
 template<typename T>
@@ -179,20 +460,16 @@ class MlirJitCpuKernel final : public user_op::OpKernel {
   MlirJitCpuKernel() = default;
   ~MlirJitCpuKernel() = default;
 
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return CreateMlirJitKernelState(ctx, mlir::oneflow::LowerModuleToLLVM);
+  }
+
  private:
-  void Compute(user_op::KernelComputeContext* ctx) const override {
-    llvm::SmallVector<llvm::StringRef, 4> ext_libs(
-        {SharedLibPaths()->begin(), SharedLibPaths()->end()});
-    WithMlirContext(
-        ctx, ext_libs,
-        [&ctx](mlir::MLIRContext* mlir_ctx) {
-          return mlir::parseSourceString<mlir::ModuleOp>(ctx->Attr<std::string>("mlir_assembly"),
-                                                         mlir_ctx);
-        },
-        [](mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module) {
-          CHECK(mlir::succeeded(mlir::oneflow::LowerModuleToLLVM(mlir_ctx, module)))
-              << "fail to lower OneFlow to LLVM";
-        });
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    dynamic_cast<const MlirJitKernelState*>(state)->function().Invoke(ctx);
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -222,20 +499,16 @@ class MlirJitGpuKernel final : public user_op::OpKernel {
   MlirJitGpuKernel() = default;
   ~MlirJitGpuKernel() = default;
 
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return CreateMlirJitKernelState(ctx, mlir::oneflow::LowerModuleToCUDALLVM);
+  }
+
  private:
-  void Compute(user_op::KernelComputeContext* ctx) const override {
-    llvm::SmallVector<llvm::StringRef, 4> ext_libs(
-        {SharedLibPaths()->begin(), SharedLibPaths()->end()});
-    WithMlirContext(
-        ctx, ext_libs,
-        [&ctx](mlir::MLIRContext* mlir_ctx) {
-          return mlir::parseSourceString<mlir::ModuleOp>(ctx->Attr<std::string>("mlir_assembly"),
-                                                         mlir_ctx);
-        },
-        [](mlir::MLIRContext* mlir_ctx, mlir::ModuleOp module) {
-          CHECK(mlir::succeeded(mlir::oneflow::LowerModuleToCUDALLVM(mlir_ctx, module)))
-              << "fail to lower OneFlow to CUDA LLVM";
-        });
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    dynamic_cast<const MlirJitKernelState*>(state)->function().Invoke(ctx);
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -261,4 +534,6 @@ REGISTER_MLIR_JIT_GPU_KERNEL(int64_t)
 
 }  // namespace
 
+MlirJitCacheStats GetMlirJitCacheStats() { return MlirJitCache::Get()->stats(); }
+
 }  // namespace oneflow
@@ -0,0 +1,31 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_IR_ONEFLOW_RUNTIME_INCLUDE_ONEFLOW_ASYNCRUNTIME_H_
+#define ONEFLOW_IR_ONEFLOW_RUNTIME_INCLUDE_ONEFLOW_ASYNCRUNTIME_H_
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace oneflow {
+
+// Names and addresses of the functions of the MLIR async runtime API. They run the tasks of the
+// async dialect on the OneFlow thread pool and must be registered to every JIT that executes code
+// lowered by async-to-llvm.
+const std::vector<std::pair<std::string, void*>>& AsyncRuntimeSymbols();
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_IR_ONEFLOW_RUNTIME_INCLUDE_ONEFLOW_ASYNCRUNTIME_H_
@@ -13,5 +13,251 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include "oneflow/ir/oneflow-runtime/include/OneFlow/AsyncRuntime.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glog/logging.h>
+#include "oneflow/core/common/global.h"
+#include "oneflow/core/platform/include/pthread_fork.h"
+#include "oneflow/core/thread/thread_pool.h"
 
-// This file is added to avoid cmake error
+namespace oneflow {
+
+namespace {
+
+// Same object model as the MLIR reference runtime (mlir/lib/ExecutionEngine/AsyncRuntime.cpp),
+// with the coroutines resumed on the OneFlow thread pool instead of a private llvm::ThreadPool.
+
+using CoroHandle = void*;
+using CoroResume = void (*)(void*);
+
+enum class AsyncState : int8_t { kUnavailable = 0, kAvailable = 1, kError = 2 };
+
+class RefCounted {
+ public:
+  explicit RefCounted(int64_t ref_count) : ref_count_(ref_count) {}
+  virtual ~RefCounted() = default;
+
+  void AddRef(int64_t count) { ref_count_.fetch_add(count); }
+  void DropRef(int64_t count) {
+    const int64_t previous = ref_count_.fetch_sub(count);
+    CHECK_GE(previous, count) << "reference count must not become negative";
+    if (previous == count) { delete this; }
+  }
+
+ private:
+  std::atomic<int64_t> ref_count_;
+};
+
+// Tokens and values are created with two references: one owned by the caller and one dropped
+// when they become available or an error, which keeps them alive until the async task completes.
+struct AsyncToken final : public RefCounted {
+  AsyncToken() : RefCounted(2), state(AsyncState::kUnavailable) {}
+
+  std::atomic<AsyncState> state;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<std::function<void()>> awaiters;
+};
+
+struct AsyncValue final : public RefCounted {
+  explicit AsyncValue(int64_t size)
+      : RefCounted(2), state(AsyncState::kUnavailable), storage(size) {}
+
+  std::atomic<AsyncState> state;
+  std::vector<int8_t> storage;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<std::function<void()>> awaiters;
+};
+
+// The size of a group is known when it is created, it becomes available once that many tokens
+// added to it are available or errors.
+struct AsyncGroup final : public RefCounted {
+  explicit AsyncGroup(int64_t size)
+      : RefCounted(1), pending_tokens(size), num_errors(0), rank(0) {}
+
+  std::atomic<int64_t> pending_tokens;
+  std::atomic<int64_t> num_errors;
+  std::atomic<int64_t> rank;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<std::function<void()>> awaiters;
+};
+
+bool IsReady(AsyncState state) { return state != AsyncState::kUnavailable; }
+
+template<typename T>
+void SetState(T* obj, AsyncState state) {
+  // The lock must be released before DropRef may destroy the mutex.
+  {
+    std::unique_lock<std::mutex> lock(obj->mutex);
+    CHECK(!IsReady(obj->state)) << "async token or value must be set only once";
+    obj->state = state;
+    obj->cv.notify_all();
+    for (auto& awaiter : obj->awaiters) { awaiter(); }
+  }
+  obj->DropRef(1);
+}
+
+template<typename T>
+void Await(T* obj) {
+  std::unique_lock<std::mutex> lock(obj->mutex);
+  obj->cv.wait(lock, [obj] { return IsReady(obj->state); });
+}
+
+template<typename T>
+void AwaitAndExecute(T* obj, CoroHandle handle, CoroResume resume) {
+  std::unique_lock<std::mutex> lock(obj->mutex);
+  if (IsReady(obj->state)) {
+    lock.unlock();
+    (*resume)(handle);
+  } else {
+    obj->awaiters.emplace_back([handle, resume]() { (*resume)(handle); });
+  }
+}
+
+void AddRef(void* obj, int64_t count) { static_cast<RefCounted*>(obj)->AddRef(count); }
+
+void DropRef(void* obj, int64_t count) { static_cast<RefCounted*>(obj)->DropRef(count); }
+
+AsyncToken* CreateToken() { return new AsyncToken(); }
+
+AsyncValue* CreateValue(int64_t size) { return new AsyncValue(size); }
+
+AsyncGroup* CreateGroup(int64_t size) { return new AsyncGroup(size); }
+
+int64_t AddTokenToGroup(AsyncToken* token, AsyncGroup* group) {
+  std::unique_lock<std::mutex> token_lock(token->mutex);
+  std::unique_lock<std::mutex> group_lock(group->mutex);
+  const int64_t rank = group->rank.fetch_add(1);
+  // Runs with the group mutex held.
+  auto OnTokenReady = [group, token]() {
+    if (token->state == AsyncState::kError) { group->num_errors.fetch_add(1); }
+    if (group->pending_tokens.fetch_sub(1) == 1) {
+      group->cv.notify_all();
+      for (auto& awaiter : group->awaiters) { awaiter(); }
+    }
+  };
+  if (IsReady(token->state)) {
+    OnTokenReady();
+  } else {
+    // The token becomes ready asynchronously, the group must be alive until then.
+    group->AddRef(1);
+    token->awaiters.emplace_back([group, OnTokenReady]() {
+      {
+        std::unique_lock<std::mutex> lock(group->mutex);
+        OnTokenReady();
+      }
+      group->DropRef(1);
+    });
+  }
+  return rank;
+}
+
+void EmplaceToken(AsyncToken* token) { SetState(token, AsyncState::kAvailable); }
+
+void EmplaceValue(AsyncValue* value) { SetState(value, AsyncState::kAvailable); }
+
+void SetTokenError(AsyncToken* token) { SetState(token, AsyncState::kError); }
+
+void SetValueError(AsyncValue* value) { SetState(value, AsyncState::kError); }
+
+bool IsTokenError(AsyncToken* token) { return token->state == AsyncState::kError; }
+
+bool IsValueError(AsyncValue* value) { return value->state == AsyncState::kError; }
+
+bool IsGroupError(AsyncGroup* group) { return group->num_errors.load() > 0; }
+
+void AwaitToken(AsyncToken* token) { Await(token); }
+
+void AwaitValue(AsyncValue* value) { Await(value); }
+
+void AwaitAllInGroup(AsyncGroup* group) {
+  std::unique_lock<std::mutex> lock(group->mutex);
+  group->cv.wait(lock, [group] { return group->pending_tokens.load() == 0; });
+}
+
+int8_t* GetValueStorage(AsyncValue* value) { return value->storage.data(); }
+
+bool HasThreadPool() {
+  return !pthread_fork::IsForkedSubProcess() && Global<ThreadPool>::Get() != nullptr;
+}
+
+void Execute(CoroHandle handle, CoroResume resume) {
+  if (HasThreadPool()) {
+    Global<ThreadPool>::Get()->AddWork([handle, resume]() { (*resume)(handle); });
+  } else {
+    (*resume)(handle);
+  }
+}
+
+void AwaitTokenAndExecute(AsyncToken* token, CoroHandle handle, CoroResume resume) {
+  AwaitAndExecute(token, handle, resume);
+}
+
+void AwaitValueAndExecute(AsyncValue* value, CoroHandle handle, CoroResume resume) {
+  AwaitAndExecute(value, handle, resume);
+}
+
+void AwaitAllInGroupAndExecute(AsyncGroup* group, CoroHandle handle, CoroResume resume) {
+  std::unique_lock<std::mutex> lock(group->mutex);
+  if (group->pending_tokens.load() == 0) {
+    lock.unlock();
+    (*resume)(handle);
+  } else {
+    group->awaiters.emplace_back([handle, resume]() { (*resume)(handle); });
+  }
+}
+
+int64_t GetNumWorkerThreads() {
+  return HasThreadPool() ? Global<ThreadPool>::Get()->thread_num() : 1;
+}
+
+void PrintCurrentThreadId() {
+  std::cout << "Current thread id: " << std::this_thread::get_id() << std::endl;
+}
+
+}  // namespace
+
+const std::vector<std::pair<std::string, void*>>& AsyncRuntimeSymbols() {
+#define ASYNC_RUNTIME_SYMBOL(name, func) \
+  { name, reinterpret_cast<void*>(&func) }
+  static const std::vector<std::pair<std::string, void*>> symbols = {
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeAddRef", AddRef),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeDropRef", DropRef),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeCreateToken", CreateToken),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeCreateValue", CreateValue),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeCreateGroup", CreateGroup),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeAddTokenToGroup", AddTokenToGroup),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeEmplaceToken", EmplaceToken),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeEmplaceValue", EmplaceValue),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeSetTokenError", SetTokenError),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeSetValueError", SetValueError),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeIsTokenError", IsTokenError),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeIsValueError", IsValueError),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeIsGroupError", IsGroupError),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeAwaitToken", AwaitToken),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeAwaitValue", AwaitValue),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeAwaitAllInGroup", AwaitAllInGroup),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeGetValueStorage", GetValueStorage),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeExecute", Execute),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeAwaitTokenAndExecute", AwaitTokenAndExecute),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeAwaitValueAndExecute", AwaitValueAndExecute),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimeAwaitAllInGroupAndExecute",
+                           AwaitAllInGroupAndExecute),
+      // The spelling of the upstream API.
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimGetNumWorkerThreads", GetNumWorkerThreads),
+      ASYNC_RUNTIME_SYMBOL("mlirAsyncRuntimePrintCurrentThreadId", PrintCurrentThreadId),
+  };
+#undef ASYNC_RUNTIME_SYMBOL
+  return symbols;
+}
+
+}  // namespace oneflow
@@ -57,6 +57,13 @@ def do_relu_graph(test_case, data, with_cuda):
     graph_to_run = GraphToRun()
     y_lazy = graph_to_run(x, scale)
     test_case.assertTrue(np.array_equal(y_eager.numpy(), y_lazy.numpy()))
+    # The jit kernel is compiled once and reused by later iterations.
+    num_compiles = flow._oneflow_internal.ir.jit_cache_stats()["num_compiles"]
+    y_lazy = graph_to_run(x, scale)
+    test_case.assertTrue(np.array_equal(y_eager.numpy(), y_lazy.numpy()))
+    test_case.assertEqual(
+        flow._oneflow_internal.ir.jit_cache_stats()["num_compiles"], num_compiles
+    )
 
 
 @flow.unittest.skip_unless_1n1d()
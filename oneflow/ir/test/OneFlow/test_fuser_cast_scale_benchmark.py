@@ -0,0 +1,82 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# RUN: python3 %s | FileCheck %s
+# CHECK: fused jit speedup
+
+import unittest
+import numpy as np
+
+import os
+import time
+
+os.environ["ONEFLOW_MLIR_ENABLE_ROUND_TRIP"] = "1"
+os.environ["ONEFLOW_MLIR_ENABLE_CODEGEN_FUSERS"] = "1"
+
+import oneflow as flow
+import oneflow.unittest
+
+
+class CastScaleChain(flow.nn.Module):
+    def forward(self, x, scale):
+        return x.to(dtype=flow.float32) * scale
+
+
+class CastScaleChainGraph(flow.nn.Graph):
+    def __init__(self):
+        super().__init__()
+        self.m = CastScaleChain()
+
+    def build(self, x, scale):
+        return self.m(x, scale)
+
+
+def bench(graph, x, scale, n):
+    # The first call compiles the graph and the jit kernels.
+    y = graph(x, scale)
+    y.numpy()
+    start_time = time.perf_counter()
+    for _ in range(n):
+        y = graph(x, scale)
+    y.numpy()
+    return y, (time.perf_counter() - start_time) / n
+
+
+def compare_fused_and_unfused(test_case, shape, n):
+    x = flow.tensor(np.random.randint(-100, 100, size=shape), dtype=flow.int64)
+    scale = flow.tensor([7.7], dtype=flow.float32)
+    # The fusers are checked every time a graph is compiled.
+    del os.environ["ONEFLOW_MLIR_ENABLE_CODEGEN_FUSERS"]
+    y_unfused, unfused_time = bench(CastScaleChainGraph(), x, scale, n)
+    os.environ["ONEFLOW_MLIR_ENABLE_CODEGEN_FUSERS"] = "1"
+    y_fused, fused_time = bench(CastScaleChainGraph(), x, scale, n)
+    test_case.assertTrue(np.allclose(y_unfused.numpy(), y_fused.numpy()))
+    print(
+        "shape: {}, unfused: {:.3f} ms, fused jit: {:.3f} ms".format(
+            shape, unfused_time * 1e3, fused_time * 1e3
+        )
+    )
+    print("fused jit speedup: {:.2f}x".format(unfused_time / fused_time))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestFuserCastScaleBenchmark(oneflow.unittest.TestCase):
+    def test_cast_scale_benchmark(test_case):
+        for shape in [(1024,), (256, 1024), (64, 256, 1024)]:
+            compare_fused_and_unfused(test_case, shape, 20)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,95 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+# RUN: python3 %s | FileCheck %s
+# CHECK: mlir_jit disk cache hit
+
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import unittest
+
+import numpy as np
+
+STATS_PREFIX = "jit_cache_stats "
+
+
+def run_cast_scale_graph():
+    os.environ["ONEFLOW_MLIR_ENABLE_ROUND_TRIP"] = "1"
+    os.environ["ONEFLOW_MLIR_ENABLE_CODEGEN_FUSERS"] = "1"
+    import oneflow as flow
+
+    data = np.array([[2.0, 1.0, 0.0, -1.0, -2.0], [2.0, 1.0, 0.0, -1.0, -2.0]])
+    x = flow.tensor(data, dtype=flow.int64)
+    scale = flow.tensor([7.7], dtype=flow.float32)
+
+    class GraphToRun(flow.nn.Graph):
+        def build(self, x, scale):
+            return x.to(dtype=flow.float32) * scale
+
+    y = GraphToRun()(x, scale)
+    expected = x.to(dtype=flow.float32) * scale
+    assert np.array_equal(y.numpy(), expected.numpy())
+    print(STATS_PREFIX + json.dumps(flow._oneflow_internal.ir.jit_cache_stats()))
+
+
+def run_in_new_process(cache_dir):
+    env = dict(os.environ, ONEFLOW_MLIR_JIT_CACHE_DIR=cache_dir)
+    output = subprocess.check_output([sys.executable, __file__, "--child"], env=env)
+    for line in output.decode().splitlines():
+        if line.startswith(STATS_PREFIX):
+            return json.loads(line[len(STATS_PREFIX) :])
+    raise RuntimeError("no jit cache stats in the output of the child process")
+
+
+class TestMlirJitDiskCache(unittest.TestCase):
+    def test_disk_cache(test_case):
+        with tempfile.TemporaryDirectory() as cache_dir:
+            first = run_in_new_process(cache_dir)
+            test_case.assertGreater(first["num_compiles"], 0)
+            test_case.assertEqual(first["num_disk_hits"], 0)
+            files = sorted(os.listdir(cache_dir))
+            test_case.assertEqual(len(files), 2 * first["num_compiles"])
+            test_case.assertFalse(any(".tmp" in f for f in files))
+
+            # A new process loads the object code instead of compiling it again.
+            second = run_in_new_process(cache_dir)
+            test_case.assertEqual(second["num_compiles"], 0)
+            test_case.assertEqual(second["num_disk_hits"], first["num_compiles"])
+            print("mlir_jit disk cache hit")
+
+            # Object files whose stored key does not match are compiled again.
+            for f in files:
+                if f.endswith(".key"):
+                    with open(os.path.join(cache_dir, f), "w") as key_file:
+                        key_file.write("stale")
+            third = run_in_new_process(cache_dir)
+            test_case.assertEqual(third["num_compiles"], first["num_compiles"])
+            test_case.assertEqual(third["num_disk_hits"], 0)
+
+    def test_disk_cache_dir_not_creatable(test_case):
+        with tempfile.NamedTemporaryFile() as not_a_dir:
+            stats = run_in_new_process(os.path.join(not_a_dir.name, "cache"))
+            test_case.assertGreater(stats["num_compiles"], 0)
+            test_case.assertEqual(stats["num_disk_hits"], 0)
+
+
+if __name__ == "__main__":
+    if "--child" in sys.argv:
+        run_cast_scale_graph()
+    else:
+        unittest.main()
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
+#include "oneflow/user/kernels/sort_kernel_util.h"
 
 namespace oneflow {
 
@@ -29,31 +30,41 @@ class CpuArgSortKernel final : public user_op::OpKernel {
     const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
 
-    const int32_t instance_size = in->shape().At(in->shape().NumAxes() - 1);
-    const int32_t instance_num = in->shape().elem_cnt() / instance_size;
+    const int64_t instance_size = in->shape().At(in->shape().NumAxes() - 1);
+    const int64_t instance_num = in->shape().elem_cnt() / instance_size;
     const std::string& direction = ctx->Attr<std::string>("direction");
-    const bool is_ascending = direction == "ASCENDING";
-    const bool is_descending = direction == "DESCENDING";
-    FOR_RANGE(int32_t, i, 0, instance_num) {
-      const T* in_ptr_i = in->dptr<T>() + i * instance_size;
-      int32_t* out_ptr_i = out->mut_dptr<int32_t>() + i * instance_size;
-      std::iota(out_ptr_i, out_ptr_i + instance_size, 0);
-      auto comp = [&](const int32_t lhs, const int32_t rhs) {
-        const T l = in_ptr_i[lhs];
-        const T r = in_ptr_i[rhs];
-        if (l == r) {
-          return lhs < rhs;
-        } else {
-          if (is_ascending) {
-            return l < r;
-          } else if (is_descending) {
-            return l > r;
-          } else {
-            UNIMPLEMENTED();
-          }
-        }
-      };
-      std::sort(out_ptr_i, out_ptr_i + instance_size, comp);
+    const T* in_ptr = in->dptr<T>();
+    int32_t* out_ptr = out->mut_dptr<int32_t>();
+    ep::CpuStream* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    cpu_stream->ParallelFor(0, instance_num, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        int32_t* out_ptr_i = out_ptr + i * instance_size;
+        std::iota(out_ptr_i, out_ptr_i + instance_size, 0);
+      }
+    });
+    // Ties are broken by index, which makes the order total and the result deterministic.
+    if (direction == "ASCENDING") {
+      cpu_sort::SegmentedSort(ctx->stream(), out_ptr, instance_num, instance_size,
+                              [&](int64_t i) {
+                                const T* in_ptr_i = in_ptr + i * instance_size;
+                                return [in_ptr_i](const int32_t lhs, const int32_t rhs) {
+                                  const T l = in_ptr_i[lhs];
+                                  const T r = in_ptr_i[rhs];
+                                  return l == r ? lhs < rhs : l < r;
+                                };
+                              });
+    } else if (direction == "DESCENDING") {
+      cpu_sort::SegmentedSort(ctx->stream(), out_ptr, instance_num, instance_size,
+                              [&](int64_t i) {
+                                const T* in_ptr_i = in_ptr + i * instance_size;
+                                return [in_ptr_i](const int32_t lhs, const int32_t rhs) {
+                                  const T l = in_ptr_i[lhs];
+                                  const T r = in_ptr_i[rhs];
+                                  return l == r ? lhs < rhs : l > r;
+                                };
+                              });
+    } else {
+      UNIMPLEMENTED();
     }
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
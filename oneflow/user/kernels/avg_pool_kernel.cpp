@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/kernels/avg_pool_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
@@ -41,70 +42,190 @@ std::shared_ptr<AvgPoolOpKernelCache> CreateAvgOpKernelCache(user_op::KernelCach
   return cache;
 }
 
+namespace {
+
+constexpr int64_t kMinElemsPerChunk = 32768;
+
+struct AvgPoolAxis {
+  int64_t x_size;
+  int64_t y_size;
+  int32_t kernel_size;
+  int32_t stride;
+  int32_t padding;
+
+  // Same window bounds as the device kernels. *pool_size counts the padded positions, [*start,
+  // *end) only the valid ones.
+  void Get(int64_t out, int64_t* start, int64_t* end, int64_t* pool_size) const {
+    const int64_t begin = out * stride - padding;
+    const int64_t padded_end = std::min<int64_t>(begin + kernel_size, x_size + padding);
+    *pool_size = padded_end - begin;
+    *start = std::max<int64_t>(0, begin);
+    *end = std::min<int64_t>(padded_end, x_size);
+  }
+
+  // Per-output divisor factor of this axis; divisors are the product over all axes.
+  std::vector<int64_t> GetFactors(bool count_include_pad) const {
+    std::vector<int64_t> factors(y_size);
+    for (int64_t o = 0; o < y_size; ++o) {
+      int64_t start = 0, end = 0, pool_size = 0;
+      Get(o, &start, &end, &pool_size);
+      factors[o] = count_include_pad ? pool_size : end - start;
+    }
+    return factors;
+  }
+};
+
+AvgPoolAxis GetAvgPoolAxis(const AvgPoolParams3D& params_3d, int32_t axis) {
+  AvgPoolAxis pool_axis;
+  pool_axis.x_size = params_3d.GetXShape5D().At(2 + axis);
+  pool_axis.y_size = params_3d.GetYShape5D().At(2 + axis);
+  pool_axis.kernel_size = params_3d.pool_size_3d().at(axis);
+  pool_axis.stride = params_3d.stride_3d().at(axis);
+  pool_axis.padding = params_3d.padding().at(axis);
+  return pool_axis;
+}
+
+// Covers 1d, 2d and 3d pooling: output rows of all (n, c) planes are distributed over the threads
+// and every window row is summed over contiguous memory.
+template<typename T>
+void AvgPoolForward(ep::Stream* stream, const T* src, T* dest, const AvgPoolParams3D& params_3d) {
+  const int64_t num_planes = params_3d.GetXShape5D().Count(0, 2);
+  const AvgPoolAxis at = GetAvgPoolAxis(params_3d, 0);
+  const AvgPoolAxis ah = GetAvgPoolAxis(params_3d, 1);
+  const AvgPoolAxis aw = GetAvgPoolAxis(params_3d, 2);
+  const int32_t divisor_override = params_3d.divisor_override();
+  const bool count_include_pad = params_3d.count_include_pad();
+  const int64_t x_plane_size = at.x_size * ah.x_size * aw.x_size;
+  const int64_t work_per_row =
+      aw.y_size * at.kernel_size * ah.kernel_size * static_cast<int64_t>(aw.kernel_size);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_planes * at.y_size * ah.y_size,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          const int64_t plane = row / (at.y_size * ah.y_size);
+          int64_t tstart = 0, tend = 0, tpool = 0, hstart = 0, hend = 0, hpool = 0;
+          at.Get(row / ah.y_size % at.y_size, &tstart, &tend, &tpool);
+          ah.Get(row % ah.y_size, &hstart, &hend, &hpool);
+          const T* x = src + plane * x_plane_size;
+          T* y = dest + row * aw.y_size;
+          for (int64_t w = 0; w < aw.y_size; ++w) {
+            int64_t wstart = 0, wend = 0, wpool = 0;
+            aw.Get(w, &wstart, &wend, &wpool);
+            int64_t divide_factor = 0;
+            if (divisor_override != 0) {
+              divide_factor = divisor_override;
+            } else if (count_include_pad) {
+              divide_factor = tpool * hpool * wpool;
+            } else {
+              divide_factor = (tend - tstart) * (hend - hstart) * (wend - wstart);
+            }
+            T sum = 0;
+            for (int64_t zi = tstart; zi < tend; ++zi) {
+              for (int64_t i = hstart; i < hend; ++i) {
+                const T* x_row = x + (zi * ah.x_size + i) * aw.x_size;
+                for (int64_t j = wstart; j < wend; ++j) { sum += x_row[j]; }
+              }
+            }
+            y[w] = sum / divide_factor;
+          }
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / std::max<int64_t>(1, work_per_row)));
+}
+
+// Gathers into every dx row the contributions of all outputs whose window covers it instead of
+// scattering from dy, so rows are written by a single thread and no atomics are needed. The
+// contributions are added in output order, which gives the same result as the scatter.
+template<typename T>
+void AvgPoolBackward(ep::Stream* stream, const T* src, T* dest, const AvgPoolParams3D& params_3d) {
+  const int64_t num_planes = params_3d.GetXShape5D().Count(0, 2);
+  const AvgPoolAxis at = GetAvgPoolAxis(params_3d, 0);
+  const AvgPoolAxis ah = GetAvgPoolAxis(params_3d, 1);
+  const AvgPoolAxis aw = GetAvgPoolAxis(params_3d, 2);
+  const int32_t divisor_override = params_3d.divisor_override();
+  const bool count_include_pad = params_3d.count_include_pad();
+  const std::vector<int64_t> t_factors = at.GetFactors(count_include_pad);
+  const std::vector<int64_t> h_factors = ah.GetFactors(count_include_pad);
+  const std::vector<int64_t> w_factors = aw.GetFactors(count_include_pad);
+  // Outputs [first, last) of an axis whose windows cover input position x.
+  const auto GetCoveringOutputs = [](const AvgPoolAxis& axis, int64_t x, int64_t* first,
+                                     int64_t* last) {
+    const int64_t padded_x = x + axis.padding;
+    *first = padded_x < axis.kernel_size ? 0 : (padded_x - axis.kernel_size) / axis.stride + 1;
+    *last = std::min<int64_t>(axis.y_size, padded_x / axis.stride + 1);
+  };
+  std::vector<int64_t> w_first(aw.x_size);
+  std::vector<int64_t> w_last(aw.x_size);
+  for (int64_t j = 0; j < aw.x_size; ++j) { GetCoveringOutputs(aw, j, &w_first[j], &w_last[j]); }
+  const int64_t y_plane_size = at.y_size * ah.y_size * aw.y_size;
+  const int64_t work_per_row = aw.x_size * at.kernel_size * ah.kernel_size
+                               * static_cast<int64_t>(aw.kernel_size) / (aw.stride * ah.stride);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_planes * at.x_size * ah.x_size,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          const int64_t plane = row / (at.x_size * ah.x_size);
+          int64_t tfirst = 0, tlast = 0, hfirst = 0, hlast = 0;
+          GetCoveringOutputs(at, row / ah.x_size % at.x_size, &tfirst, &tlast);
+          GetCoveringOutputs(ah, row % ah.x_size, &hfirst, &hlast);
+          const T* dy = src + plane * y_plane_size;
+          T* dx = dest + row * aw.x_size;
+          for (int64_t t = tfirst; t < tlast; ++t) {
+            for (int64_t h = hfirst; h < hlast; ++h) {
+              const T* dy_row = dy + (t * ah.y_size + h) * aw.y_size;
+              const int64_t th_factor = t_factors[t] * h_factors[h];
+              for (int64_t j = 0; j < aw.x_size; ++j) {
+                for (int64_t w = w_first[j]; w < w_last[j]; ++w) {
+                  const int64_t divide_factor =
+                      divisor_override != 0 ? divisor_override : th_factor * w_factors[w];
+                  dx[j] += dy_row[w] / divide_factor;
+                }
+              }
+            }
+          }
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / std::max<int64_t>(1, work_per_row)));
+}
+
+}  // namespace
+
 template<typename T, typename IDX>
 struct AvgPoolKernelUtil<DeviceType::kCPU, T, IDX> {
   static void Avgpool1dForward(ep::Stream* stream, const NdIndexOffsetHelper<IDX, 2>& index_helper,
                                const IDX elem_num, const T* src, T* dest,
                                const AvgPoolParams3D& params_3d) {
-    Avgpool1dForwardCompute<T, IDX>(
-        index_helper, elem_num, src, dest, params_3d.padding()[2], params_3d.num_batch(),
-        params_3d.num_channel(), params_3d.GetXShape5D().At(4), params_3d.pool_size_3d()[2],
-        params_3d.stride_3d()[2], params_3d.count_include_pad(), params_3d.divisor_override());
+    AvgPoolForward<T>(stream, src, dest, params_3d);
   }
 
   static void Avgpool1dBackward(ep::Stream* stream, const NdIndexOffsetHelper<IDX, 2>& index_helper,
                                 const IDX elem_num, const T* src, T* dest,
                                 const AvgPoolParams3D& params_3d) {
-    Avgpool1dBackwardCompute<T, IDX>(
-        index_helper, elem_num, src, dest, params_3d.padding()[2], params_3d.num_batch(),
-        params_3d.num_channel(), params_3d.GetXShape5D().At(4), params_3d.pool_size_3d()[2],
-        params_3d.stride_3d()[2], params_3d.count_include_pad(), params_3d.divisor_override());
+    AvgPoolBackward<T>(stream, src, dest, params_3d);
   }
 
   static void Avgpool2dForward(ep::Stream* stream, const NdIndexOffsetHelper<IDX, 3>& index_helper,
                                const IDX elem_num, const T* src, T* dest,
                                const AvgPoolParams3D& params_3d) {
-    Avgpool2dForwardCompute<T, IDX>(
-        index_helper, elem_num, src, dest, params_3d.padding()[1], params_3d.padding()[2],
-        params_3d.num_batch(), params_3d.num_channel(), params_3d.GetXShape5D().At(3),
-        params_3d.GetXShape5D().At(4), params_3d.pool_size_3d()[1], params_3d.pool_size_3d()[2],
-        params_3d.stride_3d()[1], params_3d.stride_3d()[2], params_3d.count_include_pad(),
-        params_3d.divisor_override());
+    AvgPoolForward<T>(stream, src, dest, params_3d);
   }
 
   static void Avgpool2dBackward(ep::Stream* stream, const NdIndexOffsetHelper<IDX, 3>& index_helper,
                                 const IDX elem_num, const T* src, T* dest,
                                 const AvgPoolParams3D& params_3d) {
-    Avgpool2dBackwardCompute<T, IDX>(
-        index_helper, elem_num, src, dest, params_3d.padding()[1], params_3d.padding()[2],
-        params_3d.num_batch(), params_3d.num_channel(), params_3d.GetXShape5D().At(3),
-        params_3d.GetXShape5D().At(4), params_3d.pool_size_3d()[1], params_3d.pool_size_3d()[2],
-        params_3d.stride_3d()[1], params_3d.stride_3d()[2], params_3d.count_include_pad(),
-        params_3d.divisor_override());
+    AvgPoolBackward<T>(stream, src, dest, params_3d);
   }
 
   static void Avgpool3dForward(ep::Stream* stream, const NdIndexOffsetHelper<IDX, 4>& index_helper,
                                const IDX elem_num, const T* src, T* dest,
                                const AvgPoolParams3D& params_3d) {
-    Avgpool3dForwardCompute<T, IDX>(
-        index_helper, elem_num, src, dest, params_3d.padding()[0], params_3d.padding()[1],
-        params_3d.padding()[2], params_3d.num_batch(), params_3d.num_channel(),
-        params_3d.GetXShape5D().At(2), params_3d.GetXShape5D().At(3), params_3d.GetXShape5D().At(4),
-        params_3d.pool_size_3d()[0], params_3d.pool_size_3d()[1], params_3d.pool_size_3d()[2],
-        params_3d.stride_3d()[0], params_3d.stride_3d()[1], params_3d.stride_3d()[2],
-        params_3d.count_include_pad(), params_3d.divisor_override());
+    AvgPoolForward<T>(stream, src, dest, params_3d);
   }
 
   static void Avgpool3dBackward(ep::Stream* stream, const NdIndexOffsetHelper<IDX, 4>& index_helper,
                                 const int64_t elem_num, const T* src, T* dest,
                                 const AvgPoolParams3D& params_3d) {
-    Avgpool3dBackwardCompute<T, IDX>(
-        index_helper, elem_num, src, dest, params_3d.padding()[0], params_3d.padding()[1],
-        params_3d.padding()[2], params_3d.num_batch(), params_3d.num_channel(),
-        params_3d.GetXShape5D().At(2), params_3d.GetXShape5D().At(3), params_3d.GetXShape5D().At(4),
-        params_3d.pool_size_3d()[0], params_3d.pool_size_3d()[1], params_3d.pool_size_3d()[2],
-        params_3d.stride_3d()[0], params_3d.stride_3d()[1], params_3d.stride_3d()[2],
-        params_3d.count_include_pad(), params_3d.divisor_override());
+    AvgPoolBackward<T>(stream, src, dest, params_3d);
   }
 };
 
@@ -0,0 +1,466 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_CONV_CPU_ALGO_UTIL_H_
+#define ONEFLOW_USER_KERNELS_CONV_CPU_ALGO_UTIL_H_
+
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/kernel/new_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+/*
+CPU convolution algorithms used next to im2col + GEMM by the conv kernels. All of them work on the
+5-D channels_first shapes held in the conv kernel cache (in: N,C,D,H,W, weight: K,C/groups,KD,KH,KW,
+out: N,K,OD,OH,OW):
+
+kDirect:       loops straight over the kernel taps without a column buffer. Picked when the
+               reduction size C/groups * KD * KH * KW is too small to feed a GEMM, which covers
+               depthwise convolutions and first layers with few input channels.
+kWinogradF23:  Winograd F(2x2, 3x3) for 3x3, stride 1, dilation 1 2-D convolutions with enough
+               channels. The data grad runs the same algorithm on dy with the flipped, transposed
+               filter; the filter grad accumulates one GEMM per kernel tap over a shifted copy of x,
+               which needs 1/(KH*KW) of the column buffer.
+kIm2ColGemm:   the fallback, and the only algorithm for channels_last.
+*/
+
+enum class ConvCpuAlgo {
+  kIm2ColGemm = 0,
+  kDirect,
+  kWinogradF23,
+};
+
+constexpr int64_t kConvCpuDirectMaxReduceSize = 32;
+constexpr int64_t kConvCpuWinogradMinChannels = 16;
+
+inline ConvCpuAlgo SelectConvCpuAlgo(const std::string& data_format, const ShapeView& weight_shape,
+                                     const std::vector<int32_t>& strides,
+                                     const std::vector<int32_t>& dilation_rate, int32_t groups) {
+  if (data_format != "channels_first") { return ConvCpuAlgo::kIm2ColGemm; }
+  const int32_t ndims = weight_shape.NumAxes() - 2;
+  if (groups > 1) {
+    return weight_shape.At(1) == 1 ? ConvCpuAlgo::kDirect : ConvCpuAlgo::kIm2ColGemm;
+  }
+  if (weight_shape.Count(1) <= kConvCpuDirectMaxReduceSize) { return ConvCpuAlgo::kDirect; }
+  bool is_3x3_unit_stride = ndims == 2;
+  for (int32_t i = 0; i < ndims; ++i) {
+    is_3x3_unit_stride = is_3x3_unit_stride && weight_shape.At(2 + i) == 3 && strides.at(i) == 1
+                         && dilation_rate.at(i) == 1;
+  }
+  if (is_3x3_unit_stride && weight_shape.At(0) >= kConvCpuWinogradMinChannels
+      && weight_shape.At(1) >= kConvCpuWinogradMinChannels) {
+    return ConvCpuAlgo::kWinogradF23;
+  }
+  return ConvCpuAlgo::kIm2ColGemm;
+}
+
+template<typename ContextT>
+ConvCpuAlgo InferConvCpuAlgo(ContextT* ctx, const ShapeView& weight_shape) {
+  return SelectConvCpuAlgo(ctx->template Attr<std::string>("data_format"), weight_shape,
+                           ctx->template Attr<std::vector<int32_t>>("strides"),
+                           ctx->template Attr<std::vector<int32_t>>("dilation_rate"),
+                           ctx->template Attr<int32_t>("groups"));
+}
+
+namespace conv_cpu {
+
+constexpr int64_t kMinElemsPerChunk = 32768;
+
+inline int64_t GetGrainSize(int64_t work_per_task) {
+  return std::max<int64_t>(1, kMinElemsPerChunk / std::max<int64_t>(1, work_per_task));
+}
+
+// Calls fn(out_offset, in_offset, cnt) for every run of output positions along W whose input
+// positions for the kernel tap (kd, kh, kw) are inside the image. Output out_offset + i reads input
+// in_offset + i * strides[2]. Offsets are relative to one D*H*W plane.
+template<typename F>
+void ForEachValidRow(const ShapeView& in_shape, const ShapeView& out_shape, const int32_t* strides,
+                     const int32_t* dilation_rate, const int32_t* padding_before, int64_t kd,
+                     int64_t kh, int64_t kw, const F& fn) {
+  const int64_t in_d = in_shape.At(2);
+  const int64_t in_h = in_shape.At(3);
+  const int64_t in_w = in_shape.At(4);
+  const int64_t out_d = out_shape.At(2);
+  const int64_t out_h = out_shape.At(3);
+  const int64_t out_w = out_shape.At(4);
+  const int64_t iw0 = kw * dilation_rate[2] - padding_before[2];
+  const int64_t ow_begin = iw0 >= 0 ? 0 : (-iw0 + strides[2] - 1) / strides[2];
+  const int64_t ow_end =
+      in_w - 1 - iw0 < 0 ? 0 : std::min<int64_t>(out_w, (in_w - 1 - iw0) / strides[2] + 1);
+  if (ow_end <= ow_begin) { return; }
+  for (int64_t od = 0; od < out_d; ++od) {
+    const int64_t id = od * strides[0] + kd * dilation_rate[0] - padding_before[0];
+    if (id < 0 || id >= in_d) { continue; }
+    for (int64_t oh = 0; oh < out_h; ++oh) {
+      const int64_t ih = oh * strides[1] + kh * dilation_rate[1] - padding_before[1];
+      if (ih < 0 || ih >= in_h) { continue; }
+      const int64_t out_offset = (od * out_h + oh) * out_w + ow_begin;
+      const int64_t in_offset = (id * in_h + ih) * in_w + ow_begin * strides[2] + iw0;
+      fn(out_offset, in_offset, ow_end - ow_begin);
+    }
+  }
+}
+
+template<typename F>
+void ForEachKernelTap(const ShapeView& weight_shape, const F& fn) {
+  int64_t tap = 0;
+  for (int64_t kd = 0; kd < weight_shape.At(2); ++kd) {
+    for (int64_t kh = 0; kh < weight_shape.At(3); ++kh) {
+      for (int64_t kw = 0; kw < weight_shape.At(4); ++kw) { fn(tap++, kd, kh, kw); }
+    }
+  }
+}
+
+}  // namespace conv_cpu
+
+template<typename T>
+struct DirectConvUtil final {
+  // out[n, k] = bias[k] + sum_{c, taps} weight[k, c, taps] * in[n, g(k) * C/groups + c, ...]
+  static void Forward(ep::Stream* stream, const T* in, const ShapeView& in_shape, const T* weight,
+                      const ShapeView& weight_shape, const ShapeView& out_shape,
+                      const int32_t* strides, const int32_t* dilation_rate,
+                      const int32_t* padding_before, int32_t groups, const T* bias, T* out) {
+    const int64_t in_channels = in_shape.At(1);
+    const int64_t out_channels = out_shape.At(1);
+    const int64_t group_in_channels = weight_shape.At(1);
+    const int64_t group_out_channels = out_channels / groups;
+    const int64_t in_plane = in_shape.Count(2);
+    const int64_t out_plane = out_shape.Count(2);
+    const int64_t kernel_size = weight_shape.Count(2);
+    const int32_t stride_w = strides[2];
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, out_shape.At(0) * out_channels,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t task = begin; task < end; ++task) {
+            const int64_t n = task / out_channels;
+            const int64_t k = task % out_channels;
+            const int64_t in_channel_begin = k / group_out_channels * group_in_channels;
+            T* out_ptr = out + task * out_plane;
+            std::fill(out_ptr, out_ptr + out_plane, bias == nullptr ? 0 : bias[k]);
+            for (int64_t c = 0; c < group_in_channels; ++c) {
+              const T* in_ptr = in + (n * in_channels + in_channel_begin + c) * in_plane;
+              const T* weight_ptr = weight + (k * group_in_channels + c) * kernel_size;
+              conv_cpu::ForEachKernelTap(weight_shape, [&](int64_t tap, int64_t kd, int64_t kh,
+                                                           int64_t kw) {
+                const T w = weight_ptr[tap];
+                conv_cpu::ForEachValidRow(
+                    in_shape, out_shape, strides, dilation_rate, padding_before, kd, kh, kw,
+                    [&](int64_t out_offset, int64_t in_offset, int64_t cnt) {
+                      T* out_row = out_ptr + out_offset;
+                      const T* in_row = in_ptr + in_offset;
+                      if (stride_w == 1) {
+                        for (int64_t i = 0; i < cnt; ++i) { out_row[i] += w * in_row[i]; }
+                      } else {
+                        for (int64_t i = 0; i < cnt; ++i) {
+                          out_row[i] += w * in_row[i * stride_w];
+                        }
+                      }
+                    });
+              });
+            }
+          }
+        },
+        conv_cpu::GetGrainSize(weight_shape.Count(1) * out_plane));
+  }
+
+  // dx[n, c] = sum_{k in group(c), taps} weight[k, c, taps] scattered by dy[n, k]
+  static void DataGrad(ep::Stream* stream, const T* dy, const ShapeView& dy_shape, const T* weight,
+                       const ShapeView& weight_shape, const ShapeView& dx_shape,
+                       const int32_t* strides, const int32_t* dilation_rate,
+                       const int32_t* padding_before, int32_t groups, T* dx) {
+    const int64_t in_channels = dx_shape.At(1);
+    const int64_t out_channels = dy_shape.At(1);
+    const int64_t group_in_channels = weight_shape.At(1);
+    const int64_t group_out_channels = out_channels / groups;
+    const int64_t in_plane = dx_shape.Count(2);
+    const int64_t out_plane = dy_shape.Count(2);
+    const int64_t kernel_size = weight_shape.Count(2);
+    const int32_t stride_w = strides[2];
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, dx_shape.At(0) * in_channels,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t task = begin; task < end; ++task) {
+            const int64_t n = task / in_channels;
+            const int64_t c = task % in_channels % group_in_channels;
+            const int64_t out_channel_begin =
+                task % in_channels / group_in_channels * group_out_channels;
+            T* dx_ptr = dx + task * in_plane;
+            std::fill(dx_ptr, dx_ptr + in_plane, static_cast<T>(0));
+            for (int64_t k = out_channel_begin; k < out_channel_begin + group_out_channels; ++k) {
+              const T* dy_ptr = dy + (n * out_channels + k) * out_plane;
+              const T* weight_ptr = weight + (k * group_in_channels + c) * kernel_size;
+              conv_cpu::ForEachKernelTap(weight_shape, [&](int64_t tap, int64_t kd, int64_t kh,
+                                                           int64_t kw) {
+                const T w = weight_ptr[tap];
+                conv_cpu::ForEachValidRow(
+                    dx_shape, dy_shape, strides, dilation_rate, padding_before, kd, kh, kw,
+                    [&](int64_t dy_offset, int64_t dx_offset, int64_t cnt) {
+                      const T* dy_row = dy_ptr + dy_offset;
+                      T* dx_row = dx_ptr + dx_offset;
+                      if (stride_w == 1) {
+                        for (int64_t i = 0; i < cnt; ++i) { dx_row[i] += w * dy_row[i]; }
+                      } else {
+                        for (int64_t i = 0; i < cnt; ++i) { dx_row[i * stride_w] += w * dy_row[i]; }
+                      }
+                    });
+              });
+            }
+          }
+        },
+        conv_cpu::GetGrainSize(group_out_channels * kernel_size * out_plane));
+  }
+
+  // filter_diff[k, c, taps] = sum_{n, positions} dy[n, k] * x[n, g(k) * C/groups + c] shifted
+  static void FilterGrad(ep::Stream* stream, const T* x, const ShapeView& x_shape, const T* dy,
+                         const ShapeView& dy_shape, const ShapeView& weight_shape,
+                         const int32_t* strides, const int32_t* dilation_rate,
+                         const int32_t* padding_before, int32_t groups, T* filter_diff) {
+    const int64_t batch_size = x_shape.At(0);
+    const int64_t in_channels = x_shape.At(1);
+    const int64_t out_channels = dy_shape.At(1);
+    const int64_t group_in_channels = weight_shape.At(1);
+    const int64_t group_out_channels = out_channels / groups;
+    const int64_t in_plane = x_shape.Count(2);
+    const int64_t out_plane = dy_shape.Count(2);
+    const int64_t kernel_size = weight_shape.Count(2);
+    const int32_t stride_w = strides[2];
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, out_channels,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t k = begin; k < end; ++k) {
+            const int64_t in_channel_begin = k / group_out_channels * group_in_channels;
+            for (int64_t c = 0; c < group_in_channels; ++c) {
+              T* filter_diff_ptr = filter_diff + (k * group_in_channels + c) * kernel_size;
+              conv_cpu::ForEachKernelTap(weight_shape, [&](int64_t tap, int64_t kd, int64_t kh,
+                                                           int64_t kw) {
+                T sum = 0;
+                for (int64_t n = 0; n < batch_size; ++n) {
+                  const T* dy_ptr = dy + (n * out_channels + k) * out_plane;
+                  const T* x_ptr = x + (n * in_channels + in_channel_begin + c) * in_plane;
+                  conv_cpu::ForEachValidRow(
+                      x_shape, dy_shape, strides, dilation_rate, padding_before, kd, kh, kw,
+                      [&](int64_t dy_offset, int64_t x_offset, int64_t cnt) {
+                        const T* dy_row = dy_ptr + dy_offset;
+                        const T* x_row = x_ptr + x_offset;
+                        for (int64_t i = 0; i < cnt; ++i) {
+                          sum += dy_row[i] * x_row[i * stride_w];
+                        }
+                      });
+                }
+                filter_diff_ptr[tap] = sum;
+              });
+            }
+          }
+        },
+        conv_cpu::GetGrainSize(batch_size * weight_shape.Count(1) * out_plane));
+  }
+};
+
+template<typename T>
+struct WinogradF23ConvUtil final {
+  static int64_t NumTiles(int64_t out_h, int64_t out_w) {
+    return ((out_h + 1) / 2) * ((out_w + 1) / 2);
+  }
+
+  // Filter, input and output transforms plus the 16 GEMMs of one image.
+  static size_t TmpElemCnt(int64_t in_channels, int64_t out_channels, int64_t out_h,
+                           int64_t out_w) {
+    const int64_t num_tiles = NumTiles(out_h, out_w);
+    return 16 * (out_channels * in_channels + in_channels * num_tiles + out_channels * num_tiles);
+  }
+
+  // U = G g G^T laid out as [16][rows][cols]. For the forward pass rows are the K filters and cols
+  // the C channels of weight (K, C, 3, 3). With flip the filter is rotated by 180 degrees and
+  // transposed to rows = C, cols = K, which turns the data grad into a forward convolution of dy.
+  static void TransformFilter(const T* weight, int64_t out_channels, int64_t in_channels, bool flip,
+                              T* u) {
+    const int64_t rows = flip ? in_channels : out_channels;
+    const int64_t cols = flip ? out_channels : in_channels;
+    for (int64_t k = 0; k < out_channels; ++k) {
+      for (int64_t c = 0; c < in_channels; ++c) {
+        const T* w = weight + (k * in_channels + c) * 9;
+        T g[3][3];
+        for (int i = 0; i < 3; ++i) {
+          for (int j = 0; j < 3; ++j) { g[i][j] = flip ? w[(2 - i) * 3 + (2 - j)] : w[i * 3 + j]; }
+        }
+        T t[4][3];
+        for (int j = 0; j < 3; ++j) {
+          t[0][j] = g[0][j];
+          t[1][j] = (g[0][j] + g[1][j] + g[2][j]) * static_cast<T>(0.5);
+          t[2][j] = (g[0][j] - g[1][j] + g[2][j]) * static_cast<T>(0.5);
+          t[3][j] = g[2][j];
+        }
+        T* u_ptr = u + (flip ? c * cols + k : k * cols + c);
+        const int64_t u_step = rows * cols;
+        for (int i = 0; i < 4; ++i) {
+          u_ptr[(i * 4 + 0) * u_step] = t[i][0];
+          u_ptr[(i * 4 + 1) * u_step] = (t[i][0] + t[i][1] + t[i][2]) * static_cast<T>(0.5);
+          u_ptr[(i * 4 + 2) * u_step] = (t[i][0] - t[i][1] + t[i][2]) * static_cast<T>(0.5);
+          u_ptr[(i * 4 + 3) * u_step] = t[i][2];
+        }
+      }
+    }
+  }
+
+  // One image: out (K, out_h, out_w) = conv(in (C, in_h, in_w), U) with a 3x3 window starting at
+  // (-pad_h, -pad_w). buf holds V [16][C][tiles] followed by M [16][K][tiles].
+  static void Conv2d(ep::Stream* stream, const T* in, int64_t in_channels, int64_t in_h,
+                     int64_t in_w, const T* u, int64_t out_channels, int64_t out_h, int64_t out_w,
+                     int64_t pad_h, int64_t pad_w, const T* bias, T* out, T* buf) {
+    const int64_t tiles_w = (out_w + 1) / 2;
+    const int64_t num_tiles = NumTiles(out_h, out_w);
+    T* v = buf;
+    T* m = buf + 16 * in_channels * num_tiles;
+    auto* cpu_stream = stream->As<ep::CpuStream>();
+    cpu_stream->ParallelFor(
+        0, in_channels,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t c = begin; c < end; ++c) {
+            const T* in_ptr = in + c * in_h * in_w;
+            for (int64_t tile = 0; tile < num_tiles; ++tile) {
+              const int64_t h0 = tile / tiles_w * 2 - pad_h;
+              const int64_t w0 = tile % tiles_w * 2 - pad_w;
+              T d[4][4];
+              for (int i = 0; i < 4; ++i) {
+                for (int j = 0; j < 4; ++j) {
+                  const int64_t h = h0 + i;
+                  const int64_t w = w0 + j;
+                  d[i][j] = (h >= 0 && h < in_h && w >= 0 && w < in_w) ? in_ptr[h * in_w + w] : 0;
+                }
+              }
+              T t[4][4];
+              for (int j = 0; j < 4; ++j) {
+                t[0][j] = d[0][j] - d[2][j];
+                t[1][j] = d[1][j] + d[2][j];
+                t[2][j] = d[2][j] - d[1][j];
+                t[3][j] = d[1][j] - d[3][j];
+              }
+              T* v_ptr = v + c * num_tiles + tile;
+              const int64_t v_step = in_channels * num_tiles;
+              for (int i = 0; i < 4; ++i) {
+                v_ptr[(i * 4 + 0) * v_step] = t[i][0] - t[i][2];
+                v_ptr[(i * 4 + 1) * v_step] = t[i][1] + t[i][2];
+                v_ptr[(i * 4 + 2) * v_step] = t[i][2] - t[i][1];
+                v_ptr[(i * 4 + 3) * v_step] = t[i][1] - t[i][3];
+              }
+            }
+          }
+        },
+        conv_cpu::GetGrainSize(16 * num_tiles));
+    for (int64_t xi = 0; xi < 16; ++xi) {
+      NewKernelUtil<DeviceType::kCPU>::OFGemm(
+          stream, CblasNoTrans, CblasNoTrans, out_channels, num_tiles, in_channels,
+          static_cast<T>(1), u + xi * out_channels * in_channels, v + xi * in_channels * num_tiles,
+          static_cast<T>(0), m + xi * out_channels * num_tiles);
+    }
+    cpu_stream->ParallelFor(
+        0, out_channels,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t k = begin; k < end; ++k) {
+            T* out_ptr = out + k * out_h * out_w;
+            const T b = bias == nullptr ? 0 : bias[k];
+            const T* m_ptr = m + k * num_tiles;
+            const int64_t m_step = out_channels * num_tiles;
+            for (int64_t tile = 0; tile < num_tiles; ++tile) {
+              T t[4][2];
+              for (int i = 0; i < 4; ++i) {
+                const T m0 = m_ptr[(i * 4 + 0) * m_step + tile];
+                const T m1 = m_ptr[(i * 4 + 1) * m_step + tile];
+                const T m2 = m_ptr[(i * 4 + 2) * m_step + tile];
+                const T m3 = m_ptr[(i * 4 + 3) * m_step + tile];
+                t[i][0] = m0 + m1 + m2;
+                t[i][1] = m1 - m2 - m3;
+              }
+              const int64_t h0 = tile / tiles_w * 2;
+              const int64_t w0 = tile % tiles_w * 2;
+              for (int j = 0; j < 2; ++j) {
+                if (w0 + j >= out_w) { break; }
+                out_ptr[h0 * out_w + w0 + j] = t[0][j] + t[1][j] + t[2][j] + b;
+                if (h0 + 1 < out_h) {
+                  out_ptr[(h0 + 1) * out_w + w0 + j] = t[1][j] - t[2][j] - t[3][j] + b;
+                }
+              }
+            }
+          }
+        },
+        conv_cpu::GetGrainSize(16 * num_tiles));
+  }
+};
+
+template<typename T>
+struct ShiftedGemmConvUtil final {
+  // The per-tap accumulators [taps][K][C] and one shifted copy of x [C][od * oh * ow].
+  static size_t FilterGradTmpElemCnt(const ShapeView& x_shape, const ShapeView& dy_shape,
+                                     const ShapeView& weight_shape) {
+    return weight_shape.Count(2) * dy_shape.At(1) * x_shape.At(1)
+           + x_shape.At(1) * dy_shape.Count(2);
+  }
+
+  // filter_diff[:, :, tap] = sum_n dy[n] * shift_tap(x[n])^T, one GEMM per kernel tap and image.
+  static void FilterGrad(ep::Stream* stream, const T* x, const ShapeView& x_shape, const T* dy,
+                         const ShapeView& dy_shape, const ShapeView& weight_shape,
+                         const int32_t* strides, const int32_t* dilation_rate,
+                         const int32_t* padding_before, T* filter_diff, T* buf) {
+    const int64_t in_channels = x_shape.At(1);
+    const int64_t out_channels = dy_shape.At(1);
+    const int64_t in_plane = x_shape.Count(2);
+    const int64_t out_plane = dy_shape.Count(2);
+    const int64_t kernel_size = weight_shape.Count(2);
+    const int32_t stride_w = strides[2];
+    T* acc = buf;
+    T* shifted = buf + kernel_size * out_channels * in_channels;
+    std::fill(acc, acc + kernel_size * out_channels * in_channels, static_cast<T>(0));
+    for (int64_t n = 0; n < x_shape.At(0); ++n) {
+      const T* x_ptr = x + n * in_channels * in_plane;
+      conv_cpu::ForEachKernelTap(weight_shape, [&](int64_t tap, int64_t kd, int64_t kh,
+                                                   int64_t kw) {
+        stream->As<ep::CpuStream>()->ParallelFor(
+            0, in_channels,
+            [&](int64_t begin, int64_t end) {
+              for (int64_t c = begin; c < end; ++c) {
+                T* shifted_ptr = shifted + c * out_plane;
+                const T* x_channel = x_ptr + c * in_plane;
+                std::fill(shifted_ptr, shifted_ptr + out_plane, static_cast<T>(0));
+                conv_cpu::ForEachValidRow(
+                    x_shape, dy_shape, strides, dilation_rate, padding_before, kd, kh, kw,
+                    [&](int64_t dy_offset, int64_t x_offset, int64_t cnt) {
+                      for (int64_t i = 0; i < cnt; ++i) {
+                        shifted_ptr[dy_offset + i] = x_channel[x_offset + i * stride_w];
+                      }
+                    });
+              }
+            },
+            conv_cpu::GetGrainSize(out_plane));
+        NewKernelUtil<DeviceType::kCPU>::OFGemm(
+            stream, CblasNoTrans, CblasTrans, out_channels, in_channels, out_plane,
+            static_cast<T>(1), dy + n * out_channels * out_plane, shifted, static_cast<T>(1),
+            acc + tap * out_channels * in_channels);
+      });
+    }
+    for (int64_t k = 0; k < out_channels; ++k) {
+      for (int64_t c = 0; c < in_channels; ++c) {
+        for (int64_t tap = 0; tap < kernel_size; ++tap) {
+          filter_diff[(k * in_channels + c) * kernel_size + tap] =
+              acc[(tap * out_channels + k) * in_channels + c];
+        }
+      }
+    }
+  }
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_CONV_CPU_ALGO_UTIL_H_
@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/kernel/kernel_util.h"
 #include "oneflow/core/ep/include/primitive/add.h"
+#include "oneflow/user/kernels/conv_cpu_algo_util.h"
 
 namespace oneflow {
 
@@ -310,6 +311,7 @@ struct ConvOpKernelCache final : public user_op::OpKernelCache {
   enum CBLAS_TRANSPOSE is_out_diff_need_trans_ = CblasNoTrans;
   int32_t idx_offset_{};
   bool is_dynamic_{};
+  ConvCpuAlgo algo_ = ConvCpuAlgo::kIm2ColGemm;
 };
 
 template<typename T>
@@ -342,11 +344,12 @@ std::shared_ptr<ConvOpKernelCache<T>> CreateConvOpKernelCache(user_op::KernelCac
   };
   const auto* in_tensor = ctx->TensorDesc4ArgNameAndIndex(in_name, 0);
   const auto& in_shape = in_tensor->shape();
+  const auto& weight_shape = ctx->TensorDesc4ArgNameAndIndex(weight_name, 0)->shape();
   cache->in_5d_shape_ = Gen5DShape(in_shape, cache->idx_offset_);
   cache->out_5d_shape_ =
       Gen5DShape(ctx->TensorDesc4ArgNameAndIndex(out_name, 0)->shape(), cache->idx_offset_);
-  cache->weight_5d_shape_ =
-      Gen5DShape(ctx->TensorDesc4ArgNameAndIndex(weight_name, 0)->shape(), cache->idx_offset_);
+  cache->weight_5d_shape_ = Gen5DShape(weight_shape, cache->idx_offset_);
+  cache->algo_ = InferConvCpuAlgo(ctx, ShapeView(weight_shape));
 
   auto Gen3DVec = [](const std::vector<int32_t>& origin_vec) -> std::vector<int32_t> {
     std::vector<int32_t> ret_vec = origin_vec;
@@ -374,6 +377,106 @@ void InitBiasMulBuf(T* dptr, int64_t num) {
   for (int64_t i = 0; i < num; ++i) { dptr[i] = 1; }
 }
 
+template<typename T>
+void WinogradF23Forward(ep::Stream* stream, const ConvOpKernelCache<T>* conv_cache,
+                        const user_op::Tensor* in, const user_op::Tensor* weight, const T* bias,
+                        user_op::Tensor* tmp_buffer, user_op::Tensor* out) {
+  const Shape& in_shape = conv_cache->in_5d_shape_;
+  const Shape& out_shape = conv_cache->out_5d_shape_;
+  const int64_t in_channels = in_shape.At(1);
+  const int64_t out_channels = out_shape.At(1);
+  T* u = tmp_buffer->mut_dptr<T>();
+  WinogradF23ConvUtil<T>::TransformFilter(weight->dptr<T>(), out_channels, in_channels, false, u);
+  T* buf = u + 16 * out_channels * in_channels;
+  FOR_RANGE(int64_t, i, 0, in_shape.At(0)) {
+    WinogradF23ConvUtil<T>::Conv2d(stream, GetImgDptr<T>(in, i), in_channels, in_shape.At(3),
+                                   in_shape.At(4), u, out_channels, out_shape.At(3),
+                                   out_shape.At(4), conv_cache->padding_before_3d_.at(1),
+                                   conv_cache->padding_before_3d_.at(2), bias,
+                                   GetImgMutDptr<T>(out, i), buf);
+  }
+}
+
+// The data grad of a 3x3 stride-1 convolution is a convolution of dy with the flipped and
+// transposed filter and padding 2 - padding_before.
+template<typename T>
+void WinogradF23DataGrad(ep::Stream* stream, const ConvOpKernelCache<T>* conv_cache,
+                         const user_op::Tensor* dy, const user_op::Tensor* filter,
+                         user_op::Tensor* tmp_buffer, user_op::Tensor* dx) {
+  const Shape& dx_shape = conv_cache->in_5d_shape_;
+  const Shape& dy_shape = conv_cache->out_5d_shape_;
+  const int64_t in_channels = dx_shape.At(1);
+  const int64_t out_channels = dy_shape.At(1);
+  T* u = tmp_buffer->mut_dptr<T>();
+  WinogradF23ConvUtil<T>::TransformFilter(filter->dptr<T>(), out_channels, in_channels, true, u);
+  T* buf = u + 16 * out_channels * in_channels;
+  FOR_RANGE(int64_t, i, 0, dx_shape.At(0)) {
+    WinogradF23ConvUtil<T>::Conv2d(stream, GetImgDptr<T>(dy, i), out_channels, dy_shape.At(3),
+                                   dy_shape.At(4), u, in_channels, dx_shape.At(3), dx_shape.At(4),
+                                   2 - conv_cache->padding_before_3d_.at(1),
+                                   2 - conv_cache->padding_before_3d_.at(2), nullptr,
+                                   GetImgMutDptr<T>(dx, i), buf);
+  }
+}
+
+template<typename T, size_t NDims>
+size_t InferConvForwardTmpSize(user_op::InferContext* ctx) {
+  size_t tmp_buffer_size = 0;
+  const auto& out_shape = ctx->OutputTensorDesc("out", 0)->shape();
+  const auto& weight_shape = ctx->InputTensorDesc("weight", 0).shape();
+  const ConvCpuAlgo algo = InferConvCpuAlgo(ctx, ShapeView(weight_shape));
+  if (algo == ConvCpuAlgo::kDirect) { return 0; }
+  if (algo == ConvCpuAlgo::kWinogradF23) {
+    return WinogradF23ConvUtil<T>::TmpElemCnt(weight_shape.At(1), weight_shape.At(0),
+                                              out_shape.At(2), out_shape.At(3))
+           * sizeof(T);
+  }
+
+  int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));
+  tmp_buffer_size += CalcElemNumOfColBuf(out_shape, weight_shape, idx_offset) * sizeof(T);
+  bool has_bias = ctx->has_input("bias", 0);
+  if (has_bias) {
+    int64_t bias_mul_cnt = 1;
+    for (size_t i = 0; i < NDims; ++i) { bias_mul_cnt *= out_shape.At(idx_offset + i); }
+    tmp_buffer_size += bias_mul_cnt * sizeof(T);
+  }
+  return tmp_buffer_size;
+}
+
+template<typename T>
+size_t InferConvDataGradTmpSize(user_op::InferContext* ctx) {
+  const auto& out_diff_shape = ctx->InputTensorDesc("dy", 0).shape();
+  const auto& weight_shape = ctx->InputTensorDesc("filter", 0).shape();
+  const ConvCpuAlgo algo = InferConvCpuAlgo(ctx, ShapeView(weight_shape));
+  if (algo == ConvCpuAlgo::kDirect) { return 0; }
+  if (algo == ConvCpuAlgo::kWinogradF23) {
+    const auto& in_diff_shape = ctx->OutputTensorDesc("dx", 0)->shape();
+    return WinogradF23ConvUtil<T>::TmpElemCnt(weight_shape.At(0), weight_shape.At(1),
+                                              in_diff_shape.At(2), in_diff_shape.At(3))
+           * sizeof(T);
+  }
+
+  int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));
+  return CalcElemNumOfColBuf(out_diff_shape, weight_shape, idx_offset) * sizeof(T);
+}
+
+template<typename T>
+size_t InferConvFilterGradTmpSize(user_op::InferContext* ctx) {
+  const auto& out_diff_shape = ctx->InputTensorDesc("dy", 0).shape();
+  const auto& weight_diff_shape = ctx->OutputTensorDesc("filter_diff", 0)->shape();
+  const ConvCpuAlgo algo = InferConvCpuAlgo(ctx, ShapeView(weight_diff_shape));
+  if (algo == ConvCpuAlgo::kDirect) { return 0; }
+  if (algo == ConvCpuAlgo::kWinogradF23) {
+    return ShiftedGemmConvUtil<T>::FilterGradTmpElemCnt(
+               ShapeView(ctx->InputTensorDesc("x", 0).shape()), ShapeView(out_diff_shape),
+               ShapeView(weight_diff_shape))
+           * sizeof(T);
+  }
+
+  int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));
+  return CalcElemNumOfColBuf(out_diff_shape, weight_diff_shape, idx_offset) * sizeof(T);
+}
+
 template<typename T, size_t NDims>
 class ConvCpuKernel final : public user_op::OpKernel {
  public:
@@ -398,6 +501,23 @@ class ConvCpuKernel final : public user_op::OpKernel {
     user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
 
+    if (conv_cache->algo_ == ConvCpuAlgo::kDirect) {
+      const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
+      DirectConvUtil<T>::Forward(
+          ctx->stream(), in->dptr<T>(), ShapeView(conv_cache->in_5d_shape_), weight->dptr<T>(),
+          ShapeView(conv_cache->weight_5d_shape_), ShapeView(conv_cache->out_5d_shape_),
+          conv_cache->strides_3d_.data(), conv_cache->dilation_rate_3d_.data(),
+          conv_cache->padding_before_3d_.data(), 1,
+          bias == nullptr ? nullptr : bias->dptr<T>(), out->mut_dptr<T>());
+      return;
+    }
+    if (conv_cache->algo_ == ConvCpuAlgo::kWinogradF23) {
+      const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
+      WinogradF23Forward<T>(ctx->stream(), conv_cache, in, weight,
+                            bias == nullptr ? nullptr : bias->dptr<T>(), tmp_buffer, out);
+      return;
+    }
+
     T* col_buf_dptr = tmp_buffer->mut_dptr<T>();
 
     bool is_bias_mul_inited = false;
@@ -445,28 +565,13 @@ class ConvCpuKernel final : public user_op::OpKernel {
   }
 };
 
-#define REGISTER_CONV_KERNEL(op_name, dtype, ndims)                                         \
-  REGISTER_USER_KERNEL(#op_name)                                                            \
-      .SetCreateFn<ConvCpuKernel<dtype, ndims>>()                                           \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                       \
-                       && (user_op::HobAttr<int32_t>("groups") == 1)                        \
-                       && (user_op::HobDataType("in", 0) == GetDataType<dtype>::value))     \
-      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                         \
-        size_t tmp_buffer_size = 0;                                                         \
-        const auto& out_shape = ctx->OutputTensorDesc("out", 0)->shape();                   \
-        const auto& weight_shape = ctx->InputTensorDesc("weight", 0).shape();               \
-                                                                                            \
-        int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));              \
-        tmp_buffer_size +=                                                                  \
-            CalcElemNumOfColBuf(out_shape, weight_shape, idx_offset) * sizeof(dtype);       \
-        bool has_bias = ctx->has_input("bias", 0);                                          \
-        if (has_bias) {                                                                     \
-          int64_t bias_mul_cnt = 1;                                                         \
-          for (int i = 0; i < ndims; ++i) { bias_mul_cnt *= out_shape.At(idx_offset + i); } \
-          tmp_buffer_size += bias_mul_cnt * sizeof(dtype);                                  \
-        }                                                                                   \
-        return tmp_buffer_size;                                                             \
-      })
+#define REGISTER_CONV_KERNEL(op_name, dtype, ndims)                                     \
+  REGISTER_USER_KERNEL(#op_name)                                                        \
+      .SetCreateFn<ConvCpuKernel<dtype, ndims>>()                                       \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobAttr<int32_t>("groups") == 1)                    \
+                       && (user_op::HobDataType("in", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn(InferConvForwardTmpSize<dtype, ndims>)
 
 REGISTER_CONV_KERNEL(conv1d, float, 1);
 REGISTER_CONV_KERNEL(conv2d, float, 2);
@@ -500,27 +605,37 @@ class ConvDataGradCpuKernel final : public user_op::OpKernel {
     user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
     user_op::Tensor* col_buf = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
 
-    Memset<DeviceType::kCPU>(ctx->stream(), dx->mut_dptr<T>(), 0,
-                             dx->shape().elem_cnt() * sizeof(T));
-
-    int32_t idx_offset = conv_cache->idx_offset_;
-    FOR_RANGE(int64_t, i, 0, dy->shape().At(0)) {
-      // channels first:  col_buf' = weight(T) * out[i]'
-      // channels last :  col_buf' = weight(T) * out[i]'(T)
-      NewKernelUtil<DeviceType::kCPU>::OFGemm(
-          ctx->stream(), CblasTrans, conv_cache->is_out_diff_need_trans_,
-          conv_cache->weight_5d_shape_.Count(1),                        //  ci * kd * kh * kw
-          conv_cache->out_5d_shape_.Count(idx_offset, idx_offset + 3),  //  od * oh * ow
-          conv_cache->weight_5d_shape_.At(0),                           //  filter
-          static_cast<T>(1), filter->dptr<T>(), GetImgDptr<T>(dy, i), static_cast<T>(0),
-          col_buf->mut_dptr<T>());
+    if (conv_cache->algo_ == ConvCpuAlgo::kDirect) {
+      DirectConvUtil<T>::DataGrad(
+          ctx->stream(), dy->dptr<T>(), ShapeView(conv_cache->out_5d_shape_), filter->dptr<T>(),
+          ShapeView(conv_cache->weight_5d_shape_), ShapeView(conv_cache->in_5d_shape_),
+          conv_cache->strides_3d_.data(), conv_cache->dilation_rate_3d_.data(),
+          conv_cache->padding_before_3d_.data(), 1, dx->mut_dptr<T>());
+    } else if (conv_cache->algo_ == ConvCpuAlgo::kWinogradF23) {
+      WinogradF23DataGrad<T>(ctx->stream(), conv_cache, dy, filter, col_buf, dx);
+    } else {
+      Memset<DeviceType::kCPU>(ctx->stream(), dx->mut_dptr<T>(), 0,
+                               dx->shape().elem_cnt() * sizeof(T));
 
-      // in' = col2im(col_buf')
-      conv_cache->col2im_func_(col_buf->dptr<T>(), ShapeView(conv_cache->in_5d_shape_),
-                               ShapeView(conv_cache->weight_5d_shape_),
-                               ShapeView(conv_cache->out_5d_shape_), conv_cache->strides_3d_.data(),
-                               conv_cache->dilation_rate_3d_.data(),
-                               conv_cache->padding_before_3d_.data(), GetImgMutDptr<T>(dx, i));
+      int32_t idx_offset = conv_cache->idx_offset_;
+      FOR_RANGE(int64_t, i, 0, dy->shape().At(0)) {
+        // channels first:  col_buf' = weight(T) * out[i]'
+        // channels last :  col_buf' = weight(T) * out[i]'(T)
+        NewKernelUtil<DeviceType::kCPU>::OFGemm(
+            ctx->stream(), CblasTrans, conv_cache->is_out_diff_need_trans_,
+            conv_cache->weight_5d_shape_.Count(1),                        //  ci * kd * kh * kw
+            conv_cache->out_5d_shape_.Count(idx_offset, idx_offset + 3),  //  od * oh * ow
+            conv_cache->weight_5d_shape_.At(0),                           //  filter
+            static_cast<T>(1), filter->dptr<T>(), GetImgDptr<T>(dy, i), static_cast<T>(0),
+            col_buf->mut_dptr<T>());
+
+        // in' = col2im(col_buf')
+        conv_cache->col2im_func_(
+            col_buf->dptr<T>(), ShapeView(conv_cache->in_5d_shape_),
+            ShapeView(conv_cache->weight_5d_shape_), ShapeView(conv_cache->out_5d_shape_),
+            conv_cache->strides_3d_.data(), conv_cache->dilation_rate_3d_.data(),
+            conv_cache->padding_before_3d_.data(), GetImgMutDptr<T>(dx, i));
+      }
     }
     if (ctx->has_input("_add_to_output", 0)) {
       const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
@@ -536,22 +651,13 @@ class ConvDataGradCpuKernel final : public user_op::OpKernel {
   }
 };
 
-#define REGISTER_CONV_DATA_GRAD_KERNEL(op_name, dtype)                                     \
-  REGISTER_USER_KERNEL(#op_name)                                                           \
-      .SetCreateFn<ConvDataGradCpuKernel<dtype>>()                                         \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                      \
-                       && (user_op::HobAttr<int32_t>("groups") == 1)                       \
-                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))    \
-      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                        \
-        size_t tmp_buffer_size = 0;                                                        \
-        const auto& out_diff_shape = ctx->InputTensorDesc("dy", 0).shape();                \
-        const auto& weight_shape = ctx->InputTensorDesc("filter", 0).shape();              \
-                                                                                           \
-        int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));             \
-        tmp_buffer_size +=                                                                 \
-            CalcElemNumOfColBuf(out_diff_shape, weight_shape, idx_offset) * sizeof(dtype); \
-        return tmp_buffer_size;                                                            \
-      })
+#define REGISTER_CONV_DATA_GRAD_KERNEL(op_name, dtype)                                  \
+  REGISTER_USER_KERNEL(#op_name)                                                        \
+      .SetCreateFn<ConvDataGradCpuKernel<dtype>>()                                      \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobAttr<int32_t>("groups") == 1)                    \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn(InferConvDataGradTmpSize<dtype>)
 
 REGISTER_CONV_DATA_GRAD_KERNEL(conv_data_grad, float);
 REGISTER_CONV_DATA_GRAD_KERNEL(conv_data_grad, double);
@@ -581,6 +687,24 @@ class ConvFilterGradCpuKernel final : public user_op::OpKernel {
     user_op::Tensor* filter_diff = ctx->Tensor4ArgNameAndIndex("filter_diff", 0);
     user_op::Tensor* col_buf = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
 
+    if (conv_cache->algo_ == ConvCpuAlgo::kDirect) {
+      DirectConvUtil<T>::FilterGrad(
+          ctx->stream(), x->dptr<T>(), ShapeView(conv_cache->in_5d_shape_), dy->dptr<T>(),
+          ShapeView(conv_cache->out_5d_shape_), ShapeView(conv_cache->weight_5d_shape_),
+          conv_cache->strides_3d_.data(), conv_cache->dilation_rate_3d_.data(),
+          conv_cache->padding_before_3d_.data(), 1, filter_diff->mut_dptr<T>());
+      return;
+    }
+    if (conv_cache->algo_ == ConvCpuAlgo::kWinogradF23) {
+      ShiftedGemmConvUtil<T>::FilterGrad(
+          ctx->stream(), x->dptr<T>(), ShapeView(conv_cache->in_5d_shape_), dy->dptr<T>(),
+          ShapeView(conv_cache->out_5d_shape_), ShapeView(conv_cache->weight_5d_shape_),
+          conv_cache->strides_3d_.data(), conv_cache->dilation_rate_3d_.data(),
+          conv_cache->padding_before_3d_.data(), filter_diff->mut_dptr<T>(),
+          col_buf->mut_dptr<T>());
+      return;
+    }
+
     Memset<DeviceType::kCPU>(ctx->stream(), filter_diff->mut_dptr<T>(), 0,
                              filter_diff->shape().elem_cnt() * sizeof(T));
     int32_t idx_offset = conv_cache->idx_offset_;
@@ -604,22 +728,13 @@ class ConvFilterGradCpuKernel final : public user_op::OpKernel {
   }
 };
 
-#define REGISTER_CONV_FILTER_GRAD_KERNEL(op_name, dtype)                                        \
-  REGISTER_USER_KERNEL(#op_name)                                                                \
-      .SetCreateFn<ConvFilterGradCpuKernel<dtype>>()                                            \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                           \
-                       && (user_op::HobAttr<int32_t>("groups") == 1)                            \
-                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))         \
-      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                             \
-        size_t tmp_buffer_size = 0;                                                             \
-        const auto& out_diff_shape = ctx->InputTensorDesc("dy", 0).shape();                     \
-        const auto& weight_diff_shape = ctx->OutputTensorDesc("filter_diff", 0)->shape();       \
-                                                                                                \
-        int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));                  \
-        tmp_buffer_size +=                                                                      \
-            CalcElemNumOfColBuf(out_diff_shape, weight_diff_shape, idx_offset) * sizeof(dtype); \
-        return tmp_buffer_size;                                                                 \
-      })
+#define REGISTER_CONV_FILTER_GRAD_KERNEL(op_name, dtype)                                \
+  REGISTER_USER_KERNEL(#op_name)                                                        \
+      .SetCreateFn<ConvFilterGradCpuKernel<dtype>>()                                    \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobAttr<int32_t>("groups") == 1)                    \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn(InferConvFilterGradTmpSize<dtype>)
 
 REGISTER_CONV_FILTER_GRAD_KERNEL(conv_filter_grad, float);
 REGISTER_CONV_FILTER_GRAD_KERNEL(conv_filter_grad, double);
@@ -0,0 +1,335 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/common/blas.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/common/onednn.h"
+
+namespace oneflow {
+
+namespace {
+
+// The GEMMs are issued on tiles of output rows, and the bias/relu epilogue of a tile runs right
+// after its GEMM while the tile is still in cache.
+constexpr int64_t kTileBytes = 256 * 1024;
+constexpr int64_t kMinTileRows = 16;
+
+int64_t GetTileRows(int64_t m, int64_t n, size_t elem_size) {
+  const int64_t rows = kTileBytes / std::max<int64_t>(1, n * elem_size);
+  return std::max<int64_t>(1, std::min(m, std::max(kMinTileRows, rows)));
+}
+
+/*
+The relu mask uses the same layout as the cublasLt relu aux output: for an output of shape (m, n)
+and a mask of shape (m, aux_ld) the bit of element (i, j) is bit i * aux_ld + j, aux_ld being a
+multiple of 128.
+*/
+uint8_t* GetReluMaskRow(int8_t* aux, int64_t aux_ld, int64_t row) {
+  return reinterpret_cast<uint8_t*>(aux) + row * (aux_ld / 8);
+}
+
+const uint8_t* GetReluMaskRow(const int8_t* aux, int64_t aux_ld, int64_t row) {
+  return reinterpret_cast<const uint8_t*>(aux) + row * (aux_ld / 8);
+}
+
+template<typename T>
+void WriteReluMaskRow(const T* y, int64_t n, int64_t aux_ld, uint8_t* mask) {
+  for (int64_t byte_idx = 0; byte_idx < aux_ld / 8; ++byte_idx) {
+    uint8_t bits = 0;
+    const int64_t begin = byte_idx * 8;
+    const int64_t end = std::min<int64_t>(begin + 8, n);
+    for (int64_t j = begin; j < end; ++j) {
+      bits |= static_cast<uint8_t>(y[j] > static_cast<T>(0)) << (j - begin);
+    }
+    mask[byte_idx] = bits;
+  }
+}
+
+bool ReluMaskAt(const uint8_t* mask, int64_t j) { return (mask[j >> 3] >> (j & 7)) & 1; }
+
+template<typename T>
+void BiasAddEpilogue(int64_t rows, int64_t n, const T* bias, T* y) {
+  for (int64_t i = 0; i < rows; ++i) {
+    T* y_row = y + i * n;
+    for (int64_t j = 0; j < n; ++j) { y_row[j] += bias[j]; }
+  }
+}
+
+template<typename T>
+void BiasAddReluEpilogue(int64_t rows, int64_t n, const T* bias, T* y, int64_t aux_ld,
+                         uint8_t* mask) {
+  for (int64_t i = 0; i < rows; ++i) {
+    T* y_row = y + i * n;
+    for (int64_t j = 0; j < n; ++j) {
+      y_row[j] = std::max(y_row[j] + bias[j], static_cast<T>(0));
+    }
+    WriteReluMaskRow(y_row, n, aux_ld, mask + i * (aux_ld / 8));
+  }
+}
+
+struct DenseLayer {
+  const void* x;
+  const void* weight;
+  const void* bias;
+  void* y;
+  int8_t* aux;
+  int64_t m;
+  int64_t n;
+  int64_t k;
+  int64_t aux_ld;
+  bool relu;
+};
+
+// y = relu(x * weight^T + bias), x: (m, k), weight: (n, k), y: (m, n)
+template<typename T>
+void ForwardDenseLayer(const DenseLayer& layer) {
+  const T* x = static_cast<const T*>(layer.x);
+  const T* weight = static_cast<const T*>(layer.weight);
+  const T* bias = static_cast<const T*>(layer.bias);
+  T* y = static_cast<T*>(layer.y);
+  const int64_t tile_rows = GetTileRows(layer.m, layer.n, sizeof(T));
+  for (int64_t row = 0; row < layer.m; row += tile_rows) {
+    const int64_t rows = std::min(tile_rows, layer.m - row);
+    T* tile_y = y + row * layer.n;
+    cblas_gemm<T>(CblasRowMajor, CblasNoTrans, CblasTrans, rows, layer.n, layer.k,
+                  static_cast<T>(1), x + row * layer.k, layer.k, weight, layer.k,
+                  static_cast<T>(0), tile_y, layer.n);
+    if (layer.relu) {
+      BiasAddReluEpilogue(rows, layer.n, bias, tile_y, layer.aux_ld,
+                          GetReluMaskRow(layer.aux, layer.aux_ld, row));
+    } else {
+      BiasAddEpilogue(rows, layer.n, bias, tile_y);
+    }
+  }
+}
+
+#ifdef WITH_ONEDNN
+
+// Same as ForwardDenseLayer, the bias and relu being fused into the oneDNN matmul as bias and
+// eltwise post-op, the relu mask is still written tile by tile.
+void OneDnnForwardDenseLayer(ep::CpuStream* cpu_stream, const DenseLayer& layer) {
+  const int64_t tile_rows = GetTileRows(layer.m, layer.n, sizeof(float));
+  ep::OneDnnExecutor* executor = cpu_stream->onednn_executor().get();
+  executor->Launch([&](dnnl::engine* onednn_engine, dnnl::stream* onednn_stream) {
+    const auto type = dnnl::memory::data_type::f32;
+    const dnnl::memory::dim n = layer.n;
+    const dnnl::memory::dim k = layer.k;
+    const dnnl::memory::desc weight_md({k, n}, type, dnnl::memory::format_tag::ba);
+    const dnnl::memory::desc bias_md({1, n}, type, dnnl::memory::format_tag::ab);
+    dnnl::memory weight_mem(weight_md, *onednn_engine, const_cast<void*>(layer.weight));
+    dnnl::memory bias_mem(bias_md, *onednn_engine, const_cast<void*>(layer.bias));
+    const float* x = static_cast<const float*>(layer.x);
+    float* y = static_cast<float*>(layer.y);
+    for (int64_t row = 0; row < layer.m; row += tile_rows) {
+      const dnnl::memory::dim rows = std::min(tile_rows, layer.m - row);
+      const dnnl::memory::desc x_md({rows, k}, type, dnnl::memory::format_tag::ab);
+      const dnnl::memory::desc y_md({rows, n}, type, dnnl::memory::format_tag::ab);
+      const dnnl::primitive matmul = executor->GetOrCreatePrimitive(
+          ep::MakeOneDnnPrimitiveKey("matmul_bias", layer.relu, rows, n, k), [&]() {
+            dnnl::post_ops post_ops;
+            if (layer.relu) {
+              post_ops.append_eltwise(1.f, dnnl::algorithm::eltwise_relu, 0.f, 0.f);
+            }
+            dnnl::primitive_attr attr;
+            attr.set_post_ops(post_ops);
+            dnnl::matmul::desc matmul_desc(x_md, weight_md, bias_md, y_md);
+            return dnnl::matmul(dnnl::matmul::primitive_desc(matmul_desc, attr, *onednn_engine));
+          });
+      dnnl::memory x_mem(x_md, *onednn_engine, const_cast<float*>(x + row * k));
+      dnnl::memory y_mem(y_md, *onednn_engine, y + row * n);
+      matmul.execute(*onednn_stream, {{DNNL_ARG_SRC, x_mem},
+                                      {DNNL_ARG_WEIGHTS, weight_mem},
+                                      {DNNL_ARG_BIAS, bias_mem},
+                                      {DNNL_ARG_DST, y_mem}});
+      if (layer.relu) {
+        onednn_stream->wait();
+        uint8_t* mask = GetReluMaskRow(layer.aux, layer.aux_ld, row);
+        for (int64_t i = 0; i < rows; ++i) {
+          WriteReluMaskRow(y + (row + i) * n, n, layer.aux_ld, mask + i * (layer.aux_ld / 8));
+        }
+      }
+    }
+  });
+}
+
+#endif  // WITH_ONEDNN
+
+template<typename T>
+void LaunchDenseLayer(ep::Stream* stream, const DenseLayer& layer) {
+#ifdef WITH_ONEDNN
+  if (std::is_same<T, float>::value && ep::primitive::OneDnnIsEnabled()) {
+    OneDnnForwardDenseLayer(stream->As<ep::CpuStream>(), layer);
+    return;
+  }
+#endif  // WITH_ONEDNN
+  ForwardDenseLayer<T>(layer);
+}
+
+template<typename T>
+class CublasFusedMLPCpuKernel final : public user_op::OpKernel {
+ public:
+  CublasFusedMLPCpuKernel() = default;
+  ~CublasFusedMLPCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const int32_t weight_size = ctx->input_size("weights");
+    const int32_t bias_size = ctx->input_size("biases");
+    CHECK_EQ(weight_size, bias_size) << "The number of weight and bias is not equal!. ";
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const bool skip_final_activation = ctx->Attr<bool>("skip_final_activation");
+
+    DenseLayer layer{};
+    layer.x = x->dptr();
+    layer.m = x->shape().At(0);
+    layer.k = x->shape().At(1);
+    for (int32_t idx = 0; idx < weight_size; ++idx) {
+      const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weights", idx);
+      const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("biases", idx);
+      user_op::Tensor* cublas_aux = ctx->Tensor4ArgNameAndIndex("cublas_aux", idx);
+      CHECK_EQ(weight->shape().At(1), layer.k);
+      layer.weight = weight->dptr();
+      layer.bias = bias->dptr();
+      layer.n = weight->shape().At(0);
+      layer.aux = cublas_aux->mut_dptr<int8_t>();
+      layer.aux_ld = cublas_aux->shape().At(1);
+      CHECK_EQ(layer.aux_ld % 8, 0);
+      CHECK_GE(layer.aux_ld, layer.n);
+      if (idx == weight_size - 1) {
+        layer.y = ctx->Tensor4ArgNameAndIndex("out", 0)->mut_dptr();
+        layer.relu = !skip_final_activation;
+      } else {
+        layer.y = ctx->Tensor4ArgNameAndIndex("hidden", idx)->mut_dptr();
+        layer.relu = true;
+      }
+      LaunchDenseLayer<T>(ctx->stream(), layer);
+      // Set hidden_layer as next layer's input.
+      layer.x = layer.y;
+      layer.k = layer.n;
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CUBLAS_FUSED_MLP_KERNEL_CPU(dtype)                   \
+  REGISTER_USER_KERNEL("cublas_fused_mlp")                            \
+      .SetCreateFn<CublasFusedMLPCpuKernel<dtype>>()                  \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
+
+REGISTER_CUBLAS_FUSED_MLP_KERNEL_CPU(float)
+REGISTER_CUBLAS_FUSED_MLP_KERNEL_CPU(double)
+
+// d_grad = relu_grad(dy * weight), d_bias = reduce_sum(d_grad, 0)
+template<typename T>
+class CublasBiasAddReluMatmulGradCpuKernel final : public user_op::OpKernel {
+ public:
+  CublasBiasAddReluMatmulGradCpuKernel() = default;
+  ~CublasBiasAddReluMatmulGradCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* aux = ctx->Tensor4ArgNameAndIndex("aux", 0);
+    user_op::Tensor* d_bias = ctx->Tensor4ArgNameAndIndex("d_bias", 0);
+    user_op::Tensor* d_grad = ctx->Tensor4ArgNameAndIndex("d_grad", 0);
+    const int64_t m = dy->shape().At(0);
+    const int64_t n = dy->shape().At(1);
+    const int64_t k = weight->shape().At(1);
+    const int64_t aux_ld = aux->shape().At(1);
+    CHECK_EQ(weight->shape().At(0), n);
+    CHECK_GE(aux_ld, k);
+    const T* dy_ptr = dy->dptr<T>();
+    T* d_grad_ptr = d_grad->mut_dptr<T>();
+    T* d_bias_ptr = d_bias->mut_dptr<T>();
+    std::fill(d_bias_ptr, d_bias_ptr + k, static_cast<T>(0));
+    const int64_t tile_rows = GetTileRows(m, k, sizeof(T));
+    for (int64_t row = 0; row < m; row += tile_rows) {
+      const int64_t rows = std::min(tile_rows, m - row);
+      T* tile_d_grad = d_grad_ptr + row * k;
+      cblas_gemm<T>(CblasRowMajor, CblasNoTrans, CblasNoTrans, rows, k, n, static_cast<T>(1),
+                    dy_ptr + row * n, n, weight->dptr<T>(), k, static_cast<T>(0), tile_d_grad, k);
+      for (int64_t i = 0; i < rows; ++i) {
+        const uint8_t* mask = GetReluMaskRow(aux->dptr<int8_t>(), aux_ld, row + i);
+        T* d_grad_row = tile_d_grad + i * k;
+        for (int64_t j = 0; j < k; ++j) {
+          d_grad_row[j] = ReluMaskAt(mask, j) ? d_grad_row[j] : static_cast<T>(0);
+        }
+        for (int64_t j = 0; j < k; ++j) { d_bias_ptr[j] += d_grad_row[j]; }
+      }
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CUBLAS_BIAS_ADD_RELU_MATMUL_GRAD_KERNEL_CPU(dtype)   \
+  REGISTER_USER_KERNEL("cublas_bias_add_relu_matmul_grad")            \
+      .SetCreateFn<CublasBiasAddReluMatmulGradCpuKernel<dtype>>()     \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("weight", 0) == GetDataType<dtype>::value));
+
+REGISTER_CUBLAS_BIAS_ADD_RELU_MATMUL_GRAD_KERNEL_CPU(float)
+REGISTER_CUBLAS_BIAS_ADD_RELU_MATMUL_GRAD_KERNEL_CPU(double)
+
+// w_grad = dy^T * x, b_grad = reduce_sum(dy, 0)
+template<typename T>
+class CublasMatmulBiasAddGradCpuKernel final : public user_op::OpKernel {
+ public:
+  CublasMatmulBiasAddGradCpuKernel() = default;
+  ~CublasMatmulBiasAddGradCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* w_grad = ctx->Tensor4ArgNameAndIndex("w_grad", 0);
+    user_op::Tensor* b_grad = ctx->Tensor4ArgNameAndIndex("b_grad", 0);
+    const int64_t m = dy->shape().At(0);
+    const int64_t n = dy->shape().At(1);
+    const int64_t k = x->shape().At(1);
+    CHECK_EQ(x->shape().At(0), m);
+    const T* dy_ptr = dy->dptr<T>();
+    cblas_gemm<T>(CblasRowMajor, CblasTrans, CblasNoTrans, n, k, m, static_cast<T>(1), dy_ptr, n,
+                  x->dptr<T>(), k, static_cast<T>(0), w_grad->mut_dptr<T>(), k);
+    T* b_grad_ptr = b_grad->mut_dptr<T>();
+    std::fill(b_grad_ptr, b_grad_ptr + n, static_cast<T>(0));
+    for (int64_t i = 0; i < m; ++i) {
+      const T* dy_row = dy_ptr + i * n;
+      for (int64_t j = 0; j < n; ++j) { b_grad_ptr[j] += dy_row[j]; }
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CUBLAS_MATMUL_BIAS_ADD_GRAD_KERNEL_CPU(dtype)        \
+  REGISTER_USER_KERNEL("cublas_matmul_bias_add_grad")                 \
+      .SetCreateFn<CublasMatmulBiasAddGradCpuKernel<dtype>>()         \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("x", 0) == GetDataType<dtype>::value));
+
+REGISTER_CUBLAS_MATMUL_BIAS_ADD_GRAD_KERNEL_CPU(float)
+REGISTER_CUBLAS_MATMUL_BIAS_ADD_GRAD_KERNEL_CPU(double)
+
+}  // namespace
+
+}  // namespace oneflow
@@ -0,0 +1,748 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ccl/ccl.h"
+#include "oneflow/core/job/parallel_desc.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+#include "oneflow/core/embedding/hash_functions.cuh"
+#include "oneflow/user/kernels/gather_kernel_util.h"
+#include "oneflow/user/kernels/unsorted_segment_sum_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int64_t kUniqueChunkGrain = 4096;
+constexpr int64_t kMaxBucketsPerPartition = 256;
+
+template<typename K>
+struct TableEntry {
+  K key;
+  uint32_t value;
+};
+
+// The keys are split into num_chunks contiguous chunks (one per worker) and radix partitioned by
+// hash into num_partition * num_buckets buckets. Every bucket is deduplicated independently with
+// its own open addressing table, so there is no sharing between threads.
+class UniqueAndPartitionParam final {
+ public:
+  UniqueAndPartitionParam(ep::Stream* stream, int64_t num_keys, int64_t num_partition)
+      : num_partition_(num_partition) {
+    const int64_t num_threads = stream->As<ep::CpuStream>()->device()->GetNumThreads();
+    num_chunks_ =
+        std::max<int64_t>(1, std::min<int64_t>(num_threads, num_keys / kUniqueChunkGrain));
+    if (num_chunks_ == 1) {
+      num_buckets_ = 1;
+    } else {
+      num_buckets_ = std::min<int64_t>(kMaxBucketsPerPartition,
+                                       RoundUp(num_chunks_ * 4, num_partition) / num_partition);
+    }
+  }
+
+  int64_t num_chunks() const { return num_chunks_; }
+  int64_t num_buckets() const { return num_buckets_; }
+  int64_t num_total_buckets() const { return num_partition_ * num_buckets_; }
+
+  template<typename K>
+  static size_t WorkspaceBytes(int64_t num_keys) {
+    // bucketed positions, hash values, in-bucket unique index and a 2x oversized table
+    return GetCudaAlignedSize(num_keys * sizeof(uint32_t))
+           + GetCudaAlignedSize(num_keys * sizeof(size_t))
+           + GetCudaAlignedSize(num_keys * sizeof(uint32_t))
+           + GetCudaAlignedSize(2 * num_keys * sizeof(TableEntry<K>));
+  }
+
+ private:
+  int64_t num_partition_;
+  int64_t num_chunks_;
+  int64_t num_buckets_;
+};
+
+template<typename K, typename V, typename IDX, typename HASH>
+void UniqueAndPartition(ep::Stream* stream, int64_t num_keys, int64_t num_partition, const K* keys,
+                        const V* values, IDX* num_partitioned_unique, K* partitioned_unique_keys,
+                        V* partitioned_unique_values, IDX* reverse_index, void* workspace_ptr,
+                        size_t workspace_bytes, bool need_process_values) {
+  CHECK_GE(workspace_bytes, UniqueAndPartitionParam::WorkspaceBytes<K>(num_keys));
+  CHECK_LE(num_keys, static_cast<int64_t>(GetMaxVal<uint32_t>()));
+  std::fill(num_partitioned_unique, num_partitioned_unique + num_partition, 0);
+  if (num_keys == 0) { return; }
+  auto* cpu_stream = stream->As<ep::CpuStream>();
+  const UniqueAndPartitionParam param(stream, num_keys, num_partition);
+  const int64_t num_chunks = param.num_chunks();
+  const int64_t num_buckets = param.num_buckets();
+  const int64_t num_total_buckets = param.num_total_buckets();
+  const int64_t chunk_size = RoundUp(num_keys, num_chunks) / num_chunks;
+
+  char* ptr = reinterpret_cast<char*>(workspace_ptr);
+  uint32_t* bucketed_pos = reinterpret_cast<uint32_t*>(ptr);
+  ptr += GetCudaAlignedSize(num_keys * sizeof(uint32_t));
+  size_t* hashes = reinterpret_cast<size_t*>(ptr);
+  ptr += GetCudaAlignedSize(num_keys * sizeof(size_t));
+  uint32_t* local_index = reinterpret_cast<uint32_t*>(ptr);
+  ptr += GetCudaAlignedSize(num_keys * sizeof(uint32_t));
+  TableEntry<K>* table = reinterpret_cast<TableEntry<K>*>(ptr);
+
+  const auto BucketId = [&](size_t hash) -> int64_t {
+    return static_cast<int64_t>(hash % num_partition) * num_buckets
+           + static_cast<int64_t>((hash >> 32) % num_buckets);
+  };
+
+  // pass 1: hash every key and build a per-chunk histogram of buckets
+  std::vector<int64_t> chunk_offsets(num_chunks * num_total_buckets, 0);
+  cpu_stream->ParallelFor(
+      0, num_chunks,
+      [&](int64_t chunk_begin, int64_t chunk_end) {
+        for (int64_t chunk = chunk_begin; chunk < chunk_end; ++chunk) {
+          int64_t* counts = chunk_offsets.data() + chunk * num_total_buckets;
+          const int64_t end = std::min(num_keys, (chunk + 1) * chunk_size);
+          for (int64_t i = chunk * chunk_size; i < end; ++i) {
+            const size_t hash = HASH()(keys[i]);
+            hashes[i] = hash;
+            counts[BucketId(hash)] += 1;
+          }
+        }
+      },
+      1);
+  std::vector<int64_t> bucket_begin(num_total_buckets + 1, 0);
+  int64_t offset = 0;
+  for (int64_t bucket = 0; bucket < num_total_buckets; ++bucket) {
+    bucket_begin[bucket] = offset;
+    for (int64_t chunk = 0; chunk < num_chunks; ++chunk) {
+      int64_t* count = &chunk_offsets[chunk * num_total_buckets + bucket];
+      const int64_t chunk_count = *count;
+      *count = offset;
+      offset += chunk_count;
+    }
+  }
+  bucket_begin[num_total_buckets] = offset;
+
+  // pass 2: stable scatter of key positions into bucket order
+  cpu_stream->ParallelFor(
+      0, num_chunks,
+      [&](int64_t chunk_begin, int64_t chunk_end) {
+        for (int64_t chunk = chunk_begin; chunk < chunk_end; ++chunk) {
+          int64_t* offsets = chunk_offsets.data() + chunk * num_total_buckets;
+          const int64_t end = std::min(num_keys, (chunk + 1) * chunk_size);
+          for (int64_t i = chunk * chunk_size; i < end; ++i) {
+            bucketed_pos[offsets[BucketId(hashes[i])]++] = static_cast<uint32_t>(i);
+          }
+        }
+      },
+      1);
+
+  // pass 3: dedup every bucket, the position of the first occurrence of the n-th unique key of
+  // a bucket overwrites bucketed_pos[begin + n], which has been consumed by then
+  std::vector<int64_t> bucket_num_unique(num_total_buckets, 0);
+  cpu_stream->ParallelFor(
+      0, num_total_buckets,
+      [&](int64_t first_bucket, int64_t last_bucket) {
+        for (int64_t bucket = first_bucket; bucket < last_bucket; ++bucket) {
+          const int64_t begin = bucket_begin[bucket];
+          const int64_t end = bucket_begin[bucket + 1];
+          if (begin == end) { continue; }
+          const uint64_t capacity = 2 * (end - begin);
+          TableEntry<K>* bucket_table = table + 2 * begin;
+          std::memset(reinterpret_cast<void*>(bucket_table), 0, capacity * sizeof(TableEntry<K>));
+          uint32_t num_unique = 0;
+          for (int64_t j = begin; j < end; ++j) {
+            const uint32_t i = bucketed_pos[j];
+            const K key = keys[i];
+            // all keys of the bucket share hash % num_partition, so drop it before probing
+            uint64_t pos = (hashes[i] / num_partition) % capacity;
+            while (true) {
+              TableEntry<K>* entry = bucket_table + pos;
+              if (entry->value == 0) {
+                entry->key = key;
+                entry->value = num_unique + 1;
+                local_index[i] = num_unique;
+                bucketed_pos[begin + num_unique] = i;
+                num_unique += 1;
+                break;
+              } else if (entry->key == key) {
+                local_index[i] = entry->value - 1;
+                break;
+              }
+              pos += 1;
+              if (pos == capacity) { pos = 0; }
+            }
+          }
+          bucket_num_unique[bucket] = num_unique;
+        }
+      },
+      1);
+
+  std::vector<int64_t> bucket_unique_offset(num_total_buckets, 0);
+  for (int64_t partition = 0; partition < num_partition; ++partition) {
+    int64_t partition_num_unique = 0;
+    for (int64_t b = 0; b < num_buckets; ++b) {
+      const int64_t bucket = partition * num_buckets + b;
+      bucket_unique_offset[bucket] = partition * num_keys + partition_num_unique;
+      partition_num_unique += bucket_num_unique[bucket];
+    }
+    num_partitioned_unique[partition] = static_cast<IDX>(partition_num_unique);
+  }
+
+  // pass 4: compact unique keys (and values) to their partition and fill the reverse index
+  cpu_stream->ParallelFor(
+      0, num_total_buckets,
+      [&](int64_t first_bucket, int64_t last_bucket) {
+        for (int64_t bucket = first_bucket; bucket < last_bucket; ++bucket) {
+          const int64_t begin = bucket_begin[bucket];
+          const int64_t out_offset = bucket_unique_offset[bucket];
+          for (int64_t n = 0; n < bucket_num_unique[bucket]; ++n) {
+            const uint32_t i = bucketed_pos[begin + n];
+            partitioned_unique_keys[out_offset + n] = keys[i];
+            if (need_process_values) { partitioned_unique_values[out_offset + n] = values[i]; }
+          }
+        }
+      },
+      1);
+  cpu_stream->ParallelFor(0, num_keys, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      reverse_index[i] =
+          static_cast<IDX>(bucket_unique_offset[BucketId(hashes[i])] + local_index[i]);
+    }
+  });
+}
+
+template<typename U>
+void GenerateTableIds(int64_t elem_cnt, int32_t num_tables, U* table_ids) {
+  for (int64_t i = 0; i < elem_cnt; ++i) { table_ids[i] = i % num_tables; }
+}
+
+template<typename T>
+void ShuffleData(ep::Stream* stream, Symbol<ParallelDesc> parallel_desc, DataType data_type,
+                 const std::vector<int64_t>& send_offsets,
+                 const std::vector<int64_t>& send_elem_cnt, const T* send_data,
+                 const std::vector<int64_t>& recv_offsets,
+                 const std::vector<int64_t>& recv_elem_cnt, T* recv_data) {
+  CHECK_JUST(ccl::AllToAll<DeviceType::kCPU>(send_data, send_offsets, send_elem_cnt, recv_data,
+                                             recv_offsets, recv_elem_cnt, data_type,
+                                             parallel_desc, stream));
+}
+
+template<typename IDX>
+void MakeShuffleParams(const IDX* host_num_unique_matrix, const int64_t num_ids,
+                       const int64_t row_size, int64_t parallel_id, int64_t parallel_num,
+                       std::vector<int64_t>* scatter_offset_vec,
+                       std::vector<int64_t>* scatter_elem_cnt_vec,
+                       std::vector<int64_t>* gather_offset_vec,
+                       std::vector<int64_t>* gather_elem_cnt_vec) {
+  scatter_offset_vec->resize(parallel_num);
+  scatter_elem_cnt_vec->resize(parallel_num);
+  gather_offset_vec->resize(parallel_num);
+  gather_elem_cnt_vec->resize(parallel_num);
+  int64_t gather_offset = 0;
+  for (int64_t i = 0; i < parallel_num; ++i) {
+    const int64_t scatter_elem_cnt =
+        host_num_unique_matrix[parallel_id * parallel_num + i] * row_size;
+    const int64_t gather_elem_cnt =
+        host_num_unique_matrix[i * parallel_num + parallel_id] * row_size;
+    scatter_offset_vec->at(i) = i * num_ids * row_size;
+    scatter_elem_cnt_vec->at(i) = scatter_elem_cnt;
+    gather_offset_vec->at(i) = gather_offset;
+    gather_elem_cnt_vec->at(i) = gather_elem_cnt;
+    gather_offset += gather_elem_cnt;
+  }
+}
+
+enum class IdShuffleBufferType {
+  kNumPartitionedUnique = 0,
+  kPartitionedUniqueIds,
+  kReceivedIds,
+  kTableIds,
+  kPartitionedUniqueTableIds,
+  kReceivedTableIds,
+  kWorkspace,
+  kMaxType
+};
+
+template<typename K, typename U, typename IDX>
+class IdShuffleTmpBufferManager final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(IdShuffleTmpBufferManager);
+  IdShuffleTmpBufferManager(void* ptr, const int64_t num_ids, const int64_t parallel_num,
+                            bool need_table_ids, bool need_process_table_ids)
+      : offset_(0),
+        offsets_(static_cast<size_t>(IdShuffleBufferType::kMaxType), -1),
+        sizes_(static_cast<size_t>(IdShuffleBufferType::kMaxType)),
+        ptr_(ptr) {
+    const int64_t num_table_ids = need_process_table_ids ? num_ids : 0;
+    const size_t table_ids_bytes = need_table_ids ? num_ids * sizeof(U) : 0;
+    AllocBuffer(IdShuffleBufferType::kNumPartitionedUnique, parallel_num * sizeof(IDX));
+    size_t partitioned_ids_bytes = parallel_num * num_ids * sizeof(K);
+    AllocBuffer(IdShuffleBufferType::kPartitionedUniqueIds, partitioned_ids_bytes);
+    AllocBuffer(IdShuffleBufferType::kReceivedIds, partitioned_ids_bytes);
+    AllocBuffer(IdShuffleBufferType::kTableIds, table_ids_bytes);
+    size_t partitioned_table_ids_bytes = parallel_num * num_table_ids * sizeof(U);
+    AllocBuffer(IdShuffleBufferType::kPartitionedUniqueTableIds, partitioned_table_ids_bytes);
+    AllocBuffer(IdShuffleBufferType::kReceivedTableIds, partitioned_table_ids_bytes);
+    // the second unique runs on up to parallel_num * num_ids received ids
+    AllocBuffer(IdShuffleBufferType::kWorkspace,
+                UniqueAndPartitionParam::WorkspaceBytes<K>(parallel_num * num_ids));
+  }
+
+  template<typename T = void>
+  T* Ptr(IdShuffleBufferType type) {
+    CHECK(ptr_ != nullptr);
+    int64_t offset = offsets_.at(static_cast<size_t>(type));
+    CHECK_NE(offset, -1);
+    return reinterpret_cast<T*>(reinterpret_cast<char*>(ptr_) + offset);
+  }
+
+  int64_t Size(IdShuffleBufferType type) { return sizes_.at(static_cast<size_t>(type)); }
+
+  size_t TotalBufferSize() const { return offset_; }
+
+ private:
+  void AllocBuffer(IdShuffleBufferType type, size_t size) {
+    const size_t type_id = static_cast<size_t>(type);
+    CHECK_EQ(offsets_.at(type_id), -1);
+    offsets_.at(type_id) = offset_;
+    sizes_.at(type_id) = size;
+    offset_ += GetCudaAlignedSize(size);
+  }
+  size_t offset_;
+  std::vector<int64_t> offsets_;
+  std::vector<int64_t> sizes_;
+  void* ptr_;
+};
+
+class DataShuffleKernelState final : public user_op::OpKernelState {
+ public:
+  explicit DataShuffleKernelState(user_op::KernelInitContext* ctx)
+      : parallel_desc_(SymbolOf(ctx->parallel_desc())) {}
+  ~DataShuffleKernelState() override = default;
+
+  Symbol<ParallelDesc> parallel_desc() const { return parallel_desc_; }
+
+ private:
+  Symbol<ParallelDesc> parallel_desc_;
+};
+
+}  // namespace
+
+template<typename K, typename U, typename IDX>
+class IdShuffleCpuKernel final : public user_op::OpKernel {
+ public:
+  IdShuffleCpuKernel() = default;
+  ~IdShuffleCpuKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<DataShuffleKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<DataShuffleKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    const user_op::Tensor* ids = ctx->Tensor4ArgNameAndIndex("ids", 0);
+    user_op::Tensor* num_unique_matrix = ctx->Tensor4ArgNameAndIndex("num_unique_matrix", 0);
+    user_op::Tensor* inverse_unique_partition_indices =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0);
+    user_op::Tensor* cur_rank_num_unique = ctx->Tensor4ArgNameAndIndex("cur_rank_num_unique", 0);
+    user_op::Tensor* cur_rank_unique_ids = ctx->Tensor4ArgNameAndIndex("cur_rank_unique_ids", 0);
+    user_op::Tensor* cur_rank_unique_table_ids =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_unique_table_ids", 0);
+    user_op::Tensor* cur_rank_inverse_indices =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_inverse_indices", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int32_t num_tables = ctx->Attr<int32_t>("num_tables");
+    const bool has_table_ids = ctx->has_input("table_ids", 0);
+    const bool need_gen_table_ids = (!has_table_ids && num_tables > 1);
+    const bool need_process_table_ids = (has_table_ids || num_tables > 1);
+    const int64_t num_ids = ids->shape().elem_cnt();
+    const int64_t parallel_num = ctx->parallel_ctx().parallel_num();
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    IdShuffleTmpBufferManager<K, U, IDX> buffer_manager(
+        tmp_buffer->mut_dptr(), num_ids, parallel_num, need_gen_table_ids, need_process_table_ids);
+    CHECK_GE(tmp_buffer->shape().elem_cnt(), buffer_manager.TotalBufferSize());
+
+    const U* table_ids_ptr;
+    if (has_table_ids) {
+      const user_op::Tensor* table_ids = ctx->Tensor4ArgNameAndIndex("table_ids", 0);
+      table_ids_ptr = reinterpret_cast<const U*>(table_ids->dptr());
+    } else if (need_gen_table_ids) {
+      GenerateTableIds(num_ids, num_tables,
+                       buffer_manager.template Ptr<U>(IdShuffleBufferType::kTableIds));
+      table_ids_ptr = buffer_manager.template Ptr<U>(IdShuffleBufferType::kTableIds);
+    } else {
+      table_ids_ptr = nullptr;
+    }
+    IDX* num_partitioned_unique =
+        buffer_manager.template Ptr<IDX>(IdShuffleBufferType::kNumPartitionedUnique);
+    K* partitioned_unique_ids =
+        buffer_manager.template Ptr<K>(IdShuffleBufferType::kPartitionedUniqueIds);
+    U* partitioned_unique_table_ids =
+        buffer_manager.template Ptr<U>(IdShuffleBufferType::kPartitionedUniqueTableIds);
+    IDX* num_unique_matrix_ptr = reinterpret_cast<IDX*>(num_unique_matrix->mut_dptr());
+    void* workspace_ptr = buffer_manager.Ptr(IdShuffleBufferType::kWorkspace);
+    size_t workspace_size = buffer_manager.Size(IdShuffleBufferType::kWorkspace);
+    UniqueAndPartition<K, U, IDX, embedding::ShardingHash>(
+        ctx->stream(), num_ids, parallel_num, reinterpret_cast<const K*>(ids->dptr()),
+        table_ids_ptr, num_partitioned_unique, partitioned_unique_ids,
+        partitioned_unique_table_ids,
+        reinterpret_cast<IDX*>(inverse_unique_partition_indices->mut_dptr()), workspace_ptr,
+        workspace_size, need_process_table_ids);
+    CHECK_JUST(ccl::AllGather<DeviceType::kCPU>(num_partitioned_unique, num_unique_matrix_ptr,
+                                                parallel_num, num_unique_matrix->data_type(),
+                                                kernel_state->parallel_desc(), ctx->stream()));
+
+    K* received_ids = buffer_manager.template Ptr<K>(IdShuffleBufferType::kReceivedIds);
+    U* received_table_ids = buffer_manager.template Ptr<U>(IdShuffleBufferType::kReceivedTableIds);
+    std::vector<int64_t> send_offsets;
+    std::vector<int64_t> send_elem_cnt;
+    std::vector<int64_t> recv_offsets;
+    std::vector<int64_t> recv_elem_cnt;
+    MakeShuffleParams(num_unique_matrix_ptr, num_ids, 1, parallel_id, parallel_num, &send_offsets,
+                      &send_elem_cnt, &recv_offsets, &recv_elem_cnt);
+    ShuffleData(ctx->stream(), kernel_state->parallel_desc(), ids->data_type(), send_offsets,
+                send_elem_cnt, partitioned_unique_ids, recv_offsets, recv_elem_cnt, received_ids);
+    const int64_t received_elem_cnt =
+        recv_offsets.at(parallel_num - 1) + recv_elem_cnt.at(parallel_num - 1);
+    if (need_process_table_ids) {
+      ShuffleData(ctx->stream(), kernel_state->parallel_desc(),
+                  cur_rank_unique_table_ids->data_type(), send_offsets, send_elem_cnt,
+                  partitioned_unique_table_ids, recv_offsets, recv_elem_cnt, received_table_ids);
+    }
+    UniqueAndPartition<K, U, IDX, embedding::LocalUniqueHash>(
+        ctx->stream(), received_elem_cnt, 1, received_ids, received_table_ids,
+        reinterpret_cast<IDX*>(cur_rank_num_unique->mut_dptr()),
+        reinterpret_cast<K*>(cur_rank_unique_ids->mut_dptr()),
+        reinterpret_cast<U*>(cur_rank_unique_table_ids->mut_dptr()),
+        reinterpret_cast<IDX*>(cur_rank_inverse_indices->mut_dptr()), workspace_ptr, workspace_size,
+        need_process_table_ids);
+    if (!need_process_table_ids) {
+      std::memset(cur_rank_unique_table_ids->mut_dptr(), 0, received_elem_cnt * sizeof(U));
+    }
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define ID_DATA_TYPE_SEQ                            \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(uint64_t, DataType::kUInt64) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)   \
+  OF_PP_MAKE_TUPLE_SEQ(int64_t, DataType::kInt64)
+
+#define TABLE_ID_DATA_TYPE_SEQ                      \
+  OF_PP_MAKE_TUPLE_SEQ(uint8_t, DataType::kUInt8)   \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(uint64_t, DataType::kUInt64) \
+  OF_PP_MAKE_TUPLE_SEQ(int8_t, DataType::kInt8)     \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)   \
+  OF_PP_MAKE_TUPLE_SEQ(int64_t, DataType::kInt64)
+
+#define IDX_DATA_TYPE_SEQ                           \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)
+
+#define REGISTER_CPU_ID_SHUFFLE_KERNEL(k_dtype_pair, table_id_dtype_pair, idx_dtype_pair)         \
+  REGISTER_USER_KERNEL("id_shuffle")                                                              \
+      .SetCreateFn<IdShuffleCpuKernel<OF_PP_PAIR_FIRST(k_dtype_pair),                             \
+                                      OF_PP_PAIR_FIRST(table_id_dtype_pair),                      \
+                                      OF_PP_PAIR_FIRST(idx_dtype_pair)>>()                        \
+      .SetIsMatchedHob(                                                                           \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                          \
+          && (user_op::HobDataType("ids", 0) == OF_PP_PAIR_SECOND(k_dtype_pair))                  \
+          && (user_op::HobDataType("cur_rank_unique_table_ids", 0)                                \
+              == OF_PP_PAIR_SECOND(table_id_dtype_pair))                                          \
+          && (user_op::HobDataType("num_unique_matrix", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                                         \
+        const user_op::TensorDesc& ids = ctx->InputTensorDesc("ids", 0);                          \
+        const bool has_table_ids = ctx->has_input("table_ids", 0);                                \
+        const int32_t num_tables = ctx->Attr<int32_t>("num_tables");                              \
+        const bool need_gen_table_ids = (!has_table_ids && num_tables > 1);                       \
+        const bool need_process_table_ids = (has_table_ids || num_tables > 1);                    \
+        IdShuffleTmpBufferManager<OF_PP_PAIR_FIRST(k_dtype_pair),                                 \
+                                  OF_PP_PAIR_FIRST(table_id_dtype_pair),                          \
+                                  OF_PP_PAIR_FIRST(idx_dtype_pair)>                               \
+            buffer_manager(nullptr, ids.shape().elem_cnt(), ctx->parallel_desc().parallel_num(),  \
+                           need_gen_table_ids, need_process_table_ids);                           \
+        return buffer_manager.TotalBufferSize();                                                  \
+      });
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ID_SHUFFLE_KERNEL, ID_DATA_TYPE_SEQ,
+                                 TABLE_ID_DATA_TYPE_SEQ, IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename IDX>
+class EmbeddingShuffleCpuKernel final : public user_op::OpKernel {
+ public:
+  EmbeddingShuffleCpuKernel() = default;
+  ~EmbeddingShuffleCpuKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<DataShuffleKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<DataShuffleKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    const user_op::Tensor* cur_rank_embeddings =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_embeddings", 0);
+    const user_op::Tensor* num_unique_matrix = ctx->Tensor4ArgNameAndIndex("num_unique_matrix", 0);
+    const user_op::Tensor* cur_rank_inverse_indices =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_inverse_indices", 0);
+    const user_op::Tensor* inverse_unique_partition_indices =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0);
+    user_op::Tensor* embeddings = ctx->Tensor4ArgNameAndIndex("embeddings", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int64_t embedding_size = cur_rank_embeddings->shape().At(1);
+    const IDX* host_num_unique_matrix = reinterpret_cast<const IDX*>(num_unique_matrix->dptr());
+    const int64_t num_ids = inverse_unique_partition_indices->shape().elem_cnt();
+    const int64_t parallel_num = ctx->parallel_ctx().parallel_num();
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    int64_t cur_rank_num_ids = 0;
+    for (int64_t i = 0; i < parallel_num; ++i) {
+      cur_rank_num_ids += host_num_unique_matrix[i * parallel_num + parallel_id];
+    }
+    size_t full_elem_cnt = parallel_num * num_ids * embedding_size;
+    CHECK_EQ(full_elem_cnt, cur_rank_embeddings->shape().elem_cnt());
+    size_t reverse_unique_cur_rank_embeddings_size = GetCudaAlignedSize(full_elem_cnt * sizeof(T));
+    size_t received_embeddings_size = reverse_unique_cur_rank_embeddings_size;
+    CHECK_GE(tmp_buffer->shape().elem_cnt(),
+             reverse_unique_cur_rank_embeddings_size + received_embeddings_size);
+    T* reverse_unique_cur_rank_embeddings = reinterpret_cast<T*>(tmp_buffer->mut_dptr());
+    T* received_embeddings = reinterpret_cast<T*>(tmp_buffer->mut_dptr<char>()
+                                                  + reverse_unique_cur_rank_embeddings_size);
+    // reverse cur_rank unique
+    GatherKernelUtilImpl<DeviceType::kCPU, T, IDX>::Forward(
+        ctx->stream(), reinterpret_cast<const IDX*>(cur_rank_inverse_indices->dptr()),
+        cur_rank_num_ids, cur_rank_embeddings->dptr<T>(),
+        Shape({1, cur_rank_embeddings->shape().elem_cnt() / embedding_size, embedding_size}),
+        reverse_unique_cur_rank_embeddings, 0);
+
+    std::vector<int64_t> send_offsets;
+    std::vector<int64_t> send_elem_cnt;
+    std::vector<int64_t> recv_offsets;
+    std::vector<int64_t> recv_elem_cnt;
+    MakeShuffleParams(host_num_unique_matrix, num_ids, embedding_size, parallel_id, parallel_num,
+                      &recv_offsets, &recv_elem_cnt, &send_offsets, &send_elem_cnt);
+    ShuffleData(ctx->stream(), kernel_state->parallel_desc(), cur_rank_embeddings->data_type(),
+                send_offsets, send_elem_cnt, reverse_unique_cur_rank_embeddings, recv_offsets,
+                recv_elem_cnt, received_embeddings);
+
+    // reverse unique_partition
+    GatherKernelUtilImpl<DeviceType::kCPU, T, IDX>::Forward(
+        ctx->stream(), reinterpret_cast<const IDX*>(inverse_unique_partition_indices->dptr()),
+        inverse_unique_partition_indices->shape().elem_cnt(), received_embeddings,
+        Shape({1, parallel_num * num_ids, embedding_size}), embeddings->mut_dptr<T>(), 0);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_EMBEDDING_SHUFFLE_KERNEL(t_dtype_pair, idx_dtype_pair)                       \
+  REGISTER_USER_KERNEL("embedding_shuffle")                                                       \
+      .SetCreateFn<EmbeddingShuffleCpuKernel<OF_PP_PAIR_FIRST(t_dtype_pair),                      \
+                                             OF_PP_PAIR_FIRST(idx_dtype_pair)>>()                 \
+      .SetIsMatchedHob(                                                                           \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                          \
+          && (user_op::HobDataType("cur_rank_embeddings", 0) == OF_PP_PAIR_SECOND(t_dtype_pair))  \
+          && (user_op::HobDataType("num_unique_matrix", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                                         \
+        const user_op::TensorDesc& cur_rank_embeddings =                                          \
+            ctx->InputTensorDesc("cur_rank_embeddings", 0);                                       \
+        size_t reverse_cur_rank_embeddings_size = GetCudaAlignedSize(                             \
+            cur_rank_embeddings.shape().elem_cnt() * sizeof(OF_PP_PAIR_FIRST(t_dtype_pair)));     \
+        size_t recv_unique_embeddings_size = reverse_cur_rank_embeddings_size;                    \
+        return reverse_cur_rank_embeddings_size + recv_unique_embeddings_size;                    \
+      });
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_SHUFFLE_KERNEL, FLOATING_DATA_TYPE_SEQ,
+                                 IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename IDX>
+class EmbeddingGradientShuffleCpuKernel final : public user_op::OpKernel {
+ public:
+  EmbeddingGradientShuffleCpuKernel() = default;
+  ~EmbeddingGradientShuffleCpuKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return std::make_shared<DataShuffleKernelState>(ctx);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    auto* kernel_state = dynamic_cast<DataShuffleKernelState*>(state);
+    CHECK(kernel_state != nullptr);
+    const user_op::Tensor* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0);
+    const user_op::Tensor* num_unique_matrix = ctx->Tensor4ArgNameAndIndex("num_unique_matrix", 0);
+    const user_op::Tensor* cur_rank_inverse_indices =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_inverse_indices", 0);
+    const user_op::Tensor* inverse_unique_partition_indices =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0);
+    user_op::Tensor* cur_rank_unique_embedding_grad =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_unique_embedding_grad", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int64_t embedding_size = cur_rank_unique_embedding_grad->shape().At(1);
+    const IDX* host_num_unique_matrix = reinterpret_cast<const IDX*>(num_unique_matrix->dptr());
+    const int64_t num_ids = inverse_unique_partition_indices->shape().elem_cnt();
+    const int64_t parallel_num = ctx->parallel_ctx().parallel_num();
+    const int64_t parallel_id = ctx->parallel_ctx().parallel_id();
+    int64_t cur_rank_num_ids = 0;
+    for (int64_t i = 0; i < parallel_num; ++i) {
+      cur_rank_num_ids += host_num_unique_matrix[i * parallel_num + parallel_id];
+    }
+    size_t full_elem_cnt = parallel_num * num_ids * embedding_size;
+    size_t unique_partition_embedding_grad_size = GetCudaAlignedSize(full_elem_cnt * sizeof(T));
+    size_t received_embedding_grad_size = unique_partition_embedding_grad_size;
+    CHECK_GE(tmp_buffer->shape().elem_cnt(),
+             unique_partition_embedding_grad_size + received_embedding_grad_size);
+    T* unique_partition_embedding_grad = reinterpret_cast<T*>(tmp_buffer->mut_dptr());
+    T* received_embedding_grad =
+        reinterpret_cast<T*>(tmp_buffer->mut_dptr<char>() + unique_partition_embedding_grad_size);
+
+    // only the valid prefix of each partition is accumulated into and sent
+    for (int64_t i = 0; i < parallel_num; ++i) {
+      const int64_t offset = i * num_ids * embedding_size;
+      const int64_t valid_value_size =
+          host_num_unique_matrix[parallel_id * parallel_num + i] * embedding_size * sizeof(T);
+      std::memset(unique_partition_embedding_grad + offset, 0, valid_value_size);
+    }
+    UnsortedSegmentSumKernelUtil<DeviceType::kCPU, T, IDX, T>::UnsortedSegmentSum(
+        ctx->stream(), reinterpret_cast<const IDX*>(inverse_unique_partition_indices->dptr()),
+        embedding_grad->dptr<T>(), num_ids, parallel_num * num_ids, 1, embedding_size, 0,
+        unique_partition_embedding_grad);
+
+    std::vector<int64_t> send_offsets;
+    std::vector<int64_t> send_elem_cnt;
+    std::vector<int64_t> recv_offsets;
+    std::vector<int64_t> recv_elem_cnt;
+    MakeShuffleParams(host_num_unique_matrix, num_ids, embedding_size, parallel_id, parallel_num,
+                      &send_offsets, &send_elem_cnt, &recv_offsets, &recv_elem_cnt);
+    ShuffleData(ctx->stream(), kernel_state->parallel_desc(), embedding_grad->data_type(),
+                send_offsets, send_elem_cnt, unique_partition_embedding_grad, recv_offsets,
+                recv_elem_cnt, received_embedding_grad);
+
+    std::memset(cur_rank_unique_embedding_grad->mut_dptr(), 0,
+                cur_rank_num_ids * embedding_size * sizeof(T));
+    UnsortedSegmentSumKernelUtil<DeviceType::kCPU, T, IDX, T>::UnsortedSegmentSum(
+        ctx->stream(), reinterpret_cast<const IDX*>(cur_rank_inverse_indices->dptr()),
+        received_embedding_grad, cur_rank_num_ids, cur_rank_num_ids, 1, embedding_size, 0,
+        cur_rank_unique_embedding_grad->mut_dptr<T>());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_EMBEDDING_GRADIENT_SHUFFLE_KERNEL(t_dtype_pair, idx_dtype_pair)              \
+  REGISTER_USER_KERNEL("embedding_gradient_shuffle")                                              \
+      .SetCreateFn<EmbeddingGradientShuffleCpuKernel<OF_PP_PAIR_FIRST(t_dtype_pair),              \
+                                                     OF_PP_PAIR_FIRST(idx_dtype_pair)>>()         \
+      .SetIsMatchedHob(                                                                           \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                          \
+          && (user_op::HobDataType("embedding_grad", 0) == OF_PP_PAIR_SECOND(t_dtype_pair))       \
+          && (user_op::HobDataType("num_unique_matrix", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                                         \
+        const user_op::TensorDesc& cur_rank_unique_embedding_grad =                               \
+            ctx->InputTensorDesc("cur_rank_unique_embedding_grad", 0);                            \
+        size_t cur_rank_embedding_grad_size =                                                     \
+            GetCudaAlignedSize(cur_rank_unique_embedding_grad.shape().elem_cnt()                  \
+                               * sizeof(OF_PP_PAIR_FIRST(t_dtype_pair)));                         \
+        return 2 * cur_rank_embedding_grad_size;                                                  \
+      });
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_GRADIENT_SHUFFLE_KERNEL,
+                                 FLOATING_DATA_TYPE_SEQ, IDX_DATA_TYPE_SEQ)
+
+template<typename K, typename V, typename IDX>
+class UniqueKeyValuePairCpuKernel final : public user_op::OpKernel {
+ public:
+  UniqueKeyValuePairCpuKernel() = default;
+  ~UniqueKeyValuePairCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* keys = ctx->Tensor4ArgNameAndIndex("keys", 0);
+    user_op::Tensor* num_unique = ctx->Tensor4ArgNameAndIndex("num_unique", 0);
+    user_op::Tensor* unique_keys = ctx->Tensor4ArgNameAndIndex("unique_keys", 0);
+    user_op::Tensor* unique_values = ctx->Tensor4ArgNameAndIndex("unique_values", 0);
+    user_op::Tensor* inverse_indices = ctx->Tensor4ArgNameAndIndex("inverse_indices", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int32_t num_tables = ctx->Attr<int32_t>("num_tables");
+    const bool has_values = ctx->has_input("values", 0);
+    const bool need_values_buffer = (!has_values && num_tables > 1);
+    const int64_t num_keys = keys->shape().elem_cnt();
+    size_t values_buffer_bytes =
+        need_values_buffer ? GetCudaAlignedSize(num_keys * sizeof(V)) : 0;
+    const size_t workspace_bytes = UniqueAndPartitionParam::WorkspaceBytes<K>(num_keys);
+    CHECK_LE(values_buffer_bytes + workspace_bytes, tmp_buffer->shape().elem_cnt());
+    const V* values_ptr;
+    if (has_values) {
+      const user_op::Tensor* values = ctx->Tensor4ArgNameAndIndex("values", 0);
+      values_ptr = reinterpret_cast<const V*>(values->dptr());
+    } else if (need_values_buffer) {
+      V* values_buffer_ptr = reinterpret_cast<V*>(tmp_buffer->mut_dptr());
+      GenerateTableIds(num_keys, num_tables, values_buffer_ptr);
+      values_ptr = values_buffer_ptr;
+    } else {
+      values_ptr = nullptr;
+    }
+    const bool need_process_table_ids = (has_values || num_tables > 1);
+    void* workspace_ptr = tmp_buffer->mut_dptr<char>() + values_buffer_bytes;
+    UniqueAndPartition<K, V, IDX, embedding::GlobalUniqueHash>(
+        ctx->stream(), num_keys, 1, reinterpret_cast<const K*>(keys->dptr()), values_ptr,
+        reinterpret_cast<IDX*>(num_unique->mut_dptr()),
+        reinterpret_cast<K*>(unique_keys->mut_dptr()),
+        reinterpret_cast<V*>(unique_values->mut_dptr()),
+        reinterpret_cast<IDX*>(inverse_indices->mut_dptr()), workspace_ptr, workspace_bytes,
+        need_process_table_ids);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_UNIQUE_KEY_VALUE_PAIR_KERNEL(k_dtype_pair, value_dtype_pair, idx_dtype_pair) \
+  REGISTER_USER_KERNEL("unique_key_value_pair")                                                   \
+      .SetCreateFn<UniqueKeyValuePairCpuKernel<OF_PP_PAIR_FIRST(k_dtype_pair),                    \
+                                               OF_PP_PAIR_FIRST(value_dtype_pair),                \
+                                               OF_PP_PAIR_FIRST(idx_dtype_pair)>>()               \
+      .SetIsMatchedHob(                                                                           \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                          \
+          && (user_op::HobDataType("keys", 0) == OF_PP_PAIR_SECOND(k_dtype_pair))                 \
+          && (user_op::HobDataType("inverse_indices", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))    \
+          && (user_op::HobDataType("unique_values", 0) == OF_PP_PAIR_SECOND(value_dtype_pair)))   \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                                         \
+        const user_op::TensorDesc& keys = ctx->InputTensorDesc("keys", 0);                        \
+        const int64_t num_keys = keys.shape().elem_cnt();                                         \
+        const size_t workspace_bytes =                                                            \
+            UniqueAndPartitionParam::WorkspaceBytes<OF_PP_PAIR_FIRST(k_dtype_pair)>(num_keys);    \
+        const int32_t num_tables = ctx->Attr<int32_t>("num_tables");                              \
+        const bool has_values = ctx->has_input("values", 0);                                      \
+        const bool need_values_buffer = (!has_values && num_tables > 1);                          \
+        size_t values_buffer_bytes =                                                              \
+            need_values_buffer                                                                    \
+                ? GetCudaAlignedSize(num_keys * sizeof(OF_PP_PAIR_FIRST(value_dtype_pair)))       \
+                : 0;                                                                              \
+        return workspace_bytes + values_buffer_bytes;                                             \
+      });
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_UNIQUE_KEY_VALUE_PAIR_KERNEL, ID_DATA_TYPE_SEQ,
+                                 TABLE_ID_DATA_TYPE_SEQ, IDX_DATA_TYPE_SEQ)
+
+}  // namespace oneflow
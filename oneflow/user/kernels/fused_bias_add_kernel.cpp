@@ -0,0 +1,239 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/primitive/unary_functor.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int64_t kMinElemsPerChunk = 32768;
+
+template<typename T>
+struct GeluFunctor {
+  ep::primitive::UnaryFunctor<DeviceType::kCPU, ep::primitive::UnaryOp::kGelu, T, T> gelu{0, 0};
+  T Compute(T x, int64_t i) const { return gelu(x); }
+};
+
+template<typename T>
+struct MaskAndScaleFunctor {
+  MaskAndScaleFunctor(const bool* mask, float scale) : mask(mask), scale(scale) {}
+  T Compute(T x, int64_t i) const { return x * static_cast<T>(mask[i]) * scale; }
+  const bool* mask;
+  float scale;
+};
+
+template<typename T>
+struct MaskAndScaleAddFunctor {
+  MaskAndScaleAddFunctor(const bool* mask, const T* addend, float scale)
+      : mask(mask), addend(addend), scale(scale) {}
+  T Compute(T x, int64_t i) const { return x * static_cast<T>(mask[i]) * scale + addend[i]; }
+  const bool* mask;
+  const T* addend;
+  float scale;
+};
+
+template<typename T>
+struct GeluGradFunctor {
+  const T coef = std::sqrt(static_cast<T>(2.0) / std::acos(static_cast<T>(-1.0)));
+  T Compute(T x, T dy, int64_t i) const {
+    return static_cast<T>(0.5)
+           * (static_cast<T>(1.0) + std::erf(static_cast<T>(M_SQRT1_2) * x)
+              + x * coef * std::exp(static_cast<T>(-0.5) * x * x))
+           * dy;
+  }
+};
+
+// Splits x into rows that share one bias layout: with inner_size == 1 a row is one outer slice and
+// its bias varies along the row, otherwise a row is one inner slice with a single bias value.
+// Rows are then distributed over the CPU stream's thread pool.
+template<typename FUNC>
+void ForEachBiasAddRow(ep::Stream* stream, int64_t outer_size, int64_t bias_size,
+                       int64_t inner_size, const FUNC& func) {
+  const int64_t num_rows = inner_size == 1 ? outer_size : outer_size * bias_size;
+  const int64_t row_size = inner_size == 1 ? bias_size : inner_size;
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_rows,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) { func(row, row * row_size, row_size); }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / std::max<int64_t>(1, row_size)));
+}
+
+template<typename FUNCTOR, typename T>
+void FusedBiasAddForwardImpl(ep::Stream* stream, const FUNCTOR& functor, int64_t outer_size,
+                             int64_t bias_size, int64_t inner_size, const T* x, const T* bias,
+                             T* y) {
+  if (inner_size == 1) {
+    ForEachBiasAddRow(stream, outer_size, bias_size, inner_size,
+                      [&](int64_t row, int64_t offset, int64_t row_size) {
+                        for (int64_t j = 0; j < row_size; ++j) {
+                          y[offset + j] = functor.Compute(x[offset + j] + bias[j], offset + j);
+                        }
+                      });
+  } else {
+    ForEachBiasAddRow(stream, outer_size, bias_size, inner_size,
+                      [&](int64_t row, int64_t offset, int64_t row_size) {
+                        const T bias_val = bias[row % bias_size];
+                        for (int64_t j = 0; j < row_size; ++j) {
+                          y[offset + j] = functor.Compute(x[offset + j] + bias_val, offset + j);
+                        }
+                      });
+  }
+}
+
+template<typename FUNCTOR, typename T>
+void FusedBiasAddGradImpl(ep::Stream* stream, const FUNCTOR& grad_functor, int64_t outer_size,
+                          int64_t bias_size, int64_t inner_size, const T* x, const T* bias,
+                          const T* dy, T* dx) {
+  if (inner_size == 1) {
+    ForEachBiasAddRow(stream, outer_size, bias_size, inner_size,
+                      [&](int64_t row, int64_t offset, int64_t row_size) {
+                        for (int64_t j = 0; j < row_size; ++j) {
+                          const int64_t i = offset + j;
+                          dx[i] = grad_functor.Compute(x[i] + bias[j], dy[i], i);
+                        }
+                      });
+  } else {
+    ForEachBiasAddRow(stream, outer_size, bias_size, inner_size,
+                      [&](int64_t row, int64_t offset, int64_t row_size) {
+                        const T bias_val = bias[row % bias_size];
+                        for (int64_t j = 0; j < row_size; ++j) {
+                          const int64_t i = offset + j;
+                          dx[i] = grad_functor.Compute(x[i] + bias_val, dy[i], i);
+                        }
+                      });
+  }
+}
+
+}  // namespace
+
+template<typename T>
+class FusedBiasAddGeluCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedBiasAddGeluCpuKernel() = default;
+  ~FusedBiasAddGeluCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const auto* a_tensor = ctx->Tensor4ArgNameAndIndex("a", 0);
+    const auto* b_tensor = ctx->Tensor4ArgNameAndIndex("b", 0);
+    auto* out_tensor = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const int32_t bias_add_axis = ctx->Attr<int32_t>("axis");
+    const int64_t outer_size = a_tensor->shape().Count(0, bias_add_axis);
+    const int64_t bias_size = a_tensor->shape().At(bias_add_axis);
+    const int64_t inner_size = a_tensor->shape().Count(bias_add_axis + 1);
+    GeluFunctor<T> gelu_functor{};
+    FusedBiasAddForwardImpl<decltype(gelu_functor), T>(
+        ctx->stream(), gelu_functor, outer_size, bias_size, inner_size, a_tensor->dptr<T>(),
+        b_tensor->dptr<T>(), out_tensor->mut_dptr<T>());
+  };
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_BIAS_ADD_GELU_CPU_KERNEL(dtype)                \
+  REGISTER_USER_KERNEL("fused_bias_add_gelu")                         \
+      .SetCreateFn<FusedBiasAddGeluCpuKernel<dtype>>()                \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
+
+REGISTER_FUSED_BIAS_ADD_GELU_CPU_KERNEL(float)
+REGISTER_FUSED_BIAS_ADD_GELU_CPU_KERNEL(double)
+
+template<typename T>
+class FusedBiasAddMaskScaleCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedBiasAddMaskScaleCpuKernel() = default;
+  ~FusedBiasAddMaskScaleCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const auto* a_tensor = ctx->Tensor4ArgNameAndIndex("a", 0);
+    const auto* b_tensor = ctx->Tensor4ArgNameAndIndex("b", 0);
+    const auto* mask_tensor = ctx->Tensor4ArgNameAndIndex("mask", 0);
+    auto* out_tensor = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const int32_t bias_add_axis = ctx->Attr<int32_t>("axis");
+    const float scale = ctx->Attr<float>("scale");
+    const int64_t outer_size = a_tensor->shape().Count(0, bias_add_axis);
+    const int64_t bias_size = a_tensor->shape().At(bias_add_axis);
+    const int64_t inner_size = a_tensor->shape().Count(bias_add_axis + 1);
+    if (ctx->has_input("_add_to_output", 0)) {
+      const user_op::Tensor* addend = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
+      MaskAndScaleAddFunctor<T> mask_and_scale_add_functor(mask_tensor->dptr<bool>(),
+                                                           addend->dptr<T>(), scale);
+      FusedBiasAddForwardImpl<decltype(mask_and_scale_add_functor), T>(
+          ctx->stream(), mask_and_scale_add_functor, outer_size, bias_size, inner_size,
+          a_tensor->dptr<T>(), b_tensor->dptr<T>(), out_tensor->mut_dptr<T>());
+    } else {
+      MaskAndScaleFunctor<T> mask_and_scale_functor(mask_tensor->dptr<bool>(), scale);
+      FusedBiasAddForwardImpl<decltype(mask_and_scale_functor), T>(
+          ctx->stream(), mask_and_scale_functor, outer_size, bias_size, inner_size,
+          a_tensor->dptr<T>(), b_tensor->dptr<T>(), out_tensor->mut_dptr<T>());
+    }
+  };
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_BIAS_ADD_MASK_SCALE_CPU_KERNEL(dtype)          \
+  REGISTER_USER_KERNEL("fused_bias_add_mask_scale")                   \
+      .SetCreateFn<FusedBiasAddMaskScaleCpuKernel<dtype>>()           \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
+
+REGISTER_FUSED_BIAS_ADD_MASK_SCALE_CPU_KERNEL(float)
+REGISTER_FUSED_BIAS_ADD_MASK_SCALE_CPU_KERNEL(double)
+
+template<typename T>
+class FusedBiasAddGeluGradCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedBiasAddGeluGradCpuKernel() = default;
+  ~FusedBiasAddGeluGradCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const auto* a_tensor = ctx->Tensor4ArgNameAndIndex("a", 0);
+    const auto* b_tensor = ctx->Tensor4ArgNameAndIndex("b", 0);
+    const auto* dy_tensor = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    auto* dx_tensor = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const int32_t bias_add_axis = ctx->Attr<int32_t>("axis");
+    const int64_t outer_size = a_tensor->shape().Count(0, bias_add_axis);
+    const int64_t bias_size = a_tensor->shape().At(bias_add_axis);
+    const int64_t inner_size = a_tensor->shape().Count(bias_add_axis + 1);
+    GeluGradFunctor<T> gelu_grad_functor;
+    FusedBiasAddGradImpl<decltype(gelu_grad_functor), T>(
+        ctx->stream(), gelu_grad_functor, outer_size, bias_size, inner_size, a_tensor->dptr<T>(),
+        b_tensor->dptr<T>(), dy_tensor->dptr<T>(), dx_tensor->mut_dptr<T>());
+  };
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_BIAS_ADD_GELU_GRAD_CPU_KERNEL(dtype)           \
+  REGISTER_USER_KERNEL("fused_bias_add_gelu_grad")                    \
+      .SetCreateFn<FusedBiasAddGeluGradCpuKernel<dtype>>()            \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("dx", 0) == GetDataType<dtype>::value));
+
+REGISTER_FUSED_BIAS_ADD_GELU_GRAD_CPU_KERNEL(float)
+REGISTER_FUSED_BIAS_ADD_GELU_GRAD_CPU_KERNEL(double)
+
+}  // namespace oneflow
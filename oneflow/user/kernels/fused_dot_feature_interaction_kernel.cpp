@@ -0,0 +1,401 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+// Number of independent accumulators of the dot product micro kernels. Keeping the lanes in a
+// fixed size array lets the compiler map them onto vector registers without reassociating the
+// floating point reduction.
+constexpr int kDotLanes = 8;
+// Number of rows of the concatenated features processed together, sharing the loads of the
+// other operand.
+constexpr int kRowBlock = 4;
+// Minimal number of multiply-adds handled by one ParallelFor chunk.
+constexpr int64_t kMinWorkPerChunk = 32768;
+
+int64_t GetBatchGrainSize(int64_t work_per_sample) {
+  return std::max<int64_t>(1, kMinWorkPerChunk / std::max<int64_t>(1, work_per_sample));
+}
+
+template<typename T>
+T Dot(const T* x, const T* y, int64_t n) {
+  T acc[kDotLanes] = {0};
+  int64_t i = 0;
+  for (; i + kDotLanes <= n; i += kDotLanes) {
+    for (int k = 0; k < kDotLanes; ++k) { acc[k] += x[i + k] * y[i + k]; }
+  }
+  T sum = 0;
+  for (int k = 0; k < kDotLanes; ++k) { sum += acc[k]; }
+  for (; i < n; ++i) { sum += x[i] * y[i]; }
+  return sum;
+}
+
+// out[j] = dot(x, y[j]) for j in [0, kRowBlock), x is loaded once for all the rows of y.
+template<typename T>
+void DotRowBlock(const T* x, const T* const* y, int64_t n, T* out) {
+  T acc[kRowBlock][kDotLanes] = {{0}};
+  int64_t i = 0;
+  for (; i + kDotLanes <= n; i += kDotLanes) {
+    for (int j = 0; j < kRowBlock; ++j) {
+      const T* y_j = y[j] + i;
+      for (int k = 0; k < kDotLanes; ++k) { acc[j][k] += x[i + k] * y_j[k]; }
+    }
+  }
+  for (int j = 0; j < kRowBlock; ++j) {
+    T sum = 0;
+    for (int k = 0; k < kDotLanes; ++k) { sum += acc[j][k]; }
+    for (int64_t t = i; t < n; ++t) { sum += x[t] * y[j][t]; }
+    out[j] = sum;
+  }
+}
+
+static_assert(kRowBlock == 4, "AxpyRowBlock is unrolled for kRowBlock == 4");
+
+// y += sum_j alpha[j] * x[j] for j in [0, kRowBlock), y is loaded and stored once per block.
+template<typename T>
+void AxpyRowBlock(const T* alpha, const T* const* x, int64_t n, T* y) {
+  const T a0 = alpha[0];
+  const T a1 = alpha[1];
+  const T a2 = alpha[2];
+  const T a3 = alpha[3];
+  const T* x0 = x[0];
+  const T* x1 = x[1];
+  const T* x2 = x[2];
+  const T* x3 = x[3];
+  for (int64_t i = 0; i < n; ++i) { y[i] += a0 * x0[i] + a1 * x1[i] + a2 * x2[i] + a3 * x3[i]; }
+}
+
+template<typename T>
+void Axpy(const T alpha, const T* x, int64_t n, T* y) {
+  for (int64_t i = 0; i < n; ++i) { y[i] += alpha * x[i]; }
+}
+
+// Row pointers of the features of one sample, as if they were concatenated along dim 1.
+template<typename T>
+void GetConcatedFeatureRows(const std::vector<const user_op::Tensor*>& features,
+                            int64_t batch_idx, int64_t vector_size, const T** rows) {
+  int64_t row = 0;
+  for (const user_op::Tensor* feature : features) {
+    const int64_t feature_dim = feature->shape().At(1);
+    const T* batch_feature = feature->dptr<T>() + batch_idx * feature_dim * vector_size;
+    for (int64_t j = 0; j < feature_dim; ++j) { rows[row++] = batch_feature + j * vector_size; }
+  }
+}
+
+template<typename T>
+void GetConcatedFeatureGradRows(const std::vector<user_op::Tensor*>& features_grad,
+                                int64_t batch_idx, int64_t vector_size, T** rows) {
+  int64_t row = 0;
+  for (user_op::Tensor* feature_grad : features_grad) {
+    const int64_t feature_dim = feature_grad->shape().At(1);
+    T* batch_feature_grad = feature_grad->mut_dptr<T>() + batch_idx * feature_dim * vector_size;
+    for (int64_t j = 0; j < feature_dim; ++j) {
+      rows[row++] = batch_feature_grad + j * vector_size;
+    }
+  }
+}
+
+std::vector<const user_op::Tensor*> GetFeatures(user_op::KernelComputeContext* ctx) {
+  std::vector<const user_op::Tensor*> features(ctx->input_size("features"));
+  for (int32_t i = 0; i < features.size(); ++i) {
+    features[i] = ctx->Tensor4ArgNameAndIndex("features", i);
+  }
+  return features;
+}
+
+std::vector<user_op::Tensor*> GetFeaturesGrad(user_op::KernelComputeContext* ctx) {
+  std::vector<user_op::Tensor*> features_grad(ctx->output_size("features_grad"));
+  for (int32_t i = 0; i < features_grad.size(); ++i) {
+    features_grad[i] = ctx->Tensor4ArgNameAndIndex("features_grad", i);
+  }
+  return features_grad;
+}
+
+int64_t GetFeaturesConcatedDim(const std::vector<const user_op::Tensor*>& features) {
+  int64_t features_concated_dim = 0;
+  for (const user_op::Tensor* feature : features) {
+    features_concated_dim += feature->shape().At(1);
+  }
+  return features_concated_dim;
+}
+
+template<typename T>
+class FusedDotFeatureInteractionCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedDotFeatureInteractionCpuKernel() = default;
+  ~FusedDotFeatureInteractionCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const std::vector<const user_op::Tensor*> features = GetFeatures(ctx);
+    const int64_t batch_size = out->shape().At(0);
+    const int64_t out_dim = out->shape().At(1);
+    const int64_t vector_size = features.at(0)->shape().At(2);
+    const int64_t features_concated_dim = GetFeaturesConcatedDim(features);
+    const bool self_interaction = ctx->Attr<bool>("self_interaction");
+    const int32_t output_padding = ctx->Attr<int32_t>("output_padding");
+    const int64_t offset = self_interaction ? 1 : 0;
+    const int64_t interaction_dim = self_interaction
+                                        ? features_concated_dim * (features_concated_dim + 1) / 2
+                                        : features_concated_dim * (features_concated_dim - 1) / 2;
+    const T* output_concat_ptr = nullptr;
+    int64_t output_concat_dim = 0;
+    if (ctx->has_input("output_concat", 0)) {
+      const user_op::Tensor* output_concat = ctx->Tensor4ArgNameAndIndex("output_concat", 0);
+      output_concat_ptr = output_concat->dptr<T>();
+      output_concat_dim = output_concat->shape().At(1);
+    }
+    CHECK_EQ(output_concat_dim + interaction_dim + output_padding, out_dim);
+    T* out_ptr = out->mut_dptr<T>();
+    // Every sample only reads its own features_concated_dim x vector_size block, which stays in
+    // cache while all of its dot products are computed.
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, batch_size,
+        [&](int64_t batch_begin, int64_t batch_end) {
+          std::vector<const T*> rows(features_concated_dim);
+          for (int64_t batch_idx = batch_begin; batch_idx < batch_end; ++batch_idx) {
+            GetConcatedFeatureRows(features, batch_idx, vector_size, rows.data());
+            T* batch_out = out_ptr + batch_idx * out_dim;
+            if (output_concat_dim > 0) {
+              std::copy(output_concat_ptr + batch_idx * output_concat_dim,
+                        output_concat_ptr + (batch_idx + 1) * output_concat_dim, batch_out);
+            }
+            T* interaction_out = batch_out + output_concat_dim;
+            for (int64_t row = 0; row < features_concated_dim; ++row) {
+              const int64_t num_cols = row + offset;
+              const T* x = rows[row];
+              int64_t col = 0;
+              for (; col + kRowBlock <= num_cols; col += kRowBlock) {
+                DotRowBlock(x, rows.data() + col, vector_size, interaction_out + col);
+              }
+              for (; col < num_cols; ++col) {
+                interaction_out[col] = Dot(x, rows[col], vector_size);
+              }
+              interaction_out += num_cols;
+            }
+            std::fill(interaction_out, interaction_out + output_padding, static_cast<T>(0));
+          }
+        },
+        GetBatchGrainSize(interaction_dim * vector_size));
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_DOT_FEATURE_INTERACTION_CPU_KERNEL(dtype)                        \
+  REGISTER_USER_KERNEL("fused_dot_feature_interaction")                                 \
+      .SetCreateFn<FusedDotFeatureInteractionCpuKernel<dtype>>()                        \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobAttr<std::string>("pooling") == "none"));
+
+REGISTER_FUSED_DOT_FEATURE_INTERACTION_CPU_KERNEL(float)
+REGISTER_FUSED_DOT_FEATURE_INTERACTION_CPU_KERNEL(double)
+
+template<typename T>
+class FusedDotFeatureInteractionGradCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedDotFeatureInteractionGradCpuKernel() = default;
+  ~FusedDotFeatureInteractionGradCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const std::vector<const user_op::Tensor*> features = GetFeatures(ctx);
+    const std::vector<user_op::Tensor*> features_grad = GetFeaturesGrad(ctx);
+    const int64_t batch_size = dy->shape().At(0);
+    const int64_t out_dim = dy->shape().At(1);
+    const int64_t vector_size = features.at(0)->shape().At(2);
+    const int64_t features_concated_dim = GetFeaturesConcatedDim(features);
+    const bool self_interaction = ctx->Attr<bool>("self_interaction");
+    const int64_t offset = self_interaction ? 1 : 0;
+    T* output_concat_grad_ptr = nullptr;
+    int64_t output_concat_dim = 0;
+    if (ctx->has_output("output_concat_grad", 0)) {
+      user_op::Tensor* output_concat_grad = ctx->Tensor4ArgNameAndIndex("output_concat_grad", 0);
+      output_concat_grad_ptr = output_concat_grad->mut_dptr<T>();
+      output_concat_dim = output_concat_grad->shape().At(1);
+    }
+    const T* dy_ptr = dy->dptr<T>();
+    const int64_t dim = features_concated_dim;
+    // The gradient of the lower triangle of X * X^T is the symmetric matrix G with
+    // G[i][j] = G[j][i] = dy(i, j) for j < i and G[i][i] = 2 * dy(i, i), so dX = G * X.
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, batch_size,
+        [&](int64_t batch_begin, int64_t batch_end) {
+          std::vector<const T*> rows(dim);
+          std::vector<T*> grad_rows(dim);
+          std::vector<T> matrix_grad(dim * dim);
+          for (int64_t batch_idx = batch_begin; batch_idx < batch_end; ++batch_idx) {
+            GetConcatedFeatureRows(features, batch_idx, vector_size, rows.data());
+            GetConcatedFeatureGradRows(features_grad, batch_idx, vector_size, grad_rows.data());
+            const T* batch_dy = dy_ptr + batch_idx * out_dim;
+            if (output_concat_dim > 0) {
+              std::copy(batch_dy, batch_dy + output_concat_dim,
+                        output_concat_grad_ptr + batch_idx * output_concat_dim);
+            }
+            const T* interaction_dy = batch_dy + output_concat_dim;
+            std::fill(matrix_grad.begin(), matrix_grad.end(), static_cast<T>(0));
+            for (int64_t row = 0; row < dim; ++row) {
+              for (int64_t col = 0; col < row; ++col) {
+                const T val = interaction_dy[col];
+                matrix_grad[row * dim + col] = val;
+                matrix_grad[col * dim + row] = val;
+              }
+              if (self_interaction) { matrix_grad[row * dim + row] = 2 * interaction_dy[row]; }
+              interaction_dy += row + offset;
+            }
+            for (int64_t row = 0; row < dim; ++row) {
+              const T* alpha = matrix_grad.data() + row * dim;
+              T* grad = grad_rows[row];
+              std::fill(grad, grad + vector_size, static_cast<T>(0));
+              int64_t col = 0;
+              for (; col + kRowBlock <= dim; col += kRowBlock) {
+                AxpyRowBlock(alpha + col, rows.data() + col, vector_size, grad);
+              }
+              for (; col < dim; ++col) { Axpy(alpha[col], rows[col], vector_size, grad); }
+            }
+          }
+        },
+        GetBatchGrainSize(dim * dim * vector_size));
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_DOT_FEATURE_INTERACTION_GRAD_CPU_KERNEL(dtype)                  \
+  REGISTER_USER_KERNEL("fused_dot_feature_interaction_grad")                           \
+      .SetCreateFn<FusedDotFeatureInteractionGradCpuKernel<dtype>>()                   \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                  \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobAttr<std::string>("pooling") == "none"));
+
+REGISTER_FUSED_DOT_FEATURE_INTERACTION_GRAD_CPU_KERNEL(float)
+REGISTER_FUSED_DOT_FEATURE_INTERACTION_GRAD_CPU_KERNEL(double)
+
+template<typename T>
+class FusedDotFeatureInteractionPoolingSumCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedDotFeatureInteractionPoolingSumCpuKernel() = default;
+  ~FusedDotFeatureInteractionPoolingSumCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const std::vector<const user_op::Tensor*> features = GetFeatures(ctx);
+    const int64_t batch_size = out->shape().At(0);
+    const int64_t vector_size = out->shape().At(1);
+    const int64_t features_concated_dim = GetFeaturesConcatedDim(features);
+    T* out_ptr = out->mut_dptr<T>();
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, batch_size,
+        [&](int64_t batch_begin, int64_t batch_end) {
+          std::vector<const T*> rows(features_concated_dim);
+          std::vector<T> square_sum(vector_size);
+          for (int64_t batch_idx = batch_begin; batch_idx < batch_end; ++batch_idx) {
+            GetConcatedFeatureRows(features, batch_idx, vector_size, rows.data());
+            T* sum = out_ptr + batch_idx * vector_size;
+            std::fill(sum, sum + vector_size, static_cast<T>(0));
+            std::fill(square_sum.begin(), square_sum.end(), static_cast<T>(0));
+            for (int64_t row = 0; row < features_concated_dim; ++row) {
+              const T* x = rows[row];
+              for (int64_t i = 0; i < vector_size; ++i) {
+                sum[i] += x[i];
+                square_sum[i] += x[i] * x[i];
+              }
+            }
+            for (int64_t i = 0; i < vector_size; ++i) {
+              sum[i] = (sum[i] * sum[i] - square_sum[i]) * static_cast<T>(0.5);
+            }
+          }
+        },
+        GetBatchGrainSize(features_concated_dim * vector_size));
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_DOT_FEATURE_INTERACTION_POOLING_SUM_CPU_KERNEL(dtype)            \
+  REGISTER_USER_KERNEL("fused_dot_feature_interaction")                                 \
+      .SetCreateFn<FusedDotFeatureInteractionPoolingSumCpuKernel<dtype>>()              \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobAttr<std::string>("pooling") == "sum"));
+
+REGISTER_FUSED_DOT_FEATURE_INTERACTION_POOLING_SUM_CPU_KERNEL(float)
+REGISTER_FUSED_DOT_FEATURE_INTERACTION_POOLING_SUM_CPU_KERNEL(double)
+
+template<typename T>
+class FusedDotFeatureInteractionPoolingSumGradCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedDotFeatureInteractionPoolingSumGradCpuKernel() = default;
+  ~FusedDotFeatureInteractionPoolingSumGradCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const std::vector<const user_op::Tensor*> features = GetFeatures(ctx);
+    const std::vector<user_op::Tensor*> features_grad = GetFeaturesGrad(ctx);
+    const int64_t batch_size = dy->shape().At(0);
+    const int64_t vector_size = dy->shape().At(1);
+    const int64_t features_concated_dim = GetFeaturesConcatedDim(features);
+    const T* dy_ptr = dy->dptr<T>();
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, batch_size,
+        [&](int64_t batch_begin, int64_t batch_end) {
+          std::vector<const T*> rows(features_concated_dim);
+          std::vector<T*> grad_rows(features_concated_dim);
+          std::vector<T> sum(vector_size);
+          for (int64_t batch_idx = batch_begin; batch_idx < batch_end; ++batch_idx) {
+            GetConcatedFeatureRows(features, batch_idx, vector_size, rows.data());
+            GetConcatedFeatureGradRows(features_grad, batch_idx, vector_size, grad_rows.data());
+            const T* batch_dy = dy_ptr + batch_idx * vector_size;
+            std::fill(sum.begin(), sum.end(), static_cast<T>(0));
+            for (int64_t row = 0; row < features_concated_dim; ++row) {
+              const T* x = rows[row];
+              for (int64_t i = 0; i < vector_size; ++i) { sum[i] += x[i]; }
+            }
+            for (int64_t row = 0; row < features_concated_dim; ++row) {
+              const T* x = rows[row];
+              T* grad = grad_rows[row];
+              for (int64_t i = 0; i < vector_size; ++i) { grad[i] = batch_dy[i] * (sum[i] - x[i]); }
+            }
+          }
+        },
+        GetBatchGrainSize(features_concated_dim * vector_size));
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_DOT_FEATURE_INTERACTION_POOLING_SUM_GRAD_CPU_KERNEL(dtype)      \
+  REGISTER_USER_KERNEL("fused_dot_feature_interaction_grad")                           \
+      .SetCreateFn<FusedDotFeatureInteractionPoolingSumGradCpuKernel<dtype>>()         \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                  \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobAttr<std::string>("pooling") == "sum"));
+
+REGISTER_FUSED_DOT_FEATURE_INTERACTION_POOLING_SUM_GRAD_CPU_KERNEL(float)
+REGISTER_FUSED_DOT_FEATURE_INTERACTION_POOLING_SUM_GRAD_CPU_KERNEL(double)
+
+}  // namespace
+
+}  // namespace oneflow
@@ -0,0 +1,221 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int64_t kMinElemsPerChunk = 32768;
+
+template<typename T>
+T Sigmoid(T in) {
+  const T one = static_cast<T>(1.0);
+  return one / (one + std::exp(-in));
+}
+
+int64_t GetBatchGrainSize(int64_t hidden_size) {
+  return std::max<int64_t>(1, kMinElemsPerChunk / std::max<int64_t>(1, 5 * hidden_size));
+}
+
+// Same math and workspace layout (rg, ig, ng, hx, hn + b2n) as gru_cell_forward in
+// fused_gru_cell_kernel.cu, parallelized over batch rows.
+template<typename T>
+void GruCellForward(ep::Stream* stream, int64_t batch_size, int64_t hidden_size,
+                    const T* input_gates_ptr, const T* hidden_gates_ptr, const T* hx_ptr,
+                    const T* input_bias_ptr, const T* hidden_bias_ptr, T* hy_ptr,
+                    T* workspace_ptr) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, batch_size,
+      [&](int64_t begin, int64_t end) {
+        std::vector<T> zero_bias;
+        const T* b1 = input_bias_ptr;
+        const T* b2 = hidden_bias_ptr;
+        if (b1 == nullptr) {
+          zero_bias.resize(3 * hidden_size, static_cast<T>(0.0));
+          b1 = zero_bias.data();
+          b2 = zero_bias.data();
+        }
+        for (int64_t row = begin; row < end; ++row) {
+          const T* ig_in = input_gates_ptr + row * 3 * hidden_size;
+          const T* hg_in = hidden_gates_ptr + row * 3 * hidden_size;
+          const T* hx = hx_ptr + row * hidden_size;
+          T* hy = hy_ptr + row * hidden_size;
+          T* ws = workspace_ptr + row * 5 * hidden_size;
+          for (int64_t j = 0; j < hidden_size; ++j) {
+            const int64_t r = j;
+            const int64_t i = hidden_size + j;
+            const int64_t n = 2 * hidden_size + j;
+            const T rg = Sigmoid(ig_in[r] + hg_in[r] + b1[r] + b2[r]);
+            const T ig = Sigmoid(ig_in[i] + hg_in[i] + b1[i] + b2[i]);
+            const T hn = hg_in[n] + b2[n];
+            const T ng = std::tanh(ig_in[n] + b1[n] + rg * hn);
+            hy[j] = ng + ig * (hx[j] - ng);
+            ws[j] = rg;
+            ws[hidden_size + j] = ig;
+            ws[2 * hidden_size + j] = ng;
+            ws[3 * hidden_size + j] = hx[j];
+            ws[4 * hidden_size + j] = hn;
+          }
+        }
+      },
+      GetBatchGrainSize(hidden_size));
+}
+
+template<typename T>
+void GruCellBackward(ep::Stream* stream, int64_t batch_size, int64_t hidden_size,
+                     const T* grad_hy_ptr, const T* workspace_ptr, T* grad_input_gates_ptr,
+                     T* grad_hidden_gates_ptr, T* grad_hx_ptr) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, batch_size,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          const T* ws = workspace_ptr + row * 5 * hidden_size;
+          const T* go = grad_hy_ptr + row * hidden_size;
+          T* grad_ig = grad_input_gates_ptr + row * 3 * hidden_size;
+          T* grad_hg = grad_hidden_gates_ptr + row * 3 * hidden_size;
+          for (int64_t j = 0; j < hidden_size; ++j) {
+            const T rg = ws[j];
+            const T ig = ws[hidden_size + j];
+            const T ng = ws[2 * hidden_size + j];
+            const T hx = ws[3 * hidden_size + j];
+            const T hn = ws[4 * hidden_size + j];
+            const T gig = go[j] * (hx - ng) * (1 - ig) * ig;
+            const T gin = go[j] * (1 - ig) * (1 - ng * ng);
+            const T grg = gin * hn * (1 - rg) * rg;
+            grad_ig[j] = grg;
+            grad_ig[hidden_size + j] = gig;
+            grad_ig[2 * hidden_size + j] = gin;
+            grad_hg[j] = grg;
+            grad_hg[hidden_size + j] = gig;
+            grad_hg[2 * hidden_size + j] = gin * rg;
+            if (grad_hx_ptr != nullptr) { grad_hx_ptr[row * hidden_size + j] = go[j] * ig; }
+          }
+        }
+      },
+      GetBatchGrainSize(hidden_size));
+}
+
+// grad_bias = sum(grad_gates, axis=0), see SumGradGatesToBias in fused_lstm_cell_kernel.cpp.
+template<typename T>
+void SumGradGatesToBias(ep::Stream* stream, int64_t batch_size, int64_t num_cols,
+                        const T* grad_gates_ptr, T* grad_bias_ptr) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_cols,
+      [&](int64_t begin, int64_t end) {
+        std::fill(grad_bias_ptr + begin, grad_bias_ptr + end, static_cast<T>(0.0));
+        for (int64_t row = 0; row < batch_size; ++row) {
+          const T* grad_gates = grad_gates_ptr + row * num_cols;
+          for (int64_t col = begin; col < end; ++col) { grad_bias_ptr[col] += grad_gates[col]; }
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / std::max<int64_t>(1, batch_size)));
+}
+
+}  // namespace
+
+template<typename T>
+class CpuFusedGruCellKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedGruCellKernel() = default;
+  ~CpuFusedGruCellKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* input_gates = ctx->Tensor4ArgNameAndIndex("input_gates", 0);
+    const user_op::Tensor* hidden_gates = ctx->Tensor4ArgNameAndIndex("hidden_gates", 0);
+    const user_op::Tensor* hx = ctx->Tensor4ArgNameAndIndex("hx", 0);
+    user_op::Tensor* hy = ctx->Tensor4ArgNameAndIndex("hy", 0);
+    user_op::Tensor* workspace = ctx->Tensor4ArgNameAndIndex("workspace", 0);
+
+    const T* input_bias_ptr = nullptr;
+    const T* hidden_bias_ptr = nullptr;
+    if (ctx->has_input("input_bias", 0)) {
+      CHECK(ctx->has_input("hidden_bias", 0));
+      input_bias_ptr = ctx->Tensor4ArgNameAndIndex("input_bias", 0)->dptr<T>();
+      hidden_bias_ptr = ctx->Tensor4ArgNameAndIndex("hidden_bias", 0)->dptr<T>();
+    }
+    const int64_t hidden_size = hx->shape().At(hx->shape().NumAxes() - 1);
+    const int64_t batch_size = hx->shape().elem_cnt() / hidden_size;
+    GruCellForward<T>(ctx->stream(), batch_size, hidden_size, input_gates->dptr<T>(),
+                      hidden_gates->dptr<T>(), hx->dptr<T>(), input_bias_ptr, hidden_bias_ptr,
+                      hy->mut_dptr<T>(), workspace->mut_dptr<T>());
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_GRU_CELL_CPU_KERNEL(dtype)                                               \
+  REGISTER_USER_KERNEL("fused_gru_cell")                                                        \
+      .SetCreateFn<CpuFusedGruCellKernel<dtype>>()                                              \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                           \
+                       && (user_op::HobDataType("hx", 0) == GetDataType<dtype>::value)          \
+                       && (user_op::HobDataType("input_gates", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("hidden_gates", 0) == GetDataType<dtype>::value))
+
+REGISTER_FUSED_GRU_CELL_CPU_KERNEL(float);
+REGISTER_FUSED_GRU_CELL_CPU_KERNEL(double);
+
+template<typename T>
+class CpuFusedGruCellGradKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedGruCellGradKernel() = default;
+  ~CpuFusedGruCellGradKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* grad_hy = ctx->Tensor4ArgNameAndIndex("grad_hy", 0);
+    const user_op::Tensor* workspace = ctx->Tensor4ArgNameAndIndex("workspace", 0);
+    user_op::Tensor* grad_input_gates = ctx->Tensor4ArgNameAndIndex("grad_input_gates", 0);
+    user_op::Tensor* grad_hidden_gates = ctx->Tensor4ArgNameAndIndex("grad_hidden_gates", 0);
+
+    T* grad_hx_ptr = nullptr;
+    if (ctx->has_output("grad_hx", 0)) {
+      grad_hx_ptr = ctx->Tensor4ArgNameAndIndex("grad_hx", 0)->mut_dptr<T>();
+    }
+    const int64_t hidden_size = grad_hy->shape().At(grad_hy->shape().NumAxes() - 1);
+    const int64_t batch_size = grad_hy->shape().elem_cnt() / hidden_size;
+    GruCellBackward<T>(ctx->stream(), batch_size, hidden_size, grad_hy->dptr<T>(),
+                       workspace->dptr<T>(), grad_input_gates->mut_dptr<T>(),
+                       grad_hidden_gates->mut_dptr<T>(), grad_hx_ptr);
+
+    if (ctx->has_output("grad_input_bias", 0) && ctx->has_output("grad_hidden_bias", 0)) {
+      SumGradGatesToBias<T>(ctx->stream(), batch_size, 3 * hidden_size,
+                            grad_input_gates->dptr<T>(),
+                            ctx->Tensor4ArgNameAndIndex("grad_input_bias", 0)->mut_dptr<T>());
+      SumGradGatesToBias<T>(ctx->stream(), batch_size, 3 * hidden_size,
+                            grad_hidden_gates->dptr<T>(),
+                            ctx->Tensor4ArgNameAndIndex("grad_hidden_bias", 0)->mut_dptr<T>());
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_GRU_CELL_GRAD_CPU_KERNEL(dtype)                                      \
+  REGISTER_USER_KERNEL("fused_gru_cell_grad")                                               \
+      .SetCreateFn<CpuFusedGruCellGradKernel<dtype>>()                                      \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                       \
+                       && (user_op::HobDataType("grad_hy", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("workspace", 0) == GetDataType<dtype>::value))
+
+REGISTER_FUSED_GRU_CELL_GRAD_CPU_KERNEL(float);
+REGISTER_FUSED_GRU_CELL_GRAD_CPU_KERNEL(double);
+
+}  // namespace oneflow
@@ -0,0 +1,229 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int64_t kMinElemsPerChunk = 32768;
+
+template<typename T>
+T Sigmoid(T in) {
+  const T one = static_cast<T>(1.0);
+  return one / (one + std::exp(-in));
+}
+
+int64_t GetBatchGrainSize(int64_t hidden_size) {
+  return std::max<int64_t>(1, kMinElemsPerChunk / std::max<int64_t>(1, 4 * hidden_size));
+}
+
+// Same math as lstm_cell_forward in fused_lstm_cell_kernel.cu, but every batch row is handled by
+// one thread and each gate is read as a contiguous slice of hidden_size elements.
+template<typename T>
+void LstmCellForward(ep::Stream* stream, int64_t batch_size, int64_t hidden_size,
+                     const T* input_gates_ptr, const T* hidden_gates_ptr, const T* cx_ptr,
+                     const T* input_bias_ptr, const T* hidden_bias_ptr, T* hy_ptr, T* cy_ptr,
+                     T* workspace_ptr) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, batch_size,
+      [&](int64_t begin, int64_t end) {
+        std::vector<T> zero_bias;
+        const T* b1 = input_bias_ptr;
+        const T* b2 = hidden_bias_ptr;
+        if (b1 == nullptr) {
+          zero_bias.resize(4 * hidden_size, static_cast<T>(0.0));
+          b1 = zero_bias.data();
+          b2 = zero_bias.data();
+        }
+        for (int64_t row = begin; row < end; ++row) {
+          const int64_t gates_offset = row * 4 * hidden_size;
+          const T* ig_in = input_gates_ptr + gates_offset;
+          const T* hg_in = hidden_gates_ptr + gates_offset;
+          T* ws = workspace_ptr + gates_offset;
+          const T* cx = cx_ptr + row * hidden_size;
+          T* hy = hy_ptr + row * hidden_size;
+          T* cy = cy_ptr + row * hidden_size;
+          for (int64_t j = 0; j < hidden_size; ++j) {
+            const int64_t i = j;
+            const int64_t f = hidden_size + j;
+            const int64_t c = 2 * hidden_size + j;
+            const int64_t o = 3 * hidden_size + j;
+            const T ig = Sigmoid(ig_in[i] + hg_in[i] + b1[i] + b2[i]);
+            const T fg = Sigmoid(ig_in[f] + hg_in[f] + b1[f] + b2[f]);
+            const T cg = std::tanh(ig_in[c] + hg_in[c] + b1[c] + b2[c]);
+            const T og = Sigmoid(ig_in[o] + hg_in[o] + b1[o] + b2[o]);
+            const T f_cy = fg * cx[j] + ig * cg;
+            cy[j] = f_cy;
+            hy[j] = og * std::tanh(f_cy);
+            ws[i] = ig;
+            ws[f] = fg;
+            ws[c] = cg;
+            ws[o] = og;
+          }
+        }
+      },
+      GetBatchGrainSize(hidden_size));
+}
+
+template<typename T>
+void LstmCellBackward(ep::Stream* stream, int64_t batch_size, int64_t hidden_size,
+                      const T* grad_hy_ptr, const T* grad_cy_ptr, const T* cx_ptr, const T* cy_ptr,
+                      const T* workspace_ptr, T* grad_gates_ptr, T* grad_cx_ptr) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, batch_size,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          const int64_t gates_offset = row * 4 * hidden_size;
+          const int64_t offset = row * hidden_size;
+          const T* ws = workspace_ptr + gates_offset;
+          T* grad_gates = grad_gates_ptr + gates_offset;
+          for (int64_t j = 0; j < hidden_size; ++j) {
+            const int64_t i = j;
+            const int64_t f = hidden_size + j;
+            const int64_t c = 2 * hidden_size + j;
+            const int64_t o = 3 * hidden_size + j;
+            const T ig = ws[i];
+            const T fg = ws[f];
+            const T cg = ws[c];
+            const T og = ws[o];
+            const T go = grad_hy_ptr[offset + j];
+            const T tanh_cy = std::tanh(cy_ptr[offset + j]);
+            const T gcx = go * og * (1 - tanh_cy * tanh_cy) + grad_cy_ptr[offset + j];
+            grad_gates[i] = gcx * cg * (1 - ig) * ig;
+            grad_gates[f] = gcx * cx_ptr[offset + j] * (1 - fg) * fg;
+            grad_gates[c] = gcx * ig * (1 - cg * cg);
+            grad_gates[o] = go * tanh_cy * (1 - og) * og;
+            if (grad_cx_ptr != nullptr) { grad_cx_ptr[offset + j] = gcx * fg; }
+          }
+        }
+      },
+      GetBatchGrainSize(hidden_size));
+}
+
+// grad_bias = sum(grad_gates, axis=0). Threads own disjoint column ranges and walk the rows in
+// order, so every read stays contiguous.
+template<typename T>
+void SumGradGatesToBias(ep::Stream* stream, int64_t batch_size, int64_t num_cols,
+                        const T* grad_gates_ptr, T* grad_bias_ptr) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_cols,
+      [&](int64_t begin, int64_t end) {
+        std::fill(grad_bias_ptr + begin, grad_bias_ptr + end, static_cast<T>(0.0));
+        for (int64_t row = 0; row < batch_size; ++row) {
+          const T* grad_gates = grad_gates_ptr + row * num_cols;
+          for (int64_t col = begin; col < end; ++col) { grad_bias_ptr[col] += grad_gates[col]; }
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / std::max<int64_t>(1, batch_size)));
+}
+
+}  // namespace
+
+template<typename T>
+class CpuFusedLstmCellKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedLstmCellKernel() = default;
+  ~CpuFusedLstmCellKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* input_gates = ctx->Tensor4ArgNameAndIndex("input_gates", 0);
+    const user_op::Tensor* hidden_gates = ctx->Tensor4ArgNameAndIndex("hidden_gates", 0);
+    const user_op::Tensor* cx = ctx->Tensor4ArgNameAndIndex("cx", 0);
+    user_op::Tensor* hy = ctx->Tensor4ArgNameAndIndex("hy", 0);
+    user_op::Tensor* cy = ctx->Tensor4ArgNameAndIndex("cy", 0);
+    user_op::Tensor* workspace = ctx->Tensor4ArgNameAndIndex("workspace", 0);
+
+    const T* input_bias_ptr = nullptr;
+    const T* hidden_bias_ptr = nullptr;
+    if (ctx->has_input("input_bias", 0)) {
+      CHECK(ctx->has_input("hidden_bias", 0));
+      input_bias_ptr = ctx->Tensor4ArgNameAndIndex("input_bias", 0)->dptr<T>();
+      hidden_bias_ptr = ctx->Tensor4ArgNameAndIndex("hidden_bias", 0)->dptr<T>();
+    }
+    const int64_t hidden_size = cx->shape().At(cx->shape().NumAxes() - 1);
+    const int64_t batch_size = cx->shape().elem_cnt() / hidden_size;
+    LstmCellForward<T>(ctx->stream(), batch_size, hidden_size, input_gates->dptr<T>(),
+                       hidden_gates->dptr<T>(), cx->dptr<T>(), input_bias_ptr, hidden_bias_ptr,
+                       hy->mut_dptr<T>(), cy->mut_dptr<T>(), workspace->mut_dptr<T>());
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_LSTM_CELL_CPU_KERNEL(dtype)                                              \
+  REGISTER_USER_KERNEL("fused_lstm_cell")                                                       \
+      .SetCreateFn<CpuFusedLstmCellKernel<dtype>>()                                             \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                           \
+                       && (user_op::HobDataType("cx", 0) == GetDataType<dtype>::value)          \
+                       && (user_op::HobDataType("input_gates", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("hidden_gates", 0) == GetDataType<dtype>::value))
+
+REGISTER_FUSED_LSTM_CELL_CPU_KERNEL(float);
+REGISTER_FUSED_LSTM_CELL_CPU_KERNEL(double);
+
+template<typename T>
+class CpuFusedLstmCellGradKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedLstmCellGradKernel() = default;
+  ~CpuFusedLstmCellGradKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* grad_hy = ctx->Tensor4ArgNameAndIndex("grad_hy", 0);
+    const user_op::Tensor* grad_cy = ctx->Tensor4ArgNameAndIndex("grad_cy", 0);
+    const user_op::Tensor* cx = ctx->Tensor4ArgNameAndIndex("cx", 0);
+    const user_op::Tensor* cy = ctx->Tensor4ArgNameAndIndex("cy", 0);
+    const user_op::Tensor* workspace = ctx->Tensor4ArgNameAndIndex("workspace", 0);
+    user_op::Tensor* grad_gates = ctx->Tensor4ArgNameAndIndex("grad_gates", 0);
+
+    T* grad_cx_ptr = nullptr;
+    if (ctx->has_output("grad_cx", 0)) {
+      grad_cx_ptr = ctx->Tensor4ArgNameAndIndex("grad_cx", 0)->mut_dptr<T>();
+    }
+    const int64_t hidden_size = cx->shape().At(cx->shape().NumAxes() - 1);
+    const int64_t batch_size = cx->shape().elem_cnt() / hidden_size;
+    LstmCellBackward<T>(ctx->stream(), batch_size, hidden_size, grad_hy->dptr<T>(),
+                        grad_cy->dptr<T>(), cx->dptr<T>(), cy->dptr<T>(), workspace->dptr<T>(),
+                        grad_gates->mut_dptr<T>(), grad_cx_ptr);
+
+    if (ctx->has_output("grad_bias", 0)) {
+      SumGradGatesToBias<T>(ctx->stream(), batch_size, 4 * hidden_size, grad_gates->dptr<T>(),
+                            ctx->Tensor4ArgNameAndIndex("grad_bias", 0)->mut_dptr<T>());
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_LSTM_CELL_GRAD_CPU_KERNEL(dtype)                                     \
+  REGISTER_USER_KERNEL("fused_lstm_cell_grad")                                              \
+      .SetCreateFn<CpuFusedLstmCellGradKernel<dtype>>()                                     \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                       \
+                       && (user_op::HobDataType("grad_hy", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("grad_cy", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("cx", 0) == GetDataType<dtype>::value)      \
+                       && (user_op::HobDataType("cy", 0) == GetDataType<dtype>::value)      \
+                       && (user_op::HobDataType("workspace", 0) == GetDataType<dtype>::value))
+
+REGISTER_FUSED_LSTM_CELL_GRAD_CPU_KERNEL(float);
+REGISTER_FUSED_LSTM_CELL_GRAD_CPU_KERNEL(double);
+
+}  // namespace oneflow
@@ -0,0 +1,189 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_FUSED_SOFTMAX_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_FUSED_SOFTMAX_KERNEL_UTIL_H_
+
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace cpu_softmax {
+
+/*
+CPU counterpart of the load/store based softmax in oneflow/core/cuda/softmax.cuh. Every row is
+loaded once through LOAD into a row buffer, where the prologue (scale, mask, ...) is applied,
+normalized in place and written once through STORE, which applies the epilogue. A LOAD provides
+`void Load(T* dst, int64_t row) const` and a STORE `void Store(const T* src, int64_t row) const`,
+both for the whole row of `cols` elements.
+*/
+
+inline int64_t GetRowGrainSize(int64_t cols) {
+  constexpr int64_t kMinElemsPerChunk = 32768;
+  return std::max<int64_t>(1, kMinElemsPerChunk / std::max<int64_t>(1, cols));
+}
+
+template<typename LOAD, typename STORE, typename T>
+void DispatchSoftmax(ep::Stream* stream, const LOAD& load, const STORE& store, int64_t rows,
+                     int64_t cols) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, rows,
+      [&](int64_t begin, int64_t end) {
+        std::vector<T> buf(cols);
+        T* row_buf = buf.data();
+        for (int64_t row = begin; row < end; ++row) {
+          load.Load(row_buf, row);
+          T row_max = -std::numeric_limits<T>::infinity();
+          for (int64_t col = 0; col < cols; ++col) { row_max = std::max(row_max, row_buf[col]); }
+          T row_sum = 0;
+          for (int64_t col = 0; col < cols; ++col) {
+            row_buf[col] = std::exp(row_buf[col] - row_max);
+            row_sum += row_buf[col];
+          }
+          const T inv_row_sum = static_cast<T>(1) / row_sum;
+          for (int64_t col = 0; col < cols; ++col) { row_buf[col] *= inv_row_sum; }
+          store.Store(row_buf, row);
+        }
+      },
+      GetRowGrainSize(cols));
+}
+
+template<typename LOAD_Y, typename LOAD_DY, typename STORE, typename T>
+void DispatchSoftmaxGrad(ep::Stream* stream, const LOAD_Y& load_y, const LOAD_DY& load_dy,
+                         const STORE& store, int64_t rows, int64_t cols) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, rows,
+      [&](int64_t begin, int64_t end) {
+        std::vector<T> buf(2 * cols);
+        T* y_buf = buf.data();
+        T* dy_buf = buf.data() + cols;
+        for (int64_t row = begin; row < end; ++row) {
+          load_y.Load(y_buf, row);
+          load_dy.Load(dy_buf, row);
+          T row_sum = 0;
+          for (int64_t col = 0; col < cols; ++col) { row_sum += y_buf[col] * dy_buf[col]; }
+          for (int64_t col = 0; col < cols; ++col) {
+            dy_buf[col] = y_buf[col] * (dy_buf[col] - row_sum);
+          }
+          store.Store(dy_buf, row);
+        }
+      },
+      GetRowGrainSize(cols));
+}
+
+template<typename T>
+struct DirectLoad {
+  DirectLoad(const T* src, int64_t row_size) : src(src), row_size(row_size) {}
+  void Load(T* dst, int64_t row) const {
+    const T* row_src = src + row * row_size;
+    std::copy(row_src, row_src + row_size, dst);
+  }
+  const T* src;
+  int64_t row_size;
+};
+
+template<typename T>
+struct DirectStore {
+  DirectStore(T* dst, int64_t row_size) : dst(dst), row_size(row_size) {}
+  void Store(const T* src, int64_t row) const {
+    std::copy(src, src + row_size, dst + row * row_size);
+  }
+  T* dst;
+  int64_t row_size;
+};
+
+// dst = mask ? src * scale : fill
+template<typename T>
+struct ScaleMaskLoad {
+  ScaleMaskLoad(const T* src, const bool* mask, int64_t row_size, T fill, T scale)
+      : src(src), mask(mask), row_size(row_size), fill(fill), scale(scale) {}
+  void Load(T* dst, int64_t row) const {
+    const T* row_src = src + row * row_size;
+    const bool* row_mask = mask + row * row_size;
+    for (int64_t col = 0; col < row_size; ++col) {
+      dst[col] = row_mask[col] ? row_src[col] * scale : fill;
+    }
+  }
+  const T* src;
+  const bool* mask;
+  int64_t row_size;
+  T fill;
+  T scale;
+};
+
+// dst = mask ? src * scale : fill
+template<typename T>
+struct ScaleMaskStore {
+  ScaleMaskStore(T* dst, const bool* mask, int64_t row_size, T fill, T scale)
+      : dst(dst), mask(mask), row_size(row_size), fill(fill), scale(scale) {}
+  void Store(const T* src, int64_t row) const {
+    T* row_dst = dst + row * row_size;
+    const bool* row_mask = mask + row * row_size;
+    for (int64_t col = 0; col < row_size; ++col) {
+      row_dst[col] = row_mask[col] ? src[col] * scale : fill;
+    }
+  }
+  T* dst;
+  const bool* mask;
+  int64_t row_size;
+  T fill;
+  T scale;
+};
+
+// dst = src * mask * scale
+template<typename T>
+struct MaskAndScaleLoad {
+  MaskAndScaleLoad(const T* src, const bool* mask, int64_t row_size, T scale)
+      : src(src), mask(mask), row_size(row_size), scale(scale) {}
+  void Load(T* dst, int64_t row) const {
+    const T* row_src = src + row * row_size;
+    const bool* row_mask = mask + row * row_size;
+    for (int64_t col = 0; col < row_size; ++col) {
+      dst[col] = row_src[col] * static_cast<T>(row_mask[col]) * scale;
+    }
+  }
+  const T* src;
+  const bool* mask;
+  int64_t row_size;
+  T scale;
+};
+
+// softmax_y = src, dst = src * mask * scale
+template<typename T>
+struct MaskAndScaleStore {
+  MaskAndScaleStore(T* dst, T* softmax_y, const bool* mask, int64_t row_size, T scale)
+      : dst(dst), softmax_y(softmax_y), mask(mask), row_size(row_size), scale(scale) {}
+  void Store(const T* src, int64_t row) const {
+    const int64_t offset = row * row_size;
+    T* row_dst = dst + offset;
+    T* row_softmax_y = softmax_y + offset;
+    const bool* row_mask = mask + offset;
+    for (int64_t col = 0; col < row_size; ++col) {
+      row_softmax_y[col] = src[col];
+      row_dst[col] = src[col] * static_cast<T>(row_mask[col]) * scale;
+    }
+  }
+  T* dst;
+  T* softmax_y;
+  const bool* mask;
+  int64_t row_size;
+  T scale;
+};
+
+}  // namespace cpu_softmax
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_FUSED_SOFTMAX_KERNEL_UTIL_H_
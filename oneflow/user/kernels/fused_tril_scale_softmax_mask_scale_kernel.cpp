@@ -0,0 +1,156 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/fused_softmax_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// dst = col > row % tril_num_rows + diagonal ? fill : src * scale
+template<typename T>
+struct TrilScaleLoad {
+  TrilScaleLoad(const T* src, int64_t tril_num_rows, int64_t row_size, int64_t diagonal, T fill,
+                T scale)
+      : src(src),
+        tril_num_rows(tril_num_rows),
+        row_size(row_size),
+        diagonal(diagonal),
+        fill(fill),
+        scale(scale) {}
+  void Load(T* dst, int64_t row) const {
+    const T* row_src = src + row * row_size;
+    const int64_t num_kept =
+        std::min(row_size, std::max<int64_t>(0, row % tril_num_rows + diagonal + 1));
+    for (int64_t col = 0; col < num_kept; ++col) { dst[col] = row_src[col] * scale; }
+    std::fill(dst + num_kept, dst + row_size, fill);
+  }
+  const T* src;
+  int64_t tril_num_rows;
+  int64_t row_size;
+  int64_t diagonal;
+  T fill;
+  T scale;
+};
+
+template<typename T>
+struct TrilScaleStore {
+  TrilScaleStore(T* dst, int64_t tril_num_rows, int64_t row_size, int64_t diagonal, T fill,
+                 T scale)
+      : dst(dst),
+        tril_num_rows(tril_num_rows),
+        row_size(row_size),
+        diagonal(diagonal),
+        fill(fill),
+        scale(scale) {}
+  void Store(const T* src, int64_t row) const {
+    T* row_dst = dst + row * row_size;
+    const int64_t num_kept =
+        std::min(row_size, std::max<int64_t>(0, row % tril_num_rows + diagonal + 1));
+    for (int64_t col = 0; col < num_kept; ++col) { row_dst[col] = src[col] * scale; }
+    std::fill(row_dst + num_kept, row_dst + row_size, fill);
+  }
+  T* dst;
+  int64_t tril_num_rows;
+  int64_t row_size;
+  int64_t diagonal;
+  T fill;
+  T scale;
+};
+
+}  // namespace
+
+template<typename T>
+class FusedTrilScaleSoftmaxMaskScaleCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedTrilScaleSoftmaxMaskScaleCpuKernel() = default;
+  ~FusedTrilScaleSoftmaxMaskScaleCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mask = ctx->Tensor4ArgNameAndIndex("mask", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* softmax_y = ctx->Tensor4ArgNameAndIndex("softmax_y", 0);
+    const ShapeView& x_shape = x->shape();
+    CHECK_GE(x_shape.NumAxes(), 2);
+    const int64_t cols = x_shape.At(x_shape.NumAxes() - 1);
+    const int64_t rows = x_shape.Count(0, x_shape.NumAxes() - 1);
+    const int64_t tril_num_rows = x_shape.At(x_shape.NumAxes() - 2);
+    TrilScaleLoad<T> load(x->dptr<T>(), tril_num_rows, cols, ctx->Attr<int64_t>("diagonal"),
+                          ctx->Attr<float>("tril_fill_value"),
+                          ctx->Attr<float>("tril_scale_value"));
+    cpu_softmax::MaskAndScaleStore<T> store(y->mut_dptr<T>(), softmax_y->mut_dptr<T>(),
+                                            mask->dptr<bool>(), cols,
+                                            ctx->Attr<float>("mask_scale_value"));
+    cpu_softmax::DispatchSoftmax<decltype(load), decltype(store), T>(ctx->stream(), load, store,
+                                                                      rows, cols);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_TRIL_SCALE_SOFTMAX_MASK_SCALE_CPU_KERNEL(dtype) \
+  REGISTER_USER_KERNEL("fused_tril_scale_softmax_mask_scale")          \
+      .SetCreateFn<FusedTrilScaleSoftmaxMaskScaleCpuKernel<dtype>>()   \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)  \
+                       && (user_op::HobDataType("y", 0) == GetDataType<dtype>::value));
+
+REGISTER_FUSED_TRIL_SCALE_SOFTMAX_MASK_SCALE_CPU_KERNEL(float)
+REGISTER_FUSED_TRIL_SCALE_SOFTMAX_MASK_SCALE_CPU_KERNEL(double)
+#undef REGISTER_FUSED_TRIL_SCALE_SOFTMAX_MASK_SCALE_CPU_KERNEL
+
+template<typename T>
+class FusedTrilScaleSoftmaxMaskScaleGradCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedTrilScaleSoftmaxMaskScaleGradCpuKernel() = default;
+  ~FusedTrilScaleSoftmaxMaskScaleGradCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* softmax_y = ctx->Tensor4ArgNameAndIndex("softmax_y", 0);
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* mask = ctx->Tensor4ArgNameAndIndex("mask", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const ShapeView& dy_shape = dy->shape();
+    CHECK_GE(dy_shape.NumAxes(), 2);
+    const int64_t cols = dy_shape.At(dy_shape.NumAxes() - 1);
+    const int64_t rows = dy_shape.Count(0, dy_shape.NumAxes() - 1);
+    const int64_t tril_num_rows = dy_shape.At(dy_shape.NumAxes() - 2);
+    cpu_softmax::DirectLoad<T> load_softmax_y(softmax_y->dptr<T>(), cols);
+    cpu_softmax::MaskAndScaleLoad<T> load_dy(dy->dptr<T>(), mask->dptr<bool>(), cols,
+                                             ctx->Attr<float>("mask_scale_value"));
+    TrilScaleStore<T> store(dx->mut_dptr<T>(), tril_num_rows, cols,
+                            ctx->Attr<int64_t>("diagonal"), static_cast<T>(0.0),
+                            ctx->Attr<float>("tril_scale_value"));
+    cpu_softmax::DispatchSoftmaxGrad<decltype(load_softmax_y), decltype(load_dy), decltype(store),
+                                     T>(ctx->stream(), load_softmax_y, load_dy, store, rows, cols);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_TRIL_SCALE_SOFTMAX_MASK_SCALE_GRAD_CPU_KERNEL(dtype) \
+  REGISTER_USER_KERNEL("fused_tril_scale_softmax_mask_scale_grad")          \
+      .SetCreateFn<FusedTrilScaleSoftmaxMaskScaleGradCpuKernel<dtype>>()    \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)       \
+                       && (user_op::HobDataType("dx", 0) == GetDataType<dtype>::value));
+
+REGISTER_FUSED_TRIL_SCALE_SOFTMAX_MASK_SCALE_GRAD_CPU_KERNEL(float)
+REGISTER_FUSED_TRIL_SCALE_SOFTMAX_MASK_SCALE_GRAD_CPU_KERNEL(double)
+#undef REGISTER_FUSED_TRIL_SCALE_SOFTMAX_MASK_SCALE_GRAD_CPU_KERNEL
+
+}  // namespace oneflow
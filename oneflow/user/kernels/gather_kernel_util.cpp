@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/kernels/gather_kernel_util.h"
+#include "oneflow/user/kernels/indexed_rows_cpu_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
@@ -76,19 +78,34 @@ void GatherKernelUtilImpl<DeviceType::kCPU, T, K>::Forward(ep::Stream* stream, c
   const int64_t outer_dim_size = flat_in_shape.At(0);
   const int64_t gather_dim_size = flat_in_shape.At(1);
   const int64_t inner_dim_size = flat_in_shape.At(2);
-  FOR_RANGE(int64_t, outer_idx, 0, outer_dim_size) {
-    FOR_RANGE(int64_t, i, 0, num_indices) {
-      CHECK_GE(indices[i], 0);
-      const int64_t idx = indices[i] - offset;
-      T* to = out + outer_idx * num_indices * inner_dim_size + i * inner_dim_size;
-      if (idx >= 0 && idx < gather_dim_size) {
-        const T* from = in + outer_idx * gather_dim_size * inner_dim_size + idx * inner_dim_size;
-        std::copy(from, from + inner_dim_size, to);
-      } else {
-        std::memset(reinterpret_cast<void*>(to), 0, inner_dim_size * sizeof(K));
-      }
-    }
-  }
+  const auto GetInRow = [&](int64_t row) -> const T* {
+    const int64_t idx = indices[row % num_indices] - offset;
+    if (idx < 0 || idx >= gather_dim_size) { return nullptr; }
+    return in + ((row / num_indices) * gather_dim_size + idx) * inner_dim_size;
+  };
+  // Every output row is a copy of a random input row, the rows kGatherPrefetchDistance ahead
+  // are requested early so that their loads overlap with the current copies.
+  constexpr int64_t kGatherPrefetchDistance = 8;
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, outer_dim_size * num_indices,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          if (row + kGatherPrefetchDistance < end) {
+            indexed_rows::PrefetchRow(GetInRow(row + kGatherPrefetchDistance),
+                                      inner_dim_size * sizeof(T));
+          }
+          CHECK_GE(indices[row % num_indices], 0);
+          const T* from = GetInRow(row);
+          T* to = out + row * inner_dim_size;
+          if (from != nullptr) {
+            std::copy(from, from + inner_dim_size, to);
+          } else {
+            std::memset(reinterpret_cast<void*>(to), 0, inner_dim_size * sizeof(T));
+          }
+        }
+      },
+      std::max<int64_t>(1,
+                        indexed_rows::kMinElemsPerChunk / std::max<int64_t>(1, inner_dim_size)));
 }
 
 #define INITIATE_GATHER_KERNEL_UTIL_CPU_IMPL(in_type_pair, index_type_pair)              \
@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/kernel/kernel_util.h"
 #include "oneflow/core/ep/include/primitive/add.h"
+#include "oneflow/user/kernels/conv_cpu_algo_util.h"
 
 namespace oneflow {
 
@@ -323,6 +324,7 @@ struct ConvOpKernelCache final : public user_op::OpKernelCache {
   int32_t idx_offset_ = 0;
   bool is_dynamic_ = false;
   int32_t groups = 1;
+  ConvCpuAlgo algo_ = ConvCpuAlgo::kIm2ColGemm;
 };
 
 template<typename T>
@@ -360,6 +362,8 @@ std::shared_ptr<ConvOpKernelCache<T>> CreateConvOpKernelCache(user_op::KernelCac
       Gen5DShape(ctx->TensorDesc4ArgNameAndIndex(out_name, 0)->shape(), state->idx_offset_);
   state->weight_5d_shape_ =
       Gen5DShape(ctx->TensorDesc4ArgNameAndIndex(weight_name, 0)->shape(), state->idx_offset_);
+  state->algo_ =
+      InferConvCpuAlgo(ctx, ShapeView(ctx->TensorDesc4ArgNameAndIndex(weight_name, 0)->shape()));
 
   auto Gen3DVec = [](const std::vector<int32_t>& origin_vec) -> std::vector<int32_t> {
     std::vector<int32_t> ret_vec = origin_vec;
@@ -410,6 +414,18 @@ class ConvCpuKernel final : public user_op::OpKernel {
     user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
 
+    if (conv_cache->algo_ == ConvCpuAlgo::kDirect) {
+      // depthwise convolution
+      const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
+      DirectConvUtil<T>::Forward(
+          ctx->stream(), in->dptr<T>(), ShapeView(conv_cache->in_5d_shape_), weight->dptr<T>(),
+          ShapeView(conv_cache->weight_5d_shape_), ShapeView(conv_cache->out_5d_shape_),
+          conv_cache->strides_3d_.data(), conv_cache->dilation_rate_3d_.data(),
+          conv_cache->padding_before_3d_.data(), conv_cache->groups,
+          bias == nullptr ? nullptr : bias->dptr<T>(), out->mut_dptr<T>());
+      return;
+    }
+
     T* col_buf_dptr = tmp_buffer->mut_dptr<T>();
     int32_t idx_offset = conv_cache->idx_offset_;
     const int32_t input_group_interval = in->shape().At(1) / conv_cache->groups;
@@ -483,6 +499,9 @@ class ConvCpuKernel final : public user_op::OpKernel {
         size_t tmp_buffer_size = 0;                                                         \
         const auto& out_shape = ctx->OutputTensorDesc("out", 0)->shape();                   \
         const auto& weight_shape = ctx->InputTensorDesc("weight", 0).shape();               \
+        if (InferConvCpuAlgo(ctx, ShapeView(weight_shape)) == ConvCpuAlgo::kDirect) {       \
+          return 0;                                                                         \
+        }                                                                                   \
                                                                                             \
         int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));              \
         tmp_buffer_size +=                                                                  \
@@ -539,32 +558,40 @@ class ConvDataGradCpuKernel final : public user_op::OpKernel {
     const int32_t n = conv_cache->out_5d_shape_.Count(idx_offset, idx_offset + 3);
     const int32_t k = conv_cache->weight_5d_shape_.At(0) / conv_cache->groups;
 
-    Memset<DeviceType::kCPU>(ctx->stream(), dx->mut_dptr<T>(), 0,
-                             dx->shape().elem_cnt() * sizeof(T));
-
-    FOR_RANGE(int64_t, i, 0, dy->shape().At(0)) {
-      const T* filter_ptr = filter->dptr<T>();
-      const T* dy_ptr = GetImgDptr<T>(dy, i);
-      T* dx_ptr = GetImgMutDptr<T>(dx, i);
-      FOR_RANGE(int64_t, g, 0, conv_cache->groups) {
-        // channels first:  col_buf' = weight(T) * out[i]'
-        // channels last :  col_buf' = weight(T) * out[i]'(T)
-        NewKernelUtil<DeviceType::kCPU>::OFGemm(
-            nullptr, CblasTrans, conv_cache->is_out_diff_need_trans_,
-            m,  //  ci * kd * kh * kw / groups
-            n,  //  od * oh * ow
-            k,  //  filter / groups
-            static_cast<T>(1), filter_ptr, dy_ptr, static_cast<T>(0), col_buf->mut_dptr<T>());
-
-        // in' = col2im(col_buf')
-        conv_cache->col2im_func_(
-            col_buf->dptr<T>(), ShapeView(conv_cache->in_5d_shape_),
-            ShapeView(conv_cache->weight_5d_shape_), ShapeView(conv_cache->out_5d_shape_),
-            conv_cache->strides_3d_.data(), conv_cache->dilation_rate_3d_.data(),
-            conv_cache->padding_before_3d_.data(), dx_ptr);
-        filter_ptr += filter_step;
-        dy_ptr += dy_step;
-        dx_ptr += dx_step;
+    if (conv_cache->algo_ == ConvCpuAlgo::kDirect) {
+      DirectConvUtil<T>::DataGrad(
+          ctx->stream(), dy->dptr<T>(), ShapeView(conv_cache->out_5d_shape_), filter->dptr<T>(),
+          ShapeView(conv_cache->weight_5d_shape_), ShapeView(conv_cache->in_5d_shape_),
+          conv_cache->strides_3d_.data(), conv_cache->dilation_rate_3d_.data(),
+          conv_cache->padding_before_3d_.data(), conv_cache->groups, dx->mut_dptr<T>());
+    } else {
+      Memset<DeviceType::kCPU>(ctx->stream(), dx->mut_dptr<T>(), 0,
+                               dx->shape().elem_cnt() * sizeof(T));
+
+      FOR_RANGE(int64_t, i, 0, dy->shape().At(0)) {
+        const T* filter_ptr = filter->dptr<T>();
+        const T* dy_ptr = GetImgDptr<T>(dy, i);
+        T* dx_ptr = GetImgMutDptr<T>(dx, i);
+        FOR_RANGE(int64_t, g, 0, conv_cache->groups) {
+          // channels first:  col_buf' = weight(T) * out[i]'
+          // channels last :  col_buf' = weight(T) * out[i]'(T)
+          NewKernelUtil<DeviceType::kCPU>::OFGemm(
+              nullptr, CblasTrans, conv_cache->is_out_diff_need_trans_,
+              m,  //  ci * kd * kh * kw / groups
+              n,  //  od * oh * ow
+              k,  //  filter / groups
+              static_cast<T>(1), filter_ptr, dy_ptr, static_cast<T>(0), col_buf->mut_dptr<T>());
+
+          // in' = col2im(col_buf')
+          conv_cache->col2im_func_(
+              col_buf->dptr<T>(), ShapeView(conv_cache->in_5d_shape_),
+              ShapeView(conv_cache->weight_5d_shape_), ShapeView(conv_cache->out_5d_shape_),
+              conv_cache->strides_3d_.data(), conv_cache->dilation_rate_3d_.data(),
+              conv_cache->padding_before_3d_.data(), dx_ptr);
+          filter_ptr += filter_step;
+          dy_ptr += dy_step;
+          dx_ptr += dx_step;
+        }
       }
     }
     if (ctx->has_input("_add_to_output", 0)) {
@@ -591,6 +618,9 @@ class ConvDataGradCpuKernel final : public user_op::OpKernel {
         size_t tmp_buffer_size = 0;                                                        \
         const auto& out_diff_shape = ctx->InputTensorDesc("dy", 0).shape();                \
         const auto& weight_shape = ctx->InputTensorDesc("filter", 0).shape();              \
+        if (InferConvCpuAlgo(ctx, ShapeView(weight_shape)) == ConvCpuAlgo::kDirect) {      \
+          return 0;                                                                        \
+        }                                                                                  \
                                                                                            \
         int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));             \
         tmp_buffer_size +=                                                                 \
@@ -636,6 +666,15 @@ class ConvFilterGradCpuKernel final : public user_op::OpKernel {
     const int32_t n = conv_cache->weight_5d_shape_.Count(1);
     const int32_t k = conv_cache->out_5d_shape_.Count(idx_offset, idx_offset + 3);
 
+    if (conv_cache->algo_ == ConvCpuAlgo::kDirect) {
+      DirectConvUtil<T>::FilterGrad(
+          ctx->stream(), x->dptr<T>(), ShapeView(conv_cache->in_5d_shape_), dy->dptr<T>(),
+          ShapeView(conv_cache->out_5d_shape_), ShapeView(conv_cache->weight_5d_shape_),
+          conv_cache->strides_3d_.data(), conv_cache->dilation_rate_3d_.data(),
+          conv_cache->padding_before_3d_.data(), conv_cache->groups, filter_diff->mut_dptr<T>());
+      return;
+    }
+
     Memset<DeviceType::kCPU>(ctx->stream(), filter_diff->mut_dptr<T>(), 0,
                              filter_diff->shape().elem_cnt() * sizeof(T));
     FOR_RANGE(int64_t, i, 0, dy->shape().At(0)) {
@@ -675,6 +714,9 @@ class ConvFilterGradCpuKernel final : public user_op::OpKernel {
         size_t tmp_buffer_size = 0;                                                             \
         const auto& out_diff_shape = ctx->InputTensorDesc("dy", 0).shape();                     \
         const auto& weight_diff_shape = ctx->OutputTensorDesc("filter_diff", 0)->shape();       \
+        if (InferConvCpuAlgo(ctx, ShapeView(weight_diff_shape)) == ConvCpuAlgo::kDirect) {      \
+          return 0;                                                                             \
+        }                                                                                       \
                                                                                                 \
         int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));                  \
         tmp_buffer_size +=                                                                      \
@@ -0,0 +1,50 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_INDEXED_ROWS_CPU_UTIL_H_
+#define ONEFLOW_USER_KERNELS_INDEXED_ROWS_CPU_UTIL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace oneflow {
+
+// Helpers of the cpu kernels which read rows at data dependent positions, e.g. gather and
+// unsorted_segment_sum.
+namespace indexed_rows {
+
+// Elements a ParallelFor task should cover at least.
+constexpr int64_t kMinElemsPerChunk = 32768;
+
+// Software prefetch of the leading cache lines of a row, the hardware prefetcher picks up the rest.
+// A null row is ignored.
+inline void PrefetchRow(const void* row, size_t row_bytes) {
+#if defined(__GNUC__)
+  if (row == nullptr) { return; }
+  constexpr size_t kCacheLineSize = 64;
+  constexpr size_t kMaxPrefetchBytes = 4 * kCacheLineSize;
+  const char* ptr = static_cast<const char*>(row);
+  for (size_t i = 0; i < std::min(row_bytes, kMaxPrefetchBytes); i += kCacheLineSize) {
+    __builtin_prefetch(ptr + i, 0, 1);
+  }
+#endif
+}
+
+}  // namespace indexed_rows
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_INDEXED_ROWS_CPU_UTIL_H_
@@ -14,67 +14,443 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+#include "oneflow/core/device/cpu_pseudo_bfloat16.h"
 
 namespace oneflow {
 
+namespace {
+
+// Storage and compute types of a layer norm element. mean and inv_variance are stored in
+// ComputeType, which matches InferBnParamDataType of the layer_norm op.
+template<typename T>
+struct LayerNormCpuTraits {
+  using StorageType = T;
+  using ComputeType = T;
+  static ComputeType Load(StorageType x) { return x; }
+  static StorageType Store(ComputeType x) { return x; }
+};
+
+// bfloat16 has no C++ type on CPU, elements are stored as their upper 16 bits and computed in
+// float.
+struct LayerNormCpuBFloat16Traits {
+  using StorageType = uint16_t;
+  using ComputeType = float;
+  static ComputeType Load(StorageType x) { return CpuBFloat16ToFloat(x); }
+  static StorageType Store(ComputeType x) { return FloatToCpuBFloat16(x); }
+};
+
+constexpr int64_t kWelfordLanes = 8;
+
+int64_t GetRowGrainSize(int64_t norm_size) {
+  constexpr int64_t kMinElemsPerChunk = 32768;
+  return std::max<int64_t>(1, kMinElemsPerChunk / std::max<int64_t>(1, norm_size));
+}
+
 template<typename T>
+void WelfordCombine(T b_mean, T b_m2, T b_count, T* mean, T* m2, T* count) {
+  if (b_count == 0) { return; }
+  const T new_count = *count + b_count;
+  const T nb_over_n = b_count / new_count;
+  const T delta = b_mean - *mean;
+  *mean += delta * nb_over_n;
+  *m2 += b_m2 + delta * delta * (*count) * nb_over_n;
+  *count = new_count;
+}
+
+// One-pass Welford mean/variance of a row. kWelfordLanes independent accumulators run over
+// interleaved columns with fixed bounds so that the update vectorizes, and are merged at the end.
+template<typename Traits>
+void WelfordRow(const typename Traits::StorageType* x, int64_t norm_size,
+                typename Traits::ComputeType* mean, typename Traits::ComputeType* variance) {
+  using ComputeType = typename Traits::ComputeType;
+  ComputeType lane_mean[kWelfordLanes] = {0};
+  ComputeType lane_m2[kWelfordLanes] = {0};
+  const int64_t num_packs = norm_size / kWelfordLanes;
+  for (int64_t pack = 0; pack < num_packs; ++pack) {
+    const ComputeType inv_count = static_cast<ComputeType>(1) / static_cast<ComputeType>(pack + 1);
+    const typename Traits::StorageType* pack_x = x + pack * kWelfordLanes;
+    for (int64_t lane = 0; lane < kWelfordLanes; ++lane) {
+      const ComputeType val = Traits::Load(pack_x[lane]);
+      const ComputeType delta = val - lane_mean[lane];
+      lane_mean[lane] += delta * inv_count;
+      lane_m2[lane] += delta * (val - lane_mean[lane]);
+    }
+  }
+  ComputeType row_mean = 0;
+  ComputeType row_m2 = 0;
+  ComputeType row_count = 0;
+  for (int64_t lane = 0; lane < kWelfordLanes; ++lane) {
+    WelfordCombine<ComputeType>(lane_mean[lane], lane_m2[lane], static_cast<ComputeType>(num_packs),
+                                &row_mean, &row_m2, &row_count);
+  }
+  for (int64_t col = num_packs * kWelfordLanes; col < norm_size; ++col) {
+    WelfordCombine<ComputeType>(Traits::Load(x[col]), 0, 1, &row_mean, &row_m2, &row_count);
+  }
+  *mean = row_mean;
+  *variance = row_m2 / static_cast<ComputeType>(norm_size);
+}
+
+template<typename Traits, bool do_scale, bool do_center>
+void LayerNormForwardCpu(ep::Stream* stream, const int64_t num_instances, const int64_t norm_size,
+                         const double epsilon, const typename Traits::StorageType* x_ptr,
+                         const typename Traits::StorageType* gamma_ptr,
+                         const typename Traits::StorageType* beta_ptr,
+                         typename Traits::StorageType* y_ptr,
+                         typename Traits::ComputeType* mean_ptr,
+                         typename Traits::ComputeType* inv_variance_ptr) {
+  using ComputeType = typename Traits::ComputeType;
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_instances,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          const typename Traits::StorageType* row_x = x_ptr + row * norm_size;
+          typename Traits::StorageType* row_y = y_ptr + row * norm_size;
+          ComputeType row_mean;
+          ComputeType row_variance;
+          WelfordRow<Traits>(row_x, norm_size, &row_mean, &row_variance);
+          const ComputeType row_inv_variance =
+              static_cast<ComputeType>(1)
+              / std::sqrt(row_variance + static_cast<ComputeType>(epsilon));
+          mean_ptr[row] = row_mean;
+          inv_variance_ptr[row] = row_inv_variance;
+          for (int64_t col = 0; col < norm_size; ++col) {
+            ComputeType y = (Traits::Load(row_x[col]) - row_mean) * row_inv_variance;
+            if (do_scale) { y *= Traits::Load(gamma_ptr[col]); }
+            if (do_center) { y += Traits::Load(beta_ptr[col]); }
+            row_y[col] = Traits::Store(y);
+          }
+        }
+      },
+      GetRowGrainSize(norm_size));
+}
+
+template<typename Traits>
+void DispatchLayerNormForwardCpu(ep::Stream* stream, const int64_t num_instances,
+                                 const int64_t norm_size, const double epsilon,
+                                 const typename Traits::StorageType* x_ptr,
+                                 const typename Traits::StorageType* gamma_ptr,
+                                 const typename Traits::StorageType* beta_ptr,
+                                 typename Traits::StorageType* y_ptr,
+                                 typename Traits::ComputeType* mean_ptr,
+                                 typename Traits::ComputeType* inv_variance_ptr) {
+  if (gamma_ptr != nullptr && beta_ptr != nullptr) {
+    LayerNormForwardCpu<Traits, true, true>(stream, num_instances, norm_size, epsilon, x_ptr,
+                                            gamma_ptr, beta_ptr, y_ptr, mean_ptr,
+                                            inv_variance_ptr);
+  } else if (gamma_ptr != nullptr && beta_ptr == nullptr) {
+    LayerNormForwardCpu<Traits, true, false>(stream, num_instances, norm_size, epsilon, x_ptr,
+                                             gamma_ptr, beta_ptr, y_ptr, mean_ptr,
+                                             inv_variance_ptr);
+  } else if (gamma_ptr == nullptr && beta_ptr != nullptr) {
+    LayerNormForwardCpu<Traits, false, true>(stream, num_instances, norm_size, epsilon, x_ptr,
+                                             gamma_ptr, beta_ptr, y_ptr, mean_ptr,
+                                             inv_variance_ptr);
+  } else {
+    LayerNormForwardCpu<Traits, false, false>(stream, num_instances, norm_size, epsilon, x_ptr,
+                                              gamma_ptr, beta_ptr, y_ptr, mean_ptr,
+                                              inv_variance_ptr);
+  }
+}
+
+// dx = inv_variance * (dy * gamma - mean(dy * gamma) - x_hat * mean(dy * gamma * x_hat))
+template<typename Traits, bool do_scale, bool do_add>
+void LayerNormBackwardCpu(ep::Stream* stream, const int64_t num_instances, const int64_t norm_size,
+                          const typename Traits::StorageType* dy_ptr,
+                          const typename Traits::StorageType* x_ptr,
+                          const typename Traits::ComputeType* mean_ptr,
+                          const typename Traits::ComputeType* inv_variance_ptr,
+                          const typename Traits::StorageType* gamma_ptr,
+                          const typename Traits::StorageType* add_to_output_ptr,
+                          typename Traits::StorageType* dx_ptr) {
+  using ComputeType = typename Traits::ComputeType;
+  const ComputeType inv_norm_size = static_cast<ComputeType>(1) / norm_size;
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_instances,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          const int64_t offset = row * norm_size;
+          const typename Traits::StorageType* row_dy = dy_ptr + offset;
+          const typename Traits::StorageType* row_x = x_ptr + offset;
+          typename Traits::StorageType* row_dx = dx_ptr + offset;
+          const ComputeType row_mean = mean_ptr[row];
+          const ComputeType row_inv_variance = inv_variance_ptr[row];
+          ComputeType sum_dy_gamma = 0;
+          ComputeType sum_dy_gamma_x_hat = 0;
+          for (int64_t col = 0; col < norm_size; ++col) {
+            ComputeType dy_gamma = Traits::Load(row_dy[col]);
+            if (do_scale) { dy_gamma *= Traits::Load(gamma_ptr[col]); }
+            const ComputeType x_hat = (Traits::Load(row_x[col]) - row_mean) * row_inv_variance;
+            sum_dy_gamma += dy_gamma;
+            sum_dy_gamma_x_hat += dy_gamma * x_hat;
+          }
+          const ComputeType mean_dy_gamma = sum_dy_gamma * inv_norm_size;
+          const ComputeType mean_dy_gamma_x_hat = sum_dy_gamma_x_hat * inv_norm_size;
+          for (int64_t col = 0; col < norm_size; ++col) {
+            ComputeType dy_gamma = Traits::Load(row_dy[col]);
+            if (do_scale) { dy_gamma *= Traits::Load(gamma_ptr[col]); }
+            const ComputeType x_hat = (Traits::Load(row_x[col]) - row_mean) * row_inv_variance;
+            ComputeType dx =
+                row_inv_variance * (dy_gamma - mean_dy_gamma - x_hat * mean_dy_gamma_x_hat);
+            if (do_add) { dx += Traits::Load(add_to_output_ptr[offset + col]); }
+            row_dx[col] = Traits::Store(dx);
+          }
+        }
+      },
+      GetRowGrainSize(norm_size));
+}
+
+template<typename Traits, bool do_scale>
+void DispatchLayerNormBackwardDoAdd(ep::Stream* stream, const int64_t num_instances,
+                                    const int64_t norm_size,
+                                    const typename Traits::StorageType* dy_ptr,
+                                    const typename Traits::StorageType* x_ptr,
+                                    const typename Traits::ComputeType* mean_ptr,
+                                    const typename Traits::ComputeType* inv_variance_ptr,
+                                    const typename Traits::StorageType* gamma_ptr,
+                                    const typename Traits::StorageType* add_to_output_ptr,
+                                    typename Traits::StorageType* dx_ptr) {
+  if (add_to_output_ptr != nullptr) {
+    LayerNormBackwardCpu<Traits, do_scale, true>(stream, num_instances, norm_size, dy_ptr, x_ptr,
+                                                 mean_ptr, inv_variance_ptr, gamma_ptr,
+                                                 add_to_output_ptr, dx_ptr);
+  } else {
+    LayerNormBackwardCpu<Traits, do_scale, false>(stream, num_instances, norm_size, dy_ptr, x_ptr,
+                                                  mean_ptr, inv_variance_ptr, gamma_ptr,
+                                                  add_to_output_ptr, dx_ptr);
+  }
+}
+
+template<typename Traits>
+void LaunchLayerNormBackwardCpu(ep::Stream* stream, const int64_t num_instances,
+                                const int64_t norm_size,
+                                const typename Traits::StorageType* dy_ptr,
+                                const typename Traits::StorageType* x_ptr,
+                                const typename Traits::ComputeType* mean_ptr,
+                                const typename Traits::ComputeType* inv_variance_ptr,
+                                const typename Traits::StorageType* gamma_ptr,
+                                const typename Traits::StorageType* add_to_output_ptr,
+                                typename Traits::StorageType* dx_ptr) {
+  if (gamma_ptr != nullptr) {
+    DispatchLayerNormBackwardDoAdd<Traits, true>(stream, num_instances, norm_size, dy_ptr, x_ptr,
+                                                 mean_ptr, inv_variance_ptr, gamma_ptr,
+                                                 add_to_output_ptr, dx_ptr);
+  } else {
+    DispatchLayerNormBackwardDoAdd<Traits, false>(stream, num_instances, norm_size, dy_ptr, x_ptr,
+                                                  mean_ptr, inv_variance_ptr, gamma_ptr,
+                                                  add_to_output_ptr, dx_ptr);
+  }
+}
+
+// gamma_diff = sum(dy * x_hat) and beta_diff = sum(dy) over rows. Rows are split into one chunk
+// per thread, every chunk accumulates its partial sums into its own slice of a buffer and the
+// partials are then reduced in parallel over columns.
+template<typename Traits>
+void LayerNormParamGradCpu(ep::Stream* stream, const int64_t num_instances,
+                           const int64_t norm_size, const typename Traits::StorageType* dy_ptr,
+                           const typename Traits::StorageType* x_ptr,
+                           const typename Traits::ComputeType* mean_ptr,
+                           const typename Traits::ComputeType* inv_variance_ptr,
+                           typename Traits::StorageType* gamma_diff_ptr,
+                           typename Traits::StorageType* beta_diff_ptr) {
+  using ComputeType = typename Traits::ComputeType;
+  ep::CpuStream* cpu_stream = stream->As<ep::CpuStream>();
+  const int64_t row_grain_size = GetRowGrainSize(norm_size);
+  const int64_t num_chunks = std::max<int64_t>(
+      1, std::min<int64_t>(cpu_stream->device()->GetNumThreads(),
+                           (num_instances + row_grain_size - 1) / row_grain_size));
+  const int64_t rows_per_chunk = (num_instances + num_chunks - 1) / num_chunks;
+  std::vector<ComputeType> partial_gamma_diff(num_chunks * norm_size, 0);
+  std::vector<ComputeType> partial_beta_diff(num_chunks * norm_size, 0);
+  cpu_stream->ParallelFor(
+      0, num_chunks,
+      [&](int64_t chunk_begin, int64_t chunk_end) {
+        for (int64_t chunk = chunk_begin; chunk < chunk_end; ++chunk) {
+          ComputeType* chunk_gamma_diff = partial_gamma_diff.data() + chunk * norm_size;
+          ComputeType* chunk_beta_diff = partial_beta_diff.data() + chunk * norm_size;
+          const int64_t row_end = std::min(num_instances, (chunk + 1) * rows_per_chunk);
+          for (int64_t row = chunk * rows_per_chunk; row < row_end; ++row) {
+            const typename Traits::StorageType* row_dy = dy_ptr + row * norm_size;
+            const typename Traits::StorageType* row_x = x_ptr + row * norm_size;
+            const ComputeType row_mean = mean_ptr[row];
+            const ComputeType row_inv_variance = inv_variance_ptr[row];
+            for (int64_t col = 0; col < norm_size; ++col) {
+              const ComputeType dy = Traits::Load(row_dy[col]);
+              const ComputeType x_hat = (Traits::Load(row_x[col]) - row_mean) * row_inv_variance;
+              chunk_gamma_diff[col] += dy * x_hat;
+              chunk_beta_diff[col] += dy;
+            }
+          }
+        }
+      },
+      1);
+  cpu_stream->ParallelFor(
+      0, norm_size,
+      [&](int64_t col_begin, int64_t col_end) {
+        for (int64_t col = col_begin; col < col_end; ++col) {
+          ComputeType gamma_diff = 0;
+          ComputeType beta_diff = 0;
+          for (int64_t chunk = 0; chunk < num_chunks; ++chunk) {
+            gamma_diff += partial_gamma_diff[chunk * norm_size + col];
+            beta_diff += partial_beta_diff[chunk * norm_size + col];
+          }
+          if (gamma_diff_ptr != nullptr) { gamma_diff_ptr[col] = Traits::Store(gamma_diff); }
+          if (beta_diff_ptr != nullptr) { beta_diff_ptr[col] = Traits::Store(beta_diff); }
+        }
+      },
+      std::max<int64_t>(1, 32768 / num_chunks));
+}
+
+}  // namespace
+
+template<typename Traits>
 class LayerNormCpuKernel final : public user_op::OpKernel {
  public:
   LayerNormCpuKernel() = default;
   ~LayerNormCpuKernel() = default;
 
  private:
+  using user_op::OpKernel::Compute;
+  using T = typename Traits::StorageType;
+  using ComputeType = typename Traits::ComputeType;
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    const double epsilon = ctx->Attr<double>("epsilon");
+    const int64_t num_instances = mean->shape().elem_cnt();
+    const int64_t norm_size = x->shape().elem_cnt() / num_instances;
+    const T* gamma_ptr = nullptr;
+    const T* beta_ptr = nullptr;
+    if (ctx->has_input("gamma", 0)) {
+      const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+      gamma_ptr = reinterpret_cast<const T*>(gamma->dptr());
+      CHECK_EQ(gamma->shape().elem_cnt(), norm_size);
+    }
+    if (ctx->has_input("beta", 0)) {
+      const user_op::Tensor* beta = ctx->Tensor4ArgNameAndIndex("beta", 0);
+      beta_ptr = reinterpret_cast<const T*>(beta->dptr());
+      CHECK_EQ(beta->shape().elem_cnt(), norm_size);
+    }
+    DispatchLayerNormForwardCpu<Traits>(
+        ctx->stream(), num_instances, norm_size, epsilon, reinterpret_cast<const T*>(x->dptr()),
+        gamma_ptr, beta_ptr, reinterpret_cast<T*>(y->mut_dptr()),
+        mean->mut_dptr<ComputeType>(), inv_variance->mut_dptr<ComputeType>());
+  };
 };
 
-#define REGISTER_LAYER_NORM_CPU_KERNEL(dtype)                         \
+#define REGISTER_LAYER_NORM_CPU_KERNEL(traits, data_type)             \
   REGISTER_USER_KERNEL("layer_norm")                                  \
-      .SetCreateFn<LayerNormCpuKernel<dtype>>()                       \
+      .SetCreateFn<LayerNormCpuKernel<traits>>()                      \
       .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
-                       && (user_op::HobDataType("x", 0) == GetDataType<dtype>::value));
+                       && (user_op::HobDataType("x", 0) == data_type));
 
-REGISTER_LAYER_NORM_CPU_KERNEL(float)
-REGISTER_LAYER_NORM_CPU_KERNEL(double)
+REGISTER_LAYER_NORM_CPU_KERNEL(LayerNormCpuTraits<float>, DataType::kFloat)
+REGISTER_LAYER_NORM_CPU_KERNEL(LayerNormCpuTraits<double>, DataType::kDouble)
+REGISTER_LAYER_NORM_CPU_KERNEL(LayerNormCpuBFloat16Traits, DataType::kBFloat16)
 
-template<typename T>
+template<typename Traits>
 class LayerNormGradCpuKernel final : public user_op::OpKernel {
  public:
   LayerNormGradCpuKernel() = default;
   ~LayerNormGradCpuKernel() = default;
 
  private:
+  using user_op::OpKernel::Compute;
+  using T = typename Traits::StorageType;
+  using ComputeType = typename Traits::ComputeType;
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const int64_t num_instances = mean->shape().elem_cnt();
+    const int64_t norm_size = x->shape().elem_cnt() / num_instances;
+    const T* gamma_ptr = nullptr;
+    if (ctx->has_input("gamma", 0)) {
+      gamma_ptr = reinterpret_cast<const T*>(ctx->Tensor4ArgNameAndIndex("gamma", 0)->dptr());
+    }
+    const T* add_to_output_ptr = nullptr;
+    if (ctx->has_input("_add_to_output", 0)) {
+      const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
+      CHECK_EQ(add_to_output->data_type(), dx->data_type());
+      CHECK_EQ(add_to_output->shape(), dx->shape());
+      add_to_output_ptr = reinterpret_cast<const T*>(add_to_output->dptr());
+    }
+    LaunchLayerNormBackwardCpu<Traits>(
+        ctx->stream(), num_instances, norm_size, reinterpret_cast<const T*>(dy->dptr()),
+        reinterpret_cast<const T*>(x->dptr()), mean->dptr<ComputeType>(),
+        inv_variance->dptr<ComputeType>(), gamma_ptr, add_to_output_ptr,
+        reinterpret_cast<T*>(dx->mut_dptr()));
+  };
 };
 
-#define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(dtype)                    \
-  REGISTER_USER_KERNEL("layer_norm_grad")                             \
-      .SetCreateFn<LayerNormGradCpuKernel<dtype>>()                   \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
-                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value));
+#define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(traits, data_type)                             \
+  REGISTER_USER_KERNEL("layer_norm_grad")                                                  \
+      .SetCreateFn<LayerNormGradCpuKernel<traits>>()                                       \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                      \
+                       && (user_op::HobDataType("dy", 0) == data_type))                    \
+      .SetInplaceProposalFn(                                                               \
+          [](const user_op::InferContext& ctx,                                             \
+             const user_op::AddInplaceArgPair& AddInplaceArgPairFn) -> Maybe<void> {       \
+            if (ctx.has_input("_add_to_output", 0)) {                                      \
+              OF_RETURN_IF_ERROR(AddInplaceArgPairFn("dx", 0, "_add_to_output", 0, true)); \
+            }                                                                              \
+            return Maybe<void>::Ok();                                                      \
+          });
 
-REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(float)
-REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(double)
+REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(LayerNormCpuTraits<float>, DataType::kFloat)
+REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(LayerNormCpuTraits<double>, DataType::kDouble)
+REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(LayerNormCpuBFloat16Traits, DataType::kBFloat16)
 
-template<typename T>
+template<typename Traits>
 class LayerNormParamGradCpuKernel final : public user_op::OpKernel {
  public:
   LayerNormParamGradCpuKernel() = default;
   ~LayerNormParamGradCpuKernel() = default;
 
  private:
+  using user_op::OpKernel::Compute;
+  using T = typename Traits::StorageType;
+  using ComputeType = typename Traits::ComputeType;
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    const int64_t num_instances = mean->shape().elem_cnt();
+    const int64_t norm_size = x->shape().elem_cnt() / num_instances;
+    T* gamma_diff_ptr = nullptr;
+    T* beta_diff_ptr = nullptr;
+    if (ctx->has_output("gamma_diff", 0)) {
+      user_op::Tensor* gamma_diff = ctx->Tensor4ArgNameAndIndex("gamma_diff", 0);
+      gamma_diff_ptr = reinterpret_cast<T*>(gamma_diff->mut_dptr());
+    }
+    if (ctx->has_output("beta_diff", 0)) {
+      user_op::Tensor* beta_diff = ctx->Tensor4ArgNameAndIndex("beta_diff", 0);
+      beta_diff_ptr = reinterpret_cast<T*>(beta_diff->mut_dptr());
+    }
+    LayerNormParamGradCpu<Traits>(ctx->stream(), num_instances, norm_size,
+                                  reinterpret_cast<const T*>(dy->dptr()),
+                                  reinterpret_cast<const T*>(x->dptr()), mean->dptr<ComputeType>(),
+                                  inv_variance->dptr<ComputeType>(), gamma_diff_ptr, beta_diff_ptr);
+  };
 };
 
-#define REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(dtype)              \
+#define REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(traits, data_type)  \
   REGISTER_USER_KERNEL("layer_norm_param_grad")                       \
-      .SetCreateFn<LayerNormParamGradCpuKernel<dtype>>()              \
+      .SetCreateFn<LayerNormParamGradCpuKernel<traits>>()             \
       .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
-                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value));
+                       && (user_op::HobDataType("dy", 0) == data_type));
 
-REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(float)
-REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(double)
+REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(LayerNormCpuTraits<float>, DataType::kFloat)
+REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(LayerNormCpuTraits<double>, DataType::kDouble)
+REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(LayerNormCpuBFloat16Traits, DataType::kBFloat16)
 
 }  // namespace oneflow
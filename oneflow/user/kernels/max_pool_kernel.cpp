@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/kernels/max_pool_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
@@ -42,57 +43,301 @@ std::shared_ptr<PoolOpKernelCache> CreatePoolOpKernelCache(user_op::KernelCacheC
 
 namespace {
 
-template<typename T, typename IDX>
-void Maxpool2dForwardComputeCLast(const NdIndexOffsetHelper<IDX, 4>& index_helper, IDX elem_num,
-                                  const T* src, T* dest, int64_t* indice_ptr,
-                                  const int32_t padding_h, const int32_t padding_w,
-                                  const int32_t n_batch, const int32_t n_channel,
-                                  const int32_t x_height, const int32_t x_width,
-                                  const int32_t y_height, const int32_t y_width,
-                                  const int32_t kernel_size_h, const int32_t kernel_size_w,
-                                  const int32_t stride_h, const int32_t stride_w,
-                                  const int32_t dilation_h, const int32_t dilation_w) {
-  IDX n = 0, h = 0, w = 0, c = 0;
-  for (IDX num = 0; num < elem_num; ++num) {
-    index_helper.OffsetToNdIndex(num, n, h, w, c);
-
-    const IDX x_start_idx = n * x_height * x_width * n_channel;
-    const IDX y_start_idx = n * y_height * y_width * n_channel;
-    IDX hstart = h * stride_h - padding_h;
-    IDX wstart = w * stride_w - padding_w;
-    const IDX hend = (hstart + (kernel_size_h - 1) * dilation_h + 1) <= x_height
-                         ? (hstart + (kernel_size_h - 1) * dilation_h + 1)
-                         : x_height;
-    const IDX wend = (wstart + (kernel_size_w - 1) * dilation_w + 1) <= x_width
-                         ? (wstart + (kernel_size_w - 1) * dilation_w + 1)
-                         : x_width;
-
-    while (hstart < 0) { hstart += dilation_h; }
-    while (wstart < 0) { wstart += dilation_w; }
-    /* compute max value(src[src_idx]) in kernel box region, and save the value to dest[num] */
-    IDX max_index = hstart * x_width + wstart;
-    IDX src_idx = 0;
-    /* equal to -std::numeric_limits<T>::infinity(); */
-    T max_value = detail::numeric_limits<T>::lower_bound();
-
-    for (IDX i = hstart; i < hend; i += dilation_h) {
-      for (IDX j = wstart; j < wend; j += dilation_w) {
-        const IDX window_idx = i * x_width * n_channel + j * n_channel + c;
-        const IDX search_idx = x_start_idx + window_idx;
-        T val = src[search_idx];
-        if (val > max_value || detail::numerics<T>::isnan(val)) {
-          max_value = val;
-          max_index = window_idx;
-          src_idx = search_idx;
+constexpr int64_t kMinElemsPerChunk = 32768;
+// Windows at least this wide along the innermost axis (with unit dilation) are reduced with the
+// van Herk/Gil-Werman algorithm, whose cost per output does not depend on the window size.
+constexpr int32_t kSlidingWindowMinKernelSize = 5;
+
+struct PoolWindow {
+  int64_t x_size;
+  int64_t y_size;
+  int32_t kernel_size;
+  int32_t stride;
+  int32_t padding;
+  int32_t dilation;
+
+  // Same window bounds as the device kernels: [*start, *end) stepping by dilation.
+  void Get(int64_t out, int64_t* start, int64_t* end) const {
+    int64_t begin = out * stride - padding;
+    *end = std::min<int64_t>(begin + (kernel_size - 1) * dilation + 1, x_size);
+    while (begin < 0) { begin += dilation; }
+    *start = begin;
+  }
+};
+
+PoolWindow GetPoolWindow(const MaxPoolParams3D& params_3d, int32_t axis) {
+  PoolWindow window;
+  window.x_size = params_3d.GetXShape5D().At(2 + axis);
+  window.y_size = params_3d.GetYShape5D().At(2 + axis);
+  window.kernel_size = params_3d.pool_size_3d().at(axis);
+  window.stride = params_3d.stride_3d().at(axis);
+  window.padding = params_3d.padding().at(axis);
+  window.dilation = params_3d.dilation_3d().at(axis);
+  return window;
+}
+
+// Folds a later element into the running maximum. NaN always wins and the first of equal values
+// is kept, so the result only depends on the set of elements and not on how they are grouped.
+template<typename T, typename I>
+inline void UpdateMax(T val, I index, T* max_value, I* max_index) {
+  if (val > *max_value || detail::numerics<T>::isnan(val)) {
+    *max_value = val;
+    *max_index = index;
+  }
+}
+
+template<typename T>
+void MaxPoolForwardCFirstDirect(ep::Stream* stream, const T* src, T* dest, int64_t* indice_ptr,
+                                int64_t num_planes, const PoolWindow& wt, const PoolWindow& wh,
+                                const PoolWindow& ww) {
+  const int64_t x_plane_size = wt.x_size * wh.x_size * ww.x_size;
+  const int64_t num_rows = num_planes * wt.y_size * wh.y_size;
+  const int64_t work_per_row =
+      ww.y_size * wt.kernel_size * wh.kernel_size * static_cast<int64_t>(ww.kernel_size);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_rows,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          const int64_t plane = row / (wt.y_size * wh.y_size);
+          const int64_t t = row / wh.y_size % wt.y_size;
+          const int64_t h = row % wh.y_size;
+          int64_t tstart = 0, tend = 0, hstart = 0, hend = 0;
+          wt.Get(t, &tstart, &tend);
+          wh.Get(h, &hstart, &hend);
+          const T* x = src + plane * x_plane_size;
+          T* y = dest + row * ww.y_size;
+          int64_t* indice = indice_ptr + row * ww.y_size;
+          for (int64_t w = 0; w < ww.y_size; ++w) {
+            int64_t wstart = 0, wend = 0;
+            ww.Get(w, &wstart, &wend);
+            T max_value = detail::numeric_limits<T>::lower_bound();
+            int64_t max_index = (tstart * wh.x_size + hstart) * ww.x_size + wstart;
+            for (int64_t zi = tstart; zi < tend; zi += wt.dilation) {
+              for (int64_t i = hstart; i < hend; i += wh.dilation) {
+                const int64_t offset = (zi * wh.x_size + i) * ww.x_size;
+                const T* x_row = x + offset;
+                for (int64_t j = wstart; j < wend; j += ww.dilation) {
+                  UpdateMax(x_row[j], offset + j, &max_value, &max_index);
+                }
+              }
+            }
+            y[w] = max_value;
+            indice[w] = max_index;
+          }
         }
-      }
-    }
-    const IDX out_idx = y_start_idx + h * y_width * n_channel + w * n_channel + c;
-    dest[out_idx] = src[src_idx];
-    indice_ptr[out_idx] = max_index;
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / std::max<int64_t>(1, work_per_row)));
+}
+
+// Two passes: window maxima along W for every input row via van Herk/Gil-Werman (prefix and
+// suffix maxima within blocks of kernel_size), then the T/H windows over those partial results.
+template<typename T>
+void MaxPoolForwardCFirstSliding(ep::Stream* stream, const T* src, T* dest, int64_t* indice_ptr,
+                                 int64_t num_planes, const PoolWindow& wt, const PoolWindow& wh,
+                                 const PoolWindow& ww) {
+  const int64_t num_x_rows = num_planes * wt.x_size * wh.x_size;
+  const int64_t k = ww.kernel_size;
+  std::unique_ptr<T[]> row_max(new T[num_x_rows * ww.y_size]);
+  std::unique_ptr<int32_t[]> row_argmax(new int32_t[num_x_rows * ww.y_size]);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_x_rows,
+      [&](int64_t begin, int64_t end) {
+        std::vector<T> prefix(ww.x_size);
+        std::vector<T> suffix(ww.x_size);
+        std::vector<int32_t> prefix_index(ww.x_size);
+        std::vector<int32_t> suffix_index(ww.x_size);
+        for (int64_t row = begin; row < end; ++row) {
+          const T* x = src + row * ww.x_size;
+          for (int32_t j = 0; j < ww.x_size; ++j) {
+            prefix[j] = x[j];
+            prefix_index[j] = j;
+            if (j % k != 0) {
+              prefix[j] = prefix[j - 1];
+              prefix_index[j] = prefix_index[j - 1];
+              UpdateMax(x[j], j, &prefix[j], &prefix_index[j]);
+            }
+          }
+          for (int32_t j = ww.x_size - 1; j >= 0; --j) {
+            suffix[j] = x[j];
+            suffix_index[j] = j;
+            if (j % k != k - 1 && j != ww.x_size - 1) {
+              UpdateMax(suffix[j + 1], suffix_index[j + 1], &suffix[j], &suffix_index[j]);
+            }
+          }
+          T* y = row_max.get() + row * ww.y_size;
+          int32_t* indice = row_argmax.get() + row * ww.y_size;
+          for (int64_t w = 0; w < ww.y_size; ++w) {
+            int64_t wstart = 0, wend = 0;
+            ww.Get(w, &wstart, &wend);
+            T max_value = detail::numeric_limits<T>::lower_bound();
+            int32_t max_index = wstart;
+            if (wend - wstart == k) {
+              max_value = suffix[wstart];
+              max_index = suffix_index[wstart];
+              UpdateMax(prefix[wend - 1], prefix_index[wend - 1], &max_value, &max_index);
+            } else {
+              for (int64_t j = wstart; j < wend; ++j) {
+                UpdateMax(x[j], static_cast<int32_t>(j), &max_value, &max_index);
+              }
+            }
+            y[w] = max_value;
+            indice[w] = max_index;
+          }
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / ww.x_size));
+  const int64_t num_y_rows = num_planes * wt.y_size * wh.y_size;
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_y_rows,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          const int64_t plane = row / (wt.y_size * wh.y_size);
+          const int64_t t = row / wh.y_size % wt.y_size;
+          const int64_t h = row % wh.y_size;
+          int64_t tstart = 0, tend = 0, hstart = 0, hend = 0;
+          wt.Get(t, &tstart, &tend);
+          wh.Get(h, &hstart, &hend);
+          T* y = dest + row * ww.y_size;
+          int64_t* indice = indice_ptr + row * ww.y_size;
+          for (int64_t w = 0; w < ww.y_size; ++w) {
+            int64_t wstart = 0, wend = 0;
+            ww.Get(w, &wstart, &wend);
+            y[w] = detail::numeric_limits<T>::lower_bound();
+            indice[w] = (tstart * wh.x_size + hstart) * ww.x_size + wstart;
+          }
+          for (int64_t zi = tstart; zi < tend; zi += wt.dilation) {
+            for (int64_t i = hstart; i < hend; i += wh.dilation) {
+              const int64_t x_row = (plane * wt.x_size + zi) * wh.x_size + i;
+              const int64_t offset = (zi * wh.x_size + i) * ww.x_size;
+              const T* row_y = row_max.get() + x_row * ww.y_size;
+              const int32_t* row_indice = row_argmax.get() + x_row * ww.y_size;
+              for (int64_t w = 0; w < ww.y_size; ++w) {
+                UpdateMax(row_y[w], offset + row_indice[w], y + w, indice + w);
+              }
+            }
+          }
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk
+                               / std::max<int64_t>(1, ww.y_size * wt.kernel_size
+                                                          * static_cast<int64_t>(wh.kernel_size))));
+}
+
+// Covers 1d, 2d and 3d channels_first pooling: every (n, c) plane is pooled independently and the
+// output rows of all planes are distributed over the threads.
+template<typename T>
+void MaxPoolForwardCFirst(ep::Stream* stream, const T* src, T* dest, int64_t* indice_ptr,
+                          const MaxPoolParams3D& params_3d) {
+  const int64_t num_planes = params_3d.GetXShape5D().Count(0, 2);
+  const PoolWindow wt = GetPoolWindow(params_3d, 0);
+  const PoolWindow wh = GetPoolWindow(params_3d, 1);
+  const PoolWindow ww = GetPoolWindow(params_3d, 2);
+  if (ww.dilation == 1 && ww.kernel_size >= kSlidingWindowMinKernelSize
+      && ww.kernel_size > 2 * ww.stride) {
+    MaxPoolForwardCFirstSliding<T>(stream, src, dest, indice_ptr, num_planes, wt, wh, ww);
+  } else {
+    MaxPoolForwardCFirstDirect<T>(stream, src, dest, indice_ptr, num_planes, wt, wh, ww);
   }
 }
 
+// Indices are relative to the (n, c) plane, so planes own disjoint parts of dx and can be
+// scattered into concurrently without atomics.
+template<typename T>
+void MaxPoolBackwardCFirst(ep::Stream* stream, const T* src, T* dest, const int64_t* indice_ptr,
+                           const MaxPoolParams3D& params_3d) {
+  const int64_t num_planes = params_3d.GetXShape5D().Count(0, 2);
+  const int64_t x_plane_size = params_3d.GetXShape5D().Count(2);
+  const int64_t y_plane_size = params_3d.GetYShape5D().Count(2);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_planes,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t plane = begin; plane < end; ++plane) {
+          const T* dy = src + plane * y_plane_size;
+          const int64_t* indice = indice_ptr + plane * y_plane_size;
+          T* dx = dest + plane * x_plane_size;
+          for (int64_t i = 0; i < y_plane_size; ++i) { dx[indice[i]] += dy[i]; }
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / std::max<int64_t>(1, y_plane_size)));
+}
+
+// channels_last indices are offsets into the (h, w, c) image, i.e. (h * x_width + w) * C + c.
+// Output rows of all images are distributed over the threads and the innermost loop runs over
+// the contiguous channels.
+template<typename T>
+void MaxPool2dForwardCLast(ep::Stream* stream, const T* src, T* dest, int64_t* indice_ptr,
+                           const MaxPoolParams3D& params_3d) {
+  const int64_t num_batch = params_3d.num_batch();
+  const int64_t channels = params_3d.num_channel();
+  const PoolWindow wh = GetPoolWindow(params_3d, 1);
+  const PoolWindow ww = GetPoolWindow(params_3d, 2);
+  const int64_t x_image_size = wh.x_size * ww.x_size * channels;
+  const int64_t work_per_row =
+      ww.y_size * channels * wh.kernel_size * static_cast<int64_t>(ww.kernel_size);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_batch * wh.y_size,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          int64_t hstart = 0, hend = 0;
+          wh.Get(row % wh.y_size, &hstart, &hend);
+          const T* x = src + row / wh.y_size * x_image_size;
+          for (int64_t w = 0; w < ww.y_size; ++w) {
+            int64_t wstart = 0, wend = 0;
+            ww.Get(w, &wstart, &wend);
+            T* y = dest + (row * ww.y_size + w) * channels;
+            int64_t* indice = indice_ptr + (row * ww.y_size + w) * channels;
+            const int64_t start_index = (hstart * ww.x_size + wstart) * channels;
+            for (int64_t c = 0; c < channels; ++c) {
+              y[c] = detail::numeric_limits<T>::lower_bound();
+              indice[c] = start_index + c;
+            }
+            for (int64_t i = hstart; i < hend; i += wh.dilation) {
+              for (int64_t j = wstart; j < wend; j += ww.dilation) {
+                const int64_t offset = (i * ww.x_size + j) * channels;
+                const T* x_pixel = x + offset;
+                for (int64_t c = 0; c < channels; ++c) {
+                  const T val = x_pixel[c];
+                  const bool update = val > y[c] || detail::numerics<T>::isnan(val);
+                  y[c] = update ? val : y[c];
+                  indice[c] = update ? offset + c : indice[c];
+                }
+              }
+            }
+          }
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / std::max<int64_t>(1, work_per_row)));
+}
+
+// An output channel only ever selects inputs of the same channel, so (n, c) lanes own disjoint
+// parts of dx and are scattered into concurrently without atomics.
+template<typename T>
+void MaxPool2dBackwardCLast(ep::Stream* stream, const T* src, T* dest, const int64_t* indice_ptr,
+                            const MaxPoolParams3D& params_3d) {
+  const int64_t num_batch = params_3d.num_batch();
+  const int64_t channels = params_3d.num_channel();
+  const int64_t x_image_size = params_3d.GetXShape5D().Count(1);
+  const int64_t y_spatial_size = params_3d.GetYShape5D().Count(2);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_batch * channels,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t lane = begin; lane < end;) {
+          const int64_t n = lane / channels;
+          const int64_t c_begin = lane % channels;
+          const int64_t c_end = std::min<int64_t>(channels, c_begin + end - lane);
+          const T* dy = src + n * y_spatial_size * channels;
+          const int64_t* indice = indice_ptr + n * y_spatial_size * channels;
+          T* dx = dest + n * x_image_size;
+          for (int64_t i = 0; i < y_spatial_size; ++i) {
+            const int64_t offset = i * channels;
+            for (int64_t c = c_begin; c < c_end; ++c) { dx[indice[offset + c]] += dy[offset + c]; }
+          }
+          lane += c_end - c_begin;
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / std::max<int64_t>(1, y_spatial_size)));
+}
+
 }  // namespace
 
 template<typename T, typename IDX>
@@ -100,86 +345,53 @@ struct PoolKernelUtil<DeviceType::kCPU, T, IDX> {
   static void Maxpool1dForward(ep::Stream* stream, const NdIndexOffsetHelper<IDX, 2>& index_helper,
                                const IDX elem_num, const T* src, T* dest, int64_t* indice_ptr,
                                const MaxPoolParams3D& params_3d) {
-    Maxpool1dForwardCompute<T, IDX>(
-        index_helper, elem_num, src, dest, indice_ptr, params_3d.padding()[2],
-        params_3d.num_batch(), params_3d.num_channel(), params_3d.GetXShape5D().At(4),
-        params_3d.pool_size_3d()[2], params_3d.stride_3d()[2], params_3d.dilation_3d()[2]);
+    MaxPoolForwardCFirst<T>(stream, src, dest, indice_ptr, params_3d);
   }
 
   static void Maxpool1dBackward(ep::Stream* stream, const NdIndexOffsetHelper<IDX, 2>& index_helper,
                                 const IDX elem_num, const T* src, T* dest,
                                 const int64_t* indice_ptr, const MaxPoolParams3D& params_3d) {
-    Maxpool1dBackwardCompute<T, IDX>(index_helper, elem_num, src, dest, indice_ptr,
-                                     params_3d.num_batch(), params_3d.num_channel(),
-                                     params_3d.GetYShape5D().At(4), params_3d.GetXShape5D().At(4));
+    MaxPoolBackwardCFirst<T>(stream, src, dest, indice_ptr, params_3d);
   }
 
   static void Maxpool2dForwardCFirst(ep::Stream* stream,
                                      const NdIndexOffsetHelper<IDX, 3>& index_helper,
                                      const IDX elem_num, const T* src, T* dest, int64_t* indice_ptr,
                                      const MaxPoolParams3D& params_3d) {
-    Maxpool2dForwardComputeCFirst<T, IDX>(
-        index_helper, elem_num, src, dest, indice_ptr, params_3d.padding()[1],
-        params_3d.padding()[2], params_3d.num_batch(), params_3d.num_channel(),
-        params_3d.GetXShape5D().At(3), params_3d.GetXShape5D().At(4), params_3d.pool_size_3d()[1],
-        params_3d.pool_size_3d()[2], params_3d.stride_3d()[1], params_3d.stride_3d()[2],
-        params_3d.dilation_3d()[1], params_3d.dilation_3d()[2]);
+    MaxPoolForwardCFirst<T>(stream, src, dest, indice_ptr, params_3d);
   }
 
   static void Maxpool2dBackwardCFirst(ep::Stream* stream,
                                       const NdIndexOffsetHelper<IDX, 3>& index_helper,
                                       const IDX elem_num, const T* src, T* dest,
                                       const int64_t* indice_ptr, const MaxPoolParams3D& params_3d) {
-    Maxpool2dBackwardComputeCFirst<T, IDX>(
-        index_helper, elem_num, src, dest, indice_ptr, params_3d.num_batch(),
-        params_3d.num_channel(), params_3d.GetYShape5D().At(3), params_3d.GetYShape5D().At(4),
-        params_3d.GetXShape5D().At(3), params_3d.GetXShape5D().At(4));
+    MaxPoolBackwardCFirst<T>(stream, src, dest, indice_ptr, params_3d);
   }
 
   static void Maxpool2dForwardCLast(ep::Stream* stream,
                                     const NdIndexOffsetHelper<IDX, 4>& index_helper,
                                     const IDX elem_num, const T* src, T* dest, int64_t* indice_ptr,
                                     const MaxPoolParams3D& params_3d) {
-    Maxpool2dForwardComputeCLast<T, IDX>(
-        index_helper, elem_num, src, dest, indice_ptr, params_3d.padding()[1],
-        params_3d.padding()[2], params_3d.num_batch(), params_3d.num_channel(),
-        params_3d.GetXShape5D().At(3), params_3d.GetXShape5D().At(4), params_3d.GetYShape5D().At(3),
-        params_3d.GetYShape5D().At(4), params_3d.pool_size_3d()[1], params_3d.pool_size_3d()[2],
-        params_3d.stride_3d()[1], params_3d.stride_3d()[2], params_3d.dilation_3d()[1],
-        params_3d.dilation_3d()[2]);
+    MaxPool2dForwardCLast<T>(stream, src, dest, indice_ptr, params_3d);
   }
 
   static void Maxpool2dBackwardCLast(ep::Stream* stream,
                                      const NdIndexOffsetHelper<IDX, 4>& index_helper,
                                      const IDX elem_num, const T* src, T* dest,
                                      const int64_t* indice_ptr, const MaxPoolParams3D& params_3d) {
-    Maxpool2dBackwardComputeCLast<T, IDX>(
-        index_helper, elem_num, src, dest, indice_ptr, params_3d.num_batch(),
-        params_3d.num_channel(), params_3d.GetYShape5D().At(3), params_3d.GetYShape5D().At(4),
-        params_3d.GetXShape5D().At(3), params_3d.GetXShape5D().At(4));
+    MaxPool2dBackwardCLast<T>(stream, src, dest, indice_ptr, params_3d);
   }
 
   static void Maxpool3dForward(ep::Stream* stream, const NdIndexOffsetHelper<IDX, 4>& index_helper,
                                const IDX elem_num, const T* src, T* dest, int64_t* indice_ptr,
                                const MaxPoolParams3D& params_3d) {
-    Maxpool3dForwardCompute<T, IDX>(
-        index_helper, elem_num, src, dest, indice_ptr, params_3d.padding()[0],
-        params_3d.padding()[1], params_3d.padding()[2], params_3d.num_batch(),
-        params_3d.num_channel(), params_3d.GetXShape5D().At(2), params_3d.GetXShape5D().At(3),
-        params_3d.GetXShape5D().At(4), params_3d.pool_size_3d()[0], params_3d.pool_size_3d()[1],
-        params_3d.pool_size_3d()[2], params_3d.stride_3d()[0], params_3d.stride_3d()[1],
-        params_3d.stride_3d()[2], params_3d.dilation_3d()[0], params_3d.dilation_3d()[1],
-        params_3d.dilation_3d()[2]);
+    MaxPoolForwardCFirst<T>(stream, src, dest, indice_ptr, params_3d);
   }
 
-  static void Maxpool3dBackward(ep::Stream* stream, const NdIndexOffsetHelper<IDX, 4> index_helper,
+  static void Maxpool3dBackward(ep::Stream* stream, const NdIndexOffsetHelper<IDX, 4>& index_helper,
                                 const IDX elem_num, const T* src, T* dest,
                                 const int64_t* indice_ptr, const MaxPoolParams3D& params_3d) {
-    Maxpool3dBackwardCompute<T, IDX>(index_helper, elem_num, src, dest, indice_ptr,
-                                     params_3d.num_batch(), params_3d.num_channel(),
-                                     params_3d.GetYShape5D().At(2), params_3d.GetYShape5D().At(3),
-                                     params_3d.GetYShape5D().At(4), params_3d.GetXShape5D().At(2),
-                                     params_3d.GetXShape5D().At(3), params_3d.GetXShape5D().At(4));
+    MaxPoolBackwardCFirst<T>(stream, src, dest, indice_ptr, params_3d);
   }
 };
 
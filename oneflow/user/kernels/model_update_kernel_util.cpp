@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/user/kernels/model_update_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
@@ -38,6 +39,59 @@ void SumSquares2(int64_t n, const T* src0, T* dst0, const T* src1, T* dst1) {
   *dst1 += cblas_dot<T>(n, src1, 1, src1, 1);
 }
 
+constexpr int64_t kMinElemsPerChunk = 32768;
+
+struct TensorChunk {
+  int64_t tensor;
+  int64_t offset;
+  int64_t size;
+};
+
+// Cuts the concatenation of all tensors into chunks which never cross a tensor boundary and packs
+// consecutive chunks into blocks of kMinElemsPerChunk elements, so that many small tensors share
+// a block and a large tensor is spread over several. The split only depends on the sizes, per
+// chunk partial results are thus independent of the number of threads.
+class MultiTensorChunks final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MultiTensorChunks);
+  MultiTensorChunks(int64_t n_tensor, const int64_t* sizes) : block_begins_{0} {
+    int64_t block_size = 0;
+    FOR_RANGE(int64_t, tensor, 0, n_tensor) {
+      int64_t offset = 0;
+      while (offset < sizes[tensor]) {
+        const int64_t size = std::min(sizes[tensor] - offset, kMinElemsPerChunk - block_size);
+        chunks_.push_back(TensorChunk{tensor, offset, size});
+        offset += size;
+        block_size += size;
+        if (block_size == kMinElemsPerChunk) {
+          block_begins_.push_back(chunks_.size());
+          block_size = 0;
+        }
+      }
+    }
+    if (block_size > 0) { block_begins_.push_back(chunks_.size()); }
+  }
+  ~MultiTensorChunks() = default;
+
+  int64_t num_chunks() const { return chunks_.size(); }
+  const TensorChunk& chunk(int64_t i) const { return chunks_.at(i); }
+
+  // Calls fn(chunk_id, chunk) for every chunk, whole blocks are distributed over the threads.
+  template<typename F>
+  void ParallelForEach(ep::Stream* stream, const F& fn) const {
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, block_begins_.size() - 1,
+        [&](int64_t begin, int64_t end) {
+          FOR_RANGE(int64_t, i, block_begins_[begin], block_begins_[end]) { fn(i, chunks_[i]); }
+        },
+        1);
+  }
+
+ private:
+  std::vector<TensorChunk> chunks_;
+  std::vector<int64_t> block_begins_;
+};
+
 }  // namespace
 
 template<typename T, typename G>
@@ -312,6 +366,154 @@ void LambUpdateKernelUtil<DeviceType::kCPU, T, G>::Update(
 template struct LambUpdateKernelUtil<DeviceType::kCPU, float, float>;
 template struct LambUpdateKernelUtil<DeviceType::kCPU, double, double>;
 
+template<typename T, typename G>
+struct MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, T, G> {
+  static void Update(ep::Stream* stream, int64_t n_tensor, const int64_t* sizes, T scale, float l1,
+                     float l2, float weight_decay, float learning_rate_val,
+                     const float* learning_rate, const T* scale_by_ptr, const int64_t* skip_if,
+                     const G* const* model_diff, T* const* model);
+};
+
+template<typename T, typename G>
+void MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, T, G>::Update(
+    ep::Stream* stream, int64_t n_tensor, const int64_t* sizes, T scale, float l1, float l2,
+    float weight_decay, float learning_rate_val, const float* learning_rate,
+    const T* scale_by_ptr, const int64_t* skip_if, const G* const* model_diff, T* const* model) {
+  if (skip_if != nullptr && *skip_if != 0) { return; }
+  if (learning_rate != nullptr) { learning_rate_val = *learning_rate; }
+  if (scale_by_ptr != nullptr) { scale *= *scale_by_ptr; }
+  MultiTensorChunks chunks(n_tensor, sizes);
+  chunks.ParallelForEach(stream, [&](int64_t chunk_id, const TensorChunk& chunk) {
+    const G* chunk_model_diff = model_diff[chunk.tensor] + chunk.offset;
+    T* chunk_model = model[chunk.tensor] + chunk.offset;
+    for (int64_t i = 0; i != chunk.size; ++i) {
+      SGDUpdateFunctor<T, G>()(chunk_model_diff + i, chunk_model + i, scale, l1, l2, weight_decay,
+                               learning_rate_val);
+    }
+  });
+}
+
+template struct MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, float, float>;
+template struct MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, double, double>;
+
+template<typename T, typename G>
+struct MultiTensorAdamUpdateKernelUtil<DeviceType::kCPU, T, G> {
+  static void Update(ep::Stream* stream, int64_t n_tensor, const int64_t* sizes, T scale, float l1,
+                     float l2, float beta1, float beta2, float epsilon, float weight_decay,
+                     bool do_bias_correction, float learning_rate_val, float bias_correction1_val,
+                     float bias_correction2_val, const float* learning_rate, const T* scale_by_ptr,
+                     const int64_t* skip_if, const float* bias_correction1,
+                     const float* bias_correction2, const G* const* model_diff, T* const* model,
+                     T* const* m, T* const* v);
+};
+
+template<typename T, typename G>
+void MultiTensorAdamUpdateKernelUtil<DeviceType::kCPU, T, G>::Update(
+    ep::Stream* stream, int64_t n_tensor, const int64_t* sizes, T scale, float l1, float l2,
+    float beta1, float beta2, float epsilon, float weight_decay, bool do_bias_correction,
+    float learning_rate_val, float bias_correction1_val, float bias_correction2_val,
+    const float* learning_rate, const T* scale_by_ptr, const int64_t* skip_if,
+    const float* bias_correction1_ptr, const float* bias_correction2_ptr,
+    const G* const* model_diff, T* const* model, T* const* m, T* const* v) {
+  if (skip_if != nullptr && *skip_if != 0) { return; }
+  if (learning_rate != nullptr) { learning_rate_val = *learning_rate; }
+  if (scale_by_ptr != nullptr) { scale *= *scale_by_ptr; }
+  if (bias_correction1_ptr != nullptr) { bias_correction1_val = *bias_correction1_ptr; }
+  if (bias_correction2_ptr != nullptr) { bias_correction2_val = *bias_correction2_ptr; }
+  MultiTensorChunks chunks(n_tensor, sizes);
+  chunks.ParallelForEach(stream, [&](int64_t chunk_id, const TensorChunk& chunk) {
+    const G* chunk_model_diff = model_diff[chunk.tensor] + chunk.offset;
+    T* chunk_model = model[chunk.tensor] + chunk.offset;
+    T* chunk_m = m[chunk.tensor] + chunk.offset;
+    T* chunk_v = v[chunk.tensor] + chunk.offset;
+    for (int64_t i = 0; i != chunk.size; ++i) {
+      AdamUpdateFunctor<T, G>()(chunk_model_diff + i, chunk_model + i, chunk_m + i, chunk_v + i,
+                                nullptr, scale, l1, l2, beta1, beta2, epsilon, weight_decay,
+                                /*amsgrad=*/false, bias_correction1_val, bias_correction2_val,
+                                learning_rate_val);
+    }
+  });
+}
+
+template struct MultiTensorAdamUpdateKernelUtil<DeviceType::kCPU, float, float>;
+template struct MultiTensorAdamUpdateKernelUtil<DeviceType::kCPU, double, double>;
+
+template<typename T, typename G>
+struct MultiTensorLambUpdateKernelUtil<DeviceType::kCPU, T, G> {
+  static void Update(ep::Stream* stream, int64_t n_tensor, const int64_t* sizes, float scale,
+                     float l1, float l2, float beta1, float beta2, float epsilon,
+                     float weight_decay, float learning_rate_val, bool do_bias_correction,
+                     float bias_correction1_val, float bias_correction2_val,
+                     const float* learning_rate_ptr, const float* bias_correction1_ptr,
+                     const float* bias_correction2_ptr, const T* scale_by_ptr,
+                     const int64_t* skip_if, const G* const* model_diff, T* adam_diff,
+                     T* const* model, T* const* m, T* const* v);
+};
+
+template<typename T, typename G>
+void MultiTensorLambUpdateKernelUtil<DeviceType::kCPU, T, G>::Update(
+    ep::Stream* stream, int64_t n_tensor, const int64_t* sizes, float scale, float l1, float l2,
+    float beta1, float beta2, float epsilon, float weight_decay, float learning_rate_val,
+    bool do_bias_correction, float bias_correction1_val, float bias_correction2_val,
+    const float* learning_rate_ptr, const float* bias_correction1_ptr,
+    const float* bias_correction2_ptr, const T* scale_by_ptr, const int64_t* skip_if,
+    const G* const* model_diff, T* adam_diff, T* const* model, T* const* m, T* const* v) {
+  if (skip_if != nullptr && *skip_if != 0) { return; }
+  if (learning_rate_ptr != nullptr) { learning_rate_val = *learning_rate_ptr; }
+  if (scale_by_ptr != nullptr) { scale *= *scale_by_ptr; }
+  if (bias_correction1_ptr != nullptr) { bias_correction1_val = *bias_correction1_ptr; }
+  if (bias_correction2_ptr != nullptr) { bias_correction2_val = *bias_correction2_ptr; }
+
+  std::vector<int64_t> adam_diff_offsets(n_tensor + 1, 0);
+  FOR_RANGE(int64_t, i, 0, n_tensor) { adam_diff_offsets[i + 1] = adam_diff_offsets[i] + sizes[i]; }
+  MultiTensorChunks chunks(n_tensor, sizes);
+  // Squared norms of model and adam_diff, first per chunk and then reduced per tensor in chunk
+  // order, which keeps the trust ratios deterministic.
+  std::vector<T> w_norm_2(chunks.num_chunks());
+  std::vector<T> g_norm_2(chunks.num_chunks());
+  chunks.ParallelForEach(stream, [&](int64_t chunk_id, const TensorChunk& chunk) {
+    const G* chunk_model_diff = model_diff[chunk.tensor] + chunk.offset;
+    T* chunk_adam_diff = adam_diff + adam_diff_offsets[chunk.tensor] + chunk.offset;
+    T* chunk_model = model[chunk.tensor] + chunk.offset;
+    T* chunk_m = m[chunk.tensor] + chunk.offset;
+    T* chunk_v = v[chunk.tensor] + chunk.offset;
+    for (int64_t i = 0; i != chunk.size; ++i) {
+      LambGradFunctor<T, G>()(chunk_model_diff + i, chunk_adam_diff + i, chunk_model + i,
+                              chunk_m + i, chunk_v + i, scale, l1, l2, beta1, beta2, epsilon,
+                              do_bias_correction, bias_correction1_val, bias_correction2_val);
+    }
+    T w_sum = 0;
+    T g_sum = 0;
+    for (int64_t i = 0; i != chunk.size; ++i) {
+      w_sum += chunk_model[i] * chunk_model[i];
+      g_sum += chunk_adam_diff[i] * chunk_adam_diff[i];
+    }
+    w_norm_2[chunk_id] = w_sum;
+    g_norm_2[chunk_id] = g_sum;
+  });
+  std::vector<T> tensor_w_norm_2(n_tensor, 0);
+  std::vector<T> tensor_g_norm_2(n_tensor, 0);
+  FOR_RANGE(int64_t, i, 0, chunks.num_chunks()) {
+    tensor_w_norm_2[chunks.chunk(i).tensor] += w_norm_2[i];
+    tensor_g_norm_2[chunks.chunk(i).tensor] += g_norm_2[i];
+  }
+  std::vector<float> lr(n_tensor);
+  FOR_RANGE(int64_t, i, 0, n_tensor) {
+    lr[i] = LambLRFunctor<T>()(learning_rate_val, &tensor_w_norm_2[i], &tensor_g_norm_2[i]);
+  }
+  chunks.ParallelForEach(stream, [&](int64_t chunk_id, const TensorChunk& chunk) {
+    const T* chunk_adam_diff = adam_diff + adam_diff_offsets[chunk.tensor] + chunk.offset;
+    T* chunk_model = model[chunk.tensor] + chunk.offset;
+    const float tensor_lr = lr[chunk.tensor];
+    for (int64_t i = 0; i != chunk.size; ++i) {
+      LambUpdateFunctor<T>()(tensor_lr, weight_decay, chunk_adam_diff + i, chunk_model + i);
+    }
+  });
+}
+
+template struct MultiTensorLambUpdateKernelUtil<DeviceType::kCPU, float, float>;
+template struct MultiTensorLambUpdateKernelUtil<DeviceType::kCPU, double, double>;
+
 template<>
 struct BiasCorrectionFactorKernelUtil<DeviceType::kCPU> {
   static void BiasCorrectionFactorCompute(ep::Stream* stream, float beta, const int64_t* train_step,
@@ -262,6 +262,40 @@ struct LambUpdateKernelUtil {
                      T* adam_diff, T* model, T* m, T* v, T* norm_buffer);
 };
 
+// Multi tensor variants update a list of n_tensor parameters, tensor i has sizes[i] elements, in
+// a single kernel. The scalar arguments are shared by all tensors.
+template<DeviceType device_type, typename T, typename G>
+struct MultiTensorSGDUpdateKernelUtil {
+  static void Update(ep::Stream* stream, int64_t n_tensor, const int64_t* sizes, T scale, float l1,
+                     float l2, float weight_decay, float learning_rate_val,
+                     const float* learning_rate, const T* scale_by_ptr, const int64_t* skip_if,
+                     const G* const* model_diff, T* const* model);
+};
+
+template<DeviceType device_type, typename T, typename G>
+struct MultiTensorAdamUpdateKernelUtil {
+  static void Update(ep::Stream* stream, int64_t n_tensor, const int64_t* sizes, T scale, float l1,
+                     float l2, float beta1, float beta2, float epsilon, float weight_decay,
+                     bool do_bias_correction, float learning_rate_val, float bias_correction1_val,
+                     float bias_correction2_val, const float* learning_rate, const T* scale_by_ptr,
+                     const int64_t* skip_if, const float* bias_correction1,
+                     const float* bias_correction2, const G* const* model_diff, T* const* model,
+                     T* const* m, T* const* v);
+};
+
+// adam_diff is a buffer of the total element count, the trust ratio is computed per tensor.
+template<DeviceType device_type, typename T, typename G>
+struct MultiTensorLambUpdateKernelUtil {
+  static void Update(ep::Stream* stream, int64_t n_tensor, const int64_t* sizes, float scale,
+                     float l1, float l2, float beta1, float beta2, float epsilon,
+                     float weight_decay, float learning_rate_val, bool do_bias_correction,
+                     float bias_correction1_val, float bias_correction2_val,
+                     const float* learning_rate_ptr, const float* bias_correction1_ptr,
+                     const float* bias_correction2_ptr, const T* scale_by_ptr,
+                     const int64_t* skip_if, const G* const* model_diff, T* adam_diff,
+                     T* const* model, T* const* m, T* const* v);
+};
+
 template<DeviceType device_type, typename T, typename G>
 struct FtrlUpdateKernelUtil {
   static void Update(ep::Stream* stream, int64_t n, T scale, float l1, float l2, float lr_power,
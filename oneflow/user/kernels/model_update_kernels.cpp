@@ -1040,6 +1040,247 @@ REGISTER_FTRL_UPDATE_KERNEL(DeviceType::kCUDA, float, float);
 REGISTER_FTRL_UPDATE_KERNEL(DeviceType::kCUDA, double, double);
 #endif  // WITH_CUDA
 
+// Data pointers and element counts of the tensor lists of a multi tensor update.
+template<typename T, typename G>
+struct MultiTensorUpdateArgs {
+  MultiTensorUpdateArgs(user_op::KernelComputeContext* ctx, bool has_moments) {
+    const int32_t n_tensor = ctx->input_size("model");
+    FOR_RANGE(int32_t, i, 0, n_tensor) {
+      user_op::Tensor* model_i = ctx->Tensor4ArgNameAndIndex("model", i);
+      const user_op::Tensor* model_diff_i = ctx->Tensor4ArgNameAndIndex("model_diff", i);
+      CHECK_EQ(model_diff_i->shape().elem_cnt(), model_i->shape().elem_cnt());
+      sizes.push_back(model_i->shape().elem_cnt());
+      model.push_back(model_i->mut_dptr<T>());
+      model_diff.push_back(model_diff_i->dptr<G>());
+      if (has_moments) {
+        m.push_back(ctx->Tensor4ArgNameAndIndex("m", i)->mut_dptr<T>());
+        v.push_back(ctx->Tensor4ArgNameAndIndex("v", i)->mut_dptr<T>());
+      }
+    }
+  }
+  int64_t n_tensor() const { return sizes.size(); }
+
+  std::vector<int64_t> sizes;
+  std::vector<T*> model;
+  std::vector<const G*> model_diff;
+  std::vector<T*> m;
+  std::vector<T*> v;
+};
+
+template<DeviceType device_type, typename T, typename G>
+class MultiTensorSGDUpdateKernel final : public user_op::OpKernel,
+                                         public user_op::CudaGraphSupport {
+ public:
+  MultiTensorSGDUpdateKernel() = default;
+  ~MultiTensorSGDUpdateKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    MultiTensorUpdateArgs<T, G> args(ctx, /*has_moments=*/false);
+    const auto scale = ctx->Attr<double>("scale");
+    const auto l1 = ctx->Attr<float>("l1");
+    const auto l2 = ctx->Attr<float>("l2");
+    const auto weight_decay = ctx->Attr<float>("weight_decay");
+    const float learning_rate_val = ctx->Attr<float>("learning_rate_val");
+    const float* learning_rate_ptr = nullptr;
+    if (ctx->has_input("learning_rate", 0)) {
+      const user_op::Tensor* learning_rate = ctx->Tensor4ArgNameAndIndex("learning_rate", 0);
+      learning_rate_ptr = learning_rate->dptr<float>();
+    }
+    const T* scale_by_ptr = nullptr;
+    if (ctx->has_input("scale_by_tensor", 0)) {
+      const user_op::Tensor* scale_by_tensor = ctx->Tensor4ArgNameAndIndex("scale_by_tensor", 0);
+      CHECK_EQ(scale_by_tensor->data_type(), GetDataType<T>::value);
+      CHECK_EQ(scale_by_tensor->shape().elem_cnt(), 1);
+      scale_by_ptr = scale_by_tensor->dptr<T>();
+    }
+    const int64_t* skip_if_ptr = nullptr;
+    if (ctx->has_input("skip_if", 0)) {
+      const user_op::Tensor* skip_if = ctx->Tensor4ArgNameAndIndex("skip_if", 0);
+      CHECK_EQ(skip_if->shape().elem_cnt(), 1);
+      skip_if_ptr = skip_if->dptr<int64_t>();
+    }
+    MultiTensorSGDUpdateKernelUtil<device_type, T, G>::Update(
+        ctx->stream(), args.n_tensor(), args.sizes.data(), static_cast<T>(scale), l1, l2,
+        weight_decay, learning_rate_val, learning_rate_ptr, scale_by_ptr, skip_if_ptr,
+        args.model_diff.data(), args.model.data());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+#define REGISTER_MULTI_TENSOR_SGD_UPDATE_KERNEL(device, dtype, gtype)                     \
+  REGISTER_USER_KERNEL("multi_tensor_sgd_update")                                         \
+      .SetCreateFn<MultiTensorSGDUpdateKernel<device, dtype, gtype>>()                    \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                               \
+                       && (user_op::HobDataType("model", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value));
+
+REGISTER_MULTI_TENSOR_SGD_UPDATE_KERNEL(DeviceType::kCPU, float, float);
+REGISTER_MULTI_TENSOR_SGD_UPDATE_KERNEL(DeviceType::kCPU, double, double);
+
+template<DeviceType device_type, typename T, typename G>
+class MultiTensorAdamUpdateKernel final : public user_op::OpKernel,
+                                          public user_op::CudaGraphSupport {
+ public:
+  MultiTensorAdamUpdateKernel() = default;
+  ~MultiTensorAdamUpdateKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    MultiTensorUpdateArgs<T, G> args(ctx, /*has_moments=*/true);
+    const auto scale = ctx->Attr<double>("scale");
+    const auto l1 = ctx->Attr<float>("l1");
+    const auto l2 = ctx->Attr<float>("l2");
+    const auto beta1 = ctx->Attr<float>("beta1");
+    const auto beta2 = ctx->Attr<float>("beta2");
+    const auto epsilon = ctx->Attr<float>("epsilon");
+    const auto weight_decay = ctx->Attr<float>("weight_decay");
+    const bool do_bias_correction = ctx->Attr<bool>("do_bias_correction");
+
+    const float learning_rate_val = ctx->Attr<float>("learning_rate_val");
+    const float* learning_rate_ptr = nullptr;
+    if (ctx->has_input("learning_rate", 0)) {
+      const user_op::Tensor* learning_rate = ctx->Tensor4ArgNameAndIndex("learning_rate", 0);
+      learning_rate_ptr = learning_rate->dptr<float>();
+    }
+    const float bias_correction1_val = ctx->Attr<float>("bias_correction1_val");
+    const float* bias_correction1_ptr = nullptr;
+    if (ctx->has_input("bias_correction1", 0)) {
+      const user_op::Tensor* bias_correction1 = ctx->Tensor4ArgNameAndIndex("bias_correction1", 0);
+      CHECK_EQ(bias_correction1->shape().elem_cnt(), 1);
+      bias_correction1_ptr = bias_correction1->dptr<float>();
+    }
+    const float bias_correction2_val = ctx->Attr<float>("bias_correction2_val");
+    const float* bias_correction2_ptr = nullptr;
+    if (ctx->has_input("bias_correction2", 0)) {
+      const user_op::Tensor* bias_correction2 = ctx->Tensor4ArgNameAndIndex("bias_correction2", 0);
+      CHECK_EQ(bias_correction2->shape().elem_cnt(), 1);
+      bias_correction2_ptr = bias_correction2->dptr<float>();
+    }
+    const T* scale_by_ptr = nullptr;
+    if (ctx->has_input("scale_by_tensor", 0)) {
+      const user_op::Tensor* scale_by_tensor = ctx->Tensor4ArgNameAndIndex("scale_by_tensor", 0);
+      CHECK_EQ(scale_by_tensor->data_type(), GetDataType<T>::value);
+      CHECK_EQ(scale_by_tensor->shape().elem_cnt(), 1);
+      scale_by_ptr = scale_by_tensor->dptr<T>();
+    }
+    const int64_t* skip_if_ptr = nullptr;
+    if (ctx->has_input("skip_if", 0)) {
+      const user_op::Tensor* skip_if = ctx->Tensor4ArgNameAndIndex("skip_if", 0);
+      CHECK_EQ(skip_if->shape().elem_cnt(), 1);
+      skip_if_ptr = skip_if->dptr<int64_t>();
+    }
+
+    MultiTensorAdamUpdateKernelUtil<device_type, T, G>::Update(
+        ctx->stream(), args.n_tensor(), args.sizes.data(), static_cast<T>(scale), l1, l2, beta1,
+        beta2, epsilon, weight_decay, do_bias_correction, learning_rate_val, bias_correction1_val,
+        bias_correction2_val, learning_rate_ptr, scale_by_ptr, skip_if_ptr, bias_correction1_ptr,
+        bias_correction2_ptr, args.model_diff.data(), args.model.data(), args.m.data(),
+        args.v.data());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+#define REGISTER_MULTI_TENSOR_ADAM_UPDATE_KERNEL(device, dtype, gtype)                    \
+  REGISTER_USER_KERNEL("multi_tensor_adam_update")                                        \
+      .SetCreateFn<MultiTensorAdamUpdateKernel<device, dtype, gtype>>()                   \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                               \
+                       && (user_op::HobDataType("model", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value));
+
+REGISTER_MULTI_TENSOR_ADAM_UPDATE_KERNEL(DeviceType::kCPU, float, float);
+REGISTER_MULTI_TENSOR_ADAM_UPDATE_KERNEL(DeviceType::kCPU, double, double);
+
+template<DeviceType device_type, typename T, typename G>
+class MultiTensorLambUpdateKernel final : public user_op::OpKernel,
+                                          public user_op::CudaGraphSupport {
+ public:
+  MultiTensorLambUpdateKernel() = default;
+  ~MultiTensorLambUpdateKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    MultiTensorUpdateArgs<T, G> args(ctx, /*has_moments=*/true);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    int64_t total_elem_cnt = 0;
+    for (const int64_t size : args.sizes) { total_elem_cnt += size; }
+    CHECK_GE(tmp_buffer->shape().elem_cnt(), total_elem_cnt * static_cast<int64_t>(sizeof(T)));
+
+    const auto scale = ctx->Attr<double>("scale");
+    const auto l1 = ctx->Attr<float>("l1");
+    const auto l2 = ctx->Attr<float>("l2");
+    const auto beta1 = ctx->Attr<float>("beta1");
+    const auto beta2 = ctx->Attr<float>("beta2");
+    const auto epsilon = ctx->Attr<float>("epsilon");
+    const auto weight_decay = ctx->Attr<float>("weight_decay");
+    const bool do_bias_correction = ctx->Attr<bool>("do_bias_correction");
+
+    const float bias_correction1_val = ctx->Attr<float>("bias_correction1_val");
+    const float* bias_correction1_ptr = nullptr;
+    if (ctx->has_input("bias_correction1", 0)) {
+      const user_op::Tensor* bias_correction1 = ctx->Tensor4ArgNameAndIndex("bias_correction1", 0);
+      CHECK_EQ(bias_correction1->shape().elem_cnt(), 1);
+      bias_correction1_ptr = bias_correction1->dptr<float>();
+    }
+    const float bias_correction2_val = ctx->Attr<float>("bias_correction2_val");
+    const float* bias_correction2_ptr = nullptr;
+    if (ctx->has_input("bias_correction2", 0)) {
+      const user_op::Tensor* bias_correction2 = ctx->Tensor4ArgNameAndIndex("bias_correction2", 0);
+      CHECK_EQ(bias_correction2->shape().elem_cnt(), 1);
+      bias_correction2_ptr = bias_correction2->dptr<float>();
+    }
+    const float learning_rate_val = ctx->Attr<float>("learning_rate_val");
+    const float* learning_rate_ptr = nullptr;
+    if (ctx->has_input("learning_rate", 0)) {
+      const user_op::Tensor* learning_rate = ctx->Tensor4ArgNameAndIndex("learning_rate", 0);
+      learning_rate_ptr = learning_rate->dptr<float>();
+    }
+    const T* scale_by_ptr = nullptr;
+    if (ctx->has_input("scale_by_tensor", 0)) {
+      const user_op::Tensor* scale_by_tensor = ctx->Tensor4ArgNameAndIndex("scale_by_tensor", 0);
+      CHECK_EQ(scale_by_tensor->data_type(), GetDataType<T>::value);
+      CHECK_EQ(scale_by_tensor->shape().elem_cnt(), 1);
+      scale_by_ptr = scale_by_tensor->dptr<T>();
+    }
+    const int64_t* skip_if_ptr = nullptr;
+    if (ctx->has_input("skip_if", 0)) {
+      const user_op::Tensor* skip_if = ctx->Tensor4ArgNameAndIndex("skip_if", 0);
+      CHECK_EQ(skip_if->shape().elem_cnt(), 1);
+      skip_if_ptr = skip_if->dptr<int64_t>();
+    }
+
+    MultiTensorLambUpdateKernelUtil<device_type, T, G>::Update(
+        ctx->stream(), args.n_tensor(), args.sizes.data(), scale, l1, l2, beta1, beta2, epsilon,
+        weight_decay, learning_rate_val, do_bias_correction, bias_correction1_val,
+        bias_correction2_val, learning_rate_ptr, bias_correction1_ptr, bias_correction2_ptr,
+        scale_by_ptr, skip_if_ptr, args.model_diff.data(), tmp_buffer->mut_dptr<T>(),
+        args.model.data(), args.m.data(), args.v.data());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
+};
+
+template<typename T>
+user_op::InferTmpSizeFn MultiTensorLambGenInferTmpSizeFn() {
+  return [](user_op::InferContext* ctx) {
+    int64_t total_elem_cnt = 0;
+    FOR_RANGE(int32_t, i, 0, ctx->input_size("model")) {
+      total_elem_cnt += ctx->InputTensorDesc("model", i).shape().elem_cnt();
+    }
+    return GetCudaAlignedSize(total_elem_cnt * sizeof(T));
+  };
+}
+
+#define REGISTER_MULTI_TENSOR_LAMB_UPDATE_KERNEL(device, dtype, gtype)                          \
+  REGISTER_USER_KERNEL("multi_tensor_lamb_update")                                              \
+      .SetCreateFn<MultiTensorLambUpdateKernel<device, dtype, gtype>>()                         \
+      .SetIsMatchedHob((user_op::HobDeviceType() == device)                                     \
+                       && (user_op::HobDataType("model", 0) == GetDataType<dtype>::value)       \
+                       && (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value)) \
+      .SetInferTmpSizeFn(MultiTensorLambGenInferTmpSizeFn<dtype>());
+
+REGISTER_MULTI_TENSOR_LAMB_UPDATE_KERNEL(DeviceType::kCPU, float, float);
+REGISTER_MULTI_TENSOR_LAMB_UPDATE_KERNEL(DeviceType::kCPU, double, double);
+
 }  // namespace
 
 }  // namespace oneflow
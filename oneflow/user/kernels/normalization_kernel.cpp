@@ -14,87 +14,304 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
 
 namespace oneflow {
 
-template<typename T>
-static void ComputeMeanAndVar(const T* input_ptr, T* mean_ptr, T* inv_variance_ptr,
-                              T* moving_mean_ptr, T* moving_variance_ptr, const int64_t batch_size,
-                              const int64_t channel_size, const int64_t spatial_size,
-                              const float epsilon, const float momentum) {
-  // NOTE(Liang Depeng): the following parameters were used to compute mean and var
-  const int64_t jump_step = spatial_size * channel_size;
-  const int64_t reduce_count = batch_size * spatial_size;
-  const int64_t unbias_reduce_count = reduce_count - 1;
-  const T reduce_scale_factor = static_cast<T>(1) / reduce_count;
-  const T unbias_reduce_scale_factor = static_cast<T>(1) / unbias_reduce_count;
-  const T unbias_reduce_scale_factor_m2 = unbias_reduce_scale_factor * -static_cast<T>(2);
-  const T unbias_reduce_scale_factor_mn = reduce_count * unbias_reduce_scale_factor;
+// NOTE(Liang Depeng): x is viewed as (outer_size, channel_size, inner_size) where outer_size is the
+// product of the dims before axis and inner_size the product of the dims after it, so NCHW has
+// inner_size = H * W and NHWC inner_size = 1. Per-channel statistics are reduced either over
+// contiguous planes of inner_size elements (inner_size > 1), or over rows of channel_size
+// elements with per-chunk partial sums for every channel (inner_size == 1).
 
-  const T exponential_average_factor = 1.0f - momentum;
+constexpr int64_t kMinElemsPerChunk = 32768;
+constexpr int64_t kNumLanes = 8;
+
+static int64_t GetNumThreads(ep::Stream* stream) {
+  return stream->As<ep::CpuStream>()->device()->GetNumThreads();
+}
+
+// Number of chunks the outer dim is split into when reducing per-channel sums, enough to give
+// every thread work when there are fewer channels than threads.
+static int64_t GetNumOuterChunks(ep::Stream* stream, const int64_t outer_size,
+                                 const int64_t channel_size, const int64_t inner_size) {
+  const int64_t elem_cnt = outer_size * channel_size * inner_size;
+  const int64_t max_num_chunks = std::max<int64_t>(1, elem_cnt / kMinElemsPerChunk);
+  int64_t num_chunks = GetNumThreads(stream);
+  if (inner_size > 1) { num_chunks = num_chunks / std::max<int64_t>(1, channel_size); }
+  return std::max<int64_t>(1, std::min(std::min(num_chunks, max_num_chunks), outer_size));
+}
 
+// Computes sum1[c] and sum2[c] for every channel. plane_fn(plane_ptr_offset, channel, &s1, &s2)
+// accumulates one contiguous plane of inner_size elements, row_fn(row_offset, s1, s2) accumulates
+// the channel_size elements of one row into per-channel arrays.
+template<typename T, typename PlaneFn, typename RowFn>
+static void ReduceChannels(ep::Stream* stream, const int64_t outer_size,
+                           const int64_t channel_size, const int64_t inner_size,
+                           const PlaneFn& plane_fn, const RowFn& row_fn, T* sum1, T* sum2) {
+  const int64_t num_chunks = GetNumOuterChunks(stream, outer_size, channel_size, inner_size);
+  const int64_t outer_per_chunk = (outer_size + num_chunks - 1) / num_chunks;
+  std::vector<T> partial_sum1(num_chunks * channel_size, 0);
+  std::vector<T> partial_sum2(num_chunks * channel_size, 0);
+  ep::CpuStream* cpu_stream = stream->As<ep::CpuStream>();
+  if (inner_size > 1) {
+    cpu_stream->ParallelFor(
+        0, num_chunks * channel_size,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t task = begin; task < end; ++task) {
+            const int64_t chunk = task / channel_size;
+            const int64_t channel = task % channel_size;
+            const int64_t outer_end = std::min(outer_size, (chunk + 1) * outer_per_chunk);
+            for (int64_t outer = chunk * outer_per_chunk; outer < outer_end; ++outer) {
+              plane_fn((outer * channel_size + channel) * inner_size, channel,
+                       &partial_sum1[task], &partial_sum2[task]);
+            }
+          }
+        },
+        std::max<int64_t>(1, kMinElemsPerChunk / (outer_per_chunk * inner_size)));
+  } else {
+    cpu_stream->ParallelFor(
+        0, num_chunks,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t chunk = begin; chunk < end; ++chunk) {
+            const int64_t outer_end = std::min(outer_size, (chunk + 1) * outer_per_chunk);
+            for (int64_t outer = chunk * outer_per_chunk; outer < outer_end; ++outer) {
+              row_fn(outer * channel_size, partial_sum1.data() + chunk * channel_size,
+                     partial_sum2.data() + chunk * channel_size);
+            }
+          }
+        },
+        1);
+  }
   for (int64_t channel = 0; channel < channel_size; ++channel) {
-    const T* temp_input_ptr = input_ptr + channel * spatial_size;
-    T sum = 0;
-    T sum_square = 0;
-    for (int64_t batch = 0; batch < batch_size; ++batch) {
-      for (int64_t s = 0; s < spatial_size; ++s) {
-        const T x = temp_input_ptr[s];
-        sum += x;
-        sum_square += x * x;
-      }
-      temp_input_ptr += jump_step;
+    T s1 = 0;
+    T s2 = 0;
+    for (int64_t chunk = 0; chunk < num_chunks; ++chunk) {
+      s1 += partial_sum1[chunk * channel_size + channel];
+      s2 += partial_sum2[chunk * channel_size + channel];
     }
+    sum1[channel] = s1;
+    sum2[channel] = s2;
+  }
+}
 
-    const T temp_mean = sum * reduce_scale_factor;
-    mean_ptr[channel] = temp_mean;
-
-    const T temp_mean_square = temp_mean * temp_mean;
-    const T temp_variance = sum_square * reduce_scale_factor - temp_mean_square;
+// Applies fn(offset, channel, n) to runs of n contiguous elements sharing one channel, in parallel.
+// For inner_size == 1 a run is a whole row and channel is 0, the run then covers all channels.
+template<typename Fn>
+static void ForEachChannelRun(ep::Stream* stream, const int64_t outer_size,
+                              const int64_t channel_size, const int64_t inner_size,
+                              const Fn& fn) {
+  ep::CpuStream* cpu_stream = stream->As<ep::CpuStream>();
+  if (inner_size > 1) {
+    cpu_stream->ParallelFor(
+        0, outer_size * channel_size,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t plane = begin; plane < end; ++plane) {
+            fn(plane * inner_size, plane % channel_size, inner_size);
+          }
+        },
+        std::max<int64_t>(1, kMinElemsPerChunk / inner_size));
+  } else {
+    cpu_stream->ParallelFor(
+        0, outer_size,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t outer = begin; outer < end; ++outer) {
+            fn(outer * channel_size, 0, channel_size);
+          }
+        },
+        std::max<int64_t>(1, kMinElemsPerChunk / channel_size));
+  }
+}
 
-    const T temp_unbias_variance = sum_square * unbias_reduce_scale_factor
-                                   + unbias_reduce_scale_factor_m2 * temp_mean * sum
-                                   + unbias_reduce_scale_factor_mn * temp_mean_square;
+// One-pass mean and variance. Sums are taken relative to the first element of every channel,
+// which keeps sum(x)^2 and sum(x^2) from cancelling catastrophically when |mean| >> stddev.
+template<typename T>
+static void ComputeMeanAndVar(ep::Stream* stream, const T* input_ptr, T* mean_ptr,
+                              T* inv_variance_ptr, T* moving_mean_ptr, T* moving_variance_ptr,
+                              const int64_t outer_size, const int64_t channel_size,
+                              const int64_t inner_size, const float epsilon,
+                              const float momentum) {
+  std::vector<T> shift(channel_size);
+  for (int64_t channel = 0; channel < channel_size; ++channel) {
+    shift[channel] = input_ptr[channel * inner_size];
+  }
+  std::vector<T> sum(channel_size);
+  std::vector<T> sum_square(channel_size);
+  ReduceChannels<T>(
+      stream, outer_size, channel_size, inner_size,
+      [&](int64_t offset, int64_t channel, T* sum_c, T* sum_square_c) {
+        const T* x = input_ptr + offset;
+        const T k = shift[channel];
+        T lane_sum[kNumLanes] = {0};
+        T lane_sum_square[kNumLanes] = {0};
+        int64_t i = 0;
+        for (; i + kNumLanes <= inner_size; i += kNumLanes) {
+          for (int64_t lane = 0; lane < kNumLanes; ++lane) {
+            const T d = x[i + lane] - k;
+            lane_sum[lane] += d;
+            lane_sum_square[lane] += d * d;
+          }
+        }
+        for (; i < inner_size; ++i) {
+          const T d = x[i] - k;
+          lane_sum[0] += d;
+          lane_sum_square[0] += d * d;
+        }
+        for (int64_t lane = 0; lane < kNumLanes; ++lane) {
+          *sum_c += lane_sum[lane];
+          *sum_square_c += lane_sum_square[lane];
+        }
+      },
+      [&](int64_t offset, T* sum_row, T* sum_square_row) {
+        const T* x = input_ptr + offset;
+        for (int64_t channel = 0; channel < channel_size; ++channel) {
+          const T d = x[channel] - shift[channel];
+          sum_row[channel] += d;
+          sum_square_row[channel] += d * d;
+        }
+      },
+      sum.data(), sum_square.data());
 
+  const int64_t reduce_count = outer_size * inner_size;
+  const T reduce_scale_factor = static_cast<T>(1) / reduce_count;
+  const T unbias_factor = static_cast<T>(reduce_count) / (reduce_count - 1);
+  const T exponential_average_factor = 1.0f - momentum;
+  for (int64_t channel = 0; channel < channel_size; ++channel) {
+    const T shifted_mean = sum[channel] * reduce_scale_factor;
+    const T temp_mean = shift[channel] + shifted_mean;
+    const T temp_variance = std::max<T>(
+        sum_square[channel] * reduce_scale_factor - shifted_mean * shifted_mean, 0);
+    mean_ptr[channel] = temp_mean;
     inv_variance_ptr[channel] = static_cast<T>(1) / std::sqrt(temp_variance + epsilon);
-
     if (moving_mean_ptr != nullptr && moving_variance_ptr != nullptr) {
       moving_mean_ptr[channel] =
           moving_mean_ptr[channel] * momentum + temp_mean * exponential_average_factor;
       moving_variance_ptr[channel] = moving_variance_ptr[channel] * momentum
-                                     + temp_unbias_variance * exponential_average_factor;
+                                     + temp_variance * unbias_factor * exponential_average_factor;
     }
   }
 }
 
+// y = (x - mean) * inv_variance * gamma + beta, folded into y = x * scale + shift per channel.
+// add_to_output is read before y is written at every position, so y may alias it.
 template<typename T>
-static void Normalize(const T* input_ptr, const T* mean_ptr, const T* variance_ptr,
-                      const T* gamma_ptr, const T* beta_ptr, T* output_ptr,
-                      const int64_t batch_size, const int64_t channel_size,
-                      const int64_t spatial_size, const float epsilon, const bool training) {
-  const T* temp_input_ptr = input_ptr;
-  T* temp_output_ptr = output_ptr;
-  const int64_t all_channels = batch_size * channel_size;
-  int64_t channel = -1;
-  for (int64_t ac = 0; ac < all_channels; ++ac) {
-    channel += 1;
-    if (channel >= channel_size) { channel = 0; }
+static void Normalize(ep::Stream* stream, const T* input_ptr, const T* mean_ptr,
+                      const T* variance_ptr, const T* gamma_ptr, const T* beta_ptr,
+                      const T* add_to_output_ptr, T* output_ptr, const int64_t outer_size,
+                      const int64_t channel_size, const int64_t inner_size, const float epsilon,
+                      const bool training) {
+  std::vector<T> scale(channel_size);
+  std::vector<T> shift(channel_size);
+  for (int64_t channel = 0; channel < channel_size; ++channel) {
     T inv_variance = variance_ptr[channel];
     if (!training) { inv_variance = 1.0f / std::sqrt(inv_variance + epsilon); }
-    const T gamma = gamma_ptr[channel] * inv_variance;
-    const T beta = beta_ptr[channel];
-    const T mean = mean_ptr[channel];
-    for (int64_t s = 0; s < spatial_size; ++s) {
-      temp_output_ptr[s] = (temp_input_ptr[s] - mean) * gamma + beta;
-    }
-    temp_input_ptr += spatial_size;
-    temp_output_ptr += spatial_size;
+    scale[channel] = gamma_ptr[channel] * inv_variance;
+    shift[channel] = beta_ptr[channel] - mean_ptr[channel] * scale[channel];
   }
+  const T* scale_ptr = scale.data();
+  const T* shift_ptr = shift.data();
+  auto NormalizeRun = [&](int64_t offset, int64_t channel, int64_t n) {
+    const T* x = input_ptr + offset;
+    T* y = output_ptr + offset;
+    if (inner_size > 1) {
+      const T scale_c = scale_ptr[channel];
+      const T shift_c = shift_ptr[channel];
+      if (add_to_output_ptr != nullptr) {
+        const T* add = add_to_output_ptr + offset;
+        for (int64_t i = 0; i < n; ++i) { y[i] = x[i] * scale_c + shift_c + add[i]; }
+      } else {
+        for (int64_t i = 0; i < n; ++i) { y[i] = x[i] * scale_c + shift_c; }
+      }
+    } else if (add_to_output_ptr != nullptr) {
+      const T* add = add_to_output_ptr + offset;
+      for (int64_t i = 0; i < n; ++i) { y[i] = x[i] * scale_ptr[i] + shift_ptr[i] + add[i]; }
+    } else {
+      for (int64_t i = 0; i < n; ++i) { y[i] = x[i] * scale_ptr[i] + shift_ptr[i]; }
+    }
+  };
+  ForEachChannelRun(stream, outer_size, channel_size, inner_size, NormalizeRun);
 }
 
+// NOTE(Liang Depeng): Borrow the MXNet implementation to compute dx, gamma_diff and beta_diff.
+// For more details pls refers to:
+// https://github.com/apache/incubator-mxnet/blob/master/src/operator/nn/batch_norm.cc
+// dx = (dy - mean(dy) - (x - mean) * k) * inv_variance * gamma with
+// k = sum((x - mean) * dy) * inv_variance^2 / reduce_count, folded into dx = dy * a + x * b + c.
 template<typename T>
-static void AddToOutput(const T* add_to_output_ptr, T* output_ptr, const int64_t elem_count) {
-  for (int64_t i = 0; i < elem_count; ++i) { output_ptr[i] += add_to_output_ptr[i]; }
+static void NormalizeGrad(ep::Stream* stream, const T* x_ptr, const T* dy_ptr, const T* mean_ptr,
+                          const T* inv_variance_ptr, const T* gamma_ptr, T* dx_ptr,
+                          T* gamma_diff_ptr, T* beta_diff_ptr, const int64_t outer_size,
+                          const int64_t channel_size, const int64_t inner_size) {
+  std::vector<T> sum_dy(channel_size);
+  std::vector<T> dotp(channel_size);
+  ReduceChannels<T>(
+      stream, outer_size, channel_size, inner_size,
+      [&](int64_t offset, int64_t channel, T* sum_dy_c, T* dotp_c) {
+        const T* x = x_ptr + offset;
+        const T* dy = dy_ptr + offset;
+        const T mean_c = mean_ptr[channel];
+        T lane_sum_dy[kNumLanes] = {0};
+        T lane_dotp[kNumLanes] = {0};
+        int64_t i = 0;
+        for (; i + kNumLanes <= inner_size; i += kNumLanes) {
+          for (int64_t lane = 0; lane < kNumLanes; ++lane) {
+            lane_sum_dy[lane] += dy[i + lane];
+            lane_dotp[lane] += (x[i + lane] - mean_c) * dy[i + lane];
+          }
+        }
+        for (; i < inner_size; ++i) {
+          lane_sum_dy[0] += dy[i];
+          lane_dotp[0] += (x[i] - mean_c) * dy[i];
+        }
+        for (int64_t lane = 0; lane < kNumLanes; ++lane) {
+          *sum_dy_c += lane_sum_dy[lane];
+          *dotp_c += lane_dotp[lane];
+        }
+      },
+      [&](int64_t offset, T* sum_dy_row, T* dotp_row) {
+        const T* x = x_ptr + offset;
+        const T* dy = dy_ptr + offset;
+        for (int64_t channel = 0; channel < channel_size; ++channel) {
+          sum_dy_row[channel] += dy[channel];
+          dotp_row[channel] += (x[channel] - mean_ptr[channel]) * dy[channel];
+        }
+      },
+      sum_dy.data(), dotp.data());
+
+  const int64_t reduce_count = outer_size * inner_size;
+  std::vector<T> coeff_dy(channel_size);
+  std::vector<T> coeff_x(channel_size);
+  std::vector<T> coeff_bias(channel_size);
+  for (int64_t channel = 0; channel < channel_size; ++channel) {
+    const T mean_c = mean_ptr[channel];
+    const T inv_variance_c = inv_variance_ptr[channel];
+    const T k = dotp[channel] * inv_variance_c * inv_variance_c / reduce_count;
+    const T iw = inv_variance_c * gamma_ptr[channel];
+    const T grad_mean_c = sum_dy[channel] / reduce_count;
+    coeff_dy[channel] = iw;
+    coeff_x[channel] = -k * iw;
+    coeff_bias[channel] = (mean_c * k - grad_mean_c) * iw;
+    gamma_diff_ptr[channel] = dotp[channel] * inv_variance_c;
+    beta_diff_ptr[channel] = sum_dy[channel];
+  }
+  const T* a = coeff_dy.data();
+  const T* b = coeff_x.data();
+  const T* c = coeff_bias.data();
+  auto NormalizeGradRun = [&](int64_t offset, int64_t channel, int64_t n) {
+    const T* x = x_ptr + offset;
+    const T* dy = dy_ptr + offset;
+    T* dx = dx_ptr + offset;
+    if (inner_size > 1) {
+      const T a_c = a[channel];
+      const T b_c = b[channel];
+      const T c_c = c[channel];
+      for (int64_t i = 0; i < n; ++i) { dx[i] = dy[i] * a_c + x[i] * b_c + c_c; }
+    } else {
+      for (int64_t i = 0; i < n; ++i) { dx[i] = dy[i] * a[i] + x[i] * b[i] + c[i]; }
+    }
+  };
+  ForEachChannelRun(stream, outer_size, channel_size, inner_size, NormalizeGradRun);
 }
 
 template<typename T>
@@ -160,33 +377,6 @@ static void Relu(int32_t* mask_ptr, T* output_ptr, const int64_t elem_cnt) {
   }
 }
 
-template<typename T>
-static void AddReluGrad(const T* dy_ptr, const int32_t* mask_ptr, T* addend_diff_ptr,
-                        const int64_t elem_cnt) {
-  const int32_t step = 32;
-  const int64_t outer_loop = elem_cnt / step;
-  const int64_t remain_loop_start_idx = outer_loop * step;
-
-  for (int64_t outer = 0; outer < outer_loop; ++outer) {
-    const int32_t mask_val = mask_ptr[outer];
-    for (int32_t s = 0; s < step; ++s) {
-      bool is_positive = mask_val & (1 << s);
-      addend_diff_ptr[s] = static_cast<T>(is_positive) * dy_ptr[s];
-    }
-    addend_diff_ptr += step;
-    dy_ptr += step;
-  }
-
-  if (remain_loop_start_idx < elem_cnt) {
-    const int32_t mask_val = mask_ptr[outer_loop];
-    const int32_t remain = elem_cnt - remain_loop_start_idx;
-    for (int32_t i = 0; i < remain; ++i) {
-      bool is_positive = mask_val & (1 << i);
-      addend_diff_ptr[i] = static_cast<T>(is_positive) * dy_ptr[i];
-    }
-  }
-}
-
 template<typename T>
 static void ReluGrad(const T* dy_ptr, const int32_t* mask_ptr, T* relu_dx_ptr,
                      const int64_t elem_cnt) {
@@ -214,6 +404,22 @@ static void ReluGrad(const T* dy_ptr, const int32_t* mask_ptr, T* relu_dx_ptr,
   }
 }
 
+// Runs fn(offset, elem_cnt) over chunks of a relu mask in parallel. Every chunk starts at a
+// multiple of the 32 elements packed into one mask word, so mask_ptr + offset / 32 is its first
+// word.
+template<typename Fn>
+static void ParallelForMaskChunks(ep::Stream* stream, const int64_t elem_cnt, const Fn& fn) {
+  constexpr int64_t kMaskWordSize = 32;
+  const int64_t num_words = (elem_cnt + kMaskWordSize - 1) / kMaskWordSize;
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_words,
+      [&](int64_t begin, int64_t end) {
+        const int64_t offset = begin * kMaskWordSize;
+        fn(offset, std::min(elem_cnt, end * kMaskWordSize) - offset);
+      },
+      kMinElemsPerChunk / kMaskWordSize);
+}
+
 static size_t InferGradTmpSizeForCpuKernel(user_op::InferContext* ctx) {
   const auto& dy = ctx->InputTensorDesc("dy", 0);
   size_t tmp_size = 0;
@@ -223,51 +429,6 @@ static size_t InferGradTmpSizeForCpuKernel(user_op::InferContext* ctx) {
   return tmp_size;
 }
 
-// NOTE(Liang Depeng): helper functions to process datas for specific channel over all samples.
-template<typename T, typename DataProcessor>
-static inline void ForEachFast(const T* data, const int64_t batch_size, const int64_t spatial_size,
-                               const int64_t jump_step, const int64_t channel_idx,
-                               DataProcessor data_processor) {
-  const int64_t start_offset = channel_idx * spatial_size;
-  const T* tmp_data = data + start_offset;
-  for (int64_t outer = 0; outer < batch_size; ++outer) {
-    for (int64_t i = 0; i < spatial_size; ++i) { data_processor(&tmp_data[i]); }
-    tmp_data += jump_step;
-  }
-}
-
-template<typename T, typename DataProcessor>
-static inline void ForEachFast(const T* in_data1, const T* in_data2, const int64_t batch_size,
-                               const int64_t spatial_size, const int64_t jump_step,
-                               const int64_t channel_idx, DataProcessor data_processor) {
-  const int64_t start_offset = channel_idx * spatial_size;
-  const T* tmp_in_data1 = in_data1 + start_offset;
-  const T* tmp_in_data2 = in_data2 + start_offset;
-  for (int64_t outer = 0; outer < batch_size; ++outer) {
-    for (int64_t i = 0; i < spatial_size; ++i) {
-      data_processor(&tmp_in_data1[i], &tmp_in_data2[i]);
-    }
-    tmp_in_data1 += jump_step;
-    tmp_in_data2 += jump_step;
-  }
-}
-
-template<typename T, typename DataProcessor>
-static inline void ForEachFast(const T* in_data, T* out_data, const int64_t batch_size,
-                               const int64_t spatial_size, const int64_t jump_step,
-                               const int64_t channel_idx, DataProcessor data_processor) {
-  const int64_t start_offset = channel_idx * spatial_size;
-  const T* tmp_in_data = in_data + start_offset;
-  T* tmp_out_data = out_data + start_offset;
-  for (int64_t outer = 0; outer < batch_size; ++outer) {
-    for (int64_t i = 0; i < spatial_size; ++i) {
-      data_processor(&tmp_in_data[i], &tmp_out_data[i]);
-    }
-    tmp_in_data += jump_step;
-    tmp_out_data += jump_step;
-  }
-}
-
 template<typename T>
 class NormalizationInferenceCpuKernel final : public user_op::OpKernel {
  public:
@@ -294,34 +455,23 @@ class NormalizationInferenceCpuKernel final : public user_op::OpKernel {
     CHECK_GE(axis, 0);
     CHECK_LT(axis, x->shape().NumAxes());
 
-    if (axis == 1) {  // NOTE(Liang Depeng): NCHW format
-      const T* input_ptr = x->dptr<T>();
-      const T* gamma_ptr = gamma->dptr<T>();
-      const T* beta_ptr = beta->dptr<T>();
-
-      T* output_ptr = y->mut_dptr<T>();
-      T* moving_mean_ptr = moving_mean->mut_dptr<T>();
-      T* moving_variance_ptr = moving_variance->mut_dptr<T>();
-
-      const int64_t batch_size = x->shape().At(0);
-      const int64_t channel_size = x->shape().At(axis);
-      const int64_t spatial_size = x->shape().Count(axis + 1);
-
-      // NOTE(Liang Depeng):
-      // compute the normalization result
-      Normalize(input_ptr, moving_mean_ptr, moving_variance_ptr, gamma_ptr, beta_ptr, output_ptr,
-                batch_size, channel_size, spatial_size, epsilon, false);
-
-      if (ctx->has_input("_add_to_output", 0)) {
-        const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
-        CHECK_EQ(add_to_output->data_type(), y->data_type());
-        CHECK_EQ(add_to_output->shape(), y->shape());
-        AddToOutput(add_to_output->dptr<T>(), output_ptr, x->shape().elem_cnt());
-      }
+    const int64_t outer_size = x->shape().Count(0, axis);
+    const int64_t channel_size = x->shape().At(axis);
+    const int64_t inner_size = x->shape().Count(axis + 1);
 
-    } else {  // TODO(Liang Depeng): NHWC format
-      UNIMPLEMENTED() << "cpu normalization op only support nchw data_format now!";
+    const T* add_to_output_ptr = nullptr;
+    if (ctx->has_input("_add_to_output", 0)) {
+      const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
+      CHECK_EQ(add_to_output->data_type(), y->data_type());
+      CHECK_EQ(add_to_output->shape(), y->shape());
+      add_to_output_ptr = add_to_output->dptr<T>();
     }
+
+    // NOTE(Liang Depeng):
+    // compute the normalization result
+    Normalize(ctx->stream(), x->dptr<T>(), moving_mean->dptr<T>(), moving_variance->dptr<T>(),
+              gamma->dptr<T>(), beta->dptr<T>(), add_to_output_ptr, y->mut_dptr<T>(), outer_size,
+              channel_size, inner_size, epsilon, false);
   }
 
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
@@ -383,55 +533,57 @@ class NormalizationTrainCpuKernel final : public user_op::OpKernel {
       moving_variance = ctx->Tensor4ArgNameAndIndex("moving_variance", 0);
     }
 
-    if (axis == 1) {  // NOTE(Liang Depeng): NCHW format
-      const T* input_ptr = x->dptr<T>();
-      const T* gamma_ptr = gamma->dptr<T>();
-      const T* beta_ptr = beta->dptr<T>();
-
-      T* output_ptr = y->mut_dptr<T>();
-      T* mean_ptr = mean->mut_dptr<T>();
-      T* inv_variance_ptr = inv_variance->mut_dptr<T>();
+    const T* input_ptr = x->dptr<T>();
+    T* output_ptr = y->mut_dptr<T>();
+    T* mean_ptr = mean->mut_dptr<T>();
+    T* inv_variance_ptr = inv_variance->mut_dptr<T>();
 
-      T* moving_mean_ptr = nullptr;
-      T* moving_variance_ptr = nullptr;
-      if (moving_mean != nullptr && moving_variance != nullptr) {
-        moving_mean_ptr = moving_mean->mut_dptr<T>();
-        moving_variance_ptr = moving_variance->mut_dptr<T>();
-      }
-
-      const int64_t batch_size = x->shape().At(0);
-      const int64_t channel_size = x->shape().At(axis);
-      const int64_t spatial_size = x->shape().Count(axis + 1);
-
-      // NOTE(Liang Depeng):
-      // Compute mean & inv_variance and update moving_mean & moving_variance for each channel.
-      ComputeMeanAndVar(input_ptr, mean_ptr, inv_variance_ptr, moving_mean_ptr, moving_variance_ptr,
-                        batch_size, channel_size, spatial_size, epsilon, momentum);
-
-      // NOTE(Liang Depeng):
-      // compute the normalization result
-      Normalize(input_ptr, mean_ptr, inv_variance_ptr, gamma_ptr, beta_ptr, output_ptr, batch_size,
-                channel_size, spatial_size, epsilon, true);
-
-      if (ctx->has_input("_add_to_output", 0)) {
-        const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
-        CHECK_EQ(add_to_output->data_type(), y->data_type());
-        CHECK_EQ(add_to_output->shape(), y->shape());
-        AddToOutput(add_to_output->dptr<T>(), output_ptr, x->shape().elem_cnt());
-      }
+    T* moving_mean_ptr = nullptr;
+    T* moving_variance_ptr = nullptr;
+    if (moving_mean != nullptr && moving_variance != nullptr) {
+      moving_mean_ptr = moving_mean->mut_dptr<T>();
+      moving_variance_ptr = moving_variance->mut_dptr<T>();
+    }
 
-      if (ctx->op_type_name() == "normalization_add_relu") {
-        CHECK(!ctx->has_input("_add_to_output", 0));
-        auto* mask = ctx->Tensor4ArgNameAndIndex("reserve_space", 0);
+    const int64_t outer_size = x->shape().Count(0, axis);
+    const int64_t channel_size = x->shape().At(axis);
+    const int64_t inner_size = x->shape().Count(axis + 1);
+    const int64_t elem_cnt = x->shape().elem_cnt();
+
+    // NOTE(Liang Depeng):
+    // Compute mean & inv_variance and update moving_mean & moving_variance for each channel.
+    ComputeMeanAndVar(ctx->stream(), input_ptr, mean_ptr, inv_variance_ptr, moving_mean_ptr,
+                      moving_variance_ptr, outer_size, channel_size, inner_size, epsilon,
+                      momentum);
+
+    const T* add_to_output_ptr = nullptr;
+    if (ctx->has_input("_add_to_output", 0)) {
+      const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
+      CHECK_EQ(add_to_output->data_type(), y->data_type());
+      CHECK_EQ(add_to_output->shape(), y->shape());
+      add_to_output_ptr = add_to_output->dptr<T>();
+    }
 
-        if (ctx->has_input("addend", 0)) {
-          const auto* addend = ctx->Tensor4ArgNameAndIndex("addend", 0);
-          AddRelu(addend->dptr<T>(), mask->mut_dptr<int32_t>(), output_ptr, x->shape().elem_cnt());
-        } else {
-          Relu(mask->mut_dptr<int32_t>(), output_ptr, x->shape().elem_cnt());
-        }
+    // NOTE(Liang Depeng):
+    // compute the normalization result
+    Normalize(ctx->stream(), input_ptr, mean_ptr, inv_variance_ptr, gamma->dptr<T>(),
+              beta->dptr<T>(), add_to_output_ptr, output_ptr, outer_size, channel_size,
+              inner_size, epsilon, true);
+
+    if (ctx->op_type_name() == "normalization_add_relu") {
+      CHECK(!ctx->has_input("_add_to_output", 0));
+      int32_t* mask_ptr = ctx->Tensor4ArgNameAndIndex("reserve_space", 0)->mut_dptr<int32_t>();
+
+      if (ctx->has_input("addend", 0)) {
+        const T* addend_ptr = ctx->Tensor4ArgNameAndIndex("addend", 0)->dptr<T>();
+        ParallelForMaskChunks(ctx->stream(), elem_cnt, [&](int64_t offset, int64_t n) {
+          AddRelu(addend_ptr + offset, mask_ptr + offset / 32, output_ptr + offset, n);
+        });
+      } else {
+        ParallelForMaskChunks(ctx->stream(), elem_cnt, [&](int64_t offset, int64_t n) {
+          Relu(mask_ptr + offset / 32, output_ptr + offset, n);
+        });
       }
-    } else {  // TODO(Liang Depeng): NHWC format
     }
   }
 
@@ -502,77 +654,30 @@ class NormalizationGradCpuKernel final : public user_op::OpKernel {
       dy_ptr = dy->dptr<T>();
     } else if (ctx->op_type_name() == "normalization_add_relu_grad") {
       const auto* mask = ctx->Tensor4ArgNameAndIndex("reserve_space", 0);
+      const int32_t* mask_ptr = mask->dptr<int32_t>();
+      T* relu_dx_ptr = nullptr;
       if (ctx->has_output("addend_diff", 0)) {
-        user_op::Tensor* addend_diff = ctx->Tensor4ArgNameAndIndex("addend_diff", 0);
-        AddReluGrad(dy->dptr<T>(), mask->dptr<int32_t>(), addend_diff->mut_dptr<T>(),
-                    dy->shape().elem_cnt());
-        dy_ptr = addend_diff->dptr<T>();
+        relu_dx_ptr = ctx->Tensor4ArgNameAndIndex("addend_diff", 0)->mut_dptr<T>();
       } else {
-        ReluGrad(dy->dptr<T>(), mask->dptr<int32_t>(), tmp_buffer->mut_dptr<T>(),
-                 dy->shape().elem_cnt());
-        dy_ptr = tmp_buffer->dptr<T>();
+        relu_dx_ptr = tmp_buffer->mut_dptr<T>();
       }
-
+      const T* relu_dy_ptr = dy->dptr<T>();
+      ParallelForMaskChunks(ctx->stream(), dy->shape().elem_cnt(),
+                            [&](int64_t offset, int64_t n) {
+                              ReluGrad(relu_dy_ptr + offset, mask_ptr + offset / 32,
+                                       relu_dx_ptr + offset, n);
+                            });
+      dy_ptr = relu_dx_ptr;
     } else {
       UNIMPLEMENTED();
     }
 
-    if (axis == 1) {  // NOTE(Liang Depeng): NCHW format
-      const T* x_ptr = x->dptr<T>();
-      const T* gamma_ptr = gamma->dptr<T>();
-      const T* mean_ptr = mean->dptr<T>();
-      const T* inv_variance_ptr = inv_variance->dptr<T>();
-
-      T* dx_ptr = dx->mut_dptr<T>();
-      T* gamma_diff_ptr = gamma_diff->mut_dptr<T>();
-      T* beta_diff_ptr = beta_diff->mut_dptr<T>();
-
-      const int64_t batch_size = x->shape().At(0);
-      const int64_t channel_size = x->shape().At(axis);
-      const int64_t spatial_size = x->shape().Count(axis + 1);
-      const int64_t jump_step = spatial_size * channel_size;
-      const int64_t reduce_count = batch_size * spatial_size;
-
-      // NOTE(Liang Depeng):
-      // Borrow the MXNet implementation to compute dx, gamma_diff and beta_diff.
-      // For more details pls refers to:
-      // https://github.com/apache/incubator-mxnet/blob/master/src/operator/nn/batch_norm.cc
-      for (int64_t channel = 0; channel < channel_size; ++channel) {
-        const T gamma_c = gamma_ptr[channel];
-        const T mean_c = mean_ptr[channel];
-        const T inv_variance_c = inv_variance_ptr[channel];
-
-        // NOTE(Liang Depeng): sum dy for specific channel over all samples
-        T sum_dy_out = 0;
-        ForEachFast(dy_ptr, batch_size, spatial_size, jump_step, channel,
-                    [&sum_dy_out](const T* dy_data) { sum_dy_out += *dy_data; });
-
-        // NOTE(Liang Depeng): dot product of the x and dy
-        T dotp = 0;
-        ForEachFast(x_ptr, dy_ptr, batch_size, spatial_size, jump_step, channel,
-                    [&dotp, mean_c](const T* x_data, const T* dy_data) {
-                      dotp += (*x_data - mean_c) * (*dy_data);
-                    });
-
-        // NOTE(Liang Depeng): projection of dy on to output scaled by std
-        const T k = dotp * inv_variance_c * inv_variance_c / reduce_count;
-        const T iw = inv_variance_c * gamma_c;
-        const T grad_mean_c = sum_dy_out / reduce_count;
-        ForEachFast(
-            x_ptr, dx_ptr, batch_size, spatial_size, jump_step, channel,
-            [&mean_c, &k](const T* x_data, T* dx_data) { *dx_data = (*x_data - mean_c) * k; });
-
-        ForEachFast(dy_ptr, dx_ptr, batch_size, spatial_size, jump_step, channel,
-                    [iw, grad_mean_c](const T* dy_data, T* dx_data) {
-                      *dx_data = (*dy_data - grad_mean_c - *dx_data) * iw;
-                    });
-
-        gamma_diff_ptr[channel] = dotp * inv_variance_c;
-        beta_diff_ptr[channel] = sum_dy_out;
-      }
-
-    } else {  // TODO(Liang Depeng): NHWC format
-    }
+    const int64_t outer_size = x->shape().Count(0, axis);
+    const int64_t channel_size = x->shape().At(axis);
+    const int64_t inner_size = x->shape().Count(axis + 1);
+    NormalizeGrad(ctx->stream(), x->dptr<T>(), dy_ptr, mean->dptr<T>(), inv_variance->dptr<T>(),
+                  gamma->dptr<T>(), dx->mut_dptr<T>(), gamma_diff->mut_dptr<T>(),
+                  beta_diff->mut_dptr<T>(), outer_size, channel_size, inner_size);
   }
 
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
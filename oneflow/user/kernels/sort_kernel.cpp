@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
+#include "oneflow/user/kernels/sort_kernel_util.h"
 
 namespace oneflow {
 
@@ -31,20 +32,17 @@ class CpuSortKernel final : public user_op::OpKernel {
 
     Memcpy<DeviceType::kCPU>(ctx->stream(), out->mut_dptr<T>(), in->dptr<T>(),
                              in->shape().elem_cnt() * sizeof(T));
-    const int32_t instance_size = in->shape().At(in->shape().NumAxes() - 1);
-    const int32_t instance_num = in->shape().elem_cnt() / instance_size;
+    const int64_t instance_size = in->shape().At(in->shape().NumAxes() - 1);
+    const int64_t instance_num = in->shape().elem_cnt() / instance_size;
     const std::string& direction = ctx->Attr<std::string>("direction");
-    const bool is_ascending = direction == "ASCENDING";
-    const bool is_descending = direction == "DESCENDING";
-    FOR_RANGE(int32_t, i, 0, instance_num) {
-      T* out_ptr_i = out->mut_dptr<T>() + i * instance_size;
-      if (is_ascending) {
-        std::sort(out_ptr_i, out_ptr_i + instance_size, std::less<T>());
-      } else if (is_descending) {
-        std::sort(out_ptr_i, out_ptr_i + instance_size, std::greater<T>());
-      } else {
-        UNIMPLEMENTED();
-      }
+    if (direction == "ASCENDING") {
+      cpu_sort::SegmentedSort(ctx->stream(), out->mut_dptr<T>(), instance_num, instance_size,
+                              [](int64_t) { return std::less<T>(); });
+    } else if (direction == "DESCENDING") {
+      cpu_sort::SegmentedSort(ctx->stream(), out->mut_dptr<T>(), instance_num, instance_size,
+                              [](int64_t) { return std::greater<T>(); });
+    } else {
+      UNIMPLEMENTED();
     }
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
@@ -0,0 +1,132 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_SORT_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_SORT_KERNEL_UTIL_H_
+
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+
+namespace oneflow {
+
+namespace cpu_sort {
+
+/*
+Segmented sort for CPU. `data` holds num_segments consecutive segments of segment_size elements
+which are sorted independently in place, `make_comp(segment)` returns the strict weak ordering of
+a segment. With enough segments to keep every thread busy segments are sorted in parallel, each
+on one thread. Otherwise every large segment is sorted by a parallel merge sort: one chunk per
+thread is sorted with std::sort, and the sorted runs are merged pairwise where every merge is
+split into equal parts of the output by merge path partitioning.
+*/
+
+constexpr int64_t kMinElemsPerChunk = 32768;
+
+inline int64_t GetNumThreads(ep::Stream* stream) {
+  return stream->As<ep::CpuStream>()->device()->GetNumThreads();
+}
+
+// Number of elements of `a` among the first k elements of the stable merge of a and b.
+template<typename T, typename Compare>
+int64_t MergePathSplit(const T* a, int64_t a_size, const T* b, int64_t b_size, int64_t k,
+                       const Compare& comp) {
+  int64_t lo = std::max<int64_t>(0, k - b_size);
+  int64_t hi = std::min(k, a_size);
+  while (lo < hi) {
+    const int64_t i = lo + (hi - lo) / 2;
+    if (!comp(b[k - i - 1], a[i])) {
+      lo = i + 1;
+    } else {
+      hi = i;
+    }
+  }
+  return lo;
+}
+
+template<typename T, typename Compare>
+void ParallelMergeSort(ep::Stream* stream, T* data, T* buffer, int64_t size,
+                       const Compare& comp) {
+  ep::CpuStream* cpu_stream = stream->As<ep::CpuStream>();
+  const int64_t num_runs = std::max<int64_t>(
+      1, std::min<int64_t>(GetNumThreads(stream), size / kMinElemsPerChunk));
+  const int64_t run_size = (size + num_runs - 1) / num_runs;
+  cpu_stream->ParallelFor(
+      0, num_runs,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t run = begin; run < end; ++run) {
+          T* run_begin = data + std::min(size, run * run_size);
+          T* run_end = data + std::min(size, (run + 1) * run_size);
+          std::sort(run_begin, run_end, comp);
+        }
+      },
+      1);
+  T* src = data;
+  T* dst = buffer;
+  for (int64_t width = run_size; width < size; width *= 2) {
+    const int64_t num_pairs = (size + 2 * width - 1) / (2 * width);
+    const int64_t parts_per_pair = std::max<int64_t>(1, num_runs / num_pairs);
+    cpu_stream->ParallelFor(
+        0, num_pairs * parts_per_pair,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t task = begin; task < end; ++task) {
+            const int64_t pair_begin = (task / parts_per_pair) * 2 * width;
+            const int64_t part = task % parts_per_pair;
+            const T* a = src + pair_begin;
+            const int64_t a_size = std::min(width, size - pair_begin);
+            const T* b = a + a_size;
+            const int64_t b_size = std::min(width, size - pair_begin - a_size);
+            const int64_t pair_size = a_size + b_size;
+            const int64_t k_begin = pair_size * part / parts_per_pair;
+            const int64_t k_end = pair_size * (part + 1) / parts_per_pair;
+            const int64_t a_begin = MergePathSplit(a, a_size, b, b_size, k_begin, comp);
+            const int64_t a_end = MergePathSplit(a, a_size, b, b_size, k_end, comp);
+            std::merge(a + a_begin, a + a_end, b + (k_begin - a_begin), b + (k_end - a_end),
+                       dst + pair_begin + k_begin, comp);
+          }
+        },
+        1);
+    std::swap(src, dst);
+  }
+  if (src != data) { std::copy(src, src + size, data); }
+}
+
+template<typename T, typename MakeCompare>
+void SegmentedSort(ep::Stream* stream, T* data, int64_t num_segments, int64_t segment_size,
+                   const MakeCompare& make_comp) {
+  if (num_segments == 0 || segment_size <= 1) { return; }
+  if (num_segments >= GetNumThreads(stream) || segment_size < 2 * kMinElemsPerChunk) {
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, num_segments,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t segment = begin; segment < end; ++segment) {
+            T* segment_data = data + segment * segment_size;
+            std::sort(segment_data, segment_data + segment_size, make_comp(segment));
+          }
+        },
+        std::max<int64_t>(1, kMinElemsPerChunk / segment_size));
+  } else {
+    std::vector<T> buffer(segment_size);
+    for (int64_t segment = 0; segment < num_segments; ++segment) {
+      ParallelMergeSort(stream, data + segment * segment_size, buffer.data(), segment_size,
+                        make_comp(segment));
+    }
+  }
+}
+
+}  // namespace cpu_sort
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_SORT_KERNEL_UTIL_H_
@@ -14,63 +14,167 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
-#include "oneflow/core/thread/thread_manager.h"
-#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
 
 namespace oneflow {
 
 namespace {
 
+// k up to which top-k keeps a bounded heap of candidates instead of selecting over a full index
+// buffer of the instance.
+constexpr int64_t kHeapSelectionMaxK = 128;
+constexpr int64_t kMinElemsPerChunk = 32768;
+
+// Larger values rank first, ties are broken by the lower index.
+template<typename T>
+struct TopKCompare {
+  explicit TopKCompare(const T* in_ptr) : in_ptr(in_ptr) {}
+  bool operator()(const int64_t lhs, const int64_t rhs) const {
+    const T l = in_ptr[lhs];
+    const T r = in_ptr[rhs];
+    if (l == r) {
+      return lhs < rhs;
+    } else {
+      return l > r;
+    }
+  }
+  const T* in_ptr;
+};
+
+int64_t GetNumChunks(ep::Stream* stream, int64_t instance_num, int64_t instance_size) {
+  // Instances are split only when there are too few of them to keep every thread busy.
+  const int64_t num_threads = stream->As<ep::CpuStream>()->device()->GetNumThreads();
+  if (instance_num >= num_threads) { return 1; }
+  return std::max<int64_t>(1, std::min<int64_t>(num_threads / instance_num,
+                                                instance_size / kMinElemsPerChunk));
+}
+
+template<typename T>
+int64_t ArgMax(const T* in_ptr, int64_t begin, int64_t end) {
+  return std::distance(in_ptr, std::max_element(in_ptr + begin, in_ptr + end));
+}
+
 template<typename T>
-void ComputeTopOne(const T* in_ptr, const Range& range, int64_t instance_size, int64_t* out_ptr) {
-  FOR_RANGE(int64_t, i, range.begin(), range.end()) {
+void ComputeTopOne(ep::Stream* stream, const T* in_ptr, int64_t instance_num,
+                   int64_t instance_size, int64_t* out_ptr) {
+  const int64_t num_chunks = GetNumChunks(stream, instance_num, instance_size);
+  const int64_t chunk_size = (instance_size + num_chunks - 1) / num_chunks;
+  std::vector<int64_t> chunk_results(instance_num * num_chunks);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, instance_num * num_chunks,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t task = begin; task < end; ++task) {
+          const int64_t i = task / num_chunks;
+          const int64_t chunk = task % num_chunks;
+          chunk_results[task] =
+              ArgMax(in_ptr + i * instance_size, std::min(instance_size, chunk * chunk_size),
+                     std::min(instance_size, (chunk + 1) * chunk_size));
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / chunk_size));
+  FOR_RANGE(int64_t, i, 0, instance_num) {
     const T* in_ptr_i = in_ptr + i * instance_size;
-    out_ptr[i] = std::distance(in_ptr_i, std::max_element(in_ptr_i, in_ptr_i + instance_size));
+    int64_t top = chunk_results[i * num_chunks];
+    FOR_RANGE(int64_t, chunk, 1, num_chunks) {
+      const int64_t candidate = chunk_results[i * num_chunks + chunk];
+      if (candidate < instance_size && in_ptr_i[candidate] > in_ptr_i[top]) { top = candidate; }
+    }
+    out_ptr[i] = top;
   }
 }
 
+// Keeps the k best indices of [begin, end) in heap, a max-heap with respect to comp whose top is
+// the worst candidate kept so far. Returns the number of candidates.
 template<typename T>
-void ComputeTopK(const T* in_ptr, int64_t* indices_ptr, const Range& range, int64_t instance_size,
-                 int64_t k, bool sorted, int64_t* out_ptr) {
-  FOR_RANGE(int64_t, i, range.begin(), range.end()) {
-    const int64_t offset = i * instance_size;
-    const T* in_ptr_i = in_ptr + offset;
-    int64_t* indices_ptr_i = indices_ptr + offset;
-    std::iota(indices_ptr_i, indices_ptr_i + instance_size, 0);
-    auto comp = [&](const int64_t lhs, const int64_t rhs) {
-      const T l = in_ptr_i[lhs];
-      const T r = in_ptr_i[rhs];
-      if (l == r) {
-        return lhs < rhs;
-      } else {
-        return l > r;
-      }
-    };
-    std::nth_element(indices_ptr_i, indices_ptr_i + k, indices_ptr_i + instance_size, comp);
-    if (sorted) { std::sort(indices_ptr_i, indices_ptr_i + k, comp); }
-    std::copy(indices_ptr_i, indices_ptr_i + k, out_ptr + i * k);
+int64_t HeapSelect(const TopKCompare<T>& comp, int64_t begin, int64_t end, int64_t k,
+                   int64_t* heap) {
+  const int64_t heap_size = std::min(k, end - begin);
+  std::iota(heap, heap + heap_size, begin);
+  std::make_heap(heap, heap + heap_size, comp);
+  for (int64_t j = begin + heap_size; j < end; ++j) {
+    if (comp(j, heap[0])) {
+      std::pop_heap(heap, heap + heap_size, comp);
+      heap[heap_size - 1] = j;
+      std::push_heap(heap, heap + heap_size, comp);
+    }
   }
+  return heap_size;
 }
 
+// Small k: every chunk of an instance selects its k best candidates with a bounded heap, which
+// costs O(n * log(k)) without touching an index buffer of the whole instance, and the candidates
+// of all chunks are reduced to the final k.
 template<typename T>
-void CpuTopK(ep::Stream* /*stream*/, const T* in_ptr, int64_t* indices_ptr, int64_t instance_num,
-             int64_t instance_size, int64_t k, bool sorted, int64_t* out_ptr) {
-  const int64_t num_thread =
-      std::min(instance_num, static_cast<int64_t>(Global<ThreadPool>::Get()->thread_num()));
-  const BalancedSplitter bs(instance_num, num_thread);
-  BlockingCounter bc(num_thread);
-  FOR_RANGE(int64_t, thread_id, 0, num_thread) {
-    const Range range = bs.At(thread_id);
-    Global<ThreadPool>::Get()->AddWork([=, &bc]() {
-      if (k == 1) {
-        ComputeTopOne(in_ptr, range, instance_size, out_ptr);
-      } else {
-        ComputeTopK(in_ptr, indices_ptr, range, instance_size, k, sorted, out_ptr);
+void ComputeTopKByHeap(ep::Stream* stream, const T* in_ptr, int64_t instance_num,
+                       int64_t instance_size, int64_t k, bool sorted, int64_t* out_ptr) {
+  const int64_t num_chunks = GetNumChunks(stream, instance_num, instance_size);
+  const int64_t chunk_size = (instance_size + num_chunks - 1) / num_chunks;
+  std::vector<int64_t> candidates(instance_num * num_chunks * k);
+  std::vector<int64_t> num_candidates(instance_num * num_chunks);
+  ep::CpuStream* cpu_stream = stream->As<ep::CpuStream>();
+  cpu_stream->ParallelFor(
+      0, instance_num * num_chunks,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t task = begin; task < end; ++task) {
+          const int64_t i = task / num_chunks;
+          const int64_t chunk = task % num_chunks;
+          const TopKCompare<T> comp(in_ptr + i * instance_size);
+          num_candidates[task] = HeapSelect(
+              comp, std::min(instance_size, chunk * chunk_size),
+              std::min(instance_size, (chunk + 1) * chunk_size), k, candidates.data() + task * k);
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / chunk_size));
+  cpu_stream->ParallelFor(0, instance_num, [&](int64_t begin, int64_t end) {
+    std::vector<int64_t> merged;
+    for (int64_t i = begin; i < end; ++i) {
+      const TopKCompare<T> comp(in_ptr + i * instance_size);
+      merged.clear();
+      FOR_RANGE(int64_t, chunk, 0, num_chunks) {
+        const int64_t task = i * num_chunks + chunk;
+        merged.insert(merged.end(), candidates.begin() + task * k,
+                      candidates.begin() + task * k + num_candidates[task]);
+      }
+      if (static_cast<int64_t>(merged.size()) > k) {
+        std::nth_element(merged.begin(), merged.begin() + k, merged.end(), comp);
       }
-      bc.Decrease();
-    });
+      if (sorted) { std::sort(merged.begin(), merged.begin() + k, comp); }
+      std::copy(merged.begin(), merged.begin() + k, out_ptr + i * k);
+    }
+  });
+}
+
+template<typename T>
+void ComputeTopK(ep::Stream* stream, const T* in_ptr, int64_t* indices_ptr,
+                 int64_t instance_num, int64_t instance_size, int64_t k, bool sorted,
+                 int64_t* out_ptr) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, instance_num,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          const int64_t offset = i * instance_size;
+          const TopKCompare<T> comp(in_ptr + offset);
+          int64_t* indices_ptr_i = indices_ptr + offset;
+          std::iota(indices_ptr_i, indices_ptr_i + instance_size, 0);
+          std::nth_element(indices_ptr_i, indices_ptr_i + k, indices_ptr_i + instance_size, comp);
+          if (sorted) { std::sort(indices_ptr_i, indices_ptr_i + k, comp); }
+          std::copy(indices_ptr_i, indices_ptr_i + k, out_ptr + i * k);
+        }
+      },
+      std::max<int64_t>(1, kMinElemsPerChunk / instance_size));
+}
+
+template<typename T>
+void CpuTopK(ep::Stream* stream, const T* in_ptr, int64_t* indices_ptr, int64_t instance_num,
+             int64_t instance_size, int64_t k, bool sorted, int64_t* out_ptr) {
+  if (k == 1) {
+    ComputeTopOne(stream, in_ptr, instance_num, instance_size, out_ptr);
+  } else if (k <= kHeapSelectionMaxK) {
+    ComputeTopKByHeap(stream, in_ptr, instance_num, instance_size, k, sorted, out_ptr);
+  } else {
+    ComputeTopK(stream, in_ptr, indices_ptr, instance_num, instance_size, k, sorted, out_ptr);
   }
-  bc.WaitForeverUntilCntEqualZero();
 }
 
 }  // namespace
@@ -105,7 +209,9 @@ class TopKCpuKernel final : public user_op::OpKernel {
                        && (user_op::HobDataType("in", 0) == GetDataType<dtype>::value)) \
       .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                               \
         const Shape& in_shape = ctx->InputShape("in", 0);                               \
-        return ctx->Attr<int32_t>("k") > 1 ? in_shape.elem_cnt() * sizeof(int64_t) : 0; \
+        return ctx->Attr<int32_t>("k") > kHeapSelectionMaxK                             \
+                   ? in_shape.elem_cnt() * sizeof(int64_t)                              \
+                   : 0;                                                                 \
       });
 
 REGISTER_CPU_TOP_K_KERNEL(float)
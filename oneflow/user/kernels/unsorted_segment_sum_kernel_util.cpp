@@ -14,9 +14,37 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/kernels/unsorted_segment_sum_kernel_util.h"
+#include "oneflow/user/kernels/indexed_rows_cpu_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
+namespace {
+
+using indexed_rows::kMinElemsPerChunk;
+using indexed_rows::PrefetchRow;
+
+constexpr int64_t kSegmentSumPrefetchDistance = 8;
+// Bounds the partial rows, and so the temporary memory, of a hot segment.
+constexpr int64_t kMaxPartsPerHotSegment = 64;
+
+// A range of the segment sorted rows which is summed by one task. Rows of a hot segment, one with
+// more rows than a part holds, are split over several parts which sum into their own partial rows.
+struct SegmentSumPart {
+  int64_t begin;
+  int64_t end;
+  int64_t partial;  // index of the partial row, or -1 to sum into the output directly
+};
+
+// A hot segment and the range of partial rows its parts sum into.
+struct HotSegment {
+  int64_t segment;
+  int64_t partial_begin;
+  int64_t partial_end;
+};
+
+}  // namespace
+
 template<typename T, typename K>
 struct UnsortedSegmentSumKernelUtil<DeviceType::kCPU, T, K, T> final {
   static void UnsortedSegmentSum(ep::Stream* stream, const K* segment_ids, const T* data,
@@ -30,18 +58,120 @@ void UnsortedSegmentSumKernelUtil<DeviceType::kCPU, T, K, T>::UnsortedSegmentSum
     ep::Stream* stream, const K* segment_ids, const T* data, int64_t num_segment_ids,
     int64_t num_segments, int64_t outer_dim_size, int64_t inner_dim_size, int64_t segment_id_offset,
     T* out) {
-  FOR_RANGE(int64_t, outer_idx, 0, outer_dim_size) {
-    FOR_RANGE(int64_t, i, 0, num_segment_ids) {
-      CHECK_GE(segment_ids[i], 0);
-      const int64_t idx = segment_ids[i] - segment_id_offset;
-      T* to = out + outer_idx * num_segments * inner_dim_size + idx * inner_dim_size;
-      if (idx >= 0 && idx < num_segments) {
-        const T* from = data + outer_idx * num_segment_ids * inner_dim_size + i * inner_dim_size;
-        std::transform(from, from + inner_dim_size, to, to, std::plus<T>());
+  if (outer_dim_size * num_segment_ids * inner_dim_size < kMinElemsPerChunk) {
+    FOR_RANGE(int64_t, outer_idx, 0, outer_dim_size) {
+      FOR_RANGE(int64_t, i, 0, num_segment_ids) {
+        CHECK_GE(segment_ids[i], 0);
+        const int64_t idx = segment_ids[i] - segment_id_offset;
+        T* to = out + outer_idx * num_segments * inner_dim_size + idx * inner_dim_size;
+        if (idx >= 0 && idx < num_segments) {
+          const T* from = data + outer_idx * num_segment_ids * inner_dim_size + i * inner_dim_size;
+          std::transform(from, from + inner_dim_size, to, to, std::plus<T>());
+        }
       }
     }
+    return;
   }
+  // (segment, i) pairs of the ids inside [0, num_segments), sorted by segment. Rows of a segment
+  // keep their order, so every output row but those of hot segments is summed in the same order
+  // as the serial loop above.
+  std::vector<std::pair<int64_t, int64_t>> segment_rows;
+  segment_rows.reserve(num_segment_ids);
+  FOR_RANGE(int64_t, i, 0, num_segment_ids) {
+    CHECK_GE(segment_ids[i], 0);
+    const int64_t idx = segment_ids[i] - segment_id_offset;
+    if (idx >= 0 && idx < num_segments) { segment_rows.emplace_back(idx, i); }
+  }
+  std::sort(segment_rows.begin(), segment_rows.end());
+  // Whole segments are packed into parts of about kMinElemsPerChunk elements. Each part owns its
+  // output rows, so parts of all outer slices run in parallel without atomics. A hot segment gets
+  // parts of its own that sum into partial rows, which are then added to the output in order. The
+  // split only depends on the shapes, so results do not depend on the number of threads.
+  const int64_t num_rows = segment_rows.size();
+  const int64_t rows_per_part = std::max<int64_t>(1, kMinElemsPerChunk / inner_dim_size);
+  std::vector<SegmentSumPart> parts;
+  std::vector<HotSegment> hot_segments;
+  int64_t num_partials = 0;
+  int64_t part_begin = 0;
+  for (int64_t row = 0; row < num_rows;) {
+    int64_t segment_end = row + 1;
+    while (segment_end < num_rows && segment_rows[segment_end].first == segment_rows[row].first) {
+      ++segment_end;
+    }
+    if (segment_end - row > rows_per_part) {
+      if (part_begin < row) { parts.push_back({part_begin, row, -1}); }
+      HotSegment hot_segment{segment_rows[row].first, num_partials, num_partials};
+      const int64_t hot_rows = segment_end - row;
+      const int64_t num_hot_parts =
+          std::min((hot_rows + rows_per_part - 1) / rows_per_part, kMaxPartsPerHotSegment);
+      const int64_t rows_per_hot_part = (hot_rows + num_hot_parts - 1) / num_hot_parts;
+      for (int64_t begin = row; begin < segment_end; begin += rows_per_hot_part) {
+        parts.push_back({begin, std::min(begin + rows_per_hot_part, segment_end), num_partials});
+        num_partials += 1;
+      }
+      hot_segment.partial_end = num_partials;
+      hot_segments.push_back(hot_segment);
+      part_begin = segment_end;
+    } else if (segment_end - part_begin >= rows_per_part) {
+      parts.push_back({part_begin, segment_end, -1});
+      part_begin = segment_end;
+    }
+    row = segment_end;
+  }
+  if (part_begin < num_rows) { parts.push_back({part_begin, num_rows, -1}); }
+
+  const int64_t num_parts = parts.size();
+  std::vector<T> partials(outer_dim_size * num_partials * inner_dim_size, static_cast<T>(0));
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, outer_dim_size * num_parts,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t task = begin; task < end; ++task) {
+          const int64_t outer_idx = task / num_parts;
+          const SegmentSumPart& part = parts[task % num_parts];
+          const T* outer_data = data + outer_idx * num_segment_ids * inner_dim_size;
+          T* outer_out = out + outer_idx * num_segments * inner_dim_size;
+          T* partial_out = nullptr;
+          if (part.partial >= 0) {
+            partial_out =
+                partials.data() + (outer_idx * num_partials + part.partial) * inner_dim_size;
+          }
+          for (int64_t row = part.begin; row < part.end; ++row) {
+            if (row + kSegmentSumPrefetchDistance < part.end) {
+              const int64_t next_i = segment_rows[row + kSegmentSumPrefetchDistance].second;
+              PrefetchRow(outer_data + next_i * inner_dim_size, inner_dim_size * sizeof(T));
+            }
+            const T* from = outer_data + segment_rows[row].second * inner_dim_size;
+            T* to = partial_out != nullptr ? partial_out
+                                           : outer_out + segment_rows[row].first * inner_dim_size;
+            for (int64_t j = 0; j < inner_dim_size; ++j) { to[j] += from[j]; }
+          }
+        }
+      },
+      1);
+  if (hot_segments.empty()) { return; }
+  // Partial rows are added to the output in part order, in parallel over the columns of every
+  // (outer slice, hot segment) output row.
+  const int64_t num_hot_segments = hot_segments.size();
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, outer_dim_size * num_hot_segments * inner_dim_size,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end;) {
+          const int64_t out_row = i / inner_dim_size;
+          const int64_t col_begin = i % inner_dim_size;
+          const int64_t col_end = std::min(inner_dim_size, col_begin + (end - i));
+          const int64_t outer_idx = out_row / num_hot_segments;
+          const HotSegment& hot_segment = hot_segments[out_row % num_hot_segments];
+          T* to = out + (outer_idx * num_segments + hot_segment.segment) * inner_dim_size;
+          for (int64_t p = hot_segment.partial_begin; p < hot_segment.partial_end; ++p) {
+            const T* from = partials.data() + (outer_idx * num_partials + p) * inner_dim_size;
+            for (int64_t j = col_begin; j < col_end; ++j) { to[j] += from[j]; }
+          }
+          i += col_end - col_begin;
+        }
+      },
+      kMinElemsPerChunk);
 }
+
 #define INITIATE_UNSORTED_SEGMENT_SUM_KERNEL_UTIL_CPU(in_type_pair, index_type_pair)             \
   template struct UnsortedSegmentSumKernelUtil<DeviceType::kCPU, OF_PP_PAIR_FIRST(in_type_pair), \
                                                OF_PP_PAIR_FIRST(index_type_pair),                \
@@ -387,6 +387,69 @@ Maybe<void> FtrlInputArgModifyFn(const user_op::GetInputArgModifier& GetInputArg
   return Maybe<void>::Ok();
 }
 
+Maybe<void> InferMultiTensorUpdateTensorDesc(user_op::InferContext* ctx, bool has_moments) {
+  const int32_t n_tensor = ctx->input_size("model");
+  CHECK_GT_OR_RETURN(n_tensor, 0);
+  CHECK_EQ_OR_RETURN(ctx->input_size("model_diff"), n_tensor);
+  if (has_moments) {
+    CHECK_EQ_OR_RETURN(ctx->input_size("m"), n_tensor);
+    CHECK_EQ_OR_RETURN(ctx->input_size("v"), n_tensor);
+  }
+  FOR_RANGE(int32_t, i, 0, n_tensor) {
+    const user_op::TensorDesc& model = ctx->InputTensorDesc("model", i);
+    const user_op::TensorDesc& model_diff = ctx->InputTensorDesc("model_diff", i);
+    CHECK_EQ_OR_RETURN(model_diff.shape(), model.shape());
+    if (has_moments) {
+      const user_op::TensorDesc& m = ctx->InputTensorDesc("m", i);
+      JUST(CheckShapeLike(&m, &model));
+      const user_op::TensorDesc& v = ctx->InputTensorDesc("v", i);
+      JUST(CheckShapeLike(&v, &model));
+    }
+  }
+  JUST(CheckLearningRateShape(ctx));
+  if (ctx->has_input("scale_by_tensor", 0)) {
+    const auto& scale_by_tensor = ctx->InputTensorDesc("scale_by_tensor", 0);
+    JUST(CheckScalarShape(&scale_by_tensor));
+  }
+  return Maybe<void>::Ok();
+}
+
+// All tensors of a multi tensor update share one data type, the kernels are not mixed precision.
+Maybe<void> InferMultiTensorUpdateDataType(user_op::InferContext* ctx, bool has_moments) {
+  const user_op::TensorDesc& model_0 = ctx->InputTensorDesc("model", 0);
+  FOR_RANGE(int32_t, i, 0, ctx->input_size("model")) {
+    const user_op::TensorDesc& model = ctx->InputTensorDesc("model", i);
+    JUST(CheckDataTypeLike(&model, &model_0));
+    const user_op::TensorDesc& model_diff = ctx->InputTensorDesc("model_diff", i);
+    JUST(CheckDataTypeLike(&model_diff, &model_0));
+    if (has_moments) {
+      const user_op::TensorDesc& m = ctx->InputTensorDesc("m", i);
+      JUST(CheckDataTypeLike(&m, &model_0));
+      const user_op::TensorDesc& v = ctx->InputTensorDesc("v", i);
+      JUST(CheckDataTypeLike(&v, &model_0));
+    }
+  }
+  JUST(CheckLearningRateDataType(ctx));
+  if (ctx->has_input("scale_by_tensor", 0)) {
+    const auto& scale_by_tensor = ctx->InputTensorDesc("scale_by_tensor", 0);
+    JUST(CheckScalarDataType(&scale_by_tensor, model_0.data_type()));
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> MultiTensorInputArgModifyFn(const user_op::GetInputArgModifier& GetInputArgModifierFn,
+                                        const user_op::UserOpConfWrapper& conf,
+                                        bool has_moments) {
+  FOR_RANGE(int32_t, i, 0, conf.input_size("model")) {
+    JUST(SetInputArgModifierMutable(GetInputArgModifierFn, "model", i));
+    if (has_moments) {
+      JUST(SetInputArgModifierMutable(GetInputArgModifierFn, "m", i));
+      JUST(SetInputArgModifierMutable(GetInputArgModifierFn, "v", i));
+    }
+  }
+  return Maybe<void>::Ok();
+}
+
 Maybe<void> InferRmsPropUpdateTensorDesc(user_op::InferContext* ctx) {
   const user_op::TensorDesc& model = ctx->InputTensorDesc("model", 0);
 
@@ -729,6 +792,81 @@ Maybe<void> InferLarsUpdateDataType(user_op::InferContext* ctx) {
   return InferLambUpdateDataType(ctx);
 }
 
+/* static */ Maybe<void> MultiTensorSgdUpdateOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferMultiTensorUpdateTensorDesc(ctx, /*has_moments=*/false);
+}
+
+/*static*/ Maybe<void> MultiTensorSgdUpdateOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> MultiTensorSgdUpdateOp::GetSbp(user_op::SbpContext* ctx) {
+  return user_op::GetSbpFnUtil::DefaultBroadcastToBroadcast(ctx);
+}
+
+/* static */ Maybe<void> MultiTensorSgdUpdateOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper& conf) {
+  return MultiTensorInputArgModifyFn(GetInputArgModifierFn, conf, /*has_moments=*/false);
+}
+
+/* static */ Maybe<void> MultiTensorSgdUpdateOp::InferDataType(user_op::InferContext* ctx) {
+  return InferMultiTensorUpdateDataType(ctx, /*has_moments=*/false);
+}
+
+/* static */ Maybe<void> MultiTensorAdamUpdateOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferMultiTensorUpdateTensorDesc(ctx, /*has_moments=*/true);
+}
+
+/*static*/ Maybe<void> MultiTensorAdamUpdateOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> MultiTensorAdamUpdateOp::GetSbp(user_op::SbpContext* ctx) {
+  return user_op::GetSbpFnUtil::DefaultBroadcastToBroadcast(ctx);
+}
+
+/* static */ Maybe<void> MultiTensorAdamUpdateOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper& conf) {
+  return MultiTensorInputArgModifyFn(GetInputArgModifierFn, conf, /*has_moments=*/true);
+}
+
+/* static */ Maybe<void> MultiTensorAdamUpdateOp::InferDataType(user_op::InferContext* ctx) {
+  return InferMultiTensorUpdateDataType(ctx, /*has_moments=*/true);
+}
+
+/* static */ Maybe<void> MultiTensorLambUpdateOp::InferLogicalTensorDesc(
+    user_op::InferContext* ctx) {
+  const float beta1 = ctx->Attr<float>("beta1");
+  const float beta2 = ctx->Attr<float>("beta2");
+  CHECK_GE_OR_RETURN(beta1, 0);
+  CHECK_LT_OR_RETURN(beta1, 1);
+  CHECK_GE_OR_RETURN(beta2, 0);
+  CHECK_LT_OR_RETURN(beta2, 1);
+  return InferMultiTensorUpdateTensorDesc(ctx, /*has_moments=*/true);
+}
+
+/*static*/ Maybe<void> MultiTensorLambUpdateOp::InferPhysicalTensorDesc(
+    user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> MultiTensorLambUpdateOp::GetSbp(user_op::SbpContext* ctx) {
+  return user_op::GetSbpFnUtil::DefaultBroadcastToBroadcast(ctx);
+}
+
+/* static */ Maybe<void> MultiTensorLambUpdateOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper& conf) {
+  return MultiTensorInputArgModifyFn(GetInputArgModifierFn, conf, /*has_moments=*/true);
+}
+
+/* static */ Maybe<void> MultiTensorLambUpdateOp::InferDataType(user_op::InferContext* ctx) {
+  return InferMultiTensorUpdateDataType(ctx, /*has_moments=*/true);
+}
+
 /* static */ Maybe<void> AdamBiasCorrectionFactorOp::InferLogicalTensorDesc(
     user_op::InferContext* ctx) {
   *ctx->OutputShape("out", 0) = ctx->InputShape("train_step", 0);
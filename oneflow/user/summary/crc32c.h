@@ -18,6 +18,8 @@ limitations under the License.
 
 #include "oneflow/core/common/util.h"
 
+#include <cstring>
+
 namespace oneflow {
 
 namespace summary {
@@ -56,13 +58,48 @@ static const uint32_t table[256] = {
     0xf36e6f75, 0x0105ec76, 0x12551f82, 0xe03e9c81, 0x34f4f86a, 0xc69f7b69, 0xd5cf889d, 0x27a40b9e,
     0x79b737ba, 0x8bdcb4b9, 0x988c474d, 0x6ae7c44e, 0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351};
 
-inline uint32_t GetCrc32(const char* buf, size_t size) {
+inline uint32_t GetCrc32BySoftware(const char* buf, size_t size) {
   const uint8_t* uchar_buf = reinterpret_cast<const uint8_t*>(buf);
   uint32_t crc = 0 ^ 0xffffffffu;
-  for (int i = 0; i < size; ++i) { crc = table[(crc & 0xff) ^ uchar_buf[i]] ^ (crc >> 8); }
+  for (size_t i = 0; i < size; ++i) { crc = table[(crc & 0xff) ^ uchar_buf[i]] ^ (crc >> 8); }
   return crc ^ 0xffffffffu;
 }
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+#define ONEFLOW_SUMMARY_HAS_HARDWARE_CRC32C
+
+// The table above is crc32c (Castagnoli), which is what the sse4.2 crc32 instruction computes.
+__attribute__((target("sse4.2"))) inline uint32_t GetCrc32ByHardware(const char* buf,
+                                                                      size_t size) {
+  uint64_t crc = 0xffffffffu;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t value = 0;
+    memcpy(&value, buf + i, sizeof(value));
+    crc = __builtin_ia32_crc32di(crc, value);
+  }
+  uint32_t crc32 = static_cast<uint32_t>(crc);
+  for (; i < size; ++i) {
+    crc32 = __builtin_ia32_crc32qi(crc32, static_cast<unsigned char>(buf[i]));
+  }
+  return crc32 ^ 0xffffffffu;
+}
+
+inline bool IsHardwareCrc32Supported() {
+  static const bool supported = __builtin_cpu_supports("sse4.2");
+  return supported;
+}
+
+#endif
+
+inline uint32_t GetCrc32(const char* buf, size_t size) {
+#ifdef ONEFLOW_SUMMARY_HAS_HARDWARE_CRC32C
+  if (IsHardwareCrc32Supported()) { return GetCrc32ByHardware(buf, size); }
+#endif
+  return GetCrc32BySoftware(buf, size);
+}
+
 inline uint32_t MaskCrc32(uint32_t crc) { return ((crc >> 15) | (crc << 17)) + 0xa282ead8ul; }
 
 }  // namespace summary
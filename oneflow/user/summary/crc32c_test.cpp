@@ -0,0 +1,46 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/user/summary/crc32c.h"
+
+namespace oneflow {
+
+namespace summary {
+
+namespace test {
+
+TEST(Crc32c, check_value) {
+  const std::string data = "123456789";
+  ASSERT_EQ(GetCrc32BySoftware(data.data(), data.size()), 0xe3069283u);
+  ASSERT_EQ(GetCrc32(data.data(), data.size()), 0xe3069283u);
+}
+
+#ifdef ONEFLOW_SUMMARY_HAS_HARDWARE_CRC32C
+TEST(Crc32c, hardware_matches_software) {
+  if (!IsHardwareCrc32Supported()) { return; }
+  std::string data(1031, '\0');
+  for (size_t i = 0; i < data.size(); ++i) { data[i] = static_cast<char>(i * 31 + 7); }
+  for (size_t size = 0; size <= data.size(); ++size) {
+    ASSERT_EQ(GetCrc32ByHardware(data.data(), size), GetCrc32BySoftware(data.data(), size));
+  }
+}
+#endif
+
+}  // namespace test
+
+}  // namespace summary
+
+}  // namespace oneflow
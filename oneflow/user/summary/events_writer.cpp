@@ -14,24 +14,133 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/summary/events_writer.h"
+#include "oneflow/core/common/env_var/env_var.h"
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/user/summary/env_time.h"
 
 namespace oneflow {
 
+DEFINE_ENV_INTEGER(ONEFLOW_SUMMARY_QUEUE_CAPACITY, 4096);
+DEFINE_ENV_INTEGER(ONEFLOW_SUMMARY_SAMPLE_STRIDE, 10);
+DEFINE_ENV_INTEGER(ONEFLOW_SUMMARY_FLUSH_BYTES, 1024 * 1024);
+DEFINE_ENV_INTEGER(ONEFLOW_SUMMARY_FLUSH_INTERVAL_MS, 10 * 1000);
+
 namespace summary {
 
-EventsWriter::EventsWriter() : is_inited_(false) {}
+namespace {
+
+constexpr size_t kMaxRecordsBytes = 4 * 1024 * 1024;
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value) { result <<= 1; }
+  return result;
+}
+
+QueueFullPolicy GetQueueFullPolicy() {
+  const std::string policy = GetStringFromEnv("ONEFLOW_SUMMARY_QUEUE_FULL_POLICY", "drop");
+  if (policy == "drop") {
+    return QueueFullPolicy::kDrop;
+  } else if (policy == "sample") {
+    return QueueFullPolicy::kSample;
+  } else if (policy == "block") {
+    return QueueFullPolicy::kBlock;
+  } else {
+    LOG(FATAL) << "ONEFLOW_SUMMARY_QUEUE_FULL_POLICY should be drop, sample or block, but got "
+               << policy;
+    return QueueFullPolicy::kDrop;
+  }
+}
+
+}  // namespace
+
+EventQueue::EventQueue(size_t capacity)
+    : mask_(RoundUpToPowerOfTwo(std::max<size_t>(capacity, 2)) - 1),
+      enqueue_pos_(0),
+      dequeue_pos_(0) {
+  slots_.reset(new Slot[mask_ + 1]);
+  for (size_t i = 0; i <= mask_; ++i) { slots_[i].sequence.store(i, std::memory_order_relaxed); }
+}
+
+// A slot is free for position pos when its sequence is pos, and holds an event for position pos
+// when its sequence is pos + 1.
+bool EventQueue::TryPush(std::unique_ptr<Event>* event) {
+  size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    Slot* slot = &slots_[pos & mask_];
+    const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        slot->event = std::move(*event);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool EventQueue::TryPop(std::unique_ptr<Event>* event) {
+  size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    Slot* slot = &slots_[pos & mask_];
+    const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+    if (diff == 0) {
+      if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        *event = std::move(slot->event);
+        slot->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      pos = dequeue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+size_t EventQueue::ApproximateSize() const {
+  const size_t enqueue_pos = enqueue_pos_.load(std::memory_order_relaxed);
+  const size_t dequeue_pos = dequeue_pos_.load(std::memory_order_relaxed);
+  return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+}
+
+EventsWriter::EventsWriter()
+    : is_inited_(false),
+      last_flush_time_(0),
+      queue_full_policy_(GetQueueFullPolicy()),
+      sample_stride_(EnvInteger<ONEFLOW_SUMMARY_SAMPLE_STRIDE>()),
+      flush_bytes_(EnvInteger<ONEFLOW_SUMMARY_FLUSH_BYTES>()),
+      flush_interval_ms_(EnvInteger<ONEFLOW_SUMMARY_FLUSH_INTERVAL_MS>()),
+      event_queue_(EnvInteger<ONEFLOW_SUMMARY_QUEUE_CAPACITY>()),
+      num_appended_events_(0),
+      num_dropped_events_(0),
+      writer_waiting_(false),
+      closing_(false),
+      flush_requested_(0),
+      flush_finished_(0) {
+  CHECK_GT(sample_stride_, 0);
+  CHECK_GT(flush_interval_ms_, 0);
+}
 
 EventsWriter::~EventsWriter() { Close(); }
 
 Maybe<void> EventsWriter::Init(const std::string& logdir) {
+  Close();
   file_system_ = std::make_unique<fs::PosixFileSystem>();
   log_dir_ = logdir + "/event";
   file_system_->RecursivelyCreateDirIfNotExist(log_dir_);
+  filename_.clear();
   JUST(TryToInit());
   is_inited_ = true;
   last_flush_time_ = CurrentMircoTime();
+  closing_ = false;
+  writer_thread_ = std::thread(&EventsWriter::WriterLoop, this);
   return Maybe<void>::Ok();
 }
 
@@ -56,32 +165,123 @@ Maybe<void> EventsWriter::TryToInit() {
     event.set_wall_time(current_time);
     event.set_file_version(FILE_VERSION);
     WriteEvent(event);
-    Flush();
+    FileFlush();
   }
   return Maybe<void>::Ok();
 }
 
 void EventsWriter::AppendQueue(std::unique_ptr<Event> event) {
-  queue_mutex.lock();
-  event_queue_.emplace_back(std::move(event));
-  queue_mutex.unlock();
-  if (event_queue_.size() > MAX_QUEUE_NUM || CurrentMircoTime() - last_flush_time_ > FLUSH_TIME) {
-    Flush();
+  const int64_t index = num_appended_events_++;
+  if (queue_full_policy_ == QueueFullPolicy::kSample
+      && event_queue_.ApproximateSize() * 2 >= event_queue_.capacity()
+      && index % sample_stride_ != 0) {
+    ++num_dropped_events_;
+    return;
+  }
+  while (!event_queue_.TryPush(&event)) {
+    if (queue_full_policy_ != QueueFullPolicy::kBlock) {
+      LOG_FIRST_N(WARNING, 1) << "The summary event queue is full, events are dropped. Set "
+                                 "ONEFLOW_SUMMARY_QUEUE_FULL_POLICY=block to keep all of them.";
+      ++num_dropped_events_;
+      return;
+    }
+    NotifyWriter();
+    std::this_thread::yield();
+  }
+  NotifyWriter();
+}
+
+// Only takes the lock when the writer thread is sleeping on an empty queue. The fence pairs with
+// the one in WriterLoop: either the writer sees the pushed event when it checks the queue, or this
+// sees writer_waiting_ and notifies under the lock, which the writer holds until it waits.
+void EventsWriter::NotifyWriter() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (writer_waiting_.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    writer_cond_.notify_one();
   }
 }
 
 void EventsWriter::Flush() {
-  queue_mutex.lock();
-  for (const std::unique_ptr<Event>& e : event_queue_) { WriteEvent(*e); }
-  event_queue_.clear();
-  queue_mutex.unlock();
-  FileFlush();
-  last_flush_time_ = CurrentMircoTime();
+  if (!is_inited_) { return; }
+  std::unique_lock<std::mutex> lock(writer_mutex_);
+  const int64_t flush_id = ++flush_requested_;
+  writer_cond_.notify_one();
+  flush_cond_.wait(lock, [&]() { return flush_finished_ >= flush_id; });
 }
 
-void EventsWriter::WriteEvent(const Event& event) {
-  std::string event_str;
-  event.AppendToString(&event_str);
+void EventsWriter::WriterLoop() {
+  std::string records;
+  int64_t unflushed_bytes = 0;
+  std::unique_ptr<Event> event;
+  while (true) {
+    int64_t flush_id = 0;
+    size_t flush_target = 0;
+    {
+      std::unique_lock<std::mutex> lock(writer_mutex_);
+      writer_waiting_.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      writer_cond_.wait_for(lock, std::chrono::milliseconds(flush_interval_ms_), [&]() {
+        return event_queue_.ApproximateSize() > 0 || flush_requested_ > flush_finished_
+               || closing_;
+      });
+      writer_waiting_.store(false, std::memory_order_relaxed);
+      flush_id = flush_requested_;
+      // Pushes claimed before the flush request, some of them may still be writing their slot.
+      flush_target = event_queue_.num_claimed_pushes();
+    }
+    const bool closing = closing_;
+    // The events of a batch are encoded into one buffer and written with a single append.
+    while (true) {
+      if (!event_queue_.TryPop(&event)) {
+        if (flush_id > flush_finished_ && event_queue_.num_pops() < flush_target) {
+          std::this_thread::yield();
+          continue;
+        }
+        break;
+      }
+      AppendRecord(*event, &records);
+      event.reset();
+      if (records.size() >= kMaxRecordsBytes) {
+        unflushed_bytes += records.size();
+        WriteRecords(records);
+        records.clear();
+      }
+    }
+    if (!records.empty()) {
+      unflushed_bytes += records.size();
+      WriteRecords(records);
+      records.clear();
+    }
+    const uint64_t now = CurrentMircoTime();
+    if (unflushed_bytes > 0
+        && (unflushed_bytes >= flush_bytes_ || flush_id > flush_finished_ || closing
+            || now - last_flush_time_ >= static_cast<uint64_t>(flush_interval_ms_) * 1000)) {
+      FileFlush();
+      unflushed_bytes = 0;
+      last_flush_time_ = now;
+    }
+    if (flush_id > flush_finished_) {
+      std::lock_guard<std::mutex> lock(writer_mutex_);
+      flush_finished_ = flush_id;
+      flush_cond_.notify_all();
+    }
+    if (closing && event_queue_.ApproximateSize() == 0) { break; }
+  }
+}
+
+void EventsWriter::AppendRecord(const Event& event, std::string* records) {
+  const size_t offset = records->size();
+  const size_t size = event.ByteSizeLong();
+  records->resize(offset + kHeadSize + size + kTailSize);
+  char* head = &(*records)[offset];
+  char* data = head + kHeadSize;
+  event.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(data));
+  EncodeHead(head, size);
+  EncodeTail(data + size, data, size);
+}
+
+void EventsWriter::WriteRecords(const std::string& records) {
   if (!TryToInit().IsOk()) {
     LOG(ERROR) << "Write failed because file could not be opened.";
     return;
@@ -90,15 +290,13 @@ void EventsWriter::WriteEvent(const Event& event) {
     LOG(WARNING) << "Log file is closed!";
     return;
   }
+  writable_file_->Append(records.data(), records.size());
+}
 
-  char head[kHeadSize];
-  char tail[kTailSize];
-  EncodeHead(head, event_str.size());
-  EncodeTail(tail, event_str.data(), event_str.size());
-  writable_file_->Append(head, sizeof(head));
-  writable_file_->Append(event_str.data(), event_str.size());
-  writable_file_->Append(tail, sizeof(tail));
-  FileFlush();
+void EventsWriter::WriteEvent(const Event& event) {
+  std::string records;
+  AppendRecord(event, &records);
+  WriteRecords(records);
 }
 
 void EventsWriter::FileFlush() {
@@ -108,12 +306,21 @@ void EventsWriter::FileFlush() {
 
 void EventsWriter::Close() {
   if (!is_inited_) { return; }
-  queue_mutex.unlock();
-  Flush();
+  {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    closing_ = true;
+    writer_cond_.notify_one();
+  }
+  writer_thread_.join();
   if (writable_file_ != nullptr) {
     writable_file_->Close();
     writable_file_.reset(nullptr);
   }
+  is_inited_ = false;
+  if (num_dropped_events_ > 0) {
+    LOG(WARNING) << num_dropped_events_ << " summary events were dropped because the writer "
+                 << "could not keep up.";
+  }
 }
 
 }  // namespace summary
@@ -22,35 +22,78 @@ limitations under the License.
 #include "oneflow/core/summary/event.pb.h"
 
 #include <time.h>
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
 
 namespace oneflow {
 
 namespace summary {
 
-#define MAX_QUEUE_NUM 10
-#define FLUSH_TIME 3 * 60 * 1000 * 1000
 #define FILE_VERSION "brain.Event:3"
 const size_t kHeadSize = sizeof(uint64_t) + sizeof(uint32_t);
 const size_t kTailSize = sizeof(uint32_t);
 
+// Bounded multi-producer queue of events, the producers never take a lock.
+class EventQueue final {
+ public:
+  explicit EventQueue(size_t capacity);
+  ~EventQueue() = default;
+
+  bool TryPush(std::unique_ptr<Event>* event);
+  bool TryPop(std::unique_ptr<Event>* event);
+  size_t capacity() const { return mask_ + 1; }
+  size_t ApproximateSize() const;
+  // Number of pushes claimed so far, a push may still be writing its slot.
+  size_t num_claimed_pushes() const { return enqueue_pos_.load(std::memory_order_acquire); }
+  size_t num_pops() const { return dequeue_pos_.load(std::memory_order_acquire); }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    std::unique_ptr<Event> event;
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t mask_;
+  alignas(64) std::atomic<size_t> enqueue_pos_;
+  alignas(64) std::atomic<size_t> dequeue_pos_;
+  OF_DISALLOW_COPY_AND_MOVE(EventQueue);
+};
+
+// What AppendQueue does when the writer thread falls behind.
+enum class QueueFullPolicy {
+  kDrop,    // drop the events that do not fit into the queue
+  kSample,  // keep one of every sample_stride events once the queue is half full, then drop
+  kBlock,   // wait for the writer thread, no event is lost
+};
+
+// Events are encoded and written by a dedicated thread. The file is flushed once
+// flush_bytes have been written since the last flush, every flush_interval_ms, and on Flush().
 class EventsWriter {
  public:
   EventsWriter();
   ~EventsWriter();
 
   Maybe<void> Init(const std::string& logdir);
-  void WriteEvent(const Event& event);
+  // Returns after all the events appended before it are written and flushed.
   void Flush();
   void Close();
 
   void AppendQueue(std::unique_ptr<Event> event);
-  void FileFlush();
+  int64_t num_dropped_events() const { return num_dropped_events_; }
 
  private:
   Maybe<void> TryToInit();
+  void WriteEvent(const Event& event);
+  void WriteRecords(const std::string& records);
+  void FileFlush();
+  void WriterLoop();
+  void NotifyWriter();
   inline static void EncodeHead(char* head, size_t size);
   inline static void EncodeTail(char* tail, const char* data, size_t size);
+  static void AppendRecord(const Event& event, std::string* records);
 
   bool is_inited_;
   std::string log_dir_;
@@ -58,8 +101,23 @@ class EventsWriter {
   std::unique_ptr<fs::FileSystem> file_system_;
   std::unique_ptr<fs::WritableFile> writable_file_;
   uint64_t last_flush_time_;
-  std::vector<std::unique_ptr<Event>> event_queue_;
-  std::mutex queue_mutex;
+
+  QueueFullPolicy queue_full_policy_;
+  int64_t sample_stride_;
+  int64_t flush_bytes_;
+  int64_t flush_interval_ms_;
+  EventQueue event_queue_;
+  std::atomic<int64_t> num_appended_events_;
+  std::atomic<int64_t> num_dropped_events_;
+
+  std::thread writer_thread_;
+  std::mutex writer_mutex_;
+  std::condition_variable writer_cond_;
+  std::condition_variable flush_cond_;
+  std::atomic<bool> writer_waiting_;
+  std::atomic<bool> closing_;
+  std::atomic<int64_t> flush_requested_;
+  int64_t flush_finished_;
   OF_DISALLOW_COPY(EventsWriter);
 };
 
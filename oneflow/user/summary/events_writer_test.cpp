@@ -0,0 +1,275 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/user/summary/events_writer.h"
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace oneflow {
+
+namespace summary {
+
+namespace test {
+
+namespace {
+
+class EnvGuard final {
+ public:
+  EnvGuard(const std::string& capacity, const std::string& policy, const std::string& stride) {
+    setenv("ONEFLOW_SUMMARY_QUEUE_CAPACITY", capacity.c_str(), 1);
+    setenv("ONEFLOW_SUMMARY_QUEUE_FULL_POLICY", policy.c_str(), 1);
+    setenv("ONEFLOW_SUMMARY_SAMPLE_STRIDE", stride.c_str(), 1);
+  }
+  ~EnvGuard() {
+    unsetenv("ONEFLOW_SUMMARY_QUEUE_CAPACITY");
+    unsetenv("ONEFLOW_SUMMARY_QUEUE_FULL_POLICY");
+    unsetenv("ONEFLOW_SUMMARY_SAMPLE_STRIDE");
+  }
+};
+
+class TempDir final {
+ public:
+  TempDir() {
+    char path[] = "/tmp/events_writer_test.XXXXXX";
+    CHECK_NOTNULL(mkdtemp(path));
+    path_ = path;
+  }
+  ~TempDir() { RemoveAll(path_); }
+
+  const std::string& path() const { return path_; }
+
+ private:
+  static void RemoveAll(const std::string& path) {
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) {
+      unlink(path.c_str());
+      return;
+    }
+    while (const dirent* entry = readdir(dir)) {
+      const std::string name = entry->d_name;
+      if (name != "." && name != "..") { RemoveAll(path + "/" + name); }
+    }
+    closedir(dir);
+    rmdir(path.c_str());
+  }
+
+  std::string path_;
+};
+
+std::unique_ptr<Event> NewEvent(int64_t step) {
+  auto event = std::make_unique<Event>();
+  event->set_wall_time(0);
+  event->set_step(step);
+  return event;
+}
+
+// Decodes the records of the only event file under logdir and checks their checksums.
+std::vector<Event> ReadEvents(const std::string& logdir) {
+  const std::string event_dir = logdir + "/event";
+  DIR* dir = opendir(event_dir.c_str());
+  CHECK_NOTNULL(dir);
+  std::string filename;
+  while (const dirent* entry = readdir(dir)) {
+    if (std::strncmp(entry->d_name, "event.", 6) == 0) {
+      filename = event_dir + "/" + entry->d_name;
+    }
+  }
+  closedir(dir);
+  std::ifstream file(filename, std::ios::binary);
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  const std::string data = buffer.str();
+
+  std::vector<Event> events;
+  size_t offset = 0;
+  while (offset < data.size()) {
+    CHECK_LE(offset + kHeadSize, data.size());
+    uint64_t size = 0;
+    std::memcpy(&size, data.data() + offset, sizeof(size));
+    uint32_t head_crc = 0;
+    std::memcpy(&head_crc, data.data() + offset + sizeof(size), sizeof(head_crc));
+    CHECK_EQ(head_crc, MaskCrc32(GetCrc32(data.data() + offset, sizeof(size))));
+    const char* body = data.data() + offset + kHeadSize;
+    CHECK_LE(offset + kHeadSize + size + kTailSize, data.size());
+    uint32_t tail_crc = 0;
+    std::memcpy(&tail_crc, body + size, sizeof(tail_crc));
+    CHECK_EQ(tail_crc, MaskCrc32(GetCrc32(body, size)));
+    Event event;
+    CHECK(event.ParseFromArray(body, size));
+    events.emplace_back(event);
+    offset += kHeadSize + size + kTailSize;
+  }
+  return events;
+}
+
+// Steps of the written events, without the file version event.
+std::vector<int64_t> ReadSteps(const std::string& logdir) {
+  const std::vector<Event> events = ReadEvents(logdir);
+  CHECK(!events.empty());
+  CHECK(events.front().has_file_version());
+  std::vector<int64_t> steps;
+  for (size_t i = 1; i < events.size(); ++i) { steps.emplace_back(events.at(i).step()); }
+  return steps;
+}
+
+}  // namespace
+
+TEST(EventQueue, push_and_pop) {
+  EventQueue queue(3);
+  ASSERT_EQ(queue.capacity(), 4);
+  std::unique_ptr<Event> event;
+  ASSERT_FALSE(queue.TryPop(&event));
+  for (int64_t i = 0; i < 4; ++i) {
+    event = NewEvent(i);
+    ASSERT_TRUE(queue.TryPush(&event));
+  }
+  event = NewEvent(4);
+  ASSERT_FALSE(queue.TryPush(&event));
+  ASSERT_EQ(event->step(), 4);
+  ASSERT_EQ(queue.ApproximateSize(), 4);
+  for (int64_t i = 0; i < 4; ++i) {
+    ASSERT_TRUE(queue.TryPop(&event));
+    ASSERT_EQ(event->step(), i);
+  }
+  ASSERT_FALSE(queue.TryPop(&event));
+  ASSERT_EQ(queue.num_claimed_pushes(), 4);
+  ASSERT_EQ(queue.num_pops(), 4);
+}
+
+TEST(EventQueue, multi_producer_multi_consumer) {
+  constexpr int kNumProducers = 4;
+  constexpr int kNumConsumers = 4;
+  constexpr int64_t kEventsPerProducer = 20000;
+  EventQueue queue(64);
+  std::atomic<int64_t> num_popped(0);
+  std::vector<std::vector<int64_t>> popped_steps(kNumConsumers);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < kNumProducers; ++p) {
+    threads.emplace_back([&queue, p]() {
+      for (int64_t i = 0; i < kEventsPerProducer; ++i) {
+        std::unique_ptr<Event> event = NewEvent(p * kEventsPerProducer + i);
+        while (!queue.TryPush(&event)) { std::this_thread::yield(); }
+      }
+    });
+  }
+  for (int c = 0; c < kNumConsumers; ++c) {
+    threads.emplace_back([&, c]() {
+      std::unique_ptr<Event> event;
+      std::vector<int64_t> last_steps(kNumProducers, -1);
+      while (num_popped.load() < kNumProducers * kEventsPerProducer) {
+        if (!queue.TryPop(&event)) {
+          std::this_thread::yield();
+          continue;
+        }
+        num_popped += 1;
+        const int64_t step = event->step();
+        // A consumer sees the events of every producer in push order.
+        const int64_t producer = step / kEventsPerProducer;
+        ASSERT_GT(step, last_steps.at(producer));
+        last_steps.at(producer) = step;
+        popped_steps.at(c).emplace_back(step);
+      }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+
+  std::vector<int64_t> steps;
+  for (const auto& consumer_steps : popped_steps) {
+    steps.insert(steps.end(), consumer_steps.begin(), consumer_steps.end());
+  }
+  std::sort(steps.begin(), steps.end());
+  ASSERT_EQ(steps.size(), kNumProducers * kEventsPerProducer);
+  for (size_t i = 0; i < steps.size(); ++i) { ASSERT_EQ(steps.at(i), i); }
+}
+
+TEST(EventsWriter, flush_writes_all_events_appended_before_it) {
+  EnvGuard env("16", "block", "10");
+  TempDir logdir;
+  EventsWriter writer;
+  ASSERT_TRUE(writer.Init(logdir.path()).IsOk());
+
+  constexpr int kNumProducers = 4;
+  constexpr int64_t kEventsPerProducer = 1000;
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kNumProducers; ++p) {
+    producers.emplace_back([&writer, p]() {
+      for (int64_t i = 0; i < kEventsPerProducer; ++i) {
+        writer.AppendQueue(NewEvent(p * kEventsPerProducer + i));
+      }
+    });
+  }
+  for (auto& producer : producers) { producer.join(); }
+  writer.AppendQueue(NewEvent(kNumProducers * kEventsPerProducer));
+  writer.Flush();
+
+  std::vector<int64_t> steps = ReadSteps(logdir.path());
+  ASSERT_EQ(steps.back(), kNumProducers * kEventsPerProducer);
+  std::sort(steps.begin(), steps.end());
+  ASSERT_EQ(steps.size(), kNumProducers * kEventsPerProducer + 1);
+  for (size_t i = 0; i < steps.size(); ++i) { ASSERT_EQ(steps.at(i), i); }
+  ASSERT_EQ(writer.num_dropped_events(), 0);
+}
+
+// Without Init there is no writer thread, so the queue fills up deterministically.
+TEST(EventsWriter, drop_policy) {
+  EnvGuard env("4", "drop", "10");
+  TempDir logdir;
+  EventsWriter writer;
+  for (int64_t i = 0; i < 10; ++i) { writer.AppendQueue(NewEvent(i)); }
+  ASSERT_EQ(writer.num_dropped_events(), 6);
+  ASSERT_TRUE(writer.Init(logdir.path()).IsOk());
+  writer.Flush();
+  ASSERT_EQ(ReadSteps(logdir.path()), std::vector<int64_t>({0, 1, 2, 3}));
+}
+
+TEST(EventsWriter, sample_policy) {
+  EnvGuard env("8", "sample", "3");
+  TempDir logdir;
+  EventsWriter writer;
+  // Once 4 of the 8 slots are taken, only every third event is kept until the queue is full.
+  for (int64_t i = 0; i < 20; ++i) { writer.AppendQueue(NewEvent(i)); }
+  ASSERT_EQ(writer.num_dropped_events(), 13);
+  ASSERT_TRUE(writer.Init(logdir.path()).IsOk());
+  writer.Flush();
+  ASSERT_EQ(ReadSteps(logdir.path()), std::vector<int64_t>({0, 1, 2, 3, 6, 9, 12}));
+}
+
+TEST(EventsWriter, block_policy) {
+  EnvGuard env("2", "block", "10");
+  TempDir logdir;
+  EventsWriter writer;
+  ASSERT_TRUE(writer.Init(logdir.path()).IsOk());
+  for (int64_t i = 0; i < 1000; ++i) { writer.AppendQueue(NewEvent(i)); }
+  writer.Flush();
+  const std::vector<int64_t> steps = ReadSteps(logdir.path());
+  ASSERT_EQ(steps.size(), 1000);
+  for (size_t i = 0; i < steps.size(); ++i) { ASSERT_EQ(steps.at(i), i); }
+  ASSERT_EQ(writer.num_dropped_events(), 0);
+}
+
+}  // namespace test
+
+}  // namespace summary
+
+}  // namespace oneflow
@@ -15,3 +15,4 @@ limitations under the License.
 """
 from oneflow.framework.config_util import api_enable_fusion as enable_fusion
 from . import nccl
+from . import ccl
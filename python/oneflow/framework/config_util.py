@@ -34,6 +34,18 @@ def _set_attr_to_resource(attr_name, attr_value):
         setattr(sess.config_proto.resource, attr_name, attr_value)
 
 
+def _set_attr_to_collective_boxing_conf(attr_name, attr_value):
+    sess = session_ctx.GetDefaultSession()
+    if sess.status_ == sess.Status.INITED:
+        reso_config = resource_util.Resource()
+        setattr(reso_config.collective_boxing_conf, attr_name, attr_value)
+        sess.update_resource_eagerly(reso_config)
+    else:
+        setattr(
+            sess.config_proto.resource.collective_boxing_conf, attr_name, attr_value
+        )
+
+
 def api_load_library(val: str) -> None:
     """Load necessary library for job
 
@@ -551,6 +563,36 @@ def nccl_enable_mixed_fusion(val):
     sess.config_proto.resource.collective_boxing_conf.nccl_enable_mixed_fusion = val
 
 
+def api_ccl_enable(val: bool) -> None:
+    """Whether or not use ccl collective boxing for cpu placements with one device per process
+
+    Args:
+        val (bool): True or False
+    """
+    assert type(val) is bool
+    _set_attr_to_collective_boxing_conf("ccl_enable", val)
+
+
+def api_ccl_fusion_threshold_mb(val: int) -> None:
+    """Set up threshold for ccl fusion.
+
+    Args:
+        val (int): int number, e.g. 10(mb)
+    """
+    assert type(val) is int
+    _set_attr_to_collective_boxing_conf("ccl_fusion_threshold_mb", val)
+
+
+def api_ccl_fusion_max_ops(val: int) -> None:
+    """Maximum number of ops for ccl fusion.
+
+    Args:
+        val (int): Maximum number of ops
+    """
+    assert type(val) is int
+    _set_attr_to_collective_boxing_conf("ccl_fusion_max_ops", val)
+
+
 @enable_if.condition(hob.in_normal_mode & hob.session_initialized)
 def do_nothing(*args, **kwargs):
     print("This action donot working because session is initialized.", file=sys.stderr)
@@ -110,6 +110,30 @@ class GraphConfig(object):
         """
         self.proto.enable_fuse_model_update_ops = mode
 
+    def enable_multi_tensor_update(self, mode: bool = True):
+        r"""If set to true, try to update the parameters of a CPU graph which share an optimizer configuration with one multi tensor model update op instead of one op per parameter, to improve performance.
+
+        For example:
+
+        .. code-block:: python
+
+            import oneflow as flow
+
+            class Graph(flow.nn.Graph):
+                def __init__(self):
+                    super().__init__()
+                    self.linear = flow.nn.Linear(3, 8, False)
+                    self.config.enable_multi_tensor_update(True)
+                def build(self, x):
+                    return self.linear(x)
+
+            graph = Graph()
+
+        Args:
+            mode (bool, optional): The default vaule is True.
+        """
+        self.proto.enable_multi_tensor_model_update = mode
+
     def allow_fuse_add_to_output(self, mode: bool = True):
         r"""If set to true, try to fuse a binary element-wise add operetor to one of the predecessors to improve performance.
 
@@ -148,7 +148,9 @@ def layer_norm(input, normalized_shape, weight=None, bias=None, eps=1e-05):
                 f"Given normalized_shape={normalized_shape}, expected input with shape [*, {str(normalized_shape)[1:-1]}], but got input of size {input.shape}"
             )
 
-    if not input.is_cuda:
+    # The cpu layer_norm kernels only support float, double and bfloat16.
+    cpu_kernel_dtypes = (flow.float32, flow.float64, flow.bfloat16)
+    if not input.is_cuda and input.dtype not in cpu_kernel_dtypes:
         reduce_axis = []
         for dim in range(len(input.shape)):
             if dim >= begin_norm_axis:
@@ -176,24 +178,24 @@ def layer_norm(input, normalized_shape, weight=None, bias=None, eps=1e-05):
         if elementwise_affine:
             normalized = normalized * weight + bias
         return normalized
+
+    if elementwise_affine:
+        res = flow._C.layer_norm_affine(
+            input,
+            weight,
+            bias,
+            begin_norm_axis=begin_norm_axis,
+            begin_params_axis=begin_params_axis,
+            epsilon=eps,
+        )
     else:
-        if elementwise_affine:
-            res = flow._C.layer_norm_affine(
-                input,
-                weight,
-                bias,
-                begin_norm_axis=begin_norm_axis,
-                begin_params_axis=begin_params_axis,
-                epsilon=eps,
-            )
-        else:
-            res = flow._C.layer_norm(
-                input,
-                begin_norm_axis=begin_norm_axis,
-                begin_params_axis=begin_params_axis,
-                epsilon=eps,
-            )
-        return res
+        res = flow._C.layer_norm(
+            input,
+            begin_norm_axis=begin_norm_axis,
+            begin_params_axis=begin_params_axis,
+            epsilon=eps,
+        )
+    return res
 
 
 class LayerNorm(Module):
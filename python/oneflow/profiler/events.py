@@ -94,11 +94,15 @@ class Event:
 class Events(list):
     def __init__(self, events: str = "") -> None:
         list.__init__([])
+        self.trace_events = []
         if events != "":
             self.__init_events(events)
 
     def __init_events(self, events: str):
         events_json = json.loads(events)
+        if isinstance(events_json, dict):
+            self.trace_events = events_json["traceEvents"]
+            events_json = events_json["events"]
         for event_json in events_json:
             self.append(Event.from_dict(event_json))
 
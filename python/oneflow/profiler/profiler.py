@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 """
+import json
 import oneflow._oneflow_internal
 from enum import Enum
 from typing import Optional, Iterable, Set
@@ -80,6 +81,15 @@ class profile:
         self.__check_finish()
         return self.profile_events
 
+    def export_chrome_trace(self, path: str):
+        """Writes the host ranges of OF_PROFILER_RANGE_PUSH/POP as a Chrome trace, which can be
+        opened by chrome://tracing or Perfetto. The ranges are only recorded when OneFlow is
+        built with BUILD_PROFILER and ProfilerActivity.CPU is profiled.
+        """
+        self.__check_finish()
+        with open(path, "w") as f:
+            json.dump({"traceEvents": self.profile_events.trace_events}, f)
+
 
 class record_function:
     def __init__(self, name: str) -> None:
@@ -126,6 +126,44 @@ def _test_layernorm_backward(test_case, device):
     )
 
 
+def _test_layernorm_bfloat16_cpu(test_case, shape, normalized_shape):
+    # the reference runs in float32 on the bfloat16-rounded inputs
+    def make_inputs(dtype):
+        x = x_bf16.to(dtype).detach().requires_grad_()
+        m = flow.nn.LayerNorm(normalized_shape)
+        m.weight = flow.nn.Parameter(weight_bf16.to(dtype).detach())
+        m.bias = flow.nn.Parameter(bias_bf16.to(dtype).detach())
+        return x, m
+
+    x_bf16 = flow.tensor(np.random.randn(*shape).astype(np.float32)).to(flow.bfloat16)
+    params_shape = tuple(normalized_shape)
+    weight_bf16 = flow.tensor(np.random.randn(*params_shape).astype(np.float32)).to(
+        flow.bfloat16
+    )
+    bias_bf16 = flow.tensor(np.random.randn(*params_shape).astype(np.float32)).to(
+        flow.bfloat16
+    )
+    dy_bf16 = flow.tensor(np.random.randn(*shape).astype(np.float32)).to(flow.bfloat16)
+
+    x, m = make_inputs(flow.bfloat16)
+    y = m(x)
+    y.backward(dy_bf16)
+    x_ref, m_ref = make_inputs(flow.float32)
+    y_ref = m_ref(x_ref)
+    y_ref.backward(dy_bf16.to(flow.float32))
+
+    test_case.assertEqual(y.dtype, flow.bfloat16)
+    for out, ref, atol in [
+        (y, y_ref, 5e-2),
+        (x.grad, x_ref.grad, 5e-2),
+        (m.weight.grad, m_ref.weight.grad, 2e-1),
+        (m.bias.grad, m_ref.bias.grad, 2e-1),
+    ]:
+        test_case.assertTrue(
+            np.allclose(out.to(flow.float32).numpy(), ref.numpy(), 2e-2, atol)
+        )
+
+
 @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
 @flow.unittest.skip_unless_1n1d()
 class TestLayerNorm(flow.unittest.TestCase):
@@ -141,6 +179,10 @@ class TestLayerNorm(flow.unittest.TestCase):
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
 
+    def test_layernorm_bfloat16_cpu(test_case):
+        _test_layernorm_bfloat16_cpu(test_case, (4, 3, 33), (33,))
+        _test_layernorm_bfloat16_cpu(test_case, (2, 8, 5, 67), (5, 67))
+
     @autotest(n=20, auto_backward=True, rtol=1e-3, atol=1e-3)
     def test_layernorm_with_random_data_warp(test_case):
         device = "cuda"
@@ -198,6 +240,25 @@ class TestLayerNorm(flow.unittest.TestCase):
         y = m(x)
         return y
 
+    @autotest(n=10, auto_backward=True, rtol=1e-3, atol=1e-3)
+    def test_layernorm_with_random_data_cpu(test_case):
+        device = "cpu"
+        channel = random(1, 32).to(int)
+        height = random(1, 4).to(int)
+        width = random(1, 4096).to(int)
+
+        def get_random_norm_shape():
+            begin_axis = random(1, 3).to(int).value()
+            return tuple((channel.value(), height.value(), width.value())[begin_axis:])
+
+        m = torch.nn.LayerNorm(
+            normalized_shape=get_random_norm_shape(),
+            elementwise_affine=random().to(bool),
+        ).to(device)
+        x = random_tensor(ndim=4, dim1=channel, dim2=height, dim3=width).to(device)
+        y = m(x)
+        return y
+
     @autotest(n=10, auto_backward=True, rtol=1e-3, atol=1e-3)
     def test_layernorm_without_affine(test_case):
         device = random_device()
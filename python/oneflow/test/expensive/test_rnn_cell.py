@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 """
 import unittest
+import numpy as np
 import oneflow as flow
 
 import oneflow.unittest
@@ -112,5 +113,96 @@ class TestRNN(flow.unittest.TestCase):
         return hx
 
 
+def _clone_params(m):
+    return [p.detach().clone().requires_grad_() for p in m.parameters()]
+
+
+def _unfused_gru_cell(x, h, w_ih, w_hh, b_ih, b_hh):
+    ih = flow.chunk(flow.matmul(x, w_ih.t()) + b_ih, 3, dim=1)
+    hh = flow.chunk(flow.matmul(h, w_hh.t()) + b_hh, 3, dim=1)
+    reset_gate = flow.sigmoid(hh[0] + ih[0])
+    input_gate = flow.sigmoid(hh[1] + ih[1])
+    new_gate = flow.tanh(ih[2] + hh[2] * reset_gate)
+    return (h - new_gate) * input_gate + new_gate
+
+
+def _unfused_lstm_cell(x, h, c, w_ih, w_hh, b_ih, b_hh):
+    gates = flow.matmul(x, w_ih.t()) + b_ih + flow.matmul(h, w_hh.t()) + b_hh
+    in_gate, forget_gate, cell_gate, out_gate = flow.chunk(gates, 4, dim=1)
+    cy = flow.sigmoid(forget_gate) * c + flow.sigmoid(in_gate) * flow.tanh(cell_gate)
+    hy = flow.sigmoid(out_gate) * flow.tanh(cy)
+    return hy, cy
+
+
+def _leaf(shape, dtype):
+    return flow.tensor(
+        np.random.randn(*shape), dtype=dtype, device="cpu", requires_grad=True
+    )
+
+
+def _assert_grads_close(test_case, tensors, ref_tensors, rtol, atol):
+    for tensor, ref_tensor in zip(tensors, ref_tensors):
+        test_case.assertTrue(
+            np.allclose(
+                tensor.grad.numpy(), ref_tensor.grad.numpy(), rtol=rtol, atol=atol
+            )
+        )
+
+
+# Compares the cpu fused_gru_cell and fused_lstm_cell kernels with the unfused ops.
+@flow.unittest.skip_unless_1n1d()
+class TestFusedRNNCellCPU(flow.unittest.TestCase):
+    def test_fused_gru_cell_cpu(test_case):
+        for dtype, tol in [(flow.float32, 1e-4), (flow.float64, 1e-8)]:
+            m = flow.nn.GRUCell(input_size=6, hidden_size=8, dtype=dtype)
+            ref_params = _clone_params(m)
+            x = _leaf((5, 6), dtype)
+            h = _leaf((5, 8), dtype)
+            ref_x = x.detach().clone().requires_grad_()
+            ref_h = h.detach().clone().requires_grad_()
+            y = m(x, h)
+            ref_y = _unfused_gru_cell(ref_x, ref_h, *ref_params)
+            test_case.assertTrue(
+                np.allclose(y.numpy(), ref_y.numpy(), rtol=tol, atol=tol)
+            )
+            y.sum().backward()
+            ref_y.sum().backward()
+            _assert_grads_close(
+                test_case,
+                [x, h, *m.parameters()],
+                [ref_x, ref_h, *ref_params],
+                tol,
+                tol,
+            )
+
+    def test_fused_lstm_cell_cpu(test_case):
+        for dtype, tol in [(flow.float32, 1e-4), (flow.float64, 1e-8)]:
+            m = flow.nn.LSTMCell(input_size=6, hidden_size=8, dtype=dtype)
+            ref_params = _clone_params(m)
+            x = _leaf((5, 6), dtype)
+            h = _leaf((5, 8), dtype)
+            c = _leaf((5, 8), dtype)
+            ref_x, ref_h, ref_c = [
+                t.detach().clone().requires_grad_() for t in [x, h, c]
+            ]
+            hy, cy = m(x, (h, c))
+            ref_hy, ref_cy = _unfused_lstm_cell(ref_x, ref_h, ref_c, *ref_params)
+            test_case.assertTrue(
+                np.allclose(hy.numpy(), ref_hy.numpy(), rtol=tol, atol=tol)
+            )
+            test_case.assertTrue(
+                np.allclose(cy.numpy(), ref_cy.numpy(), rtol=tol, atol=tol)
+            )
+            (hy.sum() + (cy * 2).sum()).backward()
+            (ref_hy.sum() + (ref_cy * 2).sum()).backward()
+            _assert_grads_close(
+                test_case,
+                [x, h, c, *m.parameters()],
+                [ref_x, ref_h, ref_c, *ref_params],
+                tol,
+                tol,
+            )
+
+
 if __name__ == "__main__":
     unittest.main()
@@ -0,0 +1,124 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+import oneflow.core.job.plan_pb2 as plan_pb2
+
+
+def _rank_local(rank, rows=4, scale=1):
+    data = np.arange(rows * 6, dtype=np.float32).reshape(rows, 6)
+    return (data + 100 * rank) * scale
+
+
+def _rank_sum(rows=4, scale=1):
+    return _rank_local(0, rows, scale) + _rank_local(1, rows, scale)
+
+
+def _partial_input(placement, rows=4, scale=1):
+    local = flow.tensor(_rank_local(flow.env.get_rank(), rows, scale))
+    return local.to_global(placement=placement, sbp=flow.sbp.partial_sum)
+
+
+def _split_input(placement, rows=4):
+    rank = flow.env.get_rank()
+    half = rows // 2
+    local = flow.tensor(_rank_sum(rows)[rank * half : (rank + 1) * half])
+    return local.to_global(placement=placement, sbp=flow.sbp.split(0))
+
+
+# Names of the collective boxing requests in the compiled plan of graph.
+def _collective_boxing_op_names(graph):
+    plan = plan_pb2.Plan()
+    plan.ParseFromString(graph._c_nn_graph.plan)
+    job_id2request_set = plan.collective_boxing_plan.job_id2request_set
+    request_set = job_id2request_set[graph._c_nn_graph.job_id]
+    return [request.op_desc.name for request in request_set.request]
+
+
+def _check_ccl_boxing(test_case, graph, op_type, num_ops=1):
+    prefix = "System-Boxing-CclCollectiveBoxing" + op_type + "-"
+    op_names = _collective_boxing_op_names(graph)
+    test_case.assertEqual(len(op_names), num_ops)
+    test_case.assertTrue(all(name.startswith(prefix) for name in op_names))
+
+
+class _CclBoxingGraph(flow.nn.Graph):
+    def __init__(self, boxing_fn):
+        super().__init__()
+        self.boxing_fn = boxing_fn
+        flow.boxing.ccl.enable(True)
+        flow.boxing.ccl.set_fusion_threshold_mbytes(16)
+        flow.boxing.ccl.set_fusion_max_ops_num(8)
+
+    def build(self, *inputs):
+        return self.boxing_fn(*inputs)
+
+
+def _test_p2b(test_case, placement):
+    x = _partial_input(placement)
+    graph = _CclBoxingGraph(lambda x: x.to_global(sbp=flow.sbp.broadcast))
+    y = graph(x)
+    _check_ccl_boxing(test_case, graph, "AllReduce")
+    test_case.assertTrue(np.array_equal(y.to_local().numpy(), _rank_sum()))
+
+
+def _test_p2s(test_case, placement):
+    x = _partial_input(placement)
+    graph = _CclBoxingGraph(lambda x: x.to_global(sbp=flow.sbp.split(0)))
+    y = graph(x)
+    _check_ccl_boxing(test_case, graph, "ReduceScatter")
+    rank = flow.env.get_rank()
+    expected = _rank_sum()[rank * 2 : (rank + 1) * 2]
+    test_case.assertTrue(np.array_equal(y.to_local().numpy(), expected))
+
+
+def _test_s2b(test_case, placement):
+    x = _split_input(placement)
+    graph = _CclBoxingGraph(lambda x: x.to_global(sbp=flow.sbp.broadcast))
+    y = graph(x)
+    _check_ccl_boxing(test_case, graph, "AllGather")
+    test_case.assertTrue(np.array_equal(y.to_local().numpy(), _rank_sum()))
+
+
+def _test_fused_p2b(test_case, placement):
+    # Concurrent all-reduces of different sizes are fused into one request group.
+    inputs = [_partial_input(placement, rows, rows) for rows in [2, 4, 8]]
+    graph = _CclBoxingGraph(
+        lambda *xs: tuple(x.to_global(sbp=flow.sbp.broadcast) for x in xs)
+    )
+    outputs = graph(*inputs)
+    _check_ccl_boxing(test_case, graph, "AllReduce", num_ops=len(inputs))
+    test_case.assertEqual(len(outputs), len(inputs))
+    for rows, y in zip([2, 4, 8], outputs):
+        expected = _rank_sum(rows, rows)
+        test_case.assertTrue(np.array_equal(y.to_local().numpy(), expected))
+
+
+@flow.unittest.skip_unless_1n2d()
+class TestGraphCclBoxing(oneflow.unittest.TestCase):
+    def test_ccl_boxing(test_case):
+        placement = flow.placement("cpu", ranks=[0, 1])
+        _test_p2b(test_case, placement)
+        _test_p2s(test_case, placement)
+        _test_s2b(test_case, placement)
+        _test_fused_p2b(test_case, placement)
+
+
+if __name__ == "__main__":
+    unittest.main()
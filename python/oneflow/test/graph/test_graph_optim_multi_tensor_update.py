@@ -0,0 +1,109 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+from collections import OrderedDict
+import numpy as np
+
+from test_util import GenArgList
+
+import oneflow as flow
+
+
+def train_with_graph(optim_name, init_values, grad_seq, multi_tensor_update):
+    class CustomModule(flow.nn.Module):
+        def __init__(self):
+            super().__init__()
+            self.params = flow.nn.ParameterList(
+                [flow.nn.Parameter(flow.tensor(value)) for value in init_values]
+            )
+
+        def forward(self, masks):
+            return [param * mask for (param, mask) in zip(self.params, masks)]
+
+    simp_module = CustomModule()
+    simp_module.train()
+
+    if optim_name == "sgd":
+        optim = flow.optim.SGD(simp_module.parameters(), lr=0.1, weight_decay=0.01)
+    elif optim_name == "adamw":
+        optim = flow.optim.AdamW(simp_module.parameters(), lr=0.01, weight_decay=0.01)
+    else:
+        optim = flow.optim.LAMB(simp_module.parameters(), lr=0.01, weight_decay=0.01)
+
+    class CustomGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.m = simp_module
+            self.add_optimizer(optim)
+            self.config.enable_multi_tensor_update(multi_tensor_update)
+
+        def build(self, *masks):
+            loss = sum([flow.sum(out) for out in self.m(masks)])
+            loss.backward()
+            return loss
+
+    graph = CustomGraph()
+    for grads in grad_seq:
+        graph(*[flow.tensor(grad) for grad in grads])
+    op_types = [
+        op.user_conf.op_type_name
+        for op in graph._full_graph_proto.net.op
+        if op.HasField("user_conf")
+    ]
+    return [param.numpy() for param in simp_module.params], op_types
+
+
+_op_types = {"sgd": "sgd_update", "adamw": "adam_update", "lamb": "lamb_update"}
+_multi_tensor_op_types = {
+    "sgd": "multi_tensor_sgd_update",
+    "adamw": "multi_tensor_adam_update",
+    "lamb": "multi_tensor_lamb_update",
+}
+
+
+def compare_multi_tensor_update(test_case, optim_name, train_iters):
+    # Small tensors share a chunk, the large one is split over several.
+    shapes = [(3,), (17, 5), (1,), (300, 257), (64,)]
+    init_values = [np.random.uniform(size=shape).astype(np.float32) for shape in shapes]
+    grad_seq = [
+        [np.random.uniform(size=shape).astype(np.float32) for shape in shapes]
+        for _ in range(train_iters)
+    ]
+    expected, op_types = train_with_graph(optim_name, init_values, grad_seq, False)
+    multi_tensor_op_type = _multi_tensor_op_types[optim_name]
+    test_case.assertNotIn(multi_tensor_op_type, op_types)
+    actual, op_types = train_with_graph(optim_name, init_values, grad_seq, True)
+    # All params share one optimizer config, so they are updated by one op.
+    test_case.assertEqual(op_types.count(multi_tensor_op_type), 1)
+    test_case.assertNotIn(_op_types[optim_name], op_types)
+    for (expected_param, actual_param) in zip(expected, actual):
+        test_case.assertTrue(
+            np.allclose(expected_param, actual_param, rtol=1e-4, atol=1e-4)
+        )
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestMultiTensorUpdate(flow.unittest.TestCase):
+    def test_multi_tensor_update(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["optim_name"] = ["sgd", "adamw", "lamb"]
+        arg_dict["train_iters"] = [5]
+        for arg in GenArgList(arg_dict):
+            compare_multi_tensor_update(test_case, *arg)
+
+
+if __name__ == "__main__":
+    unittest.main()
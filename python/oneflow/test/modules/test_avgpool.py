@@ -144,6 +144,12 @@ class TestAvgPoolingFunctional(flow.unittest.TestCase):
             padding=1,
             ceil_mode=True,
         )
+        # resnet stem pooling
+        torch.nn.functional.avg_pool2d(
+            torch.ones(16, 64, 112, 112), kernel_size=3, stride=2, padding=1
+        )
+        # resnet head pooling
+        torch.nn.functional.avg_pool2d(torch.ones(16, 2048, 7, 7), kernel_size=7)
 
 
 if __name__ == "__main__":
@@ -26,6 +26,80 @@ import oneflow as flow
 import oneflow.unittest
 
 
+def _test_batchnorm_cpu(test_case, channels_last, training):
+    eps = 1e-5
+    momentum = 0.1
+    shape = (4, 5, 7, 6) if channels_last else (4, 6, 5, 7)
+    axis = 3 if channels_last else 1
+    reduce_axes = tuple(i for i in range(len(shape)) if i != axis)
+    param_shape = [1] * len(shape)
+    param_shape[axis] = shape[axis]
+
+    x_np = np.random.randn(*shape).astype(np.float32) * 2 + 1
+    dy_np = np.random.randn(*shape).astype(np.float32)
+    gamma_np = np.random.randn(shape[axis]).astype(np.float32)
+    beta_np = np.random.randn(shape[axis]).astype(np.float32)
+    running_mean_np = np.random.randn(shape[axis]).astype(np.float32)
+    running_var_np = np.random.rand(shape[axis]).astype(np.float32) + 0.5
+
+    x = flow.tensor(x_np, requires_grad=True)
+    gamma = flow.tensor(gamma_np, requires_grad=True)
+    beta = flow.tensor(beta_np, requires_grad=True)
+    running_mean = flow.tensor(running_mean_np)
+    running_var = flow.tensor(running_var_np)
+    y = flow._C.normalization(
+        x,
+        running_mean,
+        running_var,
+        gamma,
+        beta,
+        axis=axis,
+        epsilon=eps,
+        momentum=momentum,
+        is_training=training,
+    )
+    y.backward(flow.tensor(dy_np))
+
+    count = x_np.size // shape[axis]
+    if training:
+        mean = x_np.mean(axis=reduce_axes)
+        var = x_np.var(axis=reduce_axes)
+    else:
+        mean = running_mean_np
+        var = running_var_np
+    inv_std = (1.0 / np.sqrt(var + eps)).reshape(param_shape)
+    x_hat = (x_np - mean.reshape(param_shape)) * inv_std
+    y_np = x_hat * gamma_np.reshape(param_shape) + beta_np.reshape(param_shape)
+    beta_grad_np = dy_np.sum(axis=reduce_axes)
+    gamma_grad_np = (dy_np * x_hat).sum(axis=reduce_axes)
+    if training:
+        x_grad_np = (
+            gamma_np.reshape(param_shape)
+            * inv_std
+            / count
+            * (
+                count * dy_np
+                - beta_grad_np.reshape(param_shape)
+                - x_hat * gamma_grad_np.reshape(param_shape)
+            )
+        )
+        running_mean_np = (1 - momentum) * running_mean_np + momentum * mean
+        unbiased_var = var * count / (count - 1)
+        running_var_np = (1 - momentum) * running_var_np + momentum * unbiased_var
+    else:
+        x_grad_np = dy_np * gamma_np.reshape(param_shape) * inv_std
+
+    for out, expected in [
+        (y, y_np),
+        (x.grad, x_grad_np),
+        (gamma.grad, gamma_grad_np),
+        (beta.grad, beta_grad_np),
+        (running_mean, running_mean_np),
+        (running_var, running_var_np),
+    ]:
+        test_case.assertTrue(np.allclose(out.numpy(), expected, rtol=1e-3, atol=1e-3))
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestBatchNormModule(flow.unittest.TestCase):
     @autotest(
@@ -80,6 +154,13 @@ class TestBatchNormModule(flow.unittest.TestCase):
         y = m(x)
         return y
 
+    def test_batchnorm_cpu_nchw_and_nhwc(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["channels_last"] = [False, True]
+        arg_dict["training"] = [True, False]
+        for arg in GenArgList(arg_dict):
+            _test_batchnorm_cpu(test_case, *arg)
+
 
 if __name__ == "__main__":
     unittest.main()
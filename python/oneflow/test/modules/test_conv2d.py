@@ -1562,6 +1562,44 @@ def _test_conv2d_large_out_channel(test_case, device):
     test_case.assertTrue(np.allclose(input.grad.numpy(), np_grad, 1e-3, 1e-3))
 
 
+def _conv2d_im2col_reference(x, weight, padding, groups):
+    # channels_last always runs im2col on cpu, and its filter grad only supports
+    # groups == 1, so grouped convs are computed one group at a time.
+    xs = flow.split(x, x.shape[1] // groups, dim=1)
+    ws = flow.split(weight, weight.shape[0] // groups, dim=0)
+    outs = []
+    for x_g, w_g in zip(xs, ws):
+        y_g = flow._C.conv2d(
+            x_g.permute(0, 2, 3, 1),
+            w_g.permute(0, 2, 3, 1),
+            padding=padding,
+            channel_pos="channels_last",
+        )
+        outs.append(y_g.permute(0, 3, 1, 2))
+    return flow.cat(outs, dim=1)
+
+
+def _test_conv2d_cpu_algo(test_case, in_channels, out_channels, groups):
+    x_np = np.random.randn(2, in_channels, 10, 9).astype(np.float32)
+    w_np = np.random.randn(out_channels, in_channels // groups, 3, 3)
+    x = flow.tensor(x_np, requires_grad=True)
+    w = flow.tensor(w_np, dtype=flow.float32, requires_grad=True)
+    y = flow._C.conv2d(x, w, padding=1, groups=groups)
+    x_ref = flow.tensor(x_np, requires_grad=True)
+    w_ref = flow.tensor(w_np, dtype=flow.float32, requires_grad=True)
+    y_ref = _conv2d_im2col_reference(x_ref, w_ref, 1, groups)
+    test_case.assertTrue(np.allclose(y.numpy(), y_ref.numpy(), rtol=1e-3, atol=1e-3))
+    dy = flow.tensor(np.random.randn(*y.shape).astype(np.float32))
+    y.backward(dy)
+    y_ref.backward(dy)
+    test_case.assertTrue(
+        np.allclose(x.grad.numpy(), x_ref.grad.numpy(), rtol=1e-3, atol=1e-3)
+    )
+    test_case.assertTrue(
+        np.allclose(w.grad.numpy(), w_ref.grad.numpy(), rtol=1e-3, atol=1e-3)
+    )
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestConv2d(flow.unittest.TestCase):
     def test_conv2d_default_init(test_case):
@@ -1830,6 +1868,14 @@ class TestConv2d(flow.unittest.TestCase):
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
 
+    def test_conv2d_cpu_winograd(test_case):
+        # 3x3, stride 1 and at least 16 input/output channels selects winograd
+        _test_conv2d_cpu_algo(test_case, 16, 32, 1)
+
+    def test_conv2d_cpu_depthwise_direct(test_case):
+        # one filter per input channel selects the direct kernel
+        _test_conv2d_cpu_algo(test_case, 8, 8, 8)
+
     @autotest()
     def test_conv2d_with_random_data(test_case):
         channels = random(1, 6)
@@ -25,21 +25,20 @@ import oneflow as flow
 import oneflow.unittest
 
 
-def _test_fused_bias_add_dropout(test_case, shape, axis, drop_prob):
+def _test_fused_bias_add_dropout(test_case, shape, axis, drop_prob, device):
     x = np.random.randn(*shape)
     bias = np.random.randn(shape[axis])
-    # fused version only support in GPU
-    fused_x_tensor = flow.Tensor(x).to("cuda")
+    fused_x_tensor = flow.Tensor(x).to(device)
     fused_x_tensor.requires_grad = True
-    fused_bias_tensor = flow.Tensor(bias).to("cuda")
+    fused_bias_tensor = flow.Tensor(bias).to(device)
     fused_bias_tensor.requires_grad = True
     fused_out = flow._C.fused_bias_add_dropout(
         fused_x_tensor, fused_bias_tensor, p=drop_prob, axis=axis
     )
 
-    origin_x_tensor = flow.Tensor(x).to("cuda")
+    origin_x_tensor = flow.Tensor(x).to(device)
     origin_x_tensor.requires_grad = True
-    origin_bias_tensor = flow.Tensor(bias).to("cuda")
+    origin_bias_tensor = flow.Tensor(bias).to(device)
     origin_bias_tensor.requires_grad = True
 
     origin_dropout = flow.nn.Dropout(p=drop_prob)
@@ -80,6 +79,22 @@ class TestFusedBiasAddDropout(flow.unittest.TestCase):
         arg_dict["shape"] = [(16, 64, 72), (32, 16, 48)]
         arg_dict["axis"] = [0, 1, 2, -1, -2, -3]
         arg_dict["drop_prob"] = [0.0, 1.0]
+        arg_dict["device"] = ["cuda"]
+
+        for arg in GenArgList(arg_dict):
+            arg[0](test_case, *arg[1:])
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestFusedBiasAddDropoutCpu(flow.unittest.TestCase):
+    def test_fuse_bias_add_dropout(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["test_fun"] = [_test_fused_bias_add_dropout]
+        arg_dict["shape"] = [(16, 64, 72), (32, 16, 48)]
+        arg_dict["axis"] = [0, 1, 2, -1, -2, -3]
+        arg_dict["drop_prob"] = [0.0, 1.0]
+        arg_dict["device"] = ["cpu"]
+
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
 
@@ -19,27 +19,27 @@ from collections import OrderedDict
 import os
 
 import numpy as np
+from oneflow.test_utils.automated_test_util import *
 from oneflow.test_utils.test_util import GenArgList
 
 import oneflow as flow
 import oneflow.unittest
 
 
-def _test_fused_bias_add_gelu(test_case, channel, axis):
+def _test_fused_bias_add_gelu(test_case, channel, axis, device):
     x = np.random.randn(4, channel, 8, 10)
     bias = np.random.randn(channel)
-    # fused version only support in GPU
-    fused_x_tensor = flow.Tensor(x).to("cuda")
+    fused_x_tensor = flow.Tensor(x).to(device)
     fused_x_tensor.requires_grad = True
-    fused_bias_tensor = flow.Tensor(bias).to("cuda")
+    fused_bias_tensor = flow.Tensor(bias).to(device)
     fused_bias_tensor.requires_grad = True
     fused_out = flow._C.fused_bias_add_gelu(
         fused_x_tensor, fused_bias_tensor, axis=axis
     )
 
-    origin_x_tensor = flow.Tensor(x).to("cuda")
+    origin_x_tensor = flow.Tensor(x).to(device)
     origin_x_tensor.requires_grad = True
-    origin_bias_tensor = flow.Tensor(bias).to("cuda")
+    origin_bias_tensor = flow.Tensor(bias).to(device)
     origin_bias_tensor.requires_grad = True
     origin_out = flow.gelu(
         flow._C.bias_add(origin_x_tensor, origin_bias_tensor, axis=axis)
@@ -69,6 +69,30 @@ def _test_fused_bias_add_gelu(test_case, channel, axis):
     )
 
 
+def _make_bias_add_gelu(module):
+    def bias_add_gelu(x, bias):
+        return module.nn.functional.gelu(x + bias)
+
+    return bias_add_gelu
+
+
+# The fused op and its unfused op sequence, both against the op sequence in PyTorch.
+def _fused_bias_add_gelu():
+    return GetDualObject(
+        "fused_bias_add_gelu",
+        _make_bias_add_gelu(torch_original),
+        lambda x, bias: flow._C.fused_bias_add_gelu(x, bias, axis=2),
+    )
+
+
+def _unfused_bias_add_gelu():
+    return GetDualObject(
+        "unfused_bias_add_gelu",
+        _make_bias_add_gelu(torch_original),
+        _make_bias_add_gelu(flow),
+    )
+
+
 @flow.unittest.skip_unless_1n1d()
 @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test gpu cases")
 class TestFusedBiasAddGelu(flow.unittest.TestCase):
@@ -77,10 +101,37 @@ class TestFusedBiasAddGelu(flow.unittest.TestCase):
         arg_dict["test_fun"] = [_test_fused_bias_add_gelu]
         arg_dict["channel"] = [2, 4, 6, 8]
         arg_dict["axis"] = [1]
+        arg_dict["device"] = ["cuda"]
 
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
 
 
+@flow.unittest.skip_unless_1n1d()
+class TestFusedBiasAddGeluCpu(flow.unittest.TestCase):
+    def test_gather(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["test_fun"] = [_test_fused_bias_add_gelu]
+        arg_dict["channel"] = [2, 4, 6, 8]
+        arg_dict["axis"] = [1]
+        arg_dict["device"] = ["cpu"]
+
+        for arg in GenArgList(arg_dict):
+            arg[0](test_case, *arg[1:])
+
+    # BERT-base intermediate layer: 128 tokens, 3072 hidden units
+    @profile(_fused_bias_add_gelu())
+    def profile_fused_bias_add_gelu(test_case):
+        for batch_size in [1, 8]:
+            _fused_bias_add_gelu()(torch.ones(batch_size, 128, 3072), torch.ones(3072))
+
+    @profile(_unfused_bias_add_gelu())
+    def profile_unfused_bias_add_gelu(test_case):
+        for batch_size in [1, 8]:
+            _unfused_bias_add_gelu()(
+                torch.ones(batch_size, 128, 3072), torch.ones(3072)
+            )
+
+
 if __name__ == "__main__":
     unittest.main()
@@ -19,6 +19,7 @@ from collections import OrderedDict
 import os
 
 import numpy as np
+from oneflow.test_utils.automated_test_util import *
 from oneflow.test_utils.test_util import GenArgList
 
 import oneflow as flow
@@ -26,7 +27,7 @@ import oneflow.unittest
 
 
 def _test_fused_scale_mask_softmax(
-    test_case, batch_size, num_heads, seq_length, fill_value, scale_value,
+    test_case, batch_size, num_heads, seq_length, fill_value, scale_value, device
 ):
 
     x = np.random.randn(batch_size, num_heads, seq_length, seq_length)
@@ -34,16 +35,16 @@ def _test_fused_scale_mask_softmax(
         0, 2, size=(batch_size, num_heads, seq_length, seq_length), dtype=np.bool
     )
 
-    fused_x_tensor = flow.tensor(x).to("cuda")
-    fused_mask_tensor = flow.tensor(mask, dtype=flow.bool).to("cuda")
+    fused_x_tensor = flow.tensor(x).to(device)
+    fused_mask_tensor = flow.tensor(mask, dtype=flow.bool).to(device)
     fused_x_tensor.requires_grad = True
 
     fused_out = flow._C.fused_scale_mask_softmax(
         fused_x_tensor, fused_mask_tensor, fill_value=fill_value, scale=scale_value,
     )
 
-    origin_x_tensor = flow.tensor(x).to("cuda")
-    origin_mask_tensor = flow.tensor(mask, dtype=flow.float32).to("cuda")
+    origin_x_tensor = flow.tensor(x).to(device)
+    origin_mask_tensor = flow.tensor(mask, dtype=flow.float32).to(device)
     origin_x_tensor.requires_grad = True
     origin_out = flow.mul(
         origin_x_tensor, origin_mask_tensor
@@ -66,6 +67,39 @@ def _test_fused_scale_mask_softmax(
     )
 
 
+def _make_scale_mask_softmax(module):
+    def scale_mask_softmax(x, mask):
+        y = module.masked_fill(x * 0.125, module.logical_not(mask), -10000.0)
+        return module.softmax(y, dim=-1)
+
+    return scale_mask_softmax
+
+
+# The fused op and its unfused op sequence, both against the op sequence in PyTorch.
+def _fused_scale_mask_softmax():
+    return GetDualObject(
+        "fused_scale_mask_softmax",
+        _make_scale_mask_softmax(torch_original),
+        lambda x, mask: flow._C.fused_scale_mask_softmax(
+            x, mask, fill_value=-10000.0, scale=0.125
+        ),
+    )
+
+
+def _unfused_scale_mask_softmax():
+    return GetDualObject(
+        "unfused_scale_mask_softmax",
+        _make_scale_mask_softmax(torch_original),
+        _make_scale_mask_softmax(flow),
+    )
+
+
+def _bert_attention_inputs(batch_size):
+    # BERT-base attention scores: 12 heads over 128 tokens
+    shape = (batch_size, 12, 128, 128)
+    return torch.ones(*shape), torch.tensor(np.random.rand(*shape) > 0.1)
+
+
 @flow.unittest.skip_unless_1n1d()
 @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test gpu cases")
 class TestFusedScaleMaskSoftmax(flow.unittest.TestCase):
@@ -77,10 +111,37 @@ class TestFusedScaleMaskSoftmax(flow.unittest.TestCase):
         args_dict["seq_length"] = [16, 32, 64]
         args_dict["fill_value"] = [-10000.0]
         args_dict["scale_value"] = [1.0, 2.0, 4.0]
+        args_dict["device"] = ["cuda"]
 
         for arg in GenArgList(args_dict):
             arg[0](test_case, *arg[1:])
 
 
+@flow.unittest.skip_unless_1n1d()
+class TestFusedScaleMaskSoftmaxCpu(flow.unittest.TestCase):
+    def test_fused_op(test_case):
+        args_dict = OrderedDict()
+        args_dict["test_fun"] = [_test_fused_scale_mask_softmax]
+        args_dict["batch_size"] = [4, 8]
+        args_dict["num_heads"] = [1, 4]
+        args_dict["seq_length"] = [16, 33]
+        args_dict["fill_value"] = [-10000.0]
+        args_dict["scale_value"] = [1.0, 2.0]
+        args_dict["device"] = ["cpu"]
+
+        for arg in GenArgList(args_dict):
+            arg[0](test_case, *arg[1:])
+
+    @profile(_fused_scale_mask_softmax())
+    def profile_fused_scale_mask_softmax(test_case):
+        for batch_size in [1, 8]:
+            _fused_scale_mask_softmax()(*_bert_attention_inputs(batch_size))
+
+    @profile(_unfused_scale_mask_softmax())
+    def profile_unfused_scale_mask_softmax(test_case):
+        for batch_size in [1, 8]:
+            _unfused_scale_mask_softmax()(*_bert_attention_inputs(batch_size))
+
+
 if __name__ == "__main__":
     unittest.main()
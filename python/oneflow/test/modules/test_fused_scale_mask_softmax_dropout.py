@@ -20,6 +20,7 @@ from collections import OrderedDict
 import os
 
 import numpy as np
+from oneflow.test_utils.automated_test_util import *
 from oneflow.test_utils.test_util import GenArgList
 
 import oneflow as flow
@@ -27,15 +28,15 @@ import oneflow.unittest
 
 
 def _test_fused_scale_mask_softmax_dropout(
-    test_case, batch_size, num_heads, seq_length, fill_value, scale_value, p
+    test_case, batch_size, num_heads, seq_length, fill_value, scale_value, p, device
 ):
     x = np.random.randn(batch_size, num_heads, seq_length, seq_length)
     mask = np.random.randint(
         0, 2, size=(batch_size, num_heads, seq_length, seq_length), dtype=np.bool
     )
 
-    fused_x_tensor = flow.tensor(x).to("cuda")
-    fused_mask_tensor = flow.tensor(mask, dtype=flow.bool).to("cuda")
+    fused_x_tensor = flow.tensor(x).to(device)
+    fused_mask_tensor = flow.tensor(mask, dtype=flow.bool).to(device)
     fused_x_tensor.requires_grad = True
 
     # if mask is zero, fill it
@@ -47,8 +48,8 @@ def _test_fused_scale_mask_softmax_dropout(
         p=p,
     )[0]
 
-    origin_x_tensor = flow.tensor(x).to("cuda")
-    origin_mask_tensor = flow.tensor(mask, dtype=flow.float32).to("cuda")
+    origin_x_tensor = flow.tensor(x).to(device)
+    origin_mask_tensor = flow.tensor(mask, dtype=flow.float32).to(device)
     origin_x_tensor.requires_grad = True
     origin_out = flow.mul(
         origin_x_tensor, origin_mask_tensor
@@ -72,6 +73,39 @@ def _test_fused_scale_mask_softmax_dropout(
     )
 
 
+def _make_scale_mask_softmax_dropout(module):
+    def scale_mask_softmax_dropout(x, mask):
+        y = module.masked_fill(x * 0.125, module.logical_not(mask), -10000.0)
+        return module.nn.functional.dropout(module.softmax(y, dim=-1), p=0.1)
+
+    return scale_mask_softmax_dropout
+
+
+# The fused op and its unfused op sequence, both against the op sequence in PyTorch.
+def _fused_scale_mask_softmax_dropout():
+    return GetDualObject(
+        "fused_scale_mask_softmax_dropout",
+        _make_scale_mask_softmax_dropout(torch_original),
+        lambda x, mask: flow._C.fused_scale_mask_softmax_dropout(
+            x, mask, fill_value=-10000.0, scale=0.125, p=0.1
+        )[0],
+    )
+
+
+def _unfused_scale_mask_softmax_dropout():
+    return GetDualObject(
+        "unfused_scale_mask_softmax_dropout",
+        _make_scale_mask_softmax_dropout(torch_original),
+        _make_scale_mask_softmax_dropout(flow),
+    )
+
+
+def _bert_attention_inputs(batch_size):
+    # BERT-base attention scores: 12 heads over 128 tokens
+    shape = (batch_size, 12, 128, 128)
+    return torch.ones(*shape), torch.tensor(np.random.rand(*shape) > 0.1)
+
+
 @flow.unittest.skip_unless_1n1d()
 @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test gpu cases")
 class TestFusedScaleMaskSoftmaxDropout(flow.unittest.TestCase):
@@ -84,10 +118,38 @@ class TestFusedScaleMaskSoftmaxDropout(flow.unittest.TestCase):
         args_dict["fill_value"] = [-10000.0]
         args_dict["scale_value"] = [1.0, 2.0, 4.0]
         args_dict["p"] = [0.0, 1.0]
+        args_dict["device"] = ["cuda"]
+
+        for arg in GenArgList(args_dict):
+            arg[0](test_case, *arg[1:])
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestFusedScaleMaskSoftmaxDropoutCpu(flow.unittest.TestCase):
+    def test_fused_op(test_case):
+        args_dict = OrderedDict()
+        args_dict["test_fun"] = [_test_fused_scale_mask_softmax_dropout]
+        args_dict["batch_size"] = [4, 8]
+        args_dict["num_heads"] = [1, 4]
+        args_dict["seq_length"] = [8, 33]
+        args_dict["fill_value"] = [-10000.0]
+        args_dict["scale_value"] = [1.0, 2.0]
+        args_dict["p"] = [0.0, 1.0]
+        args_dict["device"] = ["cpu"]
 
         for arg in GenArgList(args_dict):
             arg[0](test_case, *arg[1:])
 
+    @profile(_fused_scale_mask_softmax_dropout())
+    def profile_fused_scale_mask_softmax_dropout(test_case):
+        for batch_size in [1, 8]:
+            _fused_scale_mask_softmax_dropout()(*_bert_attention_inputs(batch_size))
+
+    @profile(_unfused_scale_mask_softmax_dropout())
+    def profile_unfused_scale_mask_softmax_dropout(test_case):
+        for batch_size in [1, 8]:
+            _unfused_scale_mask_softmax_dropout()(*_bert_attention_inputs(batch_size))
+
 
 if __name__ == "__main__":
     unittest.main()
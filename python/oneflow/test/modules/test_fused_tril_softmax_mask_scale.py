@@ -19,6 +19,7 @@ from collections import OrderedDict
 import os
 
 import numpy as np
+from oneflow.test_utils.automated_test_util import *
 from oneflow.test_utils.test_util import GenArgList
 
 import oneflow as flow
@@ -26,11 +27,10 @@ import oneflow.unittest
 
 
 def _test_fused_tril_softmax_mask_scale(
-    test_case, seq_length, channel, p, diagonal, tril_scale_value
+    test_case, seq_length, channel, p, diagonal, tril_scale_value, device
 ):
     x = np.random.randn(4, seq_length, channel)
-    # fused version only support in GPU
-    fused_x_tensor = flow.Tensor(x).to("cuda")
+    fused_x_tensor = flow.Tensor(x).to(device)
     fused_x_tensor.requires_grad = True
     fused_out = flow._C.fused_scale_tril_softmax_mask_scale(
         fused_x_tensor, p=p, diagonal=diagonal, tril_scale_value=tril_scale_value
@@ -38,7 +38,7 @@ def _test_fused_tril_softmax_mask_scale(
         0
     ]  # The second output is softmax_y
 
-    origin_x_tensor = flow.Tensor(x).to("cuda")
+    origin_x_tensor = flow.Tensor(x).to(device)
     origin_x_tensor.requires_grad = True
     origin_out = flow.tril(origin_x_tensor, diagonal)
     origin_out = origin_out * tril_scale_value
@@ -61,6 +61,33 @@ def _test_fused_tril_softmax_mask_scale(
     )
 
 
+def _make_tril_softmax_dropout(module):
+    def tril_softmax_dropout(x):
+        y = module.softmax(module.tril(x, 0) * 0.125, dim=-1)
+        return module.nn.functional.dropout(y, p=0.1)
+
+    return tril_softmax_dropout
+
+
+# The fused op and its unfused op sequence, both against the op sequence in PyTorch.
+def _fused_tril_softmax_dropout():
+    return GetDualObject(
+        "fused_tril_softmax_dropout",
+        _make_tril_softmax_dropout(torch_original),
+        lambda x: flow._C.fused_scale_tril_softmax_mask_scale(
+            x, p=0.1, diagonal=0, tril_scale_value=0.125
+        )[0],
+    )
+
+
+def _unfused_tril_softmax_dropout():
+    return GetDualObject(
+        "unfused_tril_softmax_dropout",
+        _make_tril_softmax_dropout(torch_original),
+        _make_tril_softmax_dropout(flow),
+    )
+
+
 @flow.unittest.skip_unless_1n1d()
 @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test gpu cases")
 class TestFusedTrilSoftmaxMaskScale(flow.unittest.TestCase):
@@ -72,10 +99,38 @@ class TestFusedTrilSoftmaxMaskScale(flow.unittest.TestCase):
         arg_dict["p"] = [0.0, 1.0]
         arg_dict["diagonal"] = [0, 1, 2]
         arg_dict["tril_scale_value"] = [2, 4, 10]
+        arg_dict["device"] = ["cuda"]
 
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
 
 
+@flow.unittest.skip_unless_1n1d()
+class TestFusedTrilSoftmaxMaskScaleCpu(flow.unittest.TestCase):
+    def test_fused_tril_softmax_dropout(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["test_fun"] = [_test_fused_tril_softmax_mask_scale]
+        arg_dict["seq_length"] = [10, 20]
+        arg_dict["channel"] = [20, 30]
+        arg_dict["p"] = [0.0, 1.0]
+        arg_dict["diagonal"] = [0, 1, 2]
+        arg_dict["tril_scale_value"] = [2, 4, 10]
+        arg_dict["device"] = ["cpu"]
+
+        for arg in GenArgList(arg_dict):
+            arg[0](test_case, *arg[1:])
+
+    # BERT-base attention scores: 12 heads over 128 tokens, heads folded into the batch
+    @profile(_fused_tril_softmax_dropout())
+    def profile_fused_tril_softmax_dropout(test_case):
+        for batch_size in [1, 8]:
+            _fused_tril_softmax_dropout()(torch.ones(batch_size * 12, 128, 128))
+
+    @profile(_unfused_tril_softmax_dropout())
+    def profile_unfused_tril_softmax_dropout(test_case):
+        for batch_size in [1, 8]:
+            _unfused_tril_softmax_dropout()(torch.ones(batch_size * 12, 128, 128))
+
+
 if __name__ == "__main__":
     unittest.main()
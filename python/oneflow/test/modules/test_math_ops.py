@@ -306,6 +306,19 @@ class TestTopk(flow.unittest.TestCase):
         )
         return y[0], y[1]
 
+    @autotest(n=5, auto_backward=False)
+    def test_flow_topk_with_few_large_instances(test_case):
+        device = random_device()
+        x = random_tensor(ndim=2, dim0=2, dim1=random(65536, 200000)).to(device)
+        y = torch.topk(
+            x,
+            random(low=1, high=200).to(int),
+            dim=1,
+            largest=random_bool(),
+            sorted=constant(True),
+        )
+        return y[0], y[1]
+
 
 @flow.unittest.skip_unless_1n1d()
 class TestPow(flow.unittest.TestCase):
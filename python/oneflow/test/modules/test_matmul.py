@@ -15,6 +15,8 @@ limitations under the License.
 """
 import unittest
 
+import numpy as np
+
 import oneflow as flow
 import oneflow.unittest
 
@@ -49,6 +51,63 @@ class TestModule(flow.unittest.TestCase):
         y = random_tensor(ndim=2, dim0=k).to(device)
         return x.matmul(y)
 
+    def test_flow_cpu_half_matmul(test_case):
+        for (transpose_a, transpose_b) in [
+            (False, False),
+            (True, False),
+            (False, True),
+        ]:
+            a = np.random.uniform(-1, 1, size=(2, 3, 70, 33)).astype(np.float16)
+            b = np.random.uniform(-1, 1, size=(33, 17)).astype(np.float16)
+            if transpose_a:
+                a = np.ascontiguousarray(np.swapaxes(a, -1, -2))
+            if transpose_b:
+                b = np.ascontiguousarray(b.T)
+            x = flow.tensor(a, dtype=flow.float16, device="cpu")
+            y = flow.tensor(b, dtype=flow.float16, device="cpu")
+            z = flow.matmul(
+                x.transpose(-1, -2) if transpose_a else x,
+                y.transpose(-1, -2) if transpose_b else y,
+            )
+            a = np.swapaxes(a, -1, -2) if transpose_a else a
+            b = b.T if transpose_b else b
+            expected = np.matmul(a.astype(np.float32), b.astype(np.float32))
+            test_case.assertEqual(z.dtype, flow.float16)
+            test_case.assertTrue(
+                np.allclose(
+                    z.numpy().astype(np.float32), expected, rtol=1e-2, atol=1e-2
+                )
+            )
+
+    def test_flow_cpu_bfloat16_matmul(test_case):
+        for (transpose_a, transpose_b) in [
+            (False, False),
+            (True, False),
+            (False, True),
+        ]:
+            a = np.random.uniform(-1, 1, size=(2, 3, 70, 33)).astype(np.float32)
+            b = np.random.uniform(-1, 1, size=(33, 17)).astype(np.float32)
+            if transpose_a:
+                a = np.ascontiguousarray(np.swapaxes(a, -1, -2))
+            if transpose_b:
+                b = np.ascontiguousarray(b.T)
+            x = flow.tensor(a, device="cpu").to(flow.bfloat16)
+            y = flow.tensor(b, device="cpu").to(flow.bfloat16)
+            z = flow.matmul(
+                x.transpose(-1, -2) if transpose_a else x,
+                y.transpose(-1, -2) if transpose_b else y,
+            )
+            # the reference uses the bfloat16-rounded inputs and float32 accumulation
+            a = x.to(flow.float32).numpy()
+            b = y.to(flow.float32).numpy()
+            a = np.swapaxes(a, -1, -2) if transpose_a else a
+            b = b.T if transpose_b else b
+            expected = np.matmul(a, b)
+            test_case.assertEqual(z.dtype, flow.bfloat16)
+            test_case.assertTrue(
+                np.allclose(z.to(flow.float32).numpy(), expected, rtol=1e-2, atol=2e-2)
+            )
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -31,7 +31,7 @@ def _test_maxpool2d_channel_last(
 ):
     os.environ["ONEFLOW_ENABLE_NHWC"] = "1"
     arr = np.random.randn(*shape)
-    x1 = flow.tensor(arr, dtype=flow.float64, device=device)
+    x1 = flow.tensor(arr, dtype=flow.float64, device=device, requires_grad=True)
     m1 = flow.nn.MaxPool2d(
         kernel_size=kernel_size,
         stride=stride,
@@ -41,7 +41,12 @@ def _test_maxpool2d_channel_last(
     )
     y1 = m1(x1)
 
-    x2 = pytorch.tensor(arr.transpose(0, 3, 1, 2), dtype=pytorch.float64, device=device)
+    x2 = pytorch.tensor(
+        arr.transpose(0, 3, 1, 2),
+        dtype=pytorch.float64,
+        device=device,
+        requires_grad=True,
+    )
     m2 = pytorch.nn.MaxPool2d(
         kernel_size=kernel_size,
         stride=stride,
@@ -53,6 +58,16 @@ def _test_maxpool2d_channel_last(
     test_case.assertTrue(
         np.allclose(y1.detach().cpu().numpy(), y2.detach().cpu().numpy(), 1e-4, 1e-4)
     )
+    y1.sum().backward()
+    y2.sum().backward()
+    test_case.assertTrue(
+        np.allclose(
+            x1.grad.cpu().numpy(),
+            x2.grad.permute(0, 2, 3, 1).cpu().numpy(),
+            1e-4,
+            1e-4,
+        )
+    )
     os.environ["ONEFLOW_ENABLE_NHWC"] = "0"
 
 
@@ -132,6 +147,20 @@ class TestMaxPooling(flow.unittest.TestCase):
         else:
             return y
 
+    @autotest(n=5, auto_backward=True, check_graph=True)
+    def test_maxpool2d_with_large_kernel(test_case):
+        m = torch.nn.MaxPool2d(
+            kernel_size=random(5, 10).to(_size_2_t),
+            stride=random(1, 3).to(_size_2_t),
+            padding=random(0, 3).to(_size_2_t),
+            ceil_mode=random(),
+        )
+        m.train(random())
+        device = random_device()
+        m.to(device)
+        x = random_tensor(ndim=4, dim2=random(20, 40), dim3=random(20, 40)).to(device)
+        return m(x)
+
     def test_maxpool2d_channel_last(test_case):
         arg_dict = OrderedDict()
         arg_dict["test_fun"] = [_test_maxpool2d_channel_last]
@@ -240,6 +269,10 @@ class TestMaxPoolingFunctional(flow.unittest.TestCase):
             padding=1,
             ceil_mode=True,
         )
+        # resnet stem pooling
+        torch.nn.functional.max_pool2d(
+            torch.ones(16, 64, 112, 112), kernel_size=3, stride=2, padding=1
+        )
         # torch.nn.functional.max_pool2d(torch.ones(16, 128, 28, 28), kernel_size=3, dilation=2, padding=2)
 
 
@@ -77,6 +77,17 @@ class TestSort(flow.unittest.TestCase):
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
 
+    def test_sort_few_large_instances(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["test_fun"] = [_test_sort]
+        arg_dict["data_shape"] = [(2, 150000), (150000,)]
+        arg_dict["axis"] = [-1]
+        arg_dict["descending"] = [True, False]
+        arg_dict["data_type"] = ["float32", "double"]
+        arg_dict["device"] = ["cpu", "cuda"]
+        for arg in GenArgList(arg_dict):
+            arg[0](test_case, *arg[1:])
+
     @autotest(n=5, auto_backward=False, check_graph=True)
     def test_sort_with_random_data(test_case):
         device = random_device()
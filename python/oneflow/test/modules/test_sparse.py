@@ -18,6 +18,7 @@ import unittest
 from collections import OrderedDict
 
 import numpy as np
+from oneflow.test_utils.automated_test_util import *
 from oneflow.test_utils.test_util import GenArgList
 
 import oneflow as flow
@@ -147,6 +148,47 @@ def _test_embedding_functional_impl(test_case, device):
     test_case.assertTrue(np.allclose(weight.grad.numpy(), weight_grad_np, 1e-05, 1e-05))
 
 
+def _test_embedding_zipf_indices(test_case, device):
+    # Zipf distributed ids: a few hot rows and a long tail, like real embedding lookups
+    num_embeddings, embedding_dim = 5000, 64
+    weight = np.random.randn(num_embeddings, embedding_dim).astype(np.float32)
+    indices = (np.random.zipf(1.2, size=(64, 128)) - 1) % num_embeddings
+    m = flow.nn.Embedding(num_embeddings, embedding_dim, _weight=flow.Tensor(weight))
+    m = m.to(device)
+    y = m(flow.tensor(indices, dtype=flow.int64, device=flow.device(device)))
+    test_case.assertTrue(np.allclose(y.numpy(), weight[indices], 1e-05, 1e-05))
+    dy = np.random.randn(*y.shape).astype(np.float32)
+    (y * flow.tensor(dy, device=flow.device(device))).sum().backward()
+    weight_grad_np = np.zeros_like(weight)
+    np.add.at(weight_grad_np, indices.flatten(), dy.reshape(-1, embedding_dim))
+    test_case.assertTrue(
+        np.allclose(m.weight.grad.numpy(), weight_grad_np, 1e-04, 1e-04)
+    )
+
+
+def _zipf_indices(num_embeddings, size):
+    return torch.tensor((np.random.zipf(1.2, size=size) - 1) % num_embeddings)
+
+
+def _make_embedding_backward(module):
+    def embedding_backward(weight, indices, dy):
+        weight = weight.detach().requires_grad_()
+        y = module.nn.functional.embedding(indices, weight)
+        return module.autograd.grad(y, weight, dy)[0]
+
+    return embedding_backward
+
+
+# The weight grad of embedding is the unsorted_segment_sum_like of dy, eager mode
+# only reaches it through autograd.
+def _embedding_backward():
+    return GetDualObject(
+        "embedding_backward",
+        _make_embedding_backward(torch_original),
+        _make_embedding_backward(flow),
+    )
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestEmbedding(flow.unittest.TestCase):
     def test_embedding(test_case):
@@ -155,6 +197,26 @@ class TestEmbedding(flow.unittest.TestCase):
         for arg in GenArgList(arg_dict):
             _test_embedding_impl(test_case, *arg)
             _test_embedding_functional_impl(test_case, *arg)
+            _test_embedding_zipf_indices(test_case, *arg)
+
+    @profile(torch.nn.functional.embedding)
+    def profile_embedding(test_case):
+        # gather of zipf distributed ids: a few hot rows and a long tail
+        weight = torch.ones(50000, 128)
+        torch.nn.functional.embedding(_zipf_indices(50000, (64, 128)), weight)
+        torch.nn.functional.embedding(_zipf_indices(50000, (256, 128)), weight)
+
+    @profile(_embedding_backward())
+    def profile_embedding_backward(test_case):
+        # unsorted_segment_sum of zipf distributed ids, a few hot segments get most rows
+        weight = torch.ones(50000, 128)
+        for batch_size in [64, 256]:
+            _embedding_backward()(
+                weight,
+                _zipf_indices(50000, (batch_size, 128)),
+                torch.ones(batch_size, 128, 128),
+                profile_description="forward and backward",
+            )
 
 
 if __name__ == "__main__":
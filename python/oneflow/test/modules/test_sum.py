@@ -69,6 +69,29 @@ def _test_sum_impl(test_case, device, data_type):
     test_case.assertTrue(np.allclose(input.numpy(), of_out.numpy(), 1e-05, 1e-05))
 
 
+def _test_sum_reduce_patterns(test_case, device):
+    # scalar, row, column and xz reductions large enough to be split across threads
+    cases = [
+        ((1 << 20,), None),
+        ((64, 4099), 1),
+        ((3, 1 << 18), 1),
+        ((4099, 64), 0),
+        ((1 << 16, 3), 0),
+        ((16, 32, 1025), (0, 2)),
+        ((2049, 2, 7), (0, 2)),
+    ]
+    for shape, dim in cases:
+        np_input = np.random.randn(*shape).astype(np.float32)
+        input = flow.tensor(np_input, device=flow.device(device))
+        np_input = np_input.astype(np.float64)
+        of_sum = flow.sum(input) if dim is None else flow.sum(input, dim=dim)
+        of_max = input.amax(dim=dim)
+        np_sum = np.sum(np_input, axis=dim)
+        np_max = np.amax(np_input, axis=dim)
+        test_case.assertTrue(np.allclose(of_sum.numpy(), np_sum, 1e-05, 1e-04))
+        test_case.assertTrue(np.allclose(of_max.numpy(), np_max, 1e-05, 1e-05))
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestSumModule(flow.unittest.TestCase):
     def test_sum(test_case):
@@ -78,6 +101,12 @@ class TestSumModule(flow.unittest.TestCase):
         for arg in GenArgList(arg_dict):
             _test_sum_impl(test_case, *arg)
 
+    def test_sum_reduce_patterns(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["device"] = ["cpu", "cuda"]
+        for arg in GenArgList(arg_dict):
+            _test_sum_reduce_patterns(test_case, *arg)
+
     @autotest(check_graph=True)
     def test_sum_against_pytorch(test_case):
         device = random_device()
@@ -99,6 +128,14 @@ class TestSumModule(flow.unittest.TestCase):
         y = torch.sum(x)
         return y
 
+    @profile(torch.sum)
+    def profile_sum(test_case):
+        # scalar, row, column and xz (per-channel of NCHW) reductions
+        torch.sum(torch.ones(4194304))
+        torch.sum(torch.ones(4096, 1024), dim=1)
+        torch.sum(torch.ones(4096, 1024), dim=0)
+        torch.sum(torch.ones(16, 256, 56, 56), dim=(0, 2, 3))
+
 
 if __name__ == "__main__":
     unittest.main()
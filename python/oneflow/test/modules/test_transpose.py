@@ -129,6 +129,17 @@ class TestTranspose(flow.unittest.TestCase):
         y = torch.transpose(x, dim0=random(1, 3).to(int), dim1=random(1, 3).to(int))
         return y
 
+    @profile(torch.permute)
+    def profile_permute(test_case):
+        # NCHW to NHWC and back
+        torch.permute(torch.ones(16, 64, 56, 56), (0, 2, 3, 1))
+        torch.permute(torch.ones(16, 56, 56, 64), (0, 3, 1, 2))
+        # attention head split and merge of (batch, seq, heads, head_dim)
+        torch.permute(torch.ones(32, 128, 12, 64), (0, 2, 1, 3))
+        torch.permute(torch.ones(32, 12, 128, 64), (0, 2, 1, 3))
+        # 2-D transpose
+        torch.permute(torch.ones(2048, 2048), (1, 0))
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -66,6 +66,28 @@ class TestEventAndEvents(flow.unittest.TestCase):
         test_case.assertEqual(Events(events_json), events)
         test_case.assertEqual(Events(events_json).key_averages(), events_avg)
 
+    def test_events_with_trace_events(test_case):
+        trace_events = [
+            {"name": "R:test", "ph": "X", "pid": 0, "tid": 1, "ts": 0.5, "dur": 2.0}
+        ]
+        events_json = json.dumps(
+            {
+                "events": [
+                    {
+                        "name": "test",
+                        "time": 1234,
+                        "on_gpu": False,
+                        "input_shapes": "-",
+                        "type": 0,
+                    }
+                ],
+                "traceEvents": trace_events,
+            }
+        )
+        events = Events(events_json)
+        test_case.assertEqual(events, [Event("test", 1234, False, -1, 1, "-", 0)])
+        test_case.assertEqual(events.trace_events, trace_events)
+
 
 if __name__ == "__main__":
     unittest.main()